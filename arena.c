@@ -0,0 +1,164 @@
+/*
+ * arena.c - Arena ("bump") allocation for names and query scratch space
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Bump allocation: round the offset up, hand out a pointer, add
+ *    the size - no header per allocation and nothing to search
+ * 2. Alignment with _Alignof(max_align_t) (C11)
+ * 3. Overflow checks before size arithmetic (count * size, rounding)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "arena.h"
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+/* ============================================================
+ * FUNCTION: arena_init
+ * ============================================================
+ */
+void arena_init(Arena *a, size_t block_size) {
+    memset(a, 0, sizeof(*a));
+    a->block_size = block_size;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: new_block
+ * ============================================================
+ * Puts a block of at least `size` bytes in front of the list. The
+ * rest of the previous block is not used again until a reset.
+ */
+static ArenaBlock *new_block(Arena *a, size_t size) {
+    size_t block_size = a->block_size ? a->block_size : ARENA_BLOCK_SIZE;
+    ArenaBlock *block;
+
+    if (size < block_size) {
+        size = block_size;
+    }
+    if (size > SIZE_MAX - sizeof(ArenaBlock)) {
+        return NULL;
+    }
+    block = malloc(sizeof(ArenaBlock) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = a->blocks;
+    block->used = 0;
+    block->size = size;
+    a->blocks = block;
+    a->mallocs++;
+    return block;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: take
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - (used + align - 1) & ~(align - 1) rounds up to a multiple of a
+ *   power of two
+ * - A fresh block starts at data[], which is already aligned
+ */
+static void *take(Arena *a, size_t size, size_t align) {
+    ArenaBlock *block = a->blocks;
+    size_t start = 0;
+
+    if (block != NULL) {
+        start = (block->used + align - 1) & ~(align - 1);
+    }
+    if (block == NULL || start > block->size || block->size - start < size) {
+        block = new_block(a, size);
+        if (block == NULL) {
+            return NULL;
+        }
+        start = 0;
+    }
+    block->used = start + size;
+    a->used += size;
+    return (char *)block->data + start;
+}
+
+/* ============================================================
+ * FUNCTIONS: arena_alloc / arena_calloc / arena_strndup
+ * ============================================================
+ */
+void *arena_alloc(Arena *a, size_t size) {
+    return take(a, size, ARENA_ALIGN);
+}
+
+void *arena_calloc(Arena *a, size_t count, size_t size) {
+    void *p;
+
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    p = take(a, count * size, ARENA_ALIGN);
+    if (p != NULL) {
+        memset(p, 0, count * size);
+    }
+    return p;
+}
+
+char *arena_strndup(Arena *a, const char *str, size_t len) {
+    char *copy;
+
+    if (len == SIZE_MAX) {
+        return NULL;
+    }
+    copy = take(a, len + 1, 1);
+    if (copy != NULL) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+/* ============================================================
+ * FUNCTION: arena_reset
+ * ============================================================
+ * One block: just rewind it. Several: the next round would need them
+ * all again, so trade them for one block of the same total size
+ * (if that malloc() fails the arena simply starts empty).
+ */
+void arena_reset(Arena *a) {
+    ArenaBlock *block = a->blocks;
+    size_t total = 0;
+
+    a->used = 0;
+    if (block == NULL) {
+        return;
+    }
+    if (block->next == NULL) {
+        block->used = 0;
+        return;
+    }
+
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        total += block->size;
+        free(block);
+        block = next;
+    }
+    a->blocks = NULL;
+    if (new_block(a, total) != NULL) {
+        a->block_size = total;
+    }
+}
+
+/* ============================================================
+ * FUNCTION: arena_free
+ * ============================================================
+ */
+void arena_free(Arena *a) {
+    ArenaBlock *block = a->blocks;
+
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    a->blocks = NULL;
+    a->used = 0;
+}
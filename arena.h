@@ -0,0 +1,102 @@
+/*
+ * arena.h - Arena ("bump") allocation for names and query scratch space
+ *
+ * This file contains:
+ * - The Arena structure (a list of big blocks)
+ * - Functions to allocate from an arena, and to reset or free it at once
+ *
+ * Learning Concepts:
+ * - Allocation as a pointer bump: no per-object header, no free list
+ * - Freeing many objects at once: everything allocated from an arena
+ *   lives until arena_reset() or arena_free()
+ * - Reset-and-reuse: after a reset the arena keeps one block big
+ *   enough for everything the last round used, so a program that
+ *   repeats the same work stops calling malloc() after the first round
+ *
+ * Typical use:
+ *   Arena a;
+ *   arena_init(&a, 0);
+ *   for (each query) {
+ *       char *name = arena_strndup(&a, rec.player, rec.player_len);
+ *       int *counts = arena_calloc(&a, teams, sizeof(int));
+ *       ...
+ *       arena_reset(&a);       (name and counts are gone)
+ *   }
+ *   arena_free(&a);
+ *
+ * An arena is not thread-safe; give each thread its own.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* ========== CONSTANTS ========== */
+#define ARENA_BLOCK_SIZE (64 * 1024)   /* default block size */
+
+/* ========== TYPES ========== */
+
+/* One block; allocations are carved from data[] front to back */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+    max_align_t data[];          /* max_align_t: data[] is aligned for anything */
+} ArenaBlock;
+
+/*
+ * A zeroed Arena is empty and ready to use, with ARENA_BLOCK_SIZE
+ * blocks.
+ */
+typedef struct {
+    ArenaBlock *blocks;          /* newest block first */
+    size_t block_size;           /* size of the next block (0 = ARENA_BLOCK_SIZE) */
+    size_t used;                 /* bytes handed out since the last reset */
+    size_t mallocs;              /* blocks allocated so far */
+} Arena;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * arena_init
+ *
+ * An empty arena whose blocks are block_size bytes (0 = ARENA_BLOCK_SIZE).
+ * Allocates nothing until the first arena_alloc().
+ */
+void arena_init(Arena *a, size_t block_size);
+
+/*
+ * arena_alloc / arena_calloc
+ *
+ * size bytes (count * size, zeroed), aligned for any type.
+ * Returns NULL when out of memory.
+ */
+void *arena_alloc(Arena *a, size_t size);
+void *arena_calloc(Arena *a, size_t count, size_t size);
+
+/*
+ * arena_strndup
+ *
+ * A null-terminated copy of the len bytes at str (no alignment, so
+ * names are packed back to back). Returns NULL when out of memory.
+ */
+char *arena_strndup(Arena *a, const char *str, size_t len);
+
+/*
+ * arena_reset
+ *
+ * Forgets every allocation but keeps the memory. If the last round
+ * needed several blocks, they are replaced by one block of their
+ * combined size.
+ */
+void arena_reset(Arena *a);
+
+/*
+ * arena_free
+ *
+ * Returns every block to the system; the arena is empty afterwards.
+ */
+void arena_free(Arena *a);
+
+#endif /* ARENA_H */
@@ -0,0 +1,459 @@
+/*
+ * checkpoint.c - Resume queries on a growing game log
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Saving a scan's state with the byte offset it reached
+ * 2. Validating a cache against its source: device and inode, size,
+ *    line boundary and a hash of the bytes the state was built from
+ * 3. Atomic replacement: readers see the old file or the new one,
+ *    never half of one
+ * 4. Leaving a line that may still be being written out of the
+ *    checkpoint
+ */
+
+/* Needed for 64-bit file offsets with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "hw2.h"
+#include "encoding.h"
+#include "record_reader.h"
+#include "query_plan.h"
+#include "checkpoint.h"
+
+/* Entry field offsets (see the layout in checkpoint.h) */
+#define ENTRY_KIND      0
+#define ENTRY_OFFSET    8
+#define ENTRY_CHECKSUM  16
+#define ENTRY_MATCH     24
+#define ENTRY_IN_MATCH  44
+#define ENTRY_VALUES    48
+#define ENTRY_TEAM      144
+#define ENTRY_PLAYER    208
+#define ENTRY_DEVICE    272
+#define ENTRY_INODE     280
+#define ENTRY_LINE      288
+
+/* ========== TYPES ========== */
+
+/* Where a checkpoint stands in its data file */
+typedef struct {
+    long long offset;
+    uint64_t checksum;
+    uint64_t device, inode;
+    long line;                   /* line number at offset */
+} Mark;
+
+/* The entries of a checkpoint file, as read from disk */
+typedef struct {
+    unsigned char *data;         /* entry_count * CHECKPOINT_ENTRY_SIZE bytes */
+    size_t count;
+} EntryList;
+
+/* ============================================================
+ * HELPER FUNCTION: prefix_checksum
+ * ============================================================
+ * Hash of the first len bytes of a mapped file, 8 bytes at a time.
+ *
+ * LEARNING POINTS:
+ * - Hashing is many times faster than parsing, so checking the
+ *   whole prefix still leaves the resume worth it
+ * - Past CHECKPOINT_MAX_BLOCKS blocks, every stride-th block is
+ *   hashed instead, so the check costs at most 256 MiB of reading
+ *   however large the log grows; the last block is always included
+ */
+static uint64_t hash_bytes(uint64_t h, const char *p, size_t len) {
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ word) * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 29;
+    }
+    for (; i < len; i++) {
+        h = (h ^ (unsigned char)p[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t prefix_checksum(const char *base, uint64_t len) {
+    uint64_t blocks = (len + CHECKPOINT_BLOCK - 1) / CHECKPOINT_BLOCK;
+    uint64_t stride = (blocks + CHECKPOINT_MAX_BLOCKS - 1) / CHECKPOINT_MAX_BLOCKS;
+    uint64_t h = 14695981039346656037ull ^ len;
+
+    if (stride == 0) {
+        return h;
+    }
+    for (uint64_t b = 0; b < blocks; b += stride) {
+        uint64_t start = b * CHECKPOINT_BLOCK;
+        h = hash_bytes(h, base + start, len - start < CHECKPOINT_BLOCK ? (size_t)(len - start) : CHECKPOINT_BLOCK);
+    }
+    if ((blocks - 1) % stride != 0) {
+        uint64_t start = (blocks - 1) * CHECKPOINT_BLOCK;
+        h = hash_bytes(h, base + start, (size_t)(len - start));
+    }
+    return h;
+}
+
+/* in_file + suffix (caller frees) */
+static char *path_with_suffix(const char *in_file, const char *suffix) {
+    size_t len = strlen(in_file);
+    size_t suffix_len = strlen(suffix);
+    char *path = malloc(len + suffix_len + 1);
+
+    if (path != NULL) {
+        memcpy(path, in_file, len);
+        memcpy(path + len, suffix, suffix_len + 1);
+    }
+    return path;
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: Entries
+ * ============================================================
+ */
+
+/* Does entry belong to query q of a plan with this team? */
+static int entry_matches(const unsigned char *entry, const Query *q,
+                         const char *team, size_t team_len) {
+    const char *player = q->kind == QUERY_BEST_MONTH ? "" : q->player_name;
+    size_t player_len = q->kind == QUERY_BEST_MONTH ? 0 : q->player_len;
+
+    return get_le(entry + ENTRY_KIND, 4) == (uint64_t)q->kind &&
+           memcmp(entry + ENTRY_TEAM, team, team_len) == 0 &&
+           entry[ENTRY_TEAM + team_len] == '\0' &&
+           memcmp(entry + ENTRY_PLAYER, player, player_len) == 0 &&
+           entry[ENTRY_PLAYER + player_len] == '\0';
+}
+
+static const unsigned char *find_entry(const EntryList *list, const Query *q,
+                                       const char *team, size_t team_len) {
+    for (size_t i = 0; i < list->count; i++) {
+        const unsigned char *entry = list->data + i * CHECKPOINT_ENTRY_SIZE;
+        if (entry_matches(entry, q, team, team_len)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void encode_entry(unsigned char *entry, const Query *q, const char *team,
+                         size_t team_len, const Mark *mark, const QuerySnapshot *snap) {
+    const MatchState *m = &snap->match;
+    int match[5] = { m->year, m->month, m->day, m->home_score, m->opponent_score };
+
+    memset(entry, 0, CHECKPOINT_ENTRY_SIZE);
+    put_le(entry + ENTRY_KIND, (uint64_t)q->kind, 4);
+    put_le(entry + ENTRY_OFFSET, (uint64_t)mark->offset, 8);
+    put_le(entry + ENTRY_CHECKSUM, mark->checksum, 8);
+    put_le(entry + ENTRY_DEVICE, mark->device, 8);
+    put_le(entry + ENTRY_INODE, mark->inode, 8);
+    put_le(entry + ENTRY_LINE, (uint64_t)mark->line, 8);
+    for (int i = 0; i < 5; i++) {
+        put_le(entry + ENTRY_MATCH + 4 * i, (uint32_t)match[i], 4);
+    }
+    put_le(entry + ENTRY_IN_MATCH, (uint32_t)snap->in_match, 4);
+    for (int i = 0; i < 24; i++) {
+        put_le(entry + ENTRY_VALUES + 4 * i, (uint32_t)snap->values[i], 4);
+    }
+    memcpy(entry + ENTRY_TEAM, team, team_len);
+    if (q->kind != QUERY_BEST_MONTH) {
+        memcpy(entry + ENTRY_PLAYER, q->player_name, q->player_len);
+    }
+}
+
+static void decode_entry(const unsigned char *entry, QuerySnapshot *snap) {
+    int match[5];
+
+    for (int i = 0; i < 5; i++) {
+        match[i] = (int32_t)(uint32_t)get_le(entry + ENTRY_MATCH + 4 * i, 4);
+    }
+    snap->match.year = match[0];
+    snap->match.month = match[1];
+    snap->match.day = match[2];
+    snap->match.game = 0;        /* checkpointed scans read the file in order */
+    snap->match.home_score = match[3];
+    snap->match.opponent_score = match[4];
+    snap->in_match = (int32_t)(uint32_t)get_le(entry + ENTRY_IN_MATCH, 4);
+    for (int i = 0; i < 24; i++) {
+        snap->values[i] = (int32_t)(uint32_t)get_le(entry + ENTRY_VALUES + 4 * i, 4);
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: load_entries
+ * ============================================================
+ * Reads every entry of a checkpoint file. A missing or damaged file
+ * gives an empty list (the caller then scans from the start).
+ */
+static void load_entries(const char *path, EntryList *list) {
+    unsigned char header[CHECKPOINT_HEADER_SIZE];
+    FILE *fp = fopen(path, "rb");
+    uint64_t count;
+
+    list->data = NULL;
+    list->count = 0;
+    if (fp == NULL) {
+        return;
+    }
+
+    if (fread(header, 1, sizeof(header), fp) == sizeof(header) &&
+        memcmp(header, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN) == 0 &&
+        get_le(header + 8, 4) == CHECKPOINT_VERSION) {
+        count = get_le(header + 12, 4);
+        list->data = count > 0 ? malloc((size_t)count * CHECKPOINT_ENTRY_SIZE) : NULL;
+        if (list->data != NULL &&
+            fread(list->data, CHECKPOINT_ENTRY_SIZE, (size_t)count, fp) == (size_t)count) {
+            list->count = (size_t)count;
+        }
+    }
+    fclose(fp);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: save_entries
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Entries of queries not in this plan are kept: another call may
+ *   still resume from them
+ * - The new file is written next to the old one and rename()d over
+ *   it, so a crash never leaves a half-written checkpoint
+ */
+static void save_entries(const QueryPlan *plan, const char *path, const EntryList *old,
+                         const Mark *mark) {
+    unsigned char header[CHECKPOINT_HEADER_SIZE];
+    unsigned char *entries;
+    size_t count = 0;
+    char *tmp_path = path_with_suffix(path, ".tmp");
+    FILE *fp;
+    int ok;
+
+    entries = malloc((old->count + (size_t)plan->count) * CHECKPOINT_ENTRY_SIZE);
+    if (entries == NULL || tmp_path == NULL) {
+        free(entries);
+        free(tmp_path);
+        return;
+    }
+
+    for (size_t i = 0; i < old->count; i++) {
+        const unsigned char *entry = old->data + i * CHECKPOINT_ENTRY_SIZE;
+        int replaced = 0;
+
+        for (int id = 0; id < plan->count && !replaced; id++) {
+            const Query *q = &plan->queries[id];
+            replaced = !q->done && entry_matches(entry, q, plan->team_name, plan->team_len);
+        }
+        if (!replaced) {
+            memcpy(entries + count++ * CHECKPOINT_ENTRY_SIZE, entry, CHECKPOINT_ENTRY_SIZE);
+        }
+    }
+
+    for (int id = 0; id < plan->count; id++) {
+        const Query *q = &plan->queries[id];
+        EntryList written = { entries, count };
+        QuerySnapshot snap;
+
+        /* Two equal queries share one entry */
+        if (q->done || find_entry(&written, q, plan->team_name, plan->team_len) != NULL) {
+            continue;
+        }
+        plan_snapshot(plan, id, &snap);
+        encode_entry(entries + count++ * CHECKPOINT_ENTRY_SIZE, q, plan->team_name,
+                     plan->team_len, mark, &snap);
+    }
+
+    memcpy(header, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN);
+    put_le(header + 8, CHECKPOINT_VERSION, 4);
+    put_le(header + 12, count, 4);
+
+    fp = fopen(tmp_path, "wb");
+    if (fp != NULL) {
+        ok = fwrite(header, 1, sizeof(header), fp) == sizeof(header) &&
+             fwrite(entries, CHECKPOINT_ENTRY_SIZE, count, fp) == count;
+        ok = fclose(fp) == 0 && ok;
+        if (!ok || rename(tmp_path, path) != 0) {
+            remove(tmp_path);
+        }
+    }
+    free(entries);
+    free(tmp_path);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: resume_offset
+ * ============================================================
+ * Restores the plan from old if every active query has an entry, all
+ * at one offset that still describes the start of the mapped file
+ * (here: the file's device, inode and checksum). Returns that offset
+ * and sets *line, or returns 0 if the whole file must be read.
+ */
+static long long resume_offset(QueryPlan *plan, const RecordReader *rd, const EntryList *old,
+                               const Mark *here, long *line) {
+    const unsigned char *entry = NULL;
+    long long offset = -1;
+
+    for (int id = 0; id < plan->count; id++) {
+        const Query *q = &plan->queries[id];
+
+        if (q->done) {
+            continue;
+        }
+        entry = find_entry(old, q, plan->team_name, plan->team_len);
+        if (entry == NULL) {
+            return 0;
+        }
+        if (offset == -1) {
+            offset = (long long)get_le(entry + ENTRY_OFFSET, 8);
+        } else if ((uint64_t)offset != get_le(entry + ENTRY_OFFSET, 8)) {
+            return 0;
+        }
+    }
+
+    /* Another file, shorter now, not at a line boundary, or different bytes: rewritten */
+    if (offset <= 0 || get_le(entry + ENTRY_DEVICE, 8) != here->device ||
+        get_le(entry + ENTRY_INODE, 8) != here->inode ||
+        (size_t)offset > rd->map_len || rd->base[offset - 1] != '\n' ||
+        prefix_checksum(rd->base, (uint64_t)offset) != get_le(entry + ENTRY_CHECKSUM, 8)) {
+        return 0;
+    }
+    *line = (long)get_le(entry + ENTRY_LINE, 8);
+
+    for (int id = 0; id < plan->count; id++) {
+        const Query *q = &plan->queries[id];
+        QuerySnapshot snap;
+
+        if (!q->done) {
+            decode_entry(find_entry(old, q, plan->team_name, plan->team_len), &snap);
+            plan_restore(plan, id, &snap);
+        }
+    }
+    return offset;
+}
+
+/* 1 if checkpoint_run() can resume this plan at all */
+static int can_checkpoint(const QueryPlan *plan) {
+    if (!plan_resumable(plan) || plan->team_len >= MAX_NAME_LENGTH) {
+        return 0;
+    }
+    for (int i = 0; i < plan->count; i++) {
+        const Query *q = &plan->queries[i];
+        if (!q->done && q->kind != QUERY_BEST_MONTH && q->player_len >= MAX_NAME_LENGTH) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ============================================================
+ * FUNCTION: checkpoint_run
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - The saved offset is the end of the last complete line: a writer
+ *   may be half way through the line after it
+ * - State is saved just before the first record past that point, so
+ *   the unfinished line is counted now but read again next time
+ * - Nothing is saved after an error; the old checkpoint stays
+ */
+int checkpoint_run(QueryPlan *plan, const char *in_file) {
+    RecordReader rd;
+    GameRecord rec;
+    EntryList old;
+    char *path;
+    struct stat st;
+    Mark mark;
+    long long start, stable_end;
+    long line = 1;
+    int saved;
+    int status;
+
+    if (!can_checkpoint(plan)) {
+        return plan_run(plan, in_file);
+    }
+    if (reader_open(&rd, in_file) != SUCCESS) {
+        return plan_run(plan, in_file);  /* reports the error */
+    }
+    if (rd.map == NULL || rd.columns != NULL || fstat(rd.fd, &st) != 0) {
+        reader_close(&rd);
+        return plan_run(plan, in_file);
+    }
+    path = path_with_suffix(in_file, CHECKPOINT_SUFFIX);
+    status = path == NULL ? NO_MEMORY : plan_begin(plan);
+    if (status != SUCCESS) {
+        free(path);
+        reader_close(&rd);
+        for (int i = 0; i < plan->count; i++) {
+            if (!plan->queries[i].done) {
+                plan->queries[i].result = status;
+            }
+        }
+        return status;
+    }
+
+    plan->error.code = SUCCESS;
+    plan->error.line = 0;
+    plan->error.offset = 0;
+    memset(&rec, 0, sizeof(rec));
+    reader_set_fields(&rd, plan_fields(plan));
+
+    mark.device = (uint64_t)st.st_dev;
+    mark.inode = (uint64_t)st.st_ino;
+
+    load_entries(path, &old);
+    start = resume_offset(plan, &rd, &old, &mark, &line);
+    if (start > 0 && reader_seek(&rd, start) != SUCCESS) {
+        start = 0;
+        plan_begin(plan);
+    }
+    if (start > 0) {
+        rd.line = line;          /* reader_seek() does not know it */
+    }
+
+    /* Everything up to and including the last '\n' */
+    stable_end = (long long)rd.map_len;
+    while (stable_end > 0 && rd.base[stable_end - 1] != '\n') {
+        stable_end--;
+    }
+    mark.offset = stable_end;
+
+    /* Nothing new: the checkpoint is already up to date */
+    saved = start > 0 && stable_end == start;
+    while ((status = reader_next(&rd, &rec)) == RECORD_OK) {
+        if (!saved && rd.rec_offset >= stable_end) {
+            /* No '\n' after stable_end: this record is on the line that starts there */
+            mark.checksum = prefix_checksum(rd.base, (uint64_t)stable_end);
+            mark.line = rd.line;
+            save_entries(plan, path, &old, &mark);
+            saved = 1;
+        }
+        plan_feed(plan, &rec);
+    }
+    if (status == RECORD_EOF) {
+        status = SUCCESS;
+        if (!saved) {
+            mark.checksum = prefix_checksum(rd.base, (uint64_t)stable_end);
+            mark.line = rd.line;     /* every '\n' has been read */
+            save_entries(plan, path, &old, &mark);
+        }
+    }
+
+    if (status != SUCCESS) {
+        plan->error.code = status;
+        plan->error.line = rd.err_line;
+        plan->error.offset = rd.err_offset;
+    }
+    reader_close(&rd);
+    free(old.data);
+    free(path);
+
+    plan_end(plan, status);
+    return status;
+}
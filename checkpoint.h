@@ -0,0 +1,89 @@
+/*
+ * checkpoint.h - Resume queries on a growing game log
+ *
+ * This file contains:
+ * - A description of the checkpoint file layout
+ * - A plan runner that only parses what was appended since last time
+ *
+ * Learning Concepts:
+ * - Incremental computation: save the state of a scan together with
+ *   how far it got, and continue from there next time
+ * - Detecting that a file was rewritten rather than appended to
+ * - Replacing a file atomically (write a temporary file, rename())
+ *
+ * Checkpoints for "game_data.txt" live next to it in
+ * "game_data.txt.ckpt". One checkpoint file holds an entry per query
+ * (kind, home team, player), so different calls do not overwrite each
+ * other's progress.
+ *
+ * FILE LAYOUT (all integers little-endian):
+ *
+ *   Header (16 bytes)
+ *     char     magic[8]       "HW2CKP01"
+ *     uint32   version        2
+ *     uint32   entry_count
+ *
+ *   Entries, entry_count * 296 bytes
+ *     uint32   kind           QueryKind
+ *     uint32   reserved
+ *     uint64   offset         bytes of the data file already read; always
+ *                             just after a '\n'
+ *     uint64   checksum       hash of those bytes (every 4 KiB block up
+ *                             to 256 MiB, evenly spaced blocks beyond)
+ *     int32    match[5]       open match: year, month, day, home and
+ *                             opponent score
+ *     int32    in_match       player report: player seen in that match
+ *     int32    values[24]     the query's counters (QuerySnapshot)
+ *     char     team[64]       home team, zero padded
+ *     char     player[64]     player name (empty for best month), zero padded
+ *     uint64   device         st_dev and st_ino of the data file: a file
+ *     uint64   inode          replaced by a new one is not resumed
+ *     uint64   line           line number at offset (for error locations)
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "query_plan.h"
+
+/* ========== CONSTANTS ========== */
+#define CHECKPOINT_MAGIC       "HW2CKP01"
+#define CHECKPOINT_MAGIC_LEN   8
+#define CHECKPOINT_VERSION     2
+#define CHECKPOINT_HEADER_SIZE 16
+#define CHECKPOINT_ENTRY_SIZE  296
+#define CHECKPOINT_BLOCK       4096    /* bytes hashed per sampled block */
+#define CHECKPOINT_MAX_BLOCKS  65536   /* at most 256 MiB hashed per check */
+#define CHECKPOINT_SUFFIX      ".ckpt"
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * checkpoint_run
+ *
+ * Like plan_run(), for plans where plan_resumable() is 1 and in_file
+ * is a text file that only ever grows at the end:
+ *
+ * - If in_file + ".ckpt" has an entry for every query, all at the same
+ *   offset, in_file is the same file (device and inode) and the first
+ *   offset bytes of in_file are unchanged, the saved state is restored
+ *   and only the rest of the file is read; error locations keep their
+ *   real line numbers
+ * - Otherwise (no checkpoint, file truncated, replaced or rewritten)
+ *   the whole file is read
+ *
+ * Up to 256 MiB, "unchanged" means every byte hashes the same. A
+ * longer prefix is checked with 65536 blocks spread evenly across it,
+ * so a small in-place edit there may go unnoticed.
+ *
+ * After a scan without errors the state is saved up to the last
+ * complete line (a line still being written is read, but not saved).
+ * Other plans and column files are simply passed to plan_run().
+ *
+ * Returns:
+ *   As plan_run(). Failing to write the checkpoint is not an error;
+ *   the next call just reads more.
+ */
+int checkpoint_run(QueryPlan *plan, const char *in_file);
+
+#endif /* CHECKPOINT_H */
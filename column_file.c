@@ -0,0 +1,658 @@
+/*
+ * column_file.c - Compact binary columnar format for game data
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Writing integers byte by byte in a fixed (little-endian) order
+ * 2. Row groups: the converter only buffers COLUMN_GROUP_ROWS records
+ * 3. Per-group column widths (1, 2 or 4 bytes) and minute precision
+ * 4. Reading only the columns a query needs
+ * 5. Checking every offset in a binary file before trusting it
+ *
+ * See column_file.h for the file layout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hw2.h"
+#include "encoding.h"
+#include "intern.h"
+#include "record_reader.h"
+#include "column_file.h"
+
+/* Column values are 1, 2 or 4 bytes wide */
+static uint32_t get_value(const unsigned char *column, unsigned width, uint32_t row) {
+    const unsigned char *p = column + (size_t)row * width;
+
+    switch (width) {
+        case 1:
+            return p[0];
+        case 2:
+            return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+        default:
+            return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                   (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+}
+
+static unsigned width_for(uint32_t max_value) {
+    if (max_value <= 0xFF) {
+        return 1;
+    }
+    if (max_value <= 0xFFFF) {
+        return 2;
+    }
+    return 4;
+}
+
+static size_t pad8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static const float pow10_table[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f
+};
+
+/* ============================================================
+ * FUNCTIONS: Packed dates
+ * ============================================================
+ */
+uint32_t column_pack_date(int year, int month, int day) {
+    return (uint32_t)year << 9 | (uint32_t)month << 5 | (uint32_t)day;
+}
+
+void column_unpack_date(uint32_t packed, int *year, int *month, int *day) {
+    *year = (int)(packed >> 9);
+    *month = (int)((packed >> 5) & 15);
+    *day = (int)(packed & 31);
+}
+
+int column_is_file(const void *data, size_t size) {
+    return size >= COLUMN_MAGIC_LEN && memcmp(data, COLUMN_MAGIC, COLUMN_MAGIC_LEN) == 0;
+}
+
+/* ============================================================
+ * CONVERTER
+ * ============================================================
+ */
+
+/* One row group being built, plus the group directory so far */
+typedef struct {
+    FILE *out;
+    uint64_t offset;             /* bytes written so far */
+    int write_failed;
+
+    uint32_t rows;
+    uint32_t *values[COL_MINUTES];   /* date .. blocks */
+    float *minutes;
+    uint32_t *minutes_fixed;         /* minutes as stored */
+    unsigned char *scratch;          /* one encoded column */
+
+    uint64_t record_count;
+    uint32_t group_count, group_capacity;
+    unsigned char *directory;        /* COLUMN_DIR_ENTRY bytes per group */
+} ColumnWriter;
+
+static void write_bytes(ColumnWriter *w, const void *bytes, size_t len) {
+    if (len > 0 && fwrite(bytes, 1, len, w->out) != len) {
+        w->write_failed = 1;
+    }
+    w->offset += len;
+}
+
+/* Writes a column of rows values, then pads to 8 bytes */
+static void write_column(ColumnWriter *w, const uint32_t *values, unsigned width) {
+    static const unsigned char zeros[8] = {0};
+    size_t len = (size_t)w->rows * width;
+
+    for (uint32_t r = 0; r < w->rows; r++) {
+        put_le(w->scratch + (size_t)r * width, values[r], width);
+    }
+    write_bytes(w, w->scratch, len);
+    write_bytes(w, zeros, pad8(len) - len);
+}
+
+/*
+ * Picks the fewest decimals that store every minutes value exactly,
+ * i.e. (float)m / 10^d gives back the same float. Returns
+ * COLUMN_RAW_MINUTES if no 0-6 decimals work.
+ */
+static unsigned choose_decimals(const float *minutes, uint32_t rows) {
+    for (unsigned d = 0; d <= 6; d++) {
+        uint32_t r;
+        for (r = 0; r < rows; r++) {
+            double scaled = (double)minutes[r] * (double)pow10_table[d];
+            if (scaled >= 16777216.0) {
+                break;  /* integers above 2^24 are not exact floats */
+            }
+            if ((float)(uint32_t)(scaled + 0.5) / pow10_table[d] != minutes[r]) {
+                break;
+            }
+        }
+        if (r == rows) {
+            return d;
+        }
+    }
+    return COLUMN_RAW_MINUTES;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: flush_group
+ * ============================================================
+ * Writes the buffered rows as one row group and records it in the
+ * directory.
+ */
+static int flush_group(ColumnWriter *w) {
+    unsigned char header[COLUMN_GROUP_HEADER] = {0};
+    unsigned char *entry;
+    unsigned width[COL_COUNT];
+    uint32_t min_date = UINT32_MAX, max_date = 0;
+    uint32_t max_minutes = 0;
+    unsigned decimals;
+
+    if (w->rows == 0) {
+        return SUCCESS;
+    }
+
+    if (w->group_count == w->group_capacity) {
+        uint32_t capacity = w->group_capacity ? w->group_capacity * 2 : 64;
+        unsigned char *grown = realloc(w->directory, (size_t)capacity * COLUMN_DIR_ENTRY);
+        if (grown == NULL) {
+            return NO_MEMORY;
+        }
+        w->directory = grown;
+        w->group_capacity = capacity;
+    }
+
+    /* Dates are stored relative to the group's first day */
+    for (uint32_t r = 0; r < w->rows; r++) {
+        if (w->values[COL_DATE][r] < min_date) {
+            min_date = w->values[COL_DATE][r];
+        }
+        if (w->values[COL_DATE][r] > max_date) {
+            max_date = w->values[COL_DATE][r];
+        }
+    }
+    for (uint32_t r = 0; r < w->rows; r++) {
+        w->values[COL_DATE][r] -= min_date;
+    }
+
+    /* Narrowest width for each integer column */
+    for (int c = 0; c < COL_MINUTES; c++) {
+        uint32_t max_value = 0;
+        for (uint32_t r = 0; r < w->rows; r++) {
+            if (w->values[c][r] > max_value) {
+                max_value = w->values[c][r];
+            }
+        }
+        width[c] = width_for(max_value);
+    }
+
+    /* Minutes: fixed-point integers, or raw float bits */
+    decimals = choose_decimals(w->minutes, w->rows);
+    for (uint32_t r = 0; r < w->rows; r++) {
+        if (decimals == COLUMN_RAW_MINUTES) {
+            memcpy(&w->minutes_fixed[r], &w->minutes[r], sizeof(uint32_t));
+        } else {
+            w->minutes_fixed[r] = (uint32_t)((double)w->minutes[r] * (double)pow10_table[decimals] + 0.5);
+        }
+        if (w->minutes_fixed[r] > max_minutes) {
+            max_minutes = w->minutes_fixed[r];
+        }
+    }
+    width[COL_MINUTES] = decimals == COLUMN_RAW_MINUTES ? 4 : width_for(max_minutes);
+
+    /* Directory entry */
+    entry = w->directory + (size_t)w->group_count * COLUMN_DIR_ENTRY;
+    memset(entry, 0, COLUMN_DIR_ENTRY);
+    put_le(entry, w->offset, 8);
+    put_le(entry + 8, w->rows, 4);
+    put_le(entry + 12, min_date, 4);
+    put_le(entry + 16, max_date, 4);
+    w->group_count++;
+
+    /* Group header, then the columns */
+    put_le(header, w->rows, 4);
+    put_le(header + 4, min_date, 4);
+    put_le(header + 8, max_date, 4);
+    for (int c = 0; c < COL_COUNT; c++) {
+        header[12 + c] = (unsigned char)width[c];
+    }
+    header[19] = (unsigned char)decimals;
+    write_bytes(w, header, sizeof(header));
+
+    for (int c = 0; c < COL_MINUTES; c++) {
+        write_column(w, w->values[c], width[c]);
+    }
+    write_column(w, w->minutes_fixed, width[COL_MINUTES]);
+
+    w->record_count += w->rows;
+    w->rows = 0;
+    return w->write_failed ? FILE_WRITE_ERR : SUCCESS;
+}
+
+/* Writes one dictionary: count, then length-prefixed names */
+static void write_dictionary(ColumnWriter *w, const InternTable *names) {
+    unsigned char count[4];
+
+    put_le(count, names->count, 4);
+    write_bytes(w, count, 4);
+    for (uint32_t id = 0; id < names->count; id++) {
+        size_t len;
+        const char *name = intern_name(names, id, &len);
+        unsigned char len_byte = (unsigned char)len;  /* names are < MAX_NAME_LENGTH */
+        write_bytes(w, &len_byte, 1);
+        write_bytes(w, name, len);
+    }
+}
+
+/* ============================================================
+ * FUNCTION: column_convert
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - The text file is read with the normal RecordReader, so it gets
+ *   exactly the same validation as the queries
+ * - Names become ids through two intern tables (players, teams)
+ * - The header is written last (we only know the counts at the end)
+ */
+int column_convert(const char *in_file, const char *out_file, ParseError *err) {
+    RecordReader rd;
+    GameRecord rec;
+    ColumnWriter w;
+    InternTable players, teams;
+    unsigned char header[COLUMN_HEADER_SIZE] = {0};
+    uint64_t footer_offset;
+    int status;
+
+    if (err != NULL) {
+        err->code = SUCCESS;
+        err->line = 0;
+        err->offset = 0;
+    }
+
+    status = reader_open(&rd, in_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+
+    memset(&w, 0, sizeof(w));
+    if (intern_init(&players) != SUCCESS) {
+        reader_close(&rd);
+        return NO_MEMORY;
+    }
+    if (intern_init(&teams) != SUCCESS) {
+        intern_free(&players);
+        reader_close(&rd);
+        return NO_MEMORY;
+    }
+
+    status = SUCCESS;
+    for (int c = 0; c < COL_MINUTES; c++) {
+        w.values[c] = malloc(COLUMN_GROUP_ROWS * sizeof(uint32_t));
+        if (w.values[c] == NULL) {
+            status = NO_MEMORY;
+        }
+    }
+    w.minutes = malloc(COLUMN_GROUP_ROWS * sizeof(float));
+    w.minutes_fixed = malloc(COLUMN_GROUP_ROWS * sizeof(uint32_t));
+    w.scratch = malloc(COLUMN_GROUP_ROWS * sizeof(uint32_t));
+    if (w.minutes == NULL || w.minutes_fixed == NULL || w.scratch == NULL) {
+        status = NO_MEMORY;
+    }
+
+    if (status == SUCCESS) {
+        w.out = fopen(out_file, "wb");
+        if (w.out == NULL) {
+            status = FILE_WRITE_ERR;
+        } else {
+            /* Placeholder header; rewritten at the end */
+            write_bytes(&w, header, sizeof(header));
+        }
+    }
+
+    while (status == SUCCESS) {
+        uint32_t player_id, team_id;
+        uint32_t r = w.rows;
+
+        status = reader_next(&rd, &rec);
+        if (status != RECORD_OK) {
+            break;  /* RECORD_EOF (== SUCCESS) or an error */
+        }
+        status = SUCCESS;
+
+        /* The packed date has 23 bits for the year */
+        if (rec.year > COLUMN_MAX_YEAR) {
+            status = BAD_DATE;
+            rd.err_line = rd.line;
+            rd.err_offset = rd.rec_offset;
+            break;
+        }
+
+        if (intern_add(&players, rec.player, rec.player_len, &player_id) != SUCCESS ||
+            intern_add(&teams, rec.team, rec.team_len, &team_id) != SUCCESS) {
+            status = NO_MEMORY;
+            break;
+        }
+
+        w.values[COL_DATE][r] = column_pack_date(rec.year, rec.month, rec.day);
+        w.values[COL_PLAYER][r] = player_id;
+        w.values[COL_TEAM][r] = team_id;
+        w.values[COL_POINTS][r] = (uint32_t)rec.points;
+        w.values[COL_ASSISTS][r] = (uint32_t)rec.assists;
+        w.values[COL_BLOCKS][r] = (uint32_t)rec.blocks;
+        w.minutes[r] = rec.minutes;
+        w.rows++;
+
+        if (w.rows == COLUMN_GROUP_ROWS) {
+            status = flush_group(&w);
+        }
+    }
+
+    if (status == SUCCESS) {
+        status = flush_group(&w);
+    } else if ((status == BAD_RECORD || status == BAD_DATE || status == FILE_READ_ERR) &&
+               err != NULL) {
+        err->code = status;
+        err->line = rd.err_line;
+        err->offset = rd.err_offset;
+    }
+
+    if (status == SUCCESS) {
+        footer_offset = w.offset;
+        write_bytes(&w, w.directory, (size_t)w.group_count * COLUMN_DIR_ENTRY);
+        write_dictionary(&w, &players);
+        write_dictionary(&w, &teams);
+
+        memcpy(header, COLUMN_MAGIC, COLUMN_MAGIC_LEN);
+        put_le(header + 8, COLUMN_VERSION, 4);
+        put_le(header + 12, w.group_count, 4);
+        put_le(header + 16, w.record_count, 8);
+        put_le(header + 24, footer_offset, 8);
+        if (fseek(w.out, 0, SEEK_SET) != 0 ||
+            fwrite(header, 1, sizeof(header), w.out) != sizeof(header)) {
+            w.write_failed = 1;
+        }
+        if (w.write_failed) {
+            status = FILE_WRITE_ERR;
+        }
+    }
+
+    if (w.out != NULL && fclose(w.out) != 0 && status == SUCCESS) {
+        status = FILE_WRITE_ERR;
+    }
+    if (status != SUCCESS && w.out != NULL) {
+        remove(out_file);  /* never leave a half-written column file */
+    }
+
+    for (int c = 0; c < COL_MINUTES; c++) {
+        free(w.values[c]);
+    }
+    free(w.minutes);
+    free(w.minutes_fixed);
+    free(w.scratch);
+    free(w.directory);
+    intern_free(&players);
+    intern_free(&teams);
+    reader_close(&rd);
+    return status;
+}
+
+/* ============================================================
+ * READER
+ * ============================================================
+ */
+
+/*
+ * Reads a dictionary at *pos (bounds-checked). Names point into
+ * the file. Returns SUCCESS, BAD_RECORD or NO_MEMORY.
+ */
+static int read_dictionary(const unsigned char *data, size_t size, size_t *pos,
+                           ColumnName **names, uint32_t *count) {
+    uint32_t n;
+
+    if (*pos + 4 > size) {
+        return BAD_RECORD;
+    }
+    n = (uint32_t)get_le(data + *pos, 4);
+    *pos += 4;
+
+    /* Every entry needs at least 2 bytes, which bounds n before malloc */
+    if (n > (size - *pos) / 2) {
+        return BAD_RECORD;
+    }
+    *names = malloc(((size_t)n + 1) * sizeof(ColumnName));
+    if (*names == NULL) {
+        return NO_MEMORY;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        size_t len;
+        if (*pos + 1 > size) {
+            return BAD_RECORD;
+        }
+        len = data[*pos];
+        *pos += 1;
+        if (len == 0 || len >= MAX_NAME_LENGTH || *pos + len > size) {
+            return BAD_RECORD;
+        }
+        (*names)[i].name = (const char *)data + *pos;
+        (*names)[i].len = len;
+        *pos += len;
+    }
+    *count = n;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: column_reader_open
+ * ============================================================
+ */
+int column_reader_open(ColumnReader *cr, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    uint64_t footer_offset;
+    size_t pos;
+    int status;
+
+    memset(cr, 0, sizeof(*cr));
+    cr->data = bytes;
+    cr->size = size;
+
+    if (size < COLUMN_HEADER_SIZE || !column_is_file(data, size) ||
+        get_le(bytes + 8, 4) != COLUMN_VERSION) {
+        return BAD_RECORD;
+    }
+    cr->group_count = (uint32_t)get_le(bytes + 12, 4);
+    cr->record_count = get_le(bytes + 16, 8);
+    footer_offset = get_le(bytes + 24, 8);
+
+    if (footer_offset < COLUMN_HEADER_SIZE || footer_offset > size ||
+        (size - footer_offset) / COLUMN_DIR_ENTRY < cr->group_count) {
+        return BAD_RECORD;
+    }
+    cr->directory = bytes + footer_offset;
+
+    pos = (size_t)footer_offset + (size_t)cr->group_count * COLUMN_DIR_ENTRY;
+    status = read_dictionary(bytes, size, &pos, &cr->players, &cr->player_count);
+    if (status == SUCCESS) {
+        status = read_dictionary(bytes, size, &pos, &cr->teams, &cr->team_count);
+    }
+    if (status != SUCCESS) {
+        column_reader_close(cr);
+    }
+    return status;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: load_group
+ * ============================================================
+ * Points the column pointers at row group g after checking that the
+ * whole group lies between the header and the footer.
+ */
+static int load_group(ColumnReader *cr, uint32_t g) {
+    const unsigned char *entry = cr->directory + (size_t)g * COLUMN_DIR_ENTRY;
+    uint64_t offset = get_le(entry, 8);
+    uint64_t limit = (uint64_t)(cr->directory - cr->data);
+    const unsigned char *header;
+    uint64_t pos;
+
+    cr->group_offset = offset;
+    if (offset < COLUMN_HEADER_SIZE || offset + COLUMN_GROUP_HEADER > limit) {
+        return BAD_RECORD;
+    }
+    header = cr->data + offset;
+
+    cr->rows = (uint32_t)get_le(header, 4);
+    cr->row = 0;
+    if (cr->rows != get_le(entry + 8, 4) || cr->rows > COLUMN_GROUP_ROWS) {
+        return BAD_RECORD;
+    }
+
+    cr->date_base = (uint32_t)get_le(header + 4, 4);
+    cr->minutes_decimals = header[19];
+    if (cr->minutes_decimals > 6 && cr->minutes_decimals != COLUMN_RAW_MINUTES) {
+        return BAD_RECORD;
+    }
+
+    pos = offset + COLUMN_GROUP_HEADER;
+    for (int c = 0; c < COL_COUNT; c++) {
+        unsigned width = header[12 + c];
+        if (width != 1 && width != 2 && width != 4) {
+            return BAD_RECORD;
+        }
+        if (c == COL_MINUTES && cr->minutes_decimals == COLUMN_RAW_MINUTES && width != 4) {
+            return BAD_RECORD;
+        }
+        cr->width[c] = width;
+        cr->columns[c] = cr->data + pos;
+        pos += pad8((size_t)cr->rows * width);
+        if (pos > limit) {
+            return BAD_RECORD;
+        }
+    }
+    return SUCCESS;
+}
+
+/* A stat column value as an int; 0 if it cannot be one */
+static int get_stat(const ColumnReader *cr, int column, uint32_t row, int *out) {
+    uint32_t value = get_value(cr->columns[column], cr->width[column], row);
+
+    if (value > INT32_MAX) {
+        return 0;
+    }
+    *out = (int)value;
+    return 1;
+}
+
+/* ============================================================
+ * FUNCTION: column_reader_seek
+ * ============================================================
+ * Walks the group directory to the group holding the record.
+ */
+int column_reader_seek(ColumnReader *cr, uint64_t record) {
+    uint64_t first = 0;
+
+    if (record == cr->record_count) {
+        cr->group = cr->group_count;
+        cr->row = cr->rows = 0;
+        cr->record_index = record;
+        return SUCCESS;
+    }
+
+    for (uint32_t g = 0; g < cr->group_count; g++) {
+        uint64_t rows = get_le(cr->directory + (size_t)g * COLUMN_DIR_ENTRY + 8, 4);
+
+        if (record < first + rows) {
+            if (load_group(cr, g) != SUCCESS) {
+                return BAD_RECORD;
+            }
+            cr->group = g + 1;
+            cr->row = (uint32_t)(record - first);
+            cr->record_index = record;
+            return SUCCESS;
+        }
+        first += rows;
+    }
+    return BAD_RECORD;
+}
+
+/* ============================================================
+ * FUNCTION: column_reader_next
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Only the requested columns are read (the others are never touched,
+ *   so their pages are never even faulted in)
+ * - Dictionary ids and values are range-checked: a damaged file gives
+ *   BAD_RECORD, never a crash
+ */
+int column_reader_next(ColumnReader *cr, GameRecord *rec, unsigned fields) {
+    uint32_t r, value;
+
+    while (cr->row == cr->rows) {
+        if (cr->group == cr->group_count) {
+            return RECORD_EOF;
+        }
+        if (load_group(cr, cr->group++) != SUCCESS) {
+            return BAD_RECORD;
+        }
+    }
+    r = cr->row;
+
+    if (fields & FIELD_DATE) {
+        value = cr->date_base + get_value(cr->columns[COL_DATE], cr->width[COL_DATE], r);
+        column_unpack_date(value, &rec->year, &rec->month, &rec->day);
+        if (!is_valid_date(rec->year, rec->month, rec->day)) {
+            return BAD_RECORD;
+        }
+    }
+    if (fields & FIELD_PLAYER) {
+        value = get_value(cr->columns[COL_PLAYER], cr->width[COL_PLAYER], r);
+        if (value >= cr->player_count) {
+            return BAD_RECORD;
+        }
+        rec->player = cr->players[value].name;
+        rec->player_len = cr->players[value].len;
+        rec->player_id = value;
+    }
+    if (fields & FIELD_TEAM) {
+        value = get_value(cr->columns[COL_TEAM], cr->width[COL_TEAM], r);
+        if (value >= cr->team_count) {
+            return BAD_RECORD;
+        }
+        rec->team = cr->teams[value].name;
+        rec->team_len = cr->teams[value].len;
+        rec->team_id = value;
+    }
+    if ((fields & FIELD_POINTS) && !get_stat(cr, COL_POINTS, r, &rec->points)) {
+        return BAD_RECORD;
+    }
+    if ((fields & FIELD_ASSISTS) && !get_stat(cr, COL_ASSISTS, r, &rec->assists)) {
+        return BAD_RECORD;
+    }
+    if ((fields & FIELD_BLOCKS) && !get_stat(cr, COL_BLOCKS, r, &rec->blocks)) {
+        return BAD_RECORD;
+    }
+    if (fields & FIELD_MINUTES) {
+        value = get_value(cr->columns[COL_MINUTES], cr->width[COL_MINUTES], r);
+        if (cr->minutes_decimals == COLUMN_RAW_MINUTES) {
+            memcpy(&rec->minutes, &value, sizeof(float));
+        } else {
+            rec->minutes = (float)value / pow10_table[cr->minutes_decimals];
+        }
+        if (!(rec->minutes > 0)) {
+            return BAD_RECORD;
+        }
+    }
+
+    cr->row++;
+    cr->record_index++;
+    return RECORD_OK;
+}
+
+void column_reader_close(ColumnReader *cr) {
+    free(cr->players);
+    free(cr->teams);
+    cr->players = NULL;
+    cr->teams = NULL;
+}
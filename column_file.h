@@ -0,0 +1,160 @@
+/*
+ * column_file.h - Compact binary columnar format for game data
+ *
+ * This file contains:
+ * - A description of the on-disk layout
+ * - The ColumnReader structure used by record_reader.c
+ * - The text -> columnar converter
+ *
+ * Learning Concepts:
+ * - Storing a table column by column instead of row by row
+ * - Dictionary encoding (names stored once, rows hold small ids)
+ * - Choosing the smallest integer width that fits each column
+ * - Fixed-endian binary files that work on any machine
+ *
+ * FILE LAYOUT (all integers little-endian):
+ *
+ *   Header (32 bytes)
+ *     char     magic[8]       "HW2COLS1"
+ *     uint32   version        1
+ *     uint32   group_count
+ *     uint64   record_count
+ *     uint64   footer_offset
+ *
+ *   Row groups (up to COLUMN_GROUP_ROWS records each)
+ *     uint32   rows
+ *     uint32   min_date, max_date       packed dates (see below)
+ *     uint8    width[7]                 bytes per value: 1, 2 or 4
+ *     uint8    minutes_decimals         0-6, or 255 = raw float bits
+ *     uint32   padding
+ *     columns  date, player, team, points, assists, blocks, minutes;
+ *              each rows * width bytes, padded to 8 bytes
+ *
+ *   Footer
+ *     group directory: per group uint64 offset, uint32 rows,
+ *                      uint32 min_date, uint32 max_date, uint32 padding
+ *     uint32 player_count, then per player: uint8 length, bytes
+ *     uint32 team_count,   then per team:   uint8 length, bytes
+ *
+ * Packed date = year << 9 | month << 5 | day, so packed dates sort
+ * in calendar order. The date column stores packed date - min_date,
+ * which usually fits in 1 or 2 bytes. Minutes are stored as an
+ * integer m meaning m / 10^minutes_decimals.
+ */
+
+#ifndef COLUMN_FILE_H
+#define COLUMN_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hw2.h"
+#include "record_reader.h"
+
+/* ========== CONSTANTS ========== */
+#define COLUMN_MAGIC        "HW2COLS1"
+#define COLUMN_MAGIC_LEN    8
+#define COLUMN_VERSION      1
+#define COLUMN_HEADER_SIZE  32
+#define COLUMN_GROUP_HEADER 24
+#define COLUMN_DIR_ENTRY    24
+#define COLUMN_GROUP_ROWS   65536
+#define COLUMN_RAW_MINUTES  255
+#define COLUMN_MAX_YEAR     ((1 << 23) - 1)
+
+/* Column numbers */
+enum {
+    COL_DATE, COL_PLAYER, COL_TEAM, COL_POINTS, COL_ASSISTS, COL_BLOCKS, COL_MINUTES,
+    COL_COUNT
+};
+
+/* ========== TYPES ========== */
+
+/* A dictionary entry: points into the mapped file, not null-terminated */
+typedef struct {
+    const char *name;
+    size_t len;
+} ColumnName;
+
+/*
+ * Decodes records from a column file that is already in memory
+ * (memory-mapped by record_reader.c). Treat as private.
+ */
+typedef struct ColumnReader {
+    const unsigned char *data;
+    size_t size;
+    uint32_t group_count;
+    uint64_t record_count;
+    const unsigned char *directory;
+
+    ColumnName *players;
+    uint32_t player_count;
+    ColumnName *teams;
+    uint32_t team_count;
+
+    /* Current row group */
+    uint32_t group;              /* next group to load */
+    uint32_t row, rows;
+    uint64_t group_offset;
+    uint32_t date_base;          /* the group's min_date */
+    const unsigned char *columns[COL_COUNT];
+    unsigned width[COL_COUNT];
+    unsigned minutes_decimals;
+    uint64_t record_index;       /* records returned so far */
+} ColumnReader;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * column_pack_date / column_unpack_date
+ */
+uint32_t column_pack_date(int year, int month, int day);
+void column_unpack_date(uint32_t packed, int *year, int *month, int *day);
+
+/*
+ * column_is_file
+ *
+ * Returns 1 if the bytes start with the column file magic.
+ */
+int column_is_file(const void *data, size_t size);
+
+/*
+ * column_reader_open
+ *
+ * Checks the header, directory and dictionaries of an in-memory
+ * column file. Returns SUCCESS, BAD_RECORD (corrupt file) or NO_MEMORY.
+ */
+int column_reader_open(ColumnReader *cr, const void *data, size_t size);
+
+/*
+ * column_reader_next
+ *
+ * Decodes the next record, touching only the columns named in
+ * fields (FIELD_* from record_reader.h); other fields are left unchanged.
+ * Returns RECORD_OK, RECORD_EOF or BAD_RECORD.
+ */
+int column_reader_next(ColumnReader *cr, GameRecord *rec, unsigned fields);
+
+/*
+ * column_reader_seek
+ *
+ * Makes record number `record` (0-based) the next one returned.
+ * Returns SUCCESS, or BAD_RECORD if the record does not exist or its
+ * row group is damaged.
+ */
+int column_reader_seek(ColumnReader *cr, uint64_t record);
+
+void column_reader_close(ColumnReader *cr);
+
+/*
+ * column_convert
+ *
+ * Converts a text game data file into a column file.
+ *
+ * Returns:
+ *   SUCCESS, FILE_READ_ERR, FILE_WRITE_ERR, NO_MEMORY, or the
+ *   BAD_RECORD / BAD_DATE found in the text file. If err is not
+ *   NULL it receives the location of a bad record.
+ */
+int column_convert(const char *in_file, const char *out_file, ParseError *err);
+
+#endif /* COLUMN_FILE_H */
@@ -0,0 +1,637 @@
+/*
+ * dataset.c - A game data file loaded into memory once, queried many times
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Structure of arrays, grown together by doubling
+ * 2. Interning names while loading (intern.c)
+ * 3. Precomputed tables: matches, matches sorted by date, and a
+ *    "posting list" of rows for every player (counting sort)
+ * 4. Binary search to jump straight to one date
+ *
+ * Every query returns exactly what the matching hw2.h function
+ * returns for the same file; see query_plan.c for the streaming
+ * versions of the same logic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hw2.h"
+#include "encoding.h"
+#include "intern.h"
+#include "record_reader.h"
+#include "dataset.h"
+
+/* ============================================================
+ * HELPER FUNCTIONS: Dates
+ * ============================================================
+ * Dates are packed with pack_date() (encoding.h): date >> 5 is
+ * year << 4 | month and date >> 9 is the year.
+ */
+static int date_month(int64_t date) {
+    return (int)((date >> 5) & 15);
+}
+
+static int date_day(int64_t date) {
+    return (int)(date & 31);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: grow_rows
+ * ============================================================
+ * Doubles every per-row array. realloc() keeps the old array if it
+ * fails, so a failure part way through leaves nothing to leak.
+ */
+#define GROW(array, capacity) do { \
+        void *grown = realloc((array), (size_t)(capacity) * sizeof(*(array))); \
+        if (grown == NULL) { \
+            return NO_MEMORY; \
+        } \
+        (array) = grown; \
+    } while (0)
+
+static int grow_rows(Dataset *ds) {
+    uint32_t capacity = ds->capacity ? ds->capacity * 2 : 1024;
+
+    if (ds->capacity >= UINT32_MAX / 2) {
+        return NO_MEMORY;  /* row numbers are 32-bit */
+    }
+    GROW(ds->date, capacity);
+    GROW(ds->player, capacity);
+    GROW(ds->team, capacity);
+    GROW(ds->points, capacity);
+    GROW(ds->assists, capacity);
+    GROW(ds->blocks, capacity);
+    GROW(ds->minutes, capacity);
+    GROW(ds->match_of, capacity);
+    ds->capacity = capacity;
+    return SUCCESS;
+}
+
+/*
+ * names maps a column file's dictionary ids to dataset ids (NULL for
+ * text files, whose names are interned row by row).
+ */
+static int add_row(Dataset *ds, const GameRecord *rec, uint32_t *const names[2]) {
+    uint32_t row = ds->count;
+
+    if (row == ds->capacity && grow_rows(ds) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    if (names[READER_PLAYERS] != NULL) {
+        ds->player[row] = names[READER_PLAYERS][rec->player_id];
+        ds->team[row] = names[READER_TEAMS][rec->team_id];
+    } else if (intern_add(&ds->players, rec->player, rec->player_len, &ds->player[row]) != SUCCESS ||
+               intern_add(&ds->teams, rec->team, rec->team_len, &ds->team[row]) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    ds->date[row] = pack_date(rec->year, rec->month, rec->day);
+    ds->points[row] = rec->points;
+    ds->assists[row] = rec->assists;
+    ds->blocks[row] = rec->blocks;
+    ds->minutes[row] = rec->minutes;
+    ds->count++;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: map_dictionary
+ * ============================================================
+ * A column file already names each player and team once: intern each
+ * dictionary entry here, and rows become one array lookup each.
+ */
+static int map_dictionary(const RecordReader *rd, int kind, InternTable *table, uint32_t **map) {
+    uint32_t count = reader_name_count(rd, kind);
+
+    *map = NULL;
+    if (count == 0) {
+        return SUCCESS;
+    }
+    *map = malloc((size_t)count * sizeof(uint32_t));
+    if (*map == NULL) {
+        return NO_MEMORY;
+    }
+    for (uint32_t id = 0; id < count; id++) {
+        size_t len;
+        const char *name = reader_name(rd, kind, id, &len);
+
+        if (intern_add(table, name, len, &(*map)[id]) != SUCCESS) {
+            return NO_MEMORY;
+        }
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: score_matches
+ * ============================================================
+ * Home and opponent score of every match, for the current home team.
+ */
+static void score_matches(Dataset *ds) {
+    for (uint32_t i = 0; i < ds->match_count; i++) {
+        DatasetMatch *m = &ds->matches[i];
+
+        m->home_score = 0;
+        m->opponent_score = 0;
+        m->opponent = DATASET_NONE;
+        for (uint32_t row = m->first_row; row < m->first_row + m->rows; row++) {
+            if (ds->team[row] == ds->home) {
+                m->home_score += ds->points[row];
+            } else {
+                m->opponent_score += ds->points[row];
+                if (m->opponent == DATASET_NONE) {
+                    m->opponent = ds->team[row];
+                }
+            }
+        }
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: build_matches
+ * ============================================================
+ * A new match starts wherever the date changes, exactly like the
+ * streaming queries.
+ */
+typedef struct {
+    int64_t date;
+    uint32_t match;
+} DateKey;
+
+static int compare_date_keys(const void *a, const void *b) {
+    const DateKey *x = a;
+    const DateKey *y = b;
+
+    if (x->date != y->date) {
+        return x->date < y->date ? -1 : 1;
+    }
+    return (x->match > y->match) - (x->match < y->match);
+}
+
+static int build_matches(Dataset *ds) {
+    uint32_t capacity = 0;
+    DateKey *keys;
+
+    for (uint32_t row = 0; row < ds->count; row++) {
+        DatasetMatch *m;
+
+        if (row == 0 || ds->date[row] != ds->date[row - 1]) {
+            if (ds->match_count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                GROW(ds->matches, capacity);
+            }
+            m = &ds->matches[ds->match_count++];
+            m->date = ds->date[row];
+            m->first_row = row;
+            m->rows = 0;
+        }
+        m = &ds->matches[ds->match_count - 1];
+        m->rows++;
+        ds->match_of[row] = ds->match_count - 1;
+    }
+    score_matches(ds);
+
+    /* The same matches, sorted by date (ties in file order) */
+    keys = malloc(((size_t)ds->match_count + 1) * sizeof(DateKey));
+    ds->matches_by_date = malloc(((size_t)ds->match_count + 1) * sizeof(uint32_t));
+    if (keys == NULL || ds->matches_by_date == NULL) {
+        free(keys);
+        return NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < ds->match_count; i++) {
+        keys[i].date = ds->matches[i].date;
+        keys[i].match = i;
+    }
+    qsort(keys, ds->match_count, sizeof(DateKey), compare_date_keys);
+    for (uint32_t i = 0; i < ds->match_count; i++) {
+        ds->matches_by_date[i] = keys[i].match;
+    }
+    free(keys);
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: build_player_rows
+ * ============================================================
+ * Counting sort of row numbers by player id; rows of one player stay
+ * in file order.
+ */
+static int build_player_rows(Dataset *ds) {
+    uint32_t players = ds->players.count;
+    uint32_t *next;
+
+    ds->player_first = calloc((size_t)players + 1, sizeof(uint32_t));
+    ds->player_rows = malloc(((size_t)ds->count + 1) * sizeof(uint32_t));
+    next = malloc(((size_t)players + 1) * sizeof(uint32_t));
+    if (ds->player_first == NULL || ds->player_rows == NULL || next == NULL) {
+        free(next);
+        return NO_MEMORY;
+    }
+
+    for (uint32_t row = 0; row < ds->count; row++) {
+        ds->player_first[ds->player[row] + 1]++;
+    }
+    for (uint32_t p = 0; p < players; p++) {
+        ds->player_first[p + 1] += ds->player_first[p];
+    }
+    memcpy(next, ds->player_first, (size_t)players * sizeof(uint32_t));
+    for (uint32_t row = 0; row < ds->count; row++) {
+        ds->player_rows[next[ds->player[row]]++] = row;
+    }
+
+    free(next);
+    return SUCCESS;
+}
+
+/* Looks up the home team; its id is DATASET_NONE if it never plays */
+static void set_home(Dataset *ds, const char *team) {
+    size_t len = strlen(team);
+    long id = intern_find(&ds->teams, team, len);
+
+    memcpy(ds->team_name, team, len + 1);
+    ds->home = id < 0 ? DATASET_NONE : (uint32_t)id;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_open
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - The same RecordReader as every other query (text or column file)
+ * - A bad record fails the whole load: the hw2.h functions would
+ *   return that error for every query on this file
+ */
+int dataset_open(Dataset *ds, const char *in_file, ParseError *err) {
+    RecordReader rd;
+    GameRecord rec;
+    uint32_t *names[2] = { NULL, NULL };
+    int status;
+
+    memset(ds, 0, sizeof(*ds));
+    if (err != NULL) {
+        err->code = SUCCESS;
+        err->line = 0;
+        err->offset = 0;
+    }
+
+    status = reader_open(&rd, in_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    if (intern_init(&ds->players) != SUCCESS || intern_init(&ds->teams) != SUCCESS ||
+        map_dictionary(&rd, READER_PLAYERS, &ds->players, &names[READER_PLAYERS]) != SUCCESS ||
+        map_dictionary(&rd, READER_TEAMS, &ds->teams, &names[READER_TEAMS]) != SUCCESS) {
+        free(names[READER_PLAYERS]);
+        free(names[READER_TEAMS]);
+        reader_close(&rd);
+        dataset_close(ds);
+        return NO_MEMORY;
+    }
+
+    while ((status = reader_next(&rd, &rec)) == RECORD_OK) {
+        if (add_row(ds, &rec, names) != SUCCESS) {
+            status = NO_MEMORY;
+            break;
+        }
+    }
+    free(names[READER_PLAYERS]);
+    free(names[READER_TEAMS]);
+    if (status == RECORD_EOF) {
+        status = SUCCESS;
+    } else if (status != NO_MEMORY && err != NULL) {
+        err->code = status;
+        err->line = rd.err_line;
+        err->offset = rd.err_offset;
+    }
+    reader_close(&rd);
+
+    if (status == SUCCESS) {
+        set_home(ds, "Purdue");
+        status = build_matches(ds);
+    }
+    if (status == SUCCESS) {
+        status = build_player_rows(ds);
+    }
+    if (status != SUCCESS) {
+        dataset_close(ds);
+    }
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_set_team
+ * ============================================================
+ * Matches keep their rows; only the scores change sides.
+ */
+int dataset_set_team(Dataset *ds, const char *team) {
+    size_t len = strlen(team);
+
+    if (len == 0 || len >= MAX_NAME_LENGTH) {
+        return BAD_RECORD;
+    }
+    set_home(ds, team);
+    score_matches(ds);
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_close
+ * ============================================================
+ */
+void dataset_close(Dataset *ds) {
+    free(ds->date);
+    free(ds->player);
+    free(ds->team);
+    free(ds->points);
+    free(ds->assists);
+    free(ds->blocks);
+    free(ds->minutes);
+    free(ds->match_of);
+    free(ds->matches);
+    free(ds->matches_by_date);
+    free(ds->player_first);
+    free(ds->player_rows);
+    intern_free(&ds->players);
+    intern_free(&ds->teams);
+    memset(ds, 0, sizeof(*ds));
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: Lookups
+ * ============================================================
+ */
+
+/* Position in matches_by_date of the first match on or after date */
+static uint32_t first_match_on_or_after(const Dataset *ds, int64_t date) {
+    uint32_t lo = 0, hi = ds->match_count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ds->matches[ds->matches_by_date[mid]].date < date) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Player id, or DATASET_NONE if the name never appears */
+static uint32_t find_player(const Dataset *ds, const char *player_name) {
+    long id = intern_find(&ds->players, player_name, strlen(player_name));
+    return id < 0 ? DATASET_NONE : (uint32_t)id;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_matches_history
+ * ============================================================
+ * Like generate_matches_history(): records of other years are
+ * skipped, so two matches of `year` with the same date that are
+ * separated only by other years' records are one game.
+ */
+static void write_history_match(const Dataset *ds, FILE *fp_out, int year, const DatasetMatch *m,
+                                int *header_written, int *wins, int *losses) {
+    const char *opponent = m->opponent == DATASET_NONE ? ""
+                                                       : intern_name(&ds->teams, m->opponent, NULL);
+
+    if (!*header_written) {
+        fprintf(fp_out, "%d\n", year);
+        *header_written = 1;
+    }
+    fprintf(fp_out, "%02d-%02d:%s(%d)-%s(%d)\n",
+            date_month(m->date), date_day(m->date),
+            ds->team_name, m->home_score, opponent, m->opponent_score);
+
+    if (m->home_score > m->opponent_score) {
+        (*wins)++;
+    } else {
+        (*losses)++;
+    }
+}
+
+int dataset_matches_history(const Dataset *ds, int year, const char *out_file) {
+    DatasetMatch game;
+    int have_game = 0;
+    int header_written = 0;
+    int wins = 0, losses = 0;
+    FILE *fp_out;
+
+    if (year <= 0) {
+        return BAD_DATE;
+    }
+    fp_out = fopen(out_file, "w");
+    if (fp_out == NULL) {
+        return FILE_WRITE_ERR;
+    }
+
+    for (uint32_t i = 0; i < ds->match_count; i++) {
+        const DatasetMatch *m = &ds->matches[i];
+
+        if (m->date >> 9 != year) {
+            continue;
+        }
+        if (have_game && m->date == game.date) {
+            game.home_score += m->home_score;
+            game.opponent_score += m->opponent_score;
+            if (game.opponent == DATASET_NONE) {
+                game.opponent = m->opponent;
+            }
+        } else {
+            if (have_game) {
+                write_history_match(ds, fp_out, year, &game, &header_written, &wins, &losses);
+            }
+            game = *m;
+            have_game = 1;
+        }
+    }
+
+    if (have_game) {
+        write_history_match(ds, fp_out, year, &game, &header_written, &wins, &losses);
+        fprintf(fp_out, "Record: %dW-%dL\n", wins, losses);
+    }
+    fclose(fp_out);
+    return have_game ? SUCCESS : NO_DATA_POINTS;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_most_valuable_player
+ * ============================================================
+ * Binary search to the date, then only that date's rows.
+ */
+double dataset_most_valuable_player(const Dataset *ds, int year, int month, int day) {
+    int64_t date = pack_date(year, month, day);
+    double max_combined_score = -1.0;
+    int found_match = 0;
+
+    if (!is_valid_date(year, month, day)) {
+        return BAD_DATE;
+    }
+
+    for (uint32_t i = first_match_on_or_after(ds, date); i < ds->match_count; i++) {
+        const DatasetMatch *m = &ds->matches[ds->matches_by_date[i]];
+
+        if (m->date != date) {
+            break;
+        }
+        found_match = 1;
+        for (uint32_t row = m->first_row; row < m->first_row + m->rows; row++) {
+            double combined = (double)ds->points[row] +
+                              1.5 * (double)ds->assists[row] +
+                              2.0 * (double)ds->blocks[row] +
+                              0.2 * (double)ds->minutes[row];
+            if (combined > max_combined_score) {
+                max_combined_score = combined;
+            }
+        }
+    }
+
+    return found_match ? max_combined_score : (double)NO_DATA_POINTS;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_average_points_player
+ * ============================================================
+ */
+double dataset_average_points_player(const Dataset *ds, const char *player_name) {
+    uint32_t p = find_player(ds, player_name);
+    int total_points = 0;
+    int match_count = 0;
+
+    if (p == DATASET_NONE) {
+        return NO_DATA_POINTS;
+    }
+    for (uint32_t i = ds->player_first[p]; i < ds->player_first[p + 1]; i++) {
+        total_points += ds->points[ds->player_rows[i]];
+        match_count++;
+    }
+    return match_count == 0 ? (double)NO_DATA_POINTS
+                            : (double)total_points / (double)match_count;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_best_winning_match_score
+ * ============================================================
+ * Only the matches of one month, found by binary search.
+ */
+int dataset_best_winning_match_score(const Dataset *ds, int year, int month) {
+    int64_t first_date = pack_date(year, month, 0);
+    int best_difference = -1;
+    int best_home_score = -1;
+    int found_win = 0;
+
+    if (year <= 0 || month < 1 || month > 12) {
+        return BAD_DATE;
+    }
+
+    for (uint32_t i = first_match_on_or_after(ds, first_date); i < ds->match_count; i++) {
+        const DatasetMatch *m = &ds->matches[ds->matches_by_date[i]];
+        int diff = m->home_score - m->opponent_score;
+
+        if (m->date >> 5 != first_date >> 5) {
+            break;
+        }
+        if (diff > 0 && (diff > best_difference ||
+                         (diff == best_difference && m->home_score > best_home_score))) {
+            best_difference = diff;
+            best_home_score = m->home_score;
+            found_win = 1;
+        }
+    }
+
+    return found_win ? best_home_score : NO_DATA_POINTS;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_best_month
+ * ============================================================
+ */
+int dataset_best_month(const Dataset *ds) {
+    int wins[12] = {0};
+    int total_games[12] = {0};
+    int best_month = -1;
+    double best_rate = -1.0;
+
+    for (uint32_t i = 0; i < ds->match_count; i++) {
+        const DatasetMatch *m = &ds->matches[i];
+        int month = date_month(m->date);
+
+        total_games[month - 1]++;
+        if (m->home_score > m->opponent_score) {
+            wins[month - 1]++;
+        }
+    }
+
+    for (int i = 0; i < 12; i++) {
+        if (total_games[i] > 0) {
+            double rate = (double)wins[i] / (double)total_games[i];
+            if (rate > best_rate) {
+                best_rate = rate;
+                best_month = i + 1;
+            }
+        }
+    }
+
+    if (best_month == -1 || best_rate == 0.0) {
+        return NO_DATA_POINTS;
+    }
+    return best_month;
+}
+
+/* ============================================================
+ * FUNCTION: dataset_player_report
+ * ============================================================
+ * Walks the player's rows in file order. A win counts once per
+ * match, however many rows the player has in it.
+ */
+int dataset_player_report(const Dataset *ds, const char *player_name, const char *out_file) {
+    uint32_t p = find_player(ds, player_name);
+    uint32_t last_match = DATASET_NONE;
+    int total_points = 0, total_assists = 0, total_blocks = 0;
+    float total_minutes = 0;
+    int games = 0, games_won = 0;
+    FILE *fp_out;
+
+    if (p == DATASET_NONE) {
+        return NO_DATA_POINTS;
+    }
+
+    for (uint32_t i = ds->player_first[p]; i < ds->player_first[p + 1]; i++) {
+        uint32_t row = ds->player_rows[i];
+        const DatasetMatch *m = &ds->matches[ds->match_of[row]];
+
+        if (ds->team[row] != ds->home) {
+            continue;
+        }
+        total_points += ds->points[row];
+        total_assists += ds->assists[row];
+        total_blocks += ds->blocks[row];
+        total_minutes += ds->minutes[row];
+        games++;
+        if (ds->match_of[row] != last_match) {
+            last_match = ds->match_of[row];
+            if (m->home_score > m->opponent_score) {
+                games_won++;
+            }
+        }
+    }
+
+    if (games == 0) {
+        return NO_DATA_POINTS;
+    }
+
+    fp_out = fopen(out_file, "w");
+    if (fp_out == NULL) {
+        return FILE_WRITE_ERR;
+    }
+
+    fprintf(fp_out, "Player: %s\n", player_name);
+    fprintf(fp_out, "Games: %d\n", games);
+    fprintf(fp_out, "Games Won: %d\n", games_won);
+    fprintf(fp_out, "Points per Game: %.2f\n", (double)total_points / games);
+    fprintf(fp_out, "Assists per Game: %.2f\n", (double)total_assists / games);
+    fprintf(fp_out, "Blocks per Game: %.2f\n", (double)total_blocks / games);
+    fprintf(fp_out, "Average Minutes: %.2f\n", total_minutes / games);
+
+    fclose(fp_out);
+    return SUCCESS;
+}
@@ -0,0 +1,125 @@
+/*
+ * dataset.h - A game data file loaded into memory once, queried many times
+ *
+ * This file contains:
+ * - The Dataset structure (all records, one array per field)
+ * - Functions to load and free a dataset
+ * - The six hw2.h queries, answered from memory
+ *
+ * Learning Concepts:
+ * - "Structure of arrays": a query that only needs points reads one
+ *   tightly packed int array instead of whole records
+ * - Interned names: players and teams are small integer ids, so
+ *   comparing names is comparing integers
+ * - Precomputing what many queries share (matches, per-player rows)
+ *
+ * Typical use:
+ *   Dataset ds;
+ *   if (dataset_open(&ds, "game_data.txt", NULL) == SUCCESS) {
+ *       printf("%d\n", dataset_best_month(&ds));
+ *       printf("%.2f\n", dataset_average_points_player(&ds, "Z. Edey"));
+ *       dataset_close(&ds);
+ *   }
+ *
+ * Queries only read the dataset, so several threads may query one
+ * dataset at the same time.
+ */
+
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hw2.h"
+#include "intern.h"
+
+/* ========== CONSTANTS ========== */
+#define DATASET_NONE UINT32_MAX   /* "no team" / "no player" id */
+
+/* ========== TYPES ========== */
+
+/*
+ * A match: a run of consecutive records with the same date
+ * (the same grouping the hw2.h functions use).
+ */
+typedef struct {
+    int64_t date;                /* year << 9 | month << 5 | day */
+    uint32_t first_row;
+    uint32_t rows;
+    int home_score;
+    int opponent_score;
+    uint32_t opponent;           /* team id of the first non-home-team row */
+} DatasetMatch;
+
+/*
+ * All records of one file. Row i is date[i], player[i], team[i], ...
+ * Treat as private; use the functions below.
+ */
+typedef struct {
+    uint32_t count, capacity;
+
+    /* One array per field */
+    int64_t *date;               /* year << 9 | month << 5 | day */
+    uint32_t *player;            /* id in players */
+    uint32_t *team;              /* id in teams */
+    int *points, *assists, *blocks;
+    float *minutes;
+    uint32_t *match_of;          /* row -> match number */
+
+    InternTable players, teams;
+    uint32_t home;               /* team id of the home team, or DATASET_NONE */
+    char team_name[MAX_NAME_LENGTH];  /* the home team, "Purdue" by default */
+
+    /* Matches in file order, and the same matches sorted by date */
+    DatasetMatch *matches;
+    uint32_t match_count;
+    uint32_t *matches_by_date;
+
+    /* Rows of player p: player_rows[player_first[p] .. player_first[p + 1]) */
+    uint32_t *player_first;
+    uint32_t *player_rows;
+} Dataset;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * dataset_open
+ *
+ * Reads in_file (text or column file) into memory.
+ *
+ * Returns:
+ *   SUCCESS, FILE_READ_ERR, NO_MEMORY, or the BAD_RECORD / BAD_DATE
+ *   the hw2.h functions would report for this file (err, if not NULL,
+ *   gets its location). On failure there is nothing to close.
+ */
+int dataset_open(Dataset *ds, const char *in_file, ParseError *err);
+
+/*
+ * dataset_close
+ *
+ * Frees everything dataset_open() allocated.
+ */
+void dataset_close(Dataset *ds);
+
+/*
+ * dataset_set_team
+ *
+ * Makes `team` the home team of the queries below (where hw2.h counts
+ * Purdue's rows), like hw2_set_team(). Cheap: no record is re-read.
+ *
+ * Returns: SUCCESS, or BAD_RECORD if team is empty or too long
+ */
+int dataset_set_team(Dataset *ds, const char *team);
+
+/*
+ * The six queries. Parameters and return values are exactly those of
+ * the matching hw2.h function (without in_file).
+ */
+int dataset_matches_history(const Dataset *ds, int year, const char *out_file);
+double dataset_most_valuable_player(const Dataset *ds, int year, int month, int day);
+double dataset_average_points_player(const Dataset *ds, const char *player_name);
+int dataset_best_winning_match_score(const Dataset *ds, int year, int month);
+int dataset_best_month(const Dataset *ds);
+int dataset_player_report(const Dataset *ds, const char *player_name, const char *out_file);
+
+#endif /* DATASET_H */
@@ -0,0 +1,68 @@
+/*
+ * encoding.h - Small helpers shared by the file formats and the queries
+ *
+ * This file contains:
+ * - put_le / get_le: integers of 1 to 8 bytes in little-endian order
+ * - pack_date: a date as one number that sorts in calendar order
+ * - MTIME_NSEC: the nanosecond part of a file's modification time
+ *
+ * Learning Concepts:
+ * - A file format that fixes its byte order reads the same on every
+ *   machine; writing byte by byte needs no byte-swapping functions
+ * - static inline helpers in a header: one definition for every file
+ *   that includes it, and no function call in the hot loops
+ *
+ * Typical use:
+ *   unsigned char header[16];
+ *   put_le(header + 8, version, 4);
+ *   if (get_le(header + 8, 4) != version) { ... }
+ */
+
+#ifndef ENCODING_H
+#define ENCODING_H
+
+#include <stdint.h>
+
+/* ========== MACROS ========== */
+
+/* Nanosecond part of a modification time (struct stat st) */
+#if defined(__APPLE__)
+#define MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#else
+#define MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+/* ========== FUNCTIONS ========== */
+
+/*
+ * put_le / get_le
+ *
+ * Store the low width bytes of value at p, least significant first,
+ * and read them back (width 1 to 8).
+ */
+static inline void put_le(unsigned char *p, uint64_t value, unsigned width) {
+    for (unsigned i = 0; i < width; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static inline uint64_t get_le(const unsigned char *p, unsigned width) {
+    uint64_t value = 0;
+
+    for (unsigned i = 0; i < width; i++) {
+        value |= (uint64_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+/*
+ * pack_date
+ *
+ * year << 9 | month << 5 | day: packed dates sort in calendar order,
+ * date >> 5 is year << 4 | month and date >> 9 is the year.
+ */
+static inline long long pack_date(int year, int month, int day) {
+    return (long long)year << 9 | (long long)month << 5 | (long long)day;
+}
+
+#endif /* ENCODING_H */
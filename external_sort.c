@@ -0,0 +1,853 @@
+/*
+ * external_sort.c - Sort a game data file that does not fit in memory
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Run generation: read a batch, sort it, write it to a tmpfile()
+ * 2. LSD radix sort on the packed date, then qsort_r() within a date
+ * 3. A loser tree merging up to SORT_MAX_FANIN runs at once
+ * 4. One thread per slice of a batch (pthread_create / pthread_join)
+ *
+ * See external_sort.h for the order the output is in.
+ */
+
+/* Needed for qsort_r(), sysconf() and 64-bit file offsets with -std=c17 */
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "hw2.h"
+#include "record_reader.h"
+#include "output_writer.h"
+#include "external_sort.h"
+
+/* ========== CONSTANTS ========== */
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define MIN_SLICE  4096          /* smaller batches are not split between threads */
+
+/* ========== TYPES ========== */
+
+/*
+ * The sort key of a record. In a run file each record is this
+ * header followed by its line (without the '\n').
+ */
+typedef struct {
+    uint64_t date;               /* year << 9 | month << 5 | day */
+    uint32_t line_len;
+    uint32_t team_off, team_len;      /* the names, inside the line */
+    uint32_t player_off, player_len;
+    uint32_t reserved;
+} RunHeader;
+
+/* A record of a batch; its line is at text + offset */
+typedef struct {
+    RunHeader key;
+    size_t offset;
+} SortItem;
+
+/* Records read since the last run was written */
+typedef struct {
+    char *text;                  /* the lines, back to back */
+    size_t text_len, text_cap;
+    SortItem *items;
+    size_t count, item_cap;
+} Batch;
+
+/* Buffered writes to a run file */
+typedef struct {
+    FILE *fp;
+    char *buf;
+    size_t len;
+    int failed;
+} RunWriter;
+
+/* One slice of a batch, sorted by one thread */
+typedef struct {
+    pthread_t thread;
+    int started;                 /* thread is running (else done inline) */
+    const char *text;
+    SortItem *items, *scratch;
+    size_t count;
+    SortItem *sorted;            /* items or scratch, once sorted */
+    FILE *run;                   /* written here, or NULL to keep it in memory */
+    int status;
+} SliceJob;
+
+/* The runs waiting to be merged, oldest records first */
+typedef struct {
+    FILE **files;
+    size_t count, capacity;
+} RunList;
+
+/* One input of the merge: a run file, or a sorted slice in memory */
+typedef struct {
+    FILE *fp;                    /* NULL for a slice */
+    unsigned char *buf;
+    size_t cap, pos, len;
+    const SortItem *items;       /* slice: records not yet merged */
+    size_t left;
+    const char *text;
+    int done;
+    RunHeader key;               /* the current record */
+    const char *line;
+} MergeSource;
+
+/* The final output, with the lines seen so far for the current key */
+typedef struct {
+    OutFile *file;
+    OutBuf text;
+    int dedup;
+    RunHeader group_key;
+    char *group;                 /* uint32 length + line, per line of the key */
+    size_t group_len, group_cap;
+    long long duplicates;
+} Emitter;
+
+/* ========== COMPARING KEYS ========== */
+
+static int compare_names(const char *a, size_t a_len, const char *b, size_t b_len) {
+    int c = memcmp(a, b, a_len < b_len ? a_len : b_len);
+
+    if (c != 0) {
+        return c;
+    }
+    return a_len < b_len ? -1 : a_len > b_len;
+}
+
+/* Date, then team, then player */
+static int compare_keys(const RunHeader *a, const char *a_line,
+                        const RunHeader *b, const char *b_line) {
+    int c;
+
+    if (a->date != b->date) {
+        return a->date < b->date ? -1 : 1;
+    }
+    c = compare_names(a_line + a->team_off, a->team_len, b_line + b->team_off, b->team_len);
+    if (c != 0) {
+        return c;
+    }
+    return compare_names(a_line + a->player_off, a->player_len,
+                         b_line + b->player_off, b->player_len);
+}
+
+/* qsort_r() comparator: equal keys stay in file order (text offset) */
+static int compare_items(const void *a, const void *b, void *text) {
+    const SortItem *x = a;
+    const SortItem *y = b;
+    int c = compare_keys(&x->key, (const char *)text + x->offset,
+                         &y->key, (const char *)text + y->offset);
+
+    if (c != 0) {
+        return c;
+    }
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+/* ========== SORTING A SLICE ========== */
+
+/*
+ * Stable LSD radix sort of items[0..n) by date, RADIX_BITS at a time,
+ * only over the bits some date uses. Returns items or scratch,
+ * whichever holds the result.
+ */
+static SortItem *radix_sort_dates(SortItem *items, SortItem *scratch, size_t n) {
+    size_t count[RADIX_SIZE];
+    SortItem *from = items;
+    SortItem *to = scratch;
+    uint64_t used = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        used |= items[i].key.date;
+    }
+
+    for (int shift = 0; shift < 64 && (used >> shift) != 0; shift += RADIX_BITS) {
+        SortItem *swap;
+        size_t sum = 0;
+
+        memset(count, 0, sizeof(count));
+        for (size_t i = 0; i < n; i++) {
+            count[(from[i].key.date >> shift) & (RADIX_SIZE - 1)]++;
+        }
+        for (int d = 0; d < RADIX_SIZE; d++) {
+            size_t c = count[d];
+            count[d] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            to[count[(from[i].key.date >> shift) & (RADIX_SIZE - 1)]++] = from[i];
+        }
+        swap = from;
+        from = to;
+        to = swap;
+    }
+    return from;
+}
+
+static int run_put(RunWriter *w, const RunHeader *key, const char *line);
+static int run_flush(RunWriter *w);
+
+/* Thread body: sort a slice, then write it to its run file */
+static void *sort_slice(void *arg) {
+    SliceJob *job = arg;
+    SortItem *sorted = radix_sort_dates(job->items, job->scratch, job->count);
+    size_t start = 0;
+    RunWriter w;
+
+    /* Within each date, order by team and player */
+    while (start < job->count) {
+        size_t end = start + 1;
+        while (end < job->count && sorted[end].key.date == sorted[start].key.date) {
+            end++;
+        }
+        if (end - start > 1) {
+            qsort_r(sorted + start, end - start, sizeof(SortItem), compare_items, (void *)job->text);
+        }
+        start = end;
+    }
+    job->sorted = sorted;
+    job->status = SUCCESS;
+
+    if (job->run != NULL) {
+        w.fp = job->run;
+        w.len = 0;
+        w.failed = 0;
+        w.buf = malloc(SORT_IO_SIZE);
+        if (w.buf == NULL) {
+            job->status = NO_MEMORY;
+            return NULL;
+        }
+        for (size_t i = 0; i < job->count && !w.failed; i++) {
+            run_put(&w, &sorted[i].key, job->text + sorted[i].offset);
+        }
+        job->status = run_flush(&w);
+        free(w.buf);
+    }
+    return NULL;
+}
+
+/* ========== RUN FILES ========== */
+
+static int run_flush(RunWriter *w) {
+    if (!w->failed && w->len > 0 && fwrite(w->buf, 1, w->len, w->fp) != w->len) {
+        w->failed = 1;
+    }
+    w->len = 0;
+    if (!w->failed && fflush(w->fp) != 0) {
+        w->failed = 1;
+    }
+    return w->failed ? FILE_WRITE_ERR : SUCCESS;
+}
+
+static int run_put(RunWriter *w, const RunHeader *key, const char *line) {
+    size_t size = sizeof(RunHeader) + key->line_len;
+
+    if (w->len + size > SORT_IO_SIZE) {
+        if (w->len > 0 && fwrite(w->buf, 1, w->len, w->fp) != w->len) {
+            w->failed = 1;
+        }
+        w->len = 0;
+    }
+    if (size > SORT_IO_SIZE) {
+        /* A line longer than the buffer goes straight to the file */
+        if (fwrite(key, sizeof(RunHeader), 1, w->fp) != 1 ||
+            fwrite(line, 1, key->line_len, w->fp) != key->line_len) {
+            w->failed = 1;
+        }
+    } else {
+        memcpy(w->buf + w->len, key, sizeof(RunHeader));
+        memcpy(w->buf + w->len + sizeof(RunHeader), line, key->line_len);
+        w->len += size;
+    }
+    return w->failed ? FILE_WRITE_ERR : SUCCESS;
+}
+
+static int runs_add(RunList *runs, FILE *fp) {
+    if (runs->count == runs->capacity) {
+        size_t capacity = runs->capacity == 0 ? 16 : runs->capacity * 2;
+        FILE **files = realloc(runs->files, capacity * sizeof(FILE *));
+        if (files == NULL) {
+            return NO_MEMORY;
+        }
+        runs->files = files;
+        runs->capacity = capacity;
+    }
+    runs->files[runs->count++] = fp;
+    return SUCCESS;
+}
+
+static void runs_free(RunList *runs) {
+    for (size_t i = 0; i < runs->count; i++) {
+        fclose(runs->files[i]);  /* tmpfile(): also deletes it */
+    }
+    free(runs->files);
+    runs->files = NULL;
+    runs->count = runs->capacity = 0;
+}
+
+/* ========== THE MERGE ========== */
+
+/* Makes the next record of s current, or sets s->done */
+static int source_next(MergeSource *s) {
+    size_t size;
+
+    if (s->fp == NULL) {
+        if (s->left == 0) {
+            s->done = 1;
+        } else {
+            s->key = s->items->key;
+            s->line = s->text + s->items->offset;
+            s->items++;
+            s->left--;
+        }
+        return SUCCESS;
+    }
+
+    /* Keep a whole record in the buffer: header first, then its line */
+    size = sizeof(RunHeader);
+    for (int part = 0; part < 2; part++) {
+        if (s->len - s->pos < size) {
+            memmove(s->buf, s->buf + s->pos, s->len - s->pos);
+            s->len -= s->pos;
+            s->pos = 0;
+            s->len += fread(s->buf + s->len, 1, s->cap - s->len, s->fp);
+            if (ferror(s->fp)) {
+                return FILE_READ_ERR;
+            }
+            if (s->len < size) {
+                if (part == 0 && s->len == 0) {
+                    s->done = 1;
+                    return SUCCESS;
+                }
+                return FILE_READ_ERR;  /* a truncated run */
+            }
+        }
+        if (part == 0) {
+            memcpy(&s->key, s->buf + s->pos, sizeof(RunHeader));
+            size += s->key.line_len;
+            if (size > s->cap) {
+                return FILE_READ_ERR;
+            }
+        }
+    }
+    s->line = (const char *)s->buf + s->pos + sizeof(RunHeader);
+    s->pos += size;
+    return SUCCESS;
+}
+
+/* Does source a come before source b? Finished sources come last */
+static int source_less(const MergeSource *src, size_t a, size_t b) {
+    int c;
+
+    if (src[a].done || src[b].done) {
+        return src[b].done && (!src[a].done || a < b);
+    }
+    c = compare_keys(&src[a].key, src[a].line, &src[b].key, src[b].line);
+    return c < 0 || (c == 0 && a < b);  /* earlier runs hold earlier records */
+}
+
+/*
+ * Loser tree over k sources: leaves k..2k-1 are the sources, internal
+ * node n (1 <= n < k) holds the loser of the match between its two
+ * children, and node[0] the overall winner. After the winner moves on
+ * to its next record, only the matches on its path are replayed.
+ */
+static void tree_build(const MergeSource *src, size_t k, size_t *node, size_t *winner) {
+    for (size_t i = 0; i < k; i++) {
+        winner[k + i] = i;
+    }
+    for (size_t n = k - 1; n >= 1; n--) {
+        size_t a = winner[2 * n];
+        size_t b = winner[2 * n + 1];
+        if (source_less(src, a, b)) {
+            winner[n] = a;
+            node[n] = b;
+        } else {
+            winner[n] = b;
+            node[n] = a;
+        }
+    }
+    node[0] = k > 1 ? winner[1] : 0;
+}
+
+static void tree_replay(const MergeSource *src, size_t k, size_t *node, size_t leaf) {
+    size_t winner = leaf;
+
+    for (size_t n = (leaf + k) / 2; n >= 1; n /= 2) {
+        if (source_less(src, node[n], winner)) {
+            size_t loser = winner;
+            winner = node[n];
+            node[n] = loser;
+        }
+    }
+    node[0] = winner;
+}
+
+static int emit(Emitter *e, const RunHeader *key, const char *line);
+
+/* Merges src[0..k) into a run file (out) or the final output (e) */
+static int merge(MergeSource *src, size_t k, RunWriter *out, Emitter *e) {
+    size_t *node = malloc(k * sizeof(size_t));
+    size_t *winner = malloc(2 * k * sizeof(size_t));
+    int status = SUCCESS;
+
+    if (node == NULL || winner == NULL) {
+        free(node);
+        free(winner);
+        return NO_MEMORY;
+    }
+    for (size_t i = 0; i < k && status == SUCCESS; i++) {
+        status = source_next(&src[i]);
+    }
+    if (status == SUCCESS) {
+        tree_build(src, k, node, winner);
+    }
+
+    while (status == SUCCESS && !src[node[0]].done) {
+        MergeSource *s = &src[node[0]];
+
+        status = out != NULL ? run_put(out, &s->key, s->line) : emit(e, &s->key, s->line);
+        if (status == SUCCESS) {
+            status = source_next(s);
+        }
+        tree_replay(src, k, node, node[0]);
+    }
+
+    free(node);
+    free(winner);
+    return status;
+}
+
+/* Merges files[0..k) from their start, each through a buffer of buffer_size */
+static int merge_files(FILE **files, size_t k, size_t buffer_size, RunWriter *out, Emitter *e) {
+    MergeSource *src = calloc(k, sizeof(MergeSource));
+    int status = SUCCESS;
+
+    if (src == NULL) {
+        return NO_MEMORY;
+    }
+    for (size_t i = 0; i < k && status == SUCCESS; i++) {
+        src[i].fp = files[i];
+        src[i].cap = buffer_size;
+        src[i].buf = malloc(buffer_size);
+        if (src[i].buf == NULL) {
+            status = NO_MEMORY;
+        } else if (fseek(files[i], 0, SEEK_SET) != 0) {
+            status = FILE_READ_ERR;
+        }
+    }
+    if (status == SUCCESS) {
+        status = merge(src, k, out, e);
+    }
+    for (size_t i = 0; i < k; i++) {
+        free(src[i].buf);
+    }
+    free(src);
+    return status;
+}
+
+/* ========== OUTPUT ========== */
+
+/* Was this line already written with the current key? */
+static int seen_in_group(const Emitter *e, const char *line, uint32_t len) {
+    size_t pos = 0;
+
+    while (pos < e->group_len) {
+        uint32_t seen_len;
+        memcpy(&seen_len, e->group + pos, sizeof(seen_len));
+        pos += sizeof(seen_len);
+        if (seen_len == len && memcmp(e->group + pos, line, len) == 0) {
+            return 1;
+        }
+        pos += seen_len;
+    }
+    return 0;
+}
+
+static int emit(Emitter *e, const RunHeader *key, const char *line) {
+    if (e->dedup) {
+        size_t need = sizeof(uint32_t) + key->line_len;
+
+        if (e->group_len == 0 ||
+            compare_keys(key, line, &e->group_key, e->group + sizeof(uint32_t)) != 0) {
+            e->group_len = 0;
+            e->group_key = *key;
+        } else if (seen_in_group(e, line, key->line_len)) {
+            e->duplicates++;
+            return SUCCESS;
+        }
+
+        if (e->group_len + need > e->group_cap) {
+            size_t capacity = e->group_cap == 0 ? 1024 : e->group_cap;
+            char *group;
+            while (capacity < e->group_len + need) {
+                capacity *= 2;
+            }
+            group = realloc(e->group, capacity);
+            if (group == NULL) {
+                return NO_MEMORY;
+            }
+            e->group = group;
+            e->group_cap = capacity;
+        }
+        memcpy(e->group + e->group_len, &key->line_len, sizeof(uint32_t));
+        memcpy(e->group + e->group_len + sizeof(uint32_t), line, key->line_len);
+        e->group_len += need;
+    }
+
+    out_text(&e->text, line, key->line_len);
+    out_char(&e->text, '\n');
+    if (e->text.len >= SORT_IO_SIZE) {
+        outfile_write(e->file, &e->text);
+    }
+    return e->text.failed ? NO_MEMORY : SUCCESS;
+}
+
+/* ========== BATCHES ========== */
+
+static size_t batch_bytes(const Batch *b) {
+    return b->text_len + b->count * 2 * sizeof(SortItem);  /* items + radix scratch */
+}
+
+static int batch_add(Batch *b, const GameRecord *rec, const char *line, size_t len, size_t budget) {
+    SortItem *item;
+
+    if (len > UINT32_MAX) {
+        return BAD_RECORD;
+    }
+    if (b->text_len + len > b->text_cap) {
+        size_t capacity = b->text_cap == 0 ? 64 * 1024 : b->text_cap * 2;
+        char *text;
+        if (capacity > budget) {
+            capacity = budget;
+        }
+        if (capacity < b->text_len + len) {
+            capacity = b->text_len + len;
+        }
+        text = realloc(b->text, capacity);
+        if (text == NULL) {
+            return NO_MEMORY;
+        }
+        b->text = text;
+        b->text_cap = capacity;
+    }
+    if (b->count == b->item_cap) {
+        size_t capacity = b->item_cap == 0 ? 1024 : b->item_cap * 2;
+        SortItem *items = realloc(b->items, capacity * sizeof(SortItem));
+        if (items == NULL) {
+            return NO_MEMORY;
+        }
+        b->items = items;
+        b->item_cap = capacity;
+    }
+
+    item = &b->items[b->count++];
+    item->key.date = (uint64_t)rec->year << 9 | (uint64_t)rec->month << 5 | (uint64_t)rec->day;
+    item->key.line_len = (uint32_t)len;
+    item->key.team_off = (uint32_t)(rec->team - line);
+    item->key.team_len = (uint32_t)rec->team_len;
+    item->key.player_off = (uint32_t)(rec->player - line);
+    item->key.player_len = (uint32_t)rec->player_len;
+    item->key.reserved = 0;
+    item->offset = b->text_len;
+    memcpy(b->text + b->text_len, line, len);
+    b->text_len += len;
+    return SUCCESS;
+}
+
+/*
+ * Sorts the batch in slices on up to `threads` threads. If runs is
+ * not NULL each slice becomes a run; otherwise the slices are left
+ * sorted in memory (jobs[0..*slices) say where).
+ */
+static int batch_sort(Batch *b, int threads, RunList *runs, SortItem **scratch,
+                      SliceJob *jobs, int *slices) {
+    size_t per_slice;
+    int n = threads;
+    int status = SUCCESS;
+
+    if (b->count / MIN_SLICE < (size_t)n) {
+        n = (int)(b->count / MIN_SLICE);
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    *scratch = malloc((b->count > 0 ? b->count : 1) * sizeof(SortItem));
+    if (*scratch == NULL) {
+        return NO_MEMORY;
+    }
+
+    per_slice = (b->count + (size_t)n - 1) / (size_t)n;
+    for (int i = 0; i < n; i++) {
+        size_t lo = (size_t)i * per_slice;
+        size_t hi = lo + per_slice < b->count ? lo + per_slice : b->count;
+
+        jobs[i].text = b->text;
+        jobs[i].items = b->items + lo;
+        jobs[i].scratch = *scratch + lo;
+        jobs[i].count = hi - lo;
+        jobs[i].sorted = jobs[i].items;
+        jobs[i].status = SUCCESS;
+        jobs[i].run = NULL;
+        if (runs != NULL) {
+            jobs[i].run = tmpfile();
+            if (jobs[i].run == NULL || runs_add(runs, jobs[i].run) != SUCCESS) {
+                if (jobs[i].run != NULL) {
+                    fclose(jobs[i].run);
+                }
+                *slices = i;
+                return FILE_WRITE_ERR;
+            }
+        }
+    }
+
+    /* Slice 0 on this thread, the others on their own */
+    for (int i = 1; i < n; i++) {
+        jobs[i].started = pthread_create(&jobs[i].thread, NULL, sort_slice, &jobs[i]) == 0;
+        if (!jobs[i].started) {
+            sort_slice(&jobs[i]);
+        }
+    }
+    sort_slice(&jobs[0]);
+    for (int i = 1; i < n; i++) {
+        if (jobs[i].started) {
+            pthread_join(jobs[i].thread, NULL);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (jobs[i].status != SUCCESS) {
+            status = jobs[i].status;
+        }
+    }
+    *slices = n;
+    return status;
+}
+
+/* Writes the batch as runs and empties it */
+static int batch_spill(Batch *b, int threads, RunList *runs, SortStats *stats) {
+    SliceJob jobs[SORT_MAX_THREADS];
+    SortItem *scratch = NULL;
+    int slices = 0;
+    int status = batch_sort(b, threads, runs, &scratch, jobs, &slices);
+
+    free(scratch);
+    stats->runs += slices;
+    b->text_len = 0;
+    b->count = 0;
+    return status;
+}
+
+/* ========== PUBLIC API ========== */
+
+void sort_defaults(SortOptions *opt) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    opt->memory_budget = SORT_DEFAULT_BUDGET;
+    opt->threads = cpus < 1 ? 1 : cpus > SORT_MAX_THREADS ? SORT_MAX_THREADS : (int)cpus;
+    opt->dedup = 0;
+}
+
+/*
+ * FUNCTION: sort_file
+ *
+ * IMPLEMENTATION:
+ * 1. Read records into a batch until it holds memory_budget bytes,
+ *    then sort it (radix sort on the date, qsort_r() within a date)
+ *    and write each thread's slice to a tmpfile() as a run
+ * 2. While there are more than SORT_MAX_FANIN runs, merge groups of
+ *    neighbouring runs into longer ones (a merge pass)
+ * 3. Merge the last runs into out_file; a file that fit in one batch
+ *    is merged straight from memory instead
+ */
+int sort_file(const char *in_file, const char *out_file, const SortOptions *opt, SortStats *stats) {
+    SortOptions defaults;
+    SortStats local_stats;
+    RecordReader rd;
+    GameRecord rec;
+    Batch batch;
+    RunList runs = {NULL, 0, 0};
+    OutputWriter writer;
+    OutFile *file = NULL;
+    Emitter e;
+    size_t budget;
+    size_t longest = 0;
+    int threads;
+    int status;
+
+    if (opt == NULL) {
+        sort_defaults(&defaults);
+        opt = &defaults;
+    }
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    memset(stats, 0, sizeof(*stats));
+    stats->error.code = SUCCESS;
+    budget = opt->memory_budget < SORT_MIN_BUDGET ? SORT_MIN_BUDGET : opt->memory_budget;
+    threads = opt->threads < 1 ? 1 : opt->threads > SORT_MAX_THREADS ? SORT_MAX_THREADS : opt->threads;
+
+    status = reader_open(&rd, in_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    if (rd.columns != NULL) {
+        reader_close(&rd);
+        return FILE_READ_ERR;
+    }
+
+    memset(&batch, 0, sizeof(batch));
+    memset(&e, 0, sizeof(e));
+    e.dedup = opt->dedup;
+    outbuf_init(&e.text);
+
+    /* 1. Batches and runs */
+    while (status == SUCCESS) {
+        const char *line;
+        int got = reader_next(&rd, &rec);
+
+        if (got == RECORD_EOF) {
+            break;
+        }
+        if (got != RECORD_OK) {
+            if (got == BAD_RECORD || got == BAD_DATE) {
+                stats->error.code = got;
+                stats->error.line = rd.err_line;
+                stats->error.offset = rd.err_offset;
+            }
+            status = got;
+            break;
+        }
+
+        /* The whole line is still in the reader's window */
+        line = rd.base + (rd.rec_offset - rd.base_offset);
+        status = batch_add(&batch, &rec, line, (size_t)(rd.pos - line), budget);
+        if ((size_t)(rd.pos - line) > longest) {
+            longest = (size_t)(rd.pos - line);
+        }
+        stats->records++;
+        if (status == SUCCESS && batch_bytes(&batch) >= budget) {
+            status = batch_spill(&batch, threads, &runs, stats);
+        }
+    }
+    reader_close(&rd);
+
+    /*
+     * Opened only now: an out_file written in place (a symlink, say)
+     * may be in_file itself, and opening truncates it
+     */
+    if (writer_init(&writer, 0) != SUCCESS) {
+        status = status == SUCCESS ? NO_MEMORY : status;
+        free(batch.text);
+        free(batch.items);
+        runs_free(&runs);
+        return status;
+    }
+    if (status == SUCCESS) {
+        status = outfile_open(&writer, out_file, &file);
+    }
+    e.file = file;
+
+    if (status == SUCCESS && runs.count == 0) {
+        /* 3. Everything fit in one batch: merge its slices in memory */
+        SliceJob jobs[SORT_MAX_THREADS];
+        MergeSource src[SORT_MAX_THREADS];
+        SortItem *scratch = NULL;
+        int slices = 0;
+
+        status = batch_sort(&batch, threads, NULL, &scratch, jobs, &slices);
+        if (status == SUCCESS) {
+            memset(src, 0, sizeof(src));
+            for (int i = 0; i < slices; i++) {
+                src[i].items = jobs[i].sorted;
+                src[i].left = jobs[i].count;
+                src[i].text = batch.text;
+            }
+            status = merge(src, (size_t)slices, NULL, &e);
+        }
+        free(scratch);
+    } else if (status == SUCCESS) {
+        size_t buffer_size;
+
+        if (batch.count > 0) {
+            status = batch_spill(&batch, threads, &runs, stats);
+        }
+        free(batch.text);
+        free(batch.items);
+        memset(&batch, 0, sizeof(batch));
+
+        /* Each run gets an equal share of the budget, and room for the longest record */
+        buffer_size = budget / (runs.count < SORT_MAX_FANIN ? runs.count : SORT_MAX_FANIN);
+        if (buffer_size < SORT_MIN_BUDGET) {
+            buffer_size = SORT_MIN_BUDGET;
+        }
+        if (buffer_size < sizeof(RunHeader) + longest) {
+            buffer_size = sizeof(RunHeader) + longest;
+        }
+
+        /* 2. Merge passes until one merge can take every run */
+        while (status == SUCCESS && runs.count > SORT_MAX_FANIN) {
+            RunList merged = {NULL, 0, 0};
+            size_t used = 0;
+
+            stats->merge_passes++;
+            while (status == SUCCESS && used < runs.count) {
+                size_t k = runs.count - used < SORT_MAX_FANIN ? runs.count - used : SORT_MAX_FANIN;
+                RunWriter w = {tmpfile(), malloc(SORT_IO_SIZE), 0, 0};
+
+                if (w.fp == NULL || w.buf == NULL) {
+                    status = w.fp == NULL ? FILE_WRITE_ERR : NO_MEMORY;
+                } else {
+                    status = merge_files(runs.files + used, k, buffer_size, &w, NULL);
+                    if (status == SUCCESS) {
+                        status = run_flush(&w);
+                    }
+                }
+                free(w.buf);
+                if (w.fp != NULL && runs_add(&merged, w.fp) != SUCCESS) {
+                    fclose(w.fp);
+                    status = NO_MEMORY;
+                }
+                /* The merged runs are no longer needed */
+                for (size_t i = used; i < used + k; i++) {
+                    fclose(runs.files[i]);
+                }
+                used += k;
+            }
+            /* Runs a failed pass did not reach are closed with the list */
+            runs.count -= used;
+            memmove(runs.files, runs.files + used, runs.count * sizeof(FILE *));
+            runs_free(&runs);
+            runs = merged;
+        }
+
+        /* 3. The last pass writes the output */
+        if (status == SUCCESS) {
+            stats->merge_passes++;
+            status = merge_files(runs.files, runs.count, buffer_size, NULL, &e);
+        }
+    }
+
+    free(batch.text);
+    free(batch.items);
+    runs_free(&runs);
+    free(e.group);
+    stats->duplicates = e.duplicates;
+
+    if (status == SUCCESS) {
+        outfile_close(file, &e.text);
+    } else if (file != NULL) {
+        outfile_discard(file);
+    }
+    writer_finish(&writer);
+    if (status == SUCCESS) {
+        status = outfile_status(file);
+    }
+    writer_free(&writer);
+    outbuf_free(&e.text);
+    return status;
+}
@@ -0,0 +1,98 @@
+/*
+ * external_sort.h - Sort a game data file that does not fit in memory
+ *
+ * This file contains:
+ * - The SortOptions and SortStats structures
+ * - sort_file(), which rewrites a file in (date, team, player) order
+ *
+ * Learning Concepts:
+ * - External merge sort: sort memory-sized batches into "runs" on
+ *   disk, then merge the runs in one sequential pass
+ * - LSD radix sort on a packed integer key (the date), which costs a
+ *   few linear passes instead of n log n comparisons
+ * - A loser tree (tournament tree) for the k-way merge: one
+ *   comparison per level to replace the record just written
+ * - Sorting batches on several threads at once (pthreads)
+ *
+ * Every function in hw2.h wants a file in date order; logs merged
+ * from several scorekeepers are not (game_groups.h copes with them
+ * on every query). Sorting the file once fixes it for good:
+ *
+ *   ./hw2_sort merged_log.txt game_data.txt
+ *
+ * The order is date, then team name, then player name (bytes, as
+ * memcmp() orders them). Records with the same key keep their file
+ * order, so a player's two rows of a doubleheader stay in game order.
+ * Lines are copied as they are; the output ends every line with '\n'
+ * and has no blank lines.
+ */
+
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <stddef.h>
+#include "hw2.h"
+
+/* ========== CONSTANTS ========== */
+#define SORT_DEFAULT_BUDGET ((size_t)256 << 20)  /* bytes of records in memory */
+#define SORT_MIN_BUDGET     ((size_t)64 << 10)
+#define SORT_MAX_THREADS    64
+#define SORT_MAX_FANIN      128    /* runs merged at once */
+#define SORT_IO_SIZE        (1 << 20)  /* bytes per read / write of the merge */
+
+/* ========== TYPES ========== */
+
+/* How sort_file() works; sort_defaults() fills in the defaults */
+typedef struct {
+    size_t memory_budget;        /* about this many bytes of records in memory */
+    int threads;                 /* threads sorting each batch (1 = none) */
+    int dedup;                   /* drop lines identical to an earlier one */
+} SortOptions;
+
+/* What a sort_file() did */
+typedef struct {
+    long long records;           /* records read */
+    long long duplicates;        /* lines dropped by dedup */
+    long long runs;              /* sorted runs written to temporary files */
+    int merge_passes;            /* 0 if the input fit in one batch */
+    ParseError error;            /* where the bad record is, if any */
+} SortStats;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * sort_defaults
+ *
+ * SORT_DEFAULT_BUDGET, one thread per online CPU, no dedup.
+ */
+void sort_defaults(SortOptions *opt);
+
+/*
+ * sort_file
+ *
+ * Reads in_file (a text file; plain, a pipe, or gzip / zstd) and
+ * writes its records to out_file in (date, team, player) order.
+ * Batches of about opt->memory_budget bytes (at least
+ * SORT_MIN_BUDGET) are sorted in memory and written to tmpfile()s;
+ * an input that fits in one batch is written out directly. Batches
+ * are split between opt->threads threads.
+ *
+ * With opt->dedup, a line identical (byte for byte) to an earlier
+ * line is dropped: duplicates have the same key, so they meet in the
+ * merge.
+ *
+ * out_file appears only once it is complete (output_writer.h), so
+ * out_file may be in_file. opt and stats may be NULL.
+ *
+ * Returns:
+ *   SUCCESS
+ *   FILE_READ_ERR  - in_file cannot be read, or is a column file
+ *                    (sort the text file, then convert it)
+ *   FILE_WRITE_ERR - out_file or a temporary file cannot be written
+ *   NO_MEMORY
+ *   BAD_RECORD / BAD_DATE - a bad record; stats->error says where,
+ *                    and nothing is written
+ */
+int sort_file(const char *in_file, const char *out_file, const SortOptions *opt, SortStats *stats);
+
+#endif /* EXTERNAL_SORT_H */
@@ -0,0 +1,546 @@
+/*
+ * file_index.c - Date / player index sidecar files
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Building lookup tables in one scan, then sorting them with qsort()
+ * 2. Counting sort: grouping postings by player without comparisons
+ * 3. Binary search over a memory-mapped, sorted table
+ * 4. Cache validation: size + modification time + a cheap checksum
+ *
+ * See file_index.h for the file layout.
+ */
+
+/* Needed for pread(), st_mtim and 64-bit file offsets with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hw2.h"
+#include "encoding.h"
+#include "intern.h"
+#include "record_reader.h"
+#include "file_index.h"
+
+/* ========== BUILD-TIME TYPES ========== */
+
+typedef struct {
+    long long start;
+    long long end;
+    uint64_t date;
+} DateRun;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t id;
+} PlayerKey;
+
+/* ============================================================
+ * FUNCTION: index_checksum
+ * ============================================================
+ * FNV-1a over the first and last INDEX_SAMPLE_BYTES of the file.
+ * Reading the whole file would cost as much as the scan the index
+ * saves; size + mtime catch the other changes.
+ */
+int index_checksum(int fd, uint64_t size, uint64_t *checksum) {
+    unsigned char sample[4096];
+    uint64_t h = 14695981039346656037ull;
+    off_t offsets[2];
+    int parts = 1;
+
+    offsets[0] = 0;
+    if (size > 2 * INDEX_SAMPLE_BYTES) {
+        offsets[1] = (off_t)(size - INDEX_SAMPLE_BYTES);
+        parts = 2;
+    }
+
+    for (int i = 0; i < parts; i++) {
+        size_t want = parts == 1 ? (size_t)size : INDEX_SAMPLE_BYTES;
+        size_t got = 0;
+
+        while (got < want) {
+            size_t chunk = want - got > sizeof(sample) ? sizeof(sample) : want - got;
+            ssize_t n = pread(fd, sample, chunk, offsets[i] + (off_t)got);
+            if (n <= 0) {
+                return FILE_READ_ERR;
+            }
+            for (ssize_t j = 0; j < n; j++) {
+                h ^= sample[j];
+                h *= 1099511628211ull;
+            }
+            got += (size_t)n;
+        }
+    }
+
+    *checksum = h;
+    return SUCCESS;
+}
+
+/*
+ * data_file + ".idx", in buf if it fits (buf may be NULL), else in
+ * malloc() memory the caller frees
+ */
+static char *index_path(const char *data_file, char *buf, size_t buf_size) {
+    size_t len = strlen(data_file);
+    char *path = len + sizeof(INDEX_SUFFIX) <= buf_size ? buf : malloc(len + sizeof(INDEX_SUFFIX));
+
+    if (path != NULL) {
+        memcpy(path, data_file, len);
+        memcpy(path + len, INDEX_SUFFIX, sizeof(INDEX_SUFFIX));
+    }
+    return path;
+}
+
+/* Grows *array (of elem_size items) so it can hold one more */
+static int reserve(void **array, size_t *capacity, size_t count, size_t elem_size) {
+    size_t new_capacity;
+    void *grown;
+
+    if (count < *capacity) {
+        return SUCCESS;
+    }
+    new_capacity = *capacity ? *capacity * 2 : 1024;
+    grown = realloc(*array, new_capacity * elem_size);
+    if (grown == NULL) {
+        return NO_MEMORY;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return SUCCESS;
+}
+
+static int compare_runs(const void *a, const void *b) {
+    const DateRun *x = a;
+    const DateRun *y = b;
+
+    if (x->date != y->date) {
+        return x->date < y->date ? -1 : 1;
+    }
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int compare_players(const void *a, const void *b) {
+    const PlayerKey *x = a;
+    const PlayerKey *y = b;
+
+    if (x->hash != y->hash) {
+        return x->hash < y->hash ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: write_index
+ * ============================================================
+ * Writes the header and the three tables. Postings are grouped by
+ * player with a counting sort, keeping file order within a player.
+ */
+static int write_index(FILE *out, const struct stat *st, uint64_t checksum,
+                       const DateRun *runs, size_t run_count,
+                       const InternTable *names, const uint32_t *post_ids,
+                       const long long *post_pos, size_t post_count) {
+    unsigned char header[INDEX_HEADER_SIZE] = {0};
+    unsigned char entry[INDEX_DATE_ENTRY];
+    uint64_t *first = calloc((size_t)names->count + 1, sizeof(uint64_t));
+    uint64_t *next = malloc(((size_t)names->count + 1) * sizeof(uint64_t));
+    long long *postings = malloc((post_count + 1) * sizeof(long long));
+    PlayerKey *keys = malloc(((size_t)names->count + 1) * sizeof(PlayerKey));
+    int status = SUCCESS;
+
+    if (first == NULL || next == NULL || postings == NULL || keys == NULL) {
+        status = NO_MEMORY;
+        goto done;
+    }
+
+    /* Counting sort: first[id] = index of the player's first posting */
+    for (size_t i = 0; i < post_count; i++) {
+        first[post_ids[i] + 1]++;
+    }
+    for (uint32_t id = 0; id < names->count; id++) {
+        first[id + 1] += first[id];
+    }
+    memcpy(next, first, (size_t)names->count * sizeof(uint64_t));
+    for (size_t i = 0; i < post_count; i++) {
+        postings[next[post_ids[i]]++] = post_pos[i];
+    }
+
+    for (uint32_t id = 0; id < names->count; id++) {
+        keys[id].hash = names->hashes[id];
+        keys[id].id = id;
+    }
+    qsort(keys, names->count, sizeof(PlayerKey), compare_players);
+
+    /* Header */
+    memcpy(header, INDEX_MAGIC, INDEX_MAGIC_LEN);
+    put_le(header + 8, INDEX_VERSION, 4);
+    put_le(header + 16, (uint64_t)st->st_size, 8);
+    put_le(header + 24, (uint64_t)(int64_t)st->st_mtime, 8);
+    put_le(header + 32, (uint64_t)MTIME_NSEC(*st), 4);
+    put_le(header + 40, checksum, 8);
+    put_le(header + 48, run_count, 8);
+    put_le(header + 56, names->count, 8);
+    put_le(header + 64, post_count, 8);
+    fwrite(header, 1, sizeof(header), out);
+
+    for (size_t i = 0; i < run_count; i++) {
+        put_le(entry, (uint64_t)runs[i].start, 8);
+        put_le(entry + 8, (uint64_t)runs[i].end, 8);
+        put_le(entry + 16, runs[i].date, 8);
+        fwrite(entry, 1, INDEX_DATE_ENTRY, out);
+    }
+
+    for (uint32_t i = 0; i < names->count; i++) {
+        uint32_t id = keys[i].id;
+        put_le(entry, keys[i].hash, 4);
+        put_le(entry + 4, first[id + 1] - first[id], 4);
+        put_le(entry + 8, first[id], 8);
+        fwrite(entry, 1, INDEX_PLAYER_ENTRY, out);
+    }
+
+    for (size_t i = 0; i < post_count; i++) {
+        put_le(entry, (uint64_t)postings[i], 8);
+        fwrite(entry, 1, 8, out);
+    }
+
+    if (ferror(out)) {
+        status = FILE_WRITE_ERR;
+    }
+
+done:
+    free(first);
+    free(next);
+    free(postings);
+    free(keys);
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: index_build
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - One scan collects date runs and (player id, position) pairs
+ * - Any bad record stops the build: a partial index would make
+ *   indexed lookups disagree with full scans
+ * - A failed build removes its half-written output
+ */
+int index_build(const char *data_file, const char *index_file) {
+    RecordReader rd;
+    GameRecord rec;
+    InternTable names;
+    struct stat st;
+    uint64_t checksum;
+    DateRun *runs = NULL;
+    size_t run_count = 0, run_capacity = 0;
+    uint32_t *post_ids = NULL;
+    long long *post_pos = NULL;
+    size_t post_count = 0, post_capacity = 0;
+    char *default_path = NULL;
+    FILE *out;
+    int status;
+
+    status = reader_open(&rd, data_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    if (fstat(rd.fd, &st) != 0) {
+        reader_close(&rd);
+        return FILE_READ_ERR;
+    }
+    if (intern_init(&names) != SUCCESS) {
+        reader_close(&rd);
+        return NO_MEMORY;
+    }
+
+    while ((status = reader_next(&rd, &rec)) == RECORD_OK) {
+        uint64_t date = pack_date(rec.year, rec.month, rec.day);
+        size_t capacity = post_capacity;
+        uint32_t id;
+
+        status = SUCCESS;
+        if (run_count > 0 && runs[run_count - 1].date == date) {
+            runs[run_count - 1].end = reader_tell(&rd);
+        } else {
+            status = reserve((void **)&runs, &run_capacity, run_count, sizeof(DateRun));
+            if (status != SUCCESS) {
+                break;
+            }
+            runs[run_count].start = rd.rec_offset;
+            runs[run_count].end = reader_tell(&rd);
+            runs[run_count].date = date;
+            run_count++;
+        }
+
+        if (intern_add(&names, rec.player, rec.player_len, &id) != SUCCESS ||
+            reserve((void **)&post_ids, &capacity, post_count, sizeof(uint32_t)) != SUCCESS ||
+            reserve((void **)&post_pos, &post_capacity, post_count, sizeof(long long)) != SUCCESS) {
+            status = NO_MEMORY;
+            break;
+        }
+        post_ids[post_count] = id;
+        post_pos[post_count] = rd.rec_offset;
+        post_count++;
+    }
+
+    if (status == RECORD_EOF) {
+        status = index_checksum(rd.fd, (uint64_t)st.st_size, &checksum);
+    }
+    reader_close(&rd);
+
+    if (status == SUCCESS) {
+        qsort(runs, run_count, sizeof(DateRun), compare_runs);
+
+        if (index_file == NULL) {
+            default_path = index_path(data_file, NULL, 0);
+            index_file = default_path;
+        }
+        if (index_file == NULL) {
+            status = NO_MEMORY;
+        } else if ((out = fopen(index_file, "wb")) == NULL) {
+            status = FILE_WRITE_ERR;
+        } else {
+            status = write_index(out, &st, checksum, runs, run_count,
+                                 &names, post_ids, post_pos, post_count);
+            if (fclose(out) != 0 && status == SUCCESS) {
+                status = FILE_WRITE_ERR;
+            }
+            if (status != SUCCESS) {
+                remove(index_file);
+            }
+        }
+    }
+
+    free(default_path);
+    free(runs);
+    free(post_ids);
+    free(post_pos);
+    intern_free(&names);
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: index_open / index_close
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Every count is checked against the file size before the
+ *   tables are trusted
+ * - The index is only used if the data file looks exactly as it
+ *   did when the index was built
+ */
+int index_open(FileIndex *ix, const char *data_file) {
+    struct stat data_st, st;
+    char path_buf[256];          /* lookups on short paths need no malloc() */
+    char *path = index_path(data_file, path_buf, sizeof(path_buf));
+    const unsigned char *data;
+    uint64_t checksum;
+    uint64_t tables;
+    void *map;
+    int fd;
+    int status = BAD_RECORD;
+
+    memset(ix, 0, sizeof(*ix));
+    if (path == NULL) {
+        return NO_MEMORY;
+    }
+    fd = open(path, O_RDONLY);
+    if (path != path_buf) {
+        free(path);
+    }
+    if (fd < 0) {
+        return FILE_READ_ERR;
+    }
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size < INDEX_HEADER_SIZE || (uintmax_t)st.st_size > (uintmax_t)SIZE_MAX) {
+        close(fd);
+        return BAD_RECORD;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return FILE_READ_ERR;
+    }
+
+    data = map;
+    ix->data = data;
+    ix->size = (size_t)st.st_size;
+    ix->date_count = get_le(data + 48, 8);
+    ix->player_count = get_le(data + 56, 8);
+    ix->posting_count = get_le(data + 64, 8);
+
+    /* Header and table sizes */
+    if (memcmp(data, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0 ||
+        get_le(data + 8, 4) != INDEX_VERSION ||
+        ix->date_count > ix->size / INDEX_DATE_ENTRY ||
+        ix->player_count > ix->size / INDEX_PLAYER_ENTRY ||
+        ix->posting_count > ix->size / 8) {
+        goto fail;
+    }
+    tables = ix->date_count * INDEX_DATE_ENTRY + ix->player_count * INDEX_PLAYER_ENTRY +
+             ix->posting_count * 8;
+    if (tables != ix->size - INDEX_HEADER_SIZE) {
+        goto fail;
+    }
+    ix->dates = data + INDEX_HEADER_SIZE;
+    ix->players = ix->dates + ix->date_count * INDEX_DATE_ENTRY;
+    ix->postings = ix->players + ix->player_count * INDEX_PLAYER_ENTRY;
+
+    for (uint64_t i = 0; i < ix->player_count; i++) {
+        const unsigned char *entry = ix->players + i * INDEX_PLAYER_ENTRY;
+        if (get_le(entry + 8, 8) + get_le(entry + 4, 4) > ix->posting_count) {
+            goto fail;
+        }
+    }
+
+    /* Does it still describe the data file? */
+    fd = open(data_file, O_RDONLY);
+    if (fd < 0) {
+        status = FILE_READ_ERR;
+        goto fail;
+    }
+    if (fstat(fd, &data_st) != 0 ||
+        (uint64_t)data_st.st_size != get_le(data + 16, 8) ||
+        (uint64_t)(int64_t)data_st.st_mtime != get_le(data + 24, 8) ||
+        (uint64_t)MTIME_NSEC(data_st) != get_le(data + 32, 4) ||
+        index_checksum(fd, (uint64_t)data_st.st_size, &checksum) != SUCCESS ||
+        checksum != get_le(data + 40, 8)) {
+        close(fd);
+        goto fail;
+    }
+    close(fd);
+    return SUCCESS;
+
+fail:
+    index_close(ix);
+    return status;
+}
+
+void index_close(FileIndex *ix) {
+    if (ix->data != NULL) {
+        munmap((void *)ix->data, ix->size);
+    }
+    memset(ix, 0, sizeof(*ix));
+}
+
+/* ============================================================
+ * HELPER FUNCTION: add_span
+ * ============================================================
+ */
+static int add_span(IndexSpanList *list, long long start, long long end) {
+    if (reserve((void **)&list->spans, &list->capacity, list->count, sizeof(IndexSpan)) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    list->spans[list->count].start = start;
+    list->spans[list->count].end = end;
+    list->count++;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: index_add_date
+ * ============================================================
+ * Binary search for the first run of the date, then take every
+ * run with that date.
+ */
+int index_add_date(const FileIndex *ix, int year, int month, int day, IndexSpanList *list) {
+    uint64_t date = pack_date(year, month, day);
+    uint64_t lo = 0, hi = ix->date_count;
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (get_le(ix->dates + mid * INDEX_DATE_ENTRY + 16, 8) < date) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < ix->date_count; lo++) {
+        const unsigned char *entry = ix->dates + lo * INDEX_DATE_ENTRY;
+        if (get_le(entry + 16, 8) != date) {
+            break;
+        }
+        if (add_span(list, (long long)get_le(entry, 8), (long long)get_le(entry + 8, 8)) != SUCCESS) {
+            return NO_MEMORY;
+        }
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: index_date_bounds
+ * ============================================================
+ * Date runs are sorted by date: the first and the last entry.
+ */
+int index_date_bounds(const FileIndex *ix, long long *first, long long *last) {
+    if (ix->date_count == 0) {
+        return NO_DATA_POINTS;
+    }
+    *first = (long long)get_le(ix->dates + 16, 8);
+    *last = (long long)get_le(ix->dates + (ix->date_count - 1) * INDEX_DATE_ENTRY + 16, 8);
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: index_add_player
+ * ============================================================
+ * Same idea on the player table; each posting is a one-record span.
+ */
+int index_add_player(const FileIndex *ix, const char *name, size_t len, IndexSpanList *list) {
+    uint32_t hash = intern_hash(name, len);
+    uint64_t lo = 0, hi = ix->player_count;
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (get_le(ix->players + mid * INDEX_PLAYER_ENTRY, 4) < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < ix->player_count; lo++) {
+        const unsigned char *entry = ix->players + lo * INDEX_PLAYER_ENTRY;
+        uint64_t first = get_le(entry + 8, 8);
+        uint64_t count = get_le(entry + 4, 4);
+
+        if (get_le(entry, 4) != hash) {
+            break;
+        }
+        for (uint64_t i = first; i < first + count; i++) {
+            long long pos = (long long)get_le(ix->postings + i * 8, 8);
+            if (add_span(list, pos, pos + 1) != SUCCESS) {
+                return NO_MEMORY;
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: index_sort_spans / index_free_spans
+ * ============================================================
+ */
+static int compare_spans(const void *a, const void *b) {
+    const IndexSpan *x = a;
+    const IndexSpan *y = b;
+
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+void index_sort_spans(IndexSpanList *list) {
+    qsort(list->spans, list->count, sizeof(IndexSpan), compare_spans);
+}
+
+void index_free_spans(IndexSpanList *list) {
+    free(list->spans);
+    memset(list, 0, sizeof(*list));
+}
@@ -0,0 +1,159 @@
+/*
+ * file_index.h - Date / player index sidecar files
+ *
+ * This file contains:
+ * - A description of the index file layout
+ * - Functions to build an index and to check that it is up to date
+ * - Lookups that turn a date or a player name into record positions
+ *
+ * Learning Concepts:
+ * - Trading disk space for speed: answer a lookup without a full scan
+ * - Sorted tables + binary search
+ * - Detecting a stale cache (size, modification time, checksum)
+ *
+ * An index for "game_data.txt" lives next to it in "game_data.txt.idx".
+ * Record positions are byte offsets for text files and record numbers
+ * for column files (see reader_seek() in record_reader.h).
+ *
+ * FILE LAYOUT (all integers little-endian):
+ *
+ *   Header (72 bytes)
+ *     char     magic[8]       "HW2IDX01"
+ *     uint32   version        1
+ *     uint32   reserved
+ *     uint64   data_size      size of the data file when indexed
+ *     int64    data_mtime     its modification time (seconds)
+ *     uint32   data_mtime_ns  and nanoseconds
+ *     uint32   reserved
+ *     uint64   data_checksum  FNV-1a of its first and last 64 KiB
+ *     uint64   date_count
+ *     uint64   player_count
+ *     uint64   posting_count
+ *
+ *   Date runs, sorted by (date, start); date_count * 24 bytes
+ *     uint64 start, uint64 end    positions: a record belongs to the run
+ *                                 if start <= position < end
+ *     uint64 date                 year << 9 | month << 5 | day
+ *
+ *   Players, sorted by name hash; player_count * 16 bytes
+ *     uint32 hash                 intern_hash() of the name
+ *     uint32 count                number of postings
+ *     uint64 first                index of the first posting
+ *
+ *   Postings: posting_count * uint64 record positions, in file order
+ *             for each player
+ *
+ * A run is a block of consecutive records with the same date, so an
+ * unsorted file simply has several runs for one date.
+ */
+
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========== CONSTANTS ========== */
+#define INDEX_MAGIC        "HW2IDX01"
+#define INDEX_MAGIC_LEN    8
+#define INDEX_VERSION      1
+#define INDEX_HEADER_SIZE  72
+#define INDEX_DATE_ENTRY   24
+#define INDEX_PLAYER_ENTRY 16
+#define INDEX_SAMPLE_BYTES (64 * 1024)
+#define INDEX_SUFFIX       ".idx"
+
+/* ========== TYPES ========== */
+
+/* Records with position in [start, end) */
+typedef struct {
+    long long start;
+    long long end;
+} IndexSpan;
+
+/* A growable list of spans */
+typedef struct {
+    IndexSpan *spans;
+    size_t count;
+    size_t capacity;
+} IndexSpanList;
+
+/* An open (memory-mapped) index. Treat as private. */
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    uint64_t date_count;
+    uint64_t player_count;
+    uint64_t posting_count;
+    const unsigned char *dates;
+    const unsigned char *players;
+    const unsigned char *postings;
+} FileIndex;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * index_build
+ *
+ * Scans data_file and writes its index to index_file (or to
+ * data_file + ".idx" if index_file is NULL). Only files without bad
+ * records are indexed, so a query answered from the index returns
+ * exactly what a full scan would.
+ *
+ * Returns:
+ *   SUCCESS, FILE_READ_ERR, FILE_WRITE_ERR, NO_MEMORY, or the
+ *   BAD_RECORD / BAD_DATE found in the data file.
+ */
+int index_build(const char *data_file, const char *index_file);
+
+/*
+ * index_open
+ *
+ * Opens data_file + ".idx" and checks that it still describes
+ * data_file (same size, modification time and checksum).
+ *
+ * Returns:
+ *   SUCCESS       - the index can be used
+ *   FILE_READ_ERR - there is no index
+ *   BAD_RECORD    - the index is damaged or out of date
+ */
+int index_open(FileIndex *ix, const char *data_file);
+void index_close(FileIndex *ix);
+
+/*
+ * index_checksum
+ *
+ * FNV-1a of the first and last INDEX_SAMPLE_BYTES of the first size
+ * bytes of the open file fd (all of them if there are fewer): the
+ * checksum stored in the header. Returns SUCCESS or FILE_READ_ERR.
+ */
+int index_checksum(int fd, uint64_t size, uint64_t *checksum);
+
+/*
+ * index_add_date / index_add_player
+ *
+ * Append the spans holding every record for a date / every record
+ * that may belong to a player (names with the same hash are included;
+ * callers must still compare names). Return SUCCESS or NO_MEMORY.
+ */
+int index_add_date(const FileIndex *ix, int year, int month, int day, IndexSpanList *list);
+int index_add_player(const FileIndex *ix, const char *name, size_t len, IndexSpanList *list);
+
+/*
+ * index_date_bounds
+ *
+ * The first and last date (year << 9 | month << 5 | day) of the
+ * indexed file. Returns SUCCESS, or NO_DATA_POINTS if it has no
+ * records.
+ */
+int index_date_bounds(const FileIndex *ix, long long *first, long long *last);
+
+/*
+ * index_sort_spans / index_free_spans
+ *
+ * Sorts spans by start position (file order) / frees the list.
+ */
+void index_sort_spans(IndexSpanList *list);
+void index_free_spans(IndexSpanList *list);
+
+#endif /* FILE_INDEX_H */
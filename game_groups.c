@@ -0,0 +1,635 @@
+/*
+ * game_groups.c - Group records into games, whatever their order
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Hash grouping: an open-addressing table from month to bucket
+ * 2. Spilling to disk under a memory budget (tmpfile(), pread())
+ * 3. A derived sort key (date, game number) and a stable qsort()
+ * 4. Telling games apart from repeated players, team blocks and file
+ *    adjacency, and saying so when they cannot be told apart
+ *
+ * See game_groups.h for what a game is.
+ */
+
+/* Needed for pread() and 64-bit file offsets with -std=c17 */
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "hw2.h"
+#include "intern.h"
+#include "record_reader.h"
+#include "query_plan.h"
+#include "game_groups.h"
+
+/* ========== TYPES ========== */
+
+/* One buffered record: this header, then the player and team names */
+typedef struct {
+    uint64_t seq;                /* record number in the file */
+    uint32_t date;               /* year << 9 | month << 5 | day */
+    int32_t points, assists, blocks;
+    float minutes;
+    uint16_t player_len, team_len;
+} PackedRecord;
+
+/* Bytes of one bucket in the temporary file */
+typedef struct {
+    long long offset;
+    size_t len;
+} SpillChunk;
+
+/* The records of one month: spilled chunks first, then data */
+typedef struct {
+    uint32_t month;              /* date >> 5 */
+    unsigned char *data;
+    size_t len, capacity;
+    SpillChunk *chunks;
+    size_t chunk_count, chunk_capacity;
+} Bucket;
+
+typedef struct {
+    Bucket *buckets;
+    size_t count, capacity;
+    uint32_t *slots;             /* month hash -> bucket index + 1 (0 = empty) */
+    size_t mask;
+    size_t in_memory;            /* bytes allocated for bucket data */
+    size_t budget;
+    FILE *spill;                 /* NULL until the first spill */
+    long long spill_size;
+    GroupStats stats;
+} Grouper;
+
+/* A record's place in its month, for sorting */
+typedef struct {
+    uint64_t key;                /* date << 32 | game */
+    uint64_t seq;                /* record number in the file */
+    const unsigned char *rec;    /* file order within a key */
+    uint32_t player;             /* id of "player,team" */
+    uint32_t team;               /* id of the team */
+} GroupEntry;
+
+/* A player's latest row in the month (game 0: none yet) */
+typedef struct {
+    uint32_t game;
+    size_t pos;                  /* index in the month's entries */
+} LastRow;
+
+/* A team's latest block of adjacent rows that was followed by another team's */
+typedef struct {
+    uint32_t game;
+    size_t run;
+} TeamBlock;
+
+/* ============================================================
+ * HELPER FUNCTIONS: Grouper setup
+ * ============================================================
+ */
+static void grouper_free(Grouper *g) {
+    for (size_t i = 0; i < g->count; i++) {
+        free(g->buckets[i].data);
+        free(g->buckets[i].chunks);
+    }
+    free(g->buckets);
+    free(g->slots);
+    if (g->spill != NULL) {
+        fclose(g->spill);  /* tmpfile(): also deletes it */
+    }
+    memset(g, 0, sizeof(*g));
+}
+
+static uint32_t hash_month(uint32_t month) {
+    return month * 2654435761u;
+}
+
+/* Rebuilds the slot table with room for twice as many buckets */
+static int grow_slots(Grouper *g) {
+    size_t size = g->slots == NULL ? 64 : (g->mask + 1) * 2;
+    uint32_t *slots = calloc(size, sizeof(uint32_t));
+
+    if (slots == NULL) {
+        return NO_MEMORY;
+    }
+    for (size_t i = 0; i < g->count; i++) {
+        size_t slot = hash_month(g->buckets[i].month) & (size - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (size - 1);
+        }
+        slots[slot] = (uint32_t)i + 1;
+    }
+    free(g->slots);
+    g->slots = slots;
+    g->mask = size - 1;
+    return SUCCESS;
+}
+
+/* The bucket for a month, added if new; NULL if out of memory */
+static Bucket *find_bucket(Grouper *g, uint32_t month) {
+    size_t slot;
+    Bucket *b;
+
+    if ((g->count + 1) * 2 > g->mask + 1 && grow_slots(g) != SUCCESS) {
+        return NULL;
+    }
+    for (slot = hash_month(month) & g->mask; g->slots[slot] != 0; slot = (slot + 1) & g->mask) {
+        b = &g->buckets[g->slots[slot] - 1];
+        if (b->month == month) {
+            return b;
+        }
+    }
+
+    if (g->count == g->capacity) {
+        size_t capacity = g->capacity ? g->capacity * 2 : 32;
+        Bucket *grown = realloc(g->buckets, capacity * sizeof(Bucket));
+        if (grown == NULL) {
+            return NULL;
+        }
+        g->buckets = grown;
+        g->capacity = capacity;
+    }
+    b = &g->buckets[g->count];
+    memset(b, 0, sizeof(*b));
+    b->month = month;
+    g->slots[slot] = (uint32_t)++g->count;
+    return b;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: spill
+ * ============================================================
+ * Appends every bucket's buffered records to the temporary file and
+ * frees them. A bucket remembers where its chunks went, in order.
+ */
+static int spill(Grouper *g) {
+    if (g->spill == NULL && (g->spill = tmpfile()) == NULL) {
+        return FILE_WRITE_ERR;
+    }
+    for (size_t i = 0; i < g->count; i++) {
+        Bucket *b = &g->buckets[i];
+
+        if (b->len == 0) {
+            continue;
+        }
+        if (b->chunk_count == b->chunk_capacity) {
+            size_t capacity = b->chunk_capacity ? b->chunk_capacity * 2 : 4;
+            SpillChunk *grown = realloc(b->chunks, capacity * sizeof(SpillChunk));
+            if (grown == NULL) {
+                return NO_MEMORY;
+            }
+            b->chunks = grown;
+            b->chunk_capacity = capacity;
+        }
+        if (fwrite(b->data, 1, b->len, g->spill) != b->len) {
+            return FILE_WRITE_ERR;
+        }
+        b->chunks[b->chunk_count].offset = g->spill_size;
+        b->chunks[b->chunk_count].len = b->len;
+        b->chunk_count++;
+        g->spill_size += (long long)b->len;
+        g->stats.spilled_bytes += (long long)b->len;
+
+        g->in_memory -= b->capacity;
+        free(b->data);
+        b->data = NULL;
+        b->len = b->capacity = 0;
+    }
+    g->stats.spills++;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: add_record
+ * ============================================================
+ * Copies one record into its month's bucket.
+ */
+static int add_record(Grouper *g, const GameRecord *rec, uint64_t seq) {
+    PackedRecord packed;
+    uint32_t date = (uint32_t)rec->year << 9 | (uint32_t)rec->month << 5 | (uint32_t)rec->day;
+    size_t need = sizeof(packed) + rec->player_len + rec->team_len;
+    Bucket *b = find_bucket(g, date >> 5);
+
+    if (b == NULL) {
+        return NO_MEMORY;
+    }
+    if (b->len + need > b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 4096;
+        unsigned char *grown;
+
+        while (capacity < b->len + need) {
+            capacity *= 2;
+        }
+        grown = realloc(b->data, capacity);
+        if (grown == NULL) {
+            return NO_MEMORY;
+        }
+        g->in_memory += capacity - b->capacity;
+        b->data = grown;
+        b->capacity = capacity;
+    }
+
+    packed.seq = seq;
+    packed.date = date;
+    packed.points = rec->points;
+    packed.assists = rec->assists;
+    packed.blocks = rec->blocks;
+    packed.minutes = rec->minutes;
+    packed.player_len = (uint16_t)rec->player_len;
+    packed.team_len = (uint16_t)rec->team_len;
+    memcpy(b->data + b->len, &packed, sizeof(packed));
+    if (rec->player_len > 0) {
+        memcpy(b->data + b->len + sizeof(packed), rec->player, rec->player_len);
+    }
+    if (rec->team_len > 0) {
+        memcpy(b->data + b->len + sizeof(packed) + rec->player_len, rec->team, rec->team_len);
+    }
+    b->len += need;
+    g->stats.records++;
+
+    return g->in_memory > g->budget ? spill(g) : SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: number_day
+ * ============================================================
+ * Gives the rows of one date, entries[lo..hi) in file order, their
+ * game numbers (the low 32 bits of key). Game serials are unique in
+ * the month, so rows[] and blocks[] need no clearing between days;
+ * *serial and *run are the last ones used.
+ *
+ * LEARNING POINTS:
+ * - A game has one row per player, so a row of a player already in
+ *   the current game starts the next game
+ * - Teams are listed one after the other, so the adjacent rows of
+ *   that player's team just before it (a player who only plays the
+ *   second game, say) move to the next game with it
+ * - Where that block reaches back to the player's first row, or a
+ *   team's rows come back after another team's without starting the
+ *   next game, the rows could belong to either game: the day is
+ *   reported as ambiguous, and the rows stay in the game they were
+ *   first seen with
+ */
+static int adjacent(const GroupEntry *entries, size_t lo, size_t i) {
+    return i > lo && entries[i].seq == entries[i - 1].seq + 1;
+}
+
+static void number_day(Grouper *g, GroupEntry *entries, size_t lo, size_t hi,
+                       LastRow *rows, TeamBlock *blocks, uint32_t *serial, size_t *run) {
+    uint32_t first = *serial + 1;
+    uint32_t game = first;
+    size_t back = hi;            /* a block of a team that came back, unless hi */
+    int ambiguous = 0;
+
+    for (size_t i = lo; i < hi; i++) {
+        GroupEntry *e = &entries[i];
+        LastRow *last = &rows[e->player];
+        int next_to = adjacent(entries, lo, i);
+        int new_block = !next_to || e->team != entries[i - 1].team;
+
+        if (new_block && i > lo) {
+            blocks[entries[i - 1].team].game = first + (uint32_t)entries[i - 1].key;
+            blocks[entries[i - 1].team].run = *run;
+            if (back != hi) {
+                ambiguous = 1;   /* it ended still in the same game */
+                back = hi;
+            }
+        }
+        if (!next_to) {
+            (*run)++;
+        }
+
+        if (last->game == game) {
+            size_t p = last->pos;
+            size_t b = i;
+
+            while (b - 1 > p && adjacent(entries, lo, b) && entries[b - 1].team == e->team) {
+                b--;
+            }
+            if (b < i && b - 1 == p && adjacent(entries, lo, b)) {
+                ambiguous = 1;
+                b = i;
+            }
+            if (b <= back) {
+                back = hi;       /* it starts the next game */
+            }
+            game++;
+            for (size_t k = b; k < i; k++) {
+                entries[k].key = (entries[k].key & ~(uint64_t)UINT32_MAX) | (game - first);
+                rows[entries[k].player].game = game;
+            }
+        } else if (new_block && next_to && blocks[e->team].game == game && blocks[e->team].run == *run) {
+            back = i;
+        }
+
+        e->key |= game - first;
+        last->game = game;
+        last->pos = i;
+    }
+    *serial = game;
+
+    if (ambiguous || back != hi) {
+        uint32_t date = (uint32_t)(entries[lo].key >> 32);
+        if (g->stats.ambiguous_days++ == 0) {
+            g->stats.first_ambiguous = (long long)(date >> 9) * 10000 +
+                                       (long long)((date >> 5) & 15) * 100 + (date & 31);
+        }
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: feed_month
+ * ============================================================
+ * Sorts the month's records by date, numbers each day's games and
+ * feeds the month to the plan in (date, game) order.
+ *
+ * LEARNING POINTS:
+ * - A player is "player,team": two players with one name on two
+ *   teams are two players (a name cannot contain ',')
+ * - Ties are broken by address: the buffer holds the month's records
+ *   in file order, so the sort is stable, and a day's games are
+ *   numbered in file order, so it stays sorted
+ */
+static int compare_entries(const void *a, const void *b) {
+    const GroupEntry *x = a;
+    const GroupEntry *y = b;
+
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return (x->rec > y->rec) - (x->rec < y->rec);
+}
+
+static int feed_month(Grouper *g, QueryPlan *plan, const unsigned char *data, size_t len) {
+    PackedRecord packed;
+    GameRecord rec;
+    InternTable players;
+    InternTable teams;
+    GroupEntry *entries;
+    LastRow *rows = NULL;
+    TeamBlock *blocks = NULL;
+    char *name = NULL;
+    size_t name_capacity = 0;
+    uint32_t serial = 0;
+    size_t run = 0;
+    size_t n = 0;
+    int status = SUCCESS;
+
+    for (size_t pos = 0; pos < len; n++) {
+        memcpy(&packed, data + pos, sizeof(packed));
+        pos += sizeof(packed) + packed.player_len + packed.team_len;
+    }
+    entries = malloc((n + 1) * sizeof(GroupEntry));
+    if (entries == NULL || intern_init(&players) != SUCCESS) {
+        free(entries);
+        return NO_MEMORY;
+    }
+    if (intern_init(&teams) != SUCCESS) {
+        free(entries);
+        intern_free(&players);
+        return NO_MEMORY;
+    }
+
+    n = 0;
+    for (size_t pos = 0; pos < len; n++) {
+        const char *player = (const char *)data + pos + sizeof(packed);
+        size_t name_len;
+
+        memcpy(&packed, data + pos, sizeof(packed));
+        name_len = (size_t)packed.player_len + 1 + packed.team_len;
+        if (name_len > name_capacity) {
+            char *grown = realloc(name, name_len);
+            if (grown == NULL) {
+                status = NO_MEMORY;
+                break;
+            }
+            name = grown;
+            name_capacity = name_len;
+        }
+        memcpy(name, player, packed.player_len);
+        name[packed.player_len] = ',';
+        memcpy(name + packed.player_len + 1, player + packed.player_len, packed.team_len);
+        if (intern_add(&players, name, name_len, &entries[n].player) != SUCCESS ||
+            intern_add(&teams, player + packed.player_len, packed.team_len, &entries[n].team) != SUCCESS) {
+            status = NO_MEMORY;
+            break;
+        }
+        entries[n].key = (uint64_t)packed.date << 32;
+        entries[n].seq = packed.seq;
+        entries[n].rec = data + pos;
+        pos += sizeof(packed) + packed.player_len + packed.team_len;
+    }
+
+    if (status == SUCCESS) {
+        rows = calloc((size_t)players.count + 1, sizeof(LastRow));
+        blocks = calloc((size_t)teams.count + 1, sizeof(TeamBlock));
+        if (rows == NULL || blocks == NULL) {
+            status = NO_MEMORY;
+        }
+    }
+
+    if (status == SUCCESS) {
+        qsort(entries, n, sizeof(GroupEntry), compare_entries);
+        for (size_t lo = 0, hi; lo < n; lo = hi) {
+            for (hi = lo + 1; hi < n && entries[hi].key == entries[lo].key; hi++) {
+            }
+            number_day(g, entries, lo, hi, rows, blocks, &serial, &run);
+        }
+
+        memset(&rec, 0, sizeof(rec));
+        rec.player_id = RECORD_NO_ID;
+        rec.team_id = RECORD_NO_ID;
+        for (size_t i = 0; i < n; i++) {
+            memcpy(&packed, entries[i].rec, sizeof(packed));
+            rec.year = (int)(packed.date >> 9);
+            rec.month = (int)((packed.date >> 5) & 15);
+            rec.day = (int)(packed.date & 31);
+            rec.game = (int)(uint32_t)entries[i].key;
+            rec.player = (const char *)entries[i].rec + sizeof(packed);
+            rec.player_len = packed.player_len;
+            rec.team = rec.player + packed.player_len;
+            rec.team_len = packed.team_len;
+            rec.points = packed.points;
+            rec.assists = packed.assists;
+            rec.blocks = packed.blocks;
+            rec.minutes = packed.minutes;
+            if (i == 0 || entries[i].key != entries[i - 1].key) {
+                g->stats.games++;
+            }
+            plan_feed(plan, &rec);
+        }
+    }
+
+    free(entries);
+    free(rows);
+    free(blocks);
+    free(name);
+    intern_free(&players);
+    intern_free(&teams);
+    return status;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: feed_buckets
+ * ============================================================
+ * Months in calendar order; a spilled month is read back in one piece.
+ */
+static int compare_buckets(const void *a, const void *b) {
+    const Bucket *x = a;
+    const Bucket *y = b;
+
+    return (x->month > y->month) - (x->month < y->month);
+}
+
+static int feed_buckets(Grouper *g, QueryPlan *plan) {
+    int status = SUCCESS;
+
+    if (g->spill != NULL && fflush(g->spill) != 0) {
+        return FILE_WRITE_ERR;
+    }
+    qsort(g->buckets, g->count, sizeof(Bucket), compare_buckets);  /* slots are stale now */
+
+    for (size_t i = 0; i < g->count && status == SUCCESS; i++) {
+        Bucket *b = &g->buckets[i];
+        unsigned char *month = b->data;
+        size_t len = b->len;
+
+        if (b->chunk_count > 0) {
+            for (size_t c = 0; c < b->chunk_count; c++) {
+                len += b->chunks[c].len;
+            }
+            month = malloc(len);
+            if (month == NULL) {
+                return NO_MEMORY;
+            }
+            len = 0;
+            for (size_t c = 0; c < b->chunk_count && status == SUCCESS; c++) {
+                if (pread(fileno(g->spill), month + len, b->chunks[c].len,
+                          (off_t)b->chunks[c].offset) != (ssize_t)b->chunks[c].len) {
+                    status = FILE_READ_ERR;
+                }
+                len += b->chunks[c].len;
+            }
+            if (b->len > 0) {
+                memcpy(month + len, b->data, b->len);
+                len += b->len;
+            }
+        }
+
+        if (status == SUCCESS) {
+            status = feed_month(g, plan, month, len);
+        }
+        if (month != b->data) {
+            free(month);
+        }
+        free(b->data);
+        b->data = NULL;
+        b->len = b->capacity = 0;
+    }
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: group_run
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Records outside the plan's date window are dropped while reading:
+ *   game numbers only depend on records of the same date (and on
+ *   which of them were next to each other, which seq remembers)
+ * - Only records are buffered; the queries' state is the plan's, and
+ *   it is fed exactly as plan_run() feeds it
+ */
+int group_run(QueryPlan *plan, const char *in_file, size_t memory_budget, GroupStats *stats) {
+    RecordReader rd;
+    GameRecord rec;
+    Grouper g;
+    uint64_t seq = 0;
+    int any_active = 0;
+    int status;
+
+    plan->error.code = SUCCESS;
+    plan->error.line = 0;
+    plan->error.offset = 0;
+    memset(&plan->bad, 0, sizeof(plan->bad));
+    memset(&g, 0, sizeof(g));
+    g.budget = memory_budget < GROUP_MIN_BUDGET ? GROUP_MIN_BUDGET : memory_budget;
+
+    for (int i = 0; i < plan->count; i++) {
+        if (!plan->queries[i].done) {
+            any_active = 1;
+        }
+    }
+    if (!any_active) {
+        if (stats != NULL) {
+            *stats = g.stats;
+        }
+        return SUCCESS;
+    }
+
+    status = reader_open(&rd, in_file);
+    if (status == SUCCESS) {
+        status = plan_begin(plan);
+        if (status != SUCCESS) {
+            reader_close(&rd);
+        }
+    }
+    if (status != SUCCESS) {
+        for (int i = 0; i < plan->count; i++) {
+            if (!plan->queries[i].done) {
+                plan->queries[i].result = status;
+            }
+        }
+        return status;
+    }
+
+    /* The game number needs the player and team, and the bucket the date */
+    memset(&rec, 0, sizeof(rec));
+    reader_set_fields(&rd, plan_fields(plan) | FIELD_DATE | FIELD_PLAYER | FIELD_TEAM);
+
+    for (;;) {
+        long long date;
+
+        status = reader_next(&rd, &rec);
+        if (status != RECORD_OK) {
+            if (plan_skip_bad(plan, &rd, status)) {
+                continue;
+            }
+            if (status == RECORD_EOF) {
+                status = SUCCESS;
+            } else {
+                plan->error.code = status;
+                plan->error.line = rd.err_line;
+                plan->error.offset = rd.err_offset;
+            }
+            break;
+        }
+        seq++;
+        date = (long long)rec.year << 9 | (long long)rec.month << 5 | (long long)rec.day;
+        if (plan->ranged && (date < plan->range_from || date > plan->range_to)) {
+            continue;
+        }
+        status = add_record(&g, &rec, seq);
+        if (status != SUCCESS) {
+            plan->error.code = status;
+            break;
+        }
+    }
+    reader_close(&rd);
+
+    if (status == SUCCESS) {
+        status = feed_buckets(&g, plan);
+        if (status != SUCCESS) {
+            plan->error.code = status;
+        }
+    }
+
+    if (stats != NULL) {
+        *stats = g.stats;
+    }
+    grouper_free(&g);
+    plan_end(plan, status);
+    return status;
+}
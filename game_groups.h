@@ -0,0 +1,90 @@
+/*
+ * game_groups.h - Group records into games, whatever their order
+ *
+ * This file contains:
+ * - The GroupStats structure
+ * - group_run(), a plan runner for files that are not in game order
+ *
+ * Learning Concepts:
+ * - A grouping stage: the scan loops in query_plan.c see one game's
+ *   records together, so records are regrouped before they are fed
+ * - Hash grouping with a memory budget: records wait in per-month
+ *   buckets, and when the buckets outgrow the budget they are
+ *   spilled to a temporary file and read back one month at a time
+ * - Deriving a key the data does not store: a player has one row per
+ *   game, so a player's second row on a date starts that day's second
+ *   game
+ *
+ * plan_run() takes each run of records with the same date as one
+ * match. That is wrong for logs merged from several scorekeepers
+ * (a game's rows are interleaved with other dates) and for a
+ * doubleheader (two games, one date). group_run() uses the game key
+ * (date, game number) instead. A date's rows are taken in file order,
+ * a player being a (name, team) pair:
+ *
+ *   - a row of a player already in the current game starts the next
+ *     game (0, 1, 2, ...)
+ *   - so do the rows of that player's team just before it, back to
+ *     the previous team's rows or to a gap in the file: a player who
+ *     only played the second game and is listed before the others
+ *     of the team is counted in the second game
+ *
+ * Records with the same key are one match, in date and game order;
+ * within a match they keep their file order. On a file already in
+ * date order with one game a day, results are those of plan_run().
+ *
+ * The format has no game field, so some days cannot be split for
+ * certain: rows of one team listed with no other team between the
+ * two games, or a team's rows coming back after the other team's
+ * within one stretch of the file. Such a day is counted in
+ * GroupStats (and hw2_last_ambiguous_days()); its doubtful rows stay
+ * in the game they were first seen with.
+ */
+
+#ifndef GAME_GROUPS_H
+#define GAME_GROUPS_H
+
+#include <stddef.h>
+#include "query_plan.h"
+
+/* ========== CONSTANTS ========== */
+#define GROUP_DEFAULT_BUDGET ((size_t)256 << 20)  /* bytes of buffered records */
+#define GROUP_MIN_BUDGET     ((size_t)64 << 10)
+
+/* ========== TYPES ========== */
+
+/* What a group_run() did */
+typedef struct {
+    long long records;           /* records grouped */
+    long long games;             /* distinct (date, game) keys */
+    long long ambiguous_days;    /* dates whose games could not be told apart */
+    long long first_ambiguous;   /* the first of them as YYYYMMDD, 0 if none */
+    long long spills;            /* times the buckets were written out */
+    long long spilled_bytes;     /* bytes written to the temporary file */
+} GroupStats;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * group_run
+ *
+ * Like plan_run(), with matches found by the game key above instead
+ * of by runs of equal dates. Reads in_file once (any input plan_run()
+ * accepts, including pipes and compressed files), keeping at most
+ * about memory_budget bytes of records in memory (at least
+ * GROUP_MIN_BUDGET); the rest wait in a tmpfile(). Each month is read
+ * back and grouped in memory, so one month's records should fit in
+ * the budget.
+ *
+ * The plan's date window and lenient setting apply as in plan_run().
+ * No query is fed until the whole file has been read, so a bad
+ * record (when not lenient) leaves no partial history lines.
+ *
+ * stats may be NULL.
+ *
+ * Returns: as plan_run(), or FILE_WRITE_ERR if the temporary file
+ * could not be written.
+ */
+int group_run(QueryPlan *plan, const char *in_file, size_t memory_budget, GroupStats *stats);
+
+#endif /* GAME_GROUPS_H */
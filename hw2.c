@@ -4,677 +4,305 @@
  * CS 240 File Operations Learning Examples
  *
  * KEY CONCEPTS DEMONSTRATED:
- * 1. fopen()  - Opening files for reading ("r") or writing ("w")
- * 2. fscanf() - Reading formatted data from files
- * 3. fprintf()- Writing formatted data to files
- * 4. fclose() - Closing files (ALWAYS do this!)
- * 5. Error handling - Checking return values
- * 6. String parsing with format specifiers
+ * 1. Reusing one engine for many entry points
+ * 2. Each function below builds a one-query plan (see query_plan.c)
+ *    and runs it; the plan opens, reads and closes the files
+ * 3. Error handling - checking and passing on return values
+ *
+ * The per-query logic (tracking matches, computing averages, writing
+ * reports) lives in query_plan.c so the same code can also answer
+ * many queries in a single pass over the file.
  */
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "hw2.h"
+#include "query_plan.h"
+#include "parallel_scan.h"
+#include "shard_scan.h"
+#include "checkpoint.h"
+#include "game_groups.h"
+#include "stats.h"
 
-/* ============================================================
- * HELPER FUNCTION: Validate a date
- * ============================================================
- * Checks if year > 0, month in [1,12], day in [1,30]
+/*
+ * Results of the last query, one copy per thread (_Thread_local): two
+ * threads calling the functions below each see their own call's
+ * results, never a mix of both
  */
-static int is_valid_date(int year, int month, int day) {
-    return (year > 0 && month >= 1 && month <= 12 && day >= 1 && day <= 30);
-}
 
-/* ============================================================
- * FUNCTION: generate_matches_history
- * ============================================================
- *
- * LEARNING POINTS:
- * - Opening files with fopen() and checking for NULL
- * - Using fscanf() with complex format strings
- * - Tracking state while reading (current date, scores)
- * - Writing formatted output with fprintf()
- */
-int generate_matches_history(char *in_file, int year, char *out_file) {
-    FILE *fp_in = NULL;
-    FILE *fp_out = NULL;
+/* Location of the last bad record seen by this thread's last query */
+static _Thread_local ParseError last_parse_error = { SUCCESS, 0, 0 };
 
-    /* Validate year parameter */
-    if (year <= 0) {
-        return BAD_DATE;
-    }
+ParseError hw2_last_parse_error(void) {
+    return last_parse_error;
+}
 
-    /*
-     * STEP 1: Open input file for reading
-     *
-     * fopen() returns NULL if the file cannot be opened
-     * Always check this! Common reasons for failure:
-     * - File doesn't exist
-     * - No read permissions
-     * - Path is wrong
-     */
-    fp_in = fopen(in_file, "r");
-    if (fp_in == NULL) {
-        return FILE_READ_ERR;
-    }
+/* Bad records skipped by the last lenient query */
+static _Thread_local BadRecordLog last_bad_records;
 
-    /*
-     * STEP 2: Open output file for writing
-     *
-     * "w" mode creates the file if it doesn't exist
-     * and truncates (empties) it if it does exist
-     */
-    fp_out = fopen(out_file, "w");
-    if (fp_out == NULL) {
-        fclose(fp_in);  /* Don't forget to close the input file! */
-        return FILE_WRITE_ERR;
-    }
+BadRecordLog hw2_last_bad_records(void) {
+    return last_bad_records;
+}
 
-    /*
-     * STEP 3: Read and process data
-     *
-     * FILE FORMAT: yyyy-mm-dd|player_name,team#points,assists,blocks,minutes
-     *
-     * fscanf() format specifiers used:
-     *   %d    - integer
-     *   %63[^,] - string up to 63 chars, stopping at comma
-     *   %f    - float
-     *   %*c   - read and discard one character (like '|' or '-')
-     *
-     * Note: %63[^,] reads up to 63 characters until a comma is found
-     *       This prevents buffer overflow (MAX_NAME_LENGTH is 64)
-     */
-
-    int r_year, r_month, r_day;
-    char player_name[MAX_NAME_LENGTH];
-    char team_name[MAX_NAME_LENGTH];
-    int points, assists, blocks;
-    float minutes;
-
-    /* Track current match info */
-    int current_year = -1, current_month = -1, current_day = -1;
-    int purdue_score = 0, opponent_score = 0;
-    char opponent_name[MAX_NAME_LENGTH] = "";
-    int wins = 0, losses = 0;
-    int found_data = 0;
-    int header_written = 0;
-
-    /*
-     * Main reading loop using fscanf()
-     *
-     * fscanf() returns the number of items successfully read
-     * We expect 9 items per line:
-     *   year, month, day, player_name, team, points, assists, blocks, minutes
-     */
-    while (fscanf(fp_in, "%d-%d-%d|%63[^,],%63[^#]#%d,%d,%d,%f",
-                  &r_year, &r_month, &r_day,
-                  player_name, team_name,
-                  &points, &assists, &blocks, &minutes) == 9) {
-
-        /* Validate the date */
-        if (!is_valid_date(r_year, r_month, r_day)) {
-            fclose(fp_in);
-            fclose(fp_out);
-            return BAD_DATE;
-        }
+/* Counters of the last query (hw2_last_stats, stats.h) */
+static _Thread_local Hw2Stats last_stats;
 
-        /* Validate numeric fields */
-        if (points < 0 || assists < 0 || blocks < 0 || minutes <= 0) {
-            fclose(fp_in);
-            fclose(fp_out);
-            return BAD_RECORD;
-        }
+Hw2Stats hw2_last_stats(void) {
+    return last_stats;
+}
 
-        /* Check if this is the year we want */
-        if (r_year != year) {
-            continue;  /* Skip records from other years */
-        }
+/* Threads used by every scan (hw2_set_threads) */
+static int scan_threads = 1;
 
-        /*
-         * Detect when we move to a new match
-         * (different date = different game)
-         */
-        if (r_year != current_year || r_month != current_month || r_day != current_day) {
-            /* If we had a previous match, output its result */
-            if (current_year != -1 && current_year == year) {
-                /* Write header on first match */
-                if (!header_written) {
-                    fprintf(fp_out, "%d\n", year);
-                    header_written = 1;
-                }
-
-                fprintf(fp_out, "%02d-%02d:Purdue(%d)-%s(%d)\n",
-                        current_month, current_day,
-                        purdue_score, opponent_name, opponent_score);
-
-                /* Track win/loss */
-                if (purdue_score > opponent_score) {
-                    wins++;
-                } else {
-                    losses++;
-                }
-            }
-
-            /* Reset for new match */
-            current_year = r_year;
-            current_month = r_month;
-            current_day = r_day;
-            purdue_score = 0;
-            opponent_score = 0;
-            memset(opponent_name, 0, sizeof(opponent_name));
-        }
+void hw2_set_threads(int threads) {
+    scan_threads = threads < 1 ? 1 : threads;
+}
 
-        found_data = 1;
-
-        /*
-         * Accumulate scores
-         * strcmp() returns 0 when strings are equal
-         */
-        if (strcmp(team_name, "Purdue") == 0) {
-            purdue_score += points;
-        } else {
-            opponent_score += points;
-            if (opponent_name[0] == '\0') {
-                strncpy(opponent_name, team_name, MAX_NAME_LENGTH - 1);
-            }
-        }
-    }
+/* Resume from checkpoint files (hw2_set_checkpoints) */
+static int use_checkpoints = 0;
 
-    /* Don't forget to output the last match! */
-    if (current_year == year && found_data) {
-        if (!header_written) {
-            fprintf(fp_out, "%d\n", year);
-            header_written = 1;
-        }
+void hw2_set_checkpoints(int enabled) {
+    use_checkpoints = enabled != 0;
+}
 
-        fprintf(fp_out, "%02d-%02d:Purdue(%d)-%s(%d)\n",
-                current_month, current_day,
-                purdue_score, opponent_name, opponent_score);
+/* Skip bad records instead of failing (hw2_set_lenient) */
+static int lenient = 0;
 
-        if (purdue_score > opponent_score) {
-            wins++;
-        } else {
-            losses++;
-        }
-    }
+void hw2_set_lenient(int enabled) {
+    lenient = enabled != 0;
+}
 
-    /* Write final record */
-    if (found_data) {
-        fprintf(fp_out, "Record: %dW-%dL\n", wins, losses);
-    }
+/* Group records by game, with this memory budget (hw2_set_grouping; 0 = off) */
+static size_t group_budget = 0;
 
-    /*
-     * STEP 4: Close files
-     * ALWAYS close files when done! This:
-     * - Flushes any buffered data to disk
-     * - Releases system resources
-     * - Prevents data corruption
-     */
-    fclose(fp_in);
-    fclose(fp_out);
-
-    return found_data ? SUCCESS : NO_DATA_POINTS;
+void hw2_set_grouping(long long memory_budget) {
+    group_budget = memory_budget > 0 ? (size_t)memory_budget : 0;
 }
 
-/* ============================================================
- * FUNCTION: match_most_valuable_player
- * ============================================================
- *
- * LEARNING POINTS:
- * - Filtering data by multiple criteria (year, month, day)
- * - Calculating derived values (combined score)
- * - Finding maximum value while reading
- */
-double match_most_valuable_player(char *in_file, int year, int month, int day) {
-    FILE *fp = NULL;
+/* What the last grouped query could not split (hw2_last_ambiguous_days) */
+static _Thread_local GroupStats last_group_stats;
 
-    /* Validate date parameters first */
-    if (!is_valid_date(year, month, day)) {
-        return (double)BAD_DATE;
+long long hw2_last_ambiguous_days(long long *first_day) {
+    if (first_day != NULL) {
+        *first_day = last_group_stats.first_ambiguous;
     }
+    return last_group_stats.ambiguous_days;
+}
 
-    fp = fopen(in_file, "r");
-    if (fp == NULL) {
-        return (double)FILE_READ_ERR;
-    }
-
-    int r_year, r_month, r_day;
-    char player_name[MAX_NAME_LENGTH];
-    char team_name[MAX_NAME_LENGTH];
-    int points, assists, blocks;
-    float minutes;
-
-    double max_combined_score = -1.0;
-    int found_match = 0;
-
-    while (fscanf(fp, "%d-%d-%d|%63[^,],%63[^#]#%d,%d,%d,%f",
-                  &r_year, &r_month, &r_day,
-                  player_name, team_name,
-                  &points, &assists, &blocks, &minutes) == 9) {
+/* Home team of every query (hw2_set_team) */
+static char home_team[MAX_NAME_LENGTH] = "Purdue";
 
-        if (!is_valid_date(r_year, r_month, r_day)) {
-            fclose(fp);
-            return (double)BAD_DATE;
-        }
-
-        if (points < 0 || assists < 0 || blocks < 0 || minutes <= 0) {
-            fclose(fp);
-            return (double)BAD_RECORD;
-        }
+int hw2_set_team(const char *team) {
+    size_t len;
 
-        /* Check if this is the match we're looking for */
-        if (r_year == year && r_month == month && r_day == day) {
-            found_match = 1;
-
-            /*
-             * Calculate combined score using the formula:
-             * Combined = points + 1.5*assists + 2*blocks + 0.2*minutes
-             */
-            double combined = (double)points +
-                              1.5 * (double)assists +
-                              2.0 * (double)blocks +
-                              0.2 * (double)minutes;
-
-            if (combined > max_combined_score) {
-                max_combined_score = combined;
-            }
-        }
+    if (team == NULL) {
+        team = "Purdue";
     }
+    len = strlen(team);
+    if (len == 0 || len >= MAX_NAME_LENGTH) {
+        return BAD_RECORD;
+    }
+    memcpy(home_team, team, len + 1);
+    return SUCCESS;
+}
 
-    fclose(fp);
-
-    if (!found_match) {
-        return (double)NO_DATA_POINTS;
+/* Date window of every query (hw2_set_date_range) */
+static int range_set = 0;
+static int range[6];             /* from y, m, d, to y, m, d */
+
+int hw2_set_date_range(int from_year, int from_month, int from_day,
+                       int to_year, int to_month, int to_day) {
+    QueryPlan check;
+    int status;
+
+    /* plan_set_date_range() has the rules; it allocates nothing */
+    plan_init(&check);
+    status = plan_set_date_range(&check, from_year, from_month, from_day,
+                                 to_year, to_month, to_day);
+    if (status != SUCCESS) {
+        return status;
     }
+    range[0] = from_year;
+    range[1] = from_month;
+    range[2] = from_day;
+    range[3] = to_year;
+    range[4] = to_month;
+    range[5] = to_day;
+    range_set = 1;
+    return SUCCESS;
+}
 
-    return max_combined_score;
+void hw2_clear_date_range(void) {
+    range_set = 0;
 }
 
 /* ============================================================
- * FUNCTION: average_points_player
+ * HELPER FUNCTIONS: acquire_plan / release_plan
  * ============================================================
  *
  * LEARNING POINTS:
- * - String comparison with strcmp()
- * - Accumulating totals and counts
- * - Calculating averages
+ * - Every query runs in the same QueryPlan, emptied with plan_reset()
+ *   instead of freed, so after the first few calls its arenas already
+ *   hold all the memory a query needs: no malloc() per call
+ * - pthread_mutex_trylock(): a second thread that finds the shared
+ *   plan busy does not wait for it, but uses a plan of its own
  */
-double average_points_player(char *in_file, char *player_name) {
-    FILE *fp = NULL;
-
-    fp = fopen(in_file, "r");
-    if (fp == NULL) {
-        return (double)FILE_READ_ERR;
-    }
-
-    int r_year, r_month, r_day;
-    char r_player_name[MAX_NAME_LENGTH];
-    char team_name[MAX_NAME_LENGTH];
-    int points, assists, blocks;
-    float minutes;
-
-    int total_points = 0;
-    int match_count = 0;
-
-    while (fscanf(fp, "%d-%d-%d|%63[^,],%63[^#]#%d,%d,%d,%f",
-                  &r_year, &r_month, &r_day,
-                  r_player_name, team_name,
-                  &points, &assists, &blocks, &minutes) == 9) {
-
-        if (!is_valid_date(r_year, r_month, r_day)) {
-            fclose(fp);
-            return (double)BAD_DATE;
-        }
-
-        if (points < 0 || assists < 0 || blocks < 0 || minutes <= 0) {
-            fclose(fp);
-            return (double)BAD_RECORD;
-        }
-
-        /*
-         * strcmp() returns 0 when strings match
-         * We need to match the exact player name
-         */
-        if (strcmp(r_player_name, player_name) == 0) {
-            total_points += points;
-            match_count++;
+static QueryPlan shared_plan;
+static int shared_plan_ready = 0;
+static pthread_mutex_t shared_plan_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static QueryPlan *acquire_plan(QueryPlan *local) {
+    if (pthread_mutex_trylock(&shared_plan_lock) == 0) {
+        if (!shared_plan_ready) {
+            plan_init(&shared_plan);
+            shared_plan_ready = 1;
         }
+        return &shared_plan;
     }
+    plan_init(local);
+    return local;
+}
 
-    fclose(fp);
-
-    if (match_count == 0) {
-        return (double)NO_DATA_POINTS;
+static void release_plan(QueryPlan *plan) {
+    if (plan == &shared_plan) {
+        plan_reset(plan);
+        pthread_mutex_unlock(&shared_plan_lock);
+    } else {
+        plan_free(plan);
     }
-
-    /* Calculate and return average */
-    return (double)total_points / (double)match_count;
 }
 
 /* ============================================================
- * FUNCTION: purdue_best_winning_match_score
+ * HELPER FUNCTION: run_single_query
  * ============================================================
- *
- * LEARNING POINTS:
- * - Tracking per-match totals (need to detect match boundaries)
- * - Finding maximum based on calculated difference
- * - Handling ties (highest Purdue score wins)
+ * Runs a plan holding exactly one query for `team`, remembers where
+ * it stopped (for hw2_last_parse_error), what it skipped (for
+ * hw2_last_bad_records) and what it cost (for hw2_last_stats),
+ * releases the plan and returns the query's result.
  */
-int purdue_best_winning_match_score(char *in_file, int year, int month) {
-    FILE *fp = NULL;
+static double run_single_query(QueryPlan *plan, int id, char *in_file, const char *team) {
+    double result;
+    int status = id < 0 ? id : plan_set_team(plan, team);
 
-    /* Validate parameters */
-    if (year <= 0 || month < 1 || month > 12) {
-        return BAD_DATE;
+    if (status != SUCCESS) {
+        release_plan(plan);
+        return (double)status;
     }
-
-    fp = fopen(in_file, "r");
-    if (fp == NULL) {
-        return FILE_READ_ERR;
+    if (range_set) {
+        plan_set_date_range(plan, range[0], range[1], range[2], range[3], range[4], range[5]);
     }
+    plan_set_lenient(plan, lenient);
+
+    stats_reset();
+    memset(&last_group_stats, 0, sizeof(last_group_stats));
+    if (shard_is_spec(in_file)) {
+        plan_run_sharded(plan, in_file, scan_threads, NULL);
+    } else if (group_budget > 0) {
+        group_run(plan, in_file, group_budget, &last_group_stats);
+    } else if (use_checkpoints && plan_resumable(plan)) {
+        checkpoint_run(plan, in_file);
+    } else {
+        plan_run_parallel(plan, in_file, scan_threads);
+    }
+    /* Every runner has joined its threads (plan_end() the writer): their counters are this thread's */
+    stats_collect(&last_stats);
+    last_parse_error = plan_parse_error(plan);
+    last_bad_records = *plan_bad_records(plan);
+    result = plan_result(plan, id);
+    release_plan(plan);
+    return result;
+}
 
-    int r_year, r_month, r_day;
-    char player_name[MAX_NAME_LENGTH];
-    char team_name[MAX_NAME_LENGTH];
-    int points, assists, blocks;
-    float minutes;
-
-    /* Current match tracking */
-    int current_year = -1, current_month = -1, current_day = -1;
-    int purdue_score = 0, opponent_score = 0;
-
-    /* Best winning match tracking */
-    int best_difference = -1;
-    int best_purdue_score = -1;
-    int found_win = 0;
-
-    while (fscanf(fp, "%d-%d-%d|%63[^,],%63[^#]#%d,%d,%d,%f",
-                  &r_year, &r_month, &r_day,
-                  player_name, team_name,
-                  &points, &assists, &blocks, &minutes) == 9) {
-
-        if (!is_valid_date(r_year, r_month, r_day)) {
-            fclose(fp);
-            return BAD_DATE;
-        }
-
-        if (points < 0 || assists < 0 || blocks < 0 || minutes <= 0) {
-            fclose(fp);
-            return BAD_RECORD;
-        }
-
-        /* Detect new match */
-        if (r_year != current_year || r_month != current_month || r_day != current_day) {
-            /* Process previous match if it's in our target month/year */
-            if (current_year == year && current_month == month) {
-                int diff = purdue_score - opponent_score;
-                /* Check if Purdue won and if this is the best win */
-                if (diff > 0) {
-                    if (diff > best_difference ||
-                        (diff == best_difference && purdue_score > best_purdue_score)) {
-                        best_difference = diff;
-                        best_purdue_score = purdue_score;
-                        found_win = 1;
-                    }
-                }
-            }
-
-            /* Reset for new match */
-            current_year = r_year;
-            current_month = r_month;
-            current_day = r_day;
-            purdue_score = 0;
-            opponent_score = 0;
-        }
+/* ============================================================
+ * FUNCTION: generate_matches_history
+ * ============================================================
+ */
+int generate_matches_history(char *in_file, int year, char *out_file) {
+    return team_matches_history(in_file, home_team, year, out_file);
+}
 
-        /* Accumulate scores */
-        if (strcmp(team_name, "Purdue") == 0) {
-            purdue_score += points;
-        } else {
-            opponent_score += points;
-        }
-    }
+/* ============================================================
+ * FUNCTION: match_most_valuable_player
+ * ============================================================
+ */
+double match_most_valuable_player(char *in_file, int year, int month, int day) {
+    QueryPlan local;
+    QueryPlan *plan = acquire_plan(&local);
 
-    /* Process last match */
-    if (current_year == year && current_month == month) {
-        int diff = purdue_score - opponent_score;
-        if (diff > 0) {
-            if (diff > best_difference ||
-                (diff == best_difference && purdue_score > best_purdue_score)) {
-                best_difference = diff;
-                best_purdue_score = purdue_score;
-                found_win = 1;
-            }
-        }
-    }
+    return run_single_query(plan, plan_add_most_valuable_player(plan, year, month, day), in_file,
+                            home_team);
+}
 
-    fclose(fp);
+/* ============================================================
+ * FUNCTION: average_points_player
+ * ============================================================
+ */
+double average_points_player(char *in_file, char *player_name) {
+    QueryPlan local;
+    QueryPlan *plan = acquire_plan(&local);
 
-    if (!found_win) {
-        return NO_DATA_POINTS;
-    }
+    return run_single_query(plan, plan_add_average_points(plan, player_name), in_file, home_team);
+}
 
-    return best_purdue_score;
+/* ============================================================
+ * FUNCTION: purdue_best_winning_match_score
+ * ============================================================
+ */
+int purdue_best_winning_match_score(char *in_file, int year, int month) {
+    return team_best_winning_match_score(in_file, home_team, year, month);
 }
 
 /* ============================================================
  * FUNCTION: purdue_best_month
  * ============================================================
- *
- * LEARNING POINTS:
- * - Using arrays to track per-month statistics
- * - Calculating rates/percentages
- * - Finding maximum across categories
  */
 int purdue_best_month(char *in_file) {
-    FILE *fp = NULL;
-
-    fp = fopen(in_file, "r");
-    if (fp == NULL) {
-        return FILE_READ_ERR;
-    }
-
-    /* Arrays to track wins and total games per month (index 0-11 for months 1-12) */
-    int wins[12] = {0};
-    int total_games[12] = {0};
-
-    int r_year, r_month, r_day;
-    char player_name[MAX_NAME_LENGTH];
-    char team_name[MAX_NAME_LENGTH];
-    int points, assists, blocks;
-    float minutes;
-
-    /* Current match tracking */
-    int current_year = -1, current_month = -1, current_day = -1;
-    int purdue_score = 0, opponent_score = 0;
-
-    while (fscanf(fp, "%d-%d-%d|%63[^,],%63[^#]#%d,%d,%d,%f",
-                  &r_year, &r_month, &r_day,
-                  player_name, team_name,
-                  &points, &assists, &blocks, &minutes) == 9) {
-
-        if (!is_valid_date(r_year, r_month, r_day)) {
-            fclose(fp);
-            return BAD_DATE;
-        }
-
-        if (points < 0 || assists < 0 || blocks < 0 || minutes <= 0) {
-            fclose(fp);
-            return BAD_RECORD;
-        }
-
-        /* Detect new match */
-        if (r_year != current_year || r_month != current_month || r_day != current_day) {
-            /* Process previous match */
-            if (current_month >= 1 && current_month <= 12) {
-                total_games[current_month - 1]++;
-                if (purdue_score > opponent_score) {
-                    wins[current_month - 1]++;
-                }
-            }
-
-            current_year = r_year;
-            current_month = r_month;
-            current_day = r_day;
-            purdue_score = 0;
-            opponent_score = 0;
-        }
-
-        if (strcmp(team_name, "Purdue") == 0) {
-            purdue_score += points;
-        } else {
-            opponent_score += points;
-        }
-    }
-
-    /* Process last match */
-    if (current_month >= 1 && current_month <= 12) {
-        total_games[current_month - 1]++;
-        if (purdue_score > opponent_score) {
-            wins[current_month - 1]++;
-        }
-    }
-
-    fclose(fp);
-
-    /* Find best month */
-    int best_month = -1;
-    double best_rate = -1.0;
-
-    for (int i = 0; i < 12; i++) {
-        if (total_games[i] > 0) {
-            double rate = (double)wins[i] / (double)total_games[i];
-            if (rate > best_rate) {
-                best_rate = rate;
-                best_month = i + 1;  /* Convert back to 1-based month */
-            }
-        }
-    }
-
-    if (best_month == -1 || best_rate == 0.0) {
-        return NO_DATA_POINTS;
-    }
-
-    return best_month;
+    return team_best_month(in_file, home_team);
 }
 
 /* ============================================================
  * FUNCTION: generate_player_report
  * ============================================================
- *
- * LEARNING POINTS:
- * - Combining reading and writing in one function
- * - Tracking multiple statistics
- * - Formatted output with precision specifiers (%.2f)
  */
 int generate_player_report(char *in_file, char *player_name, char *out_file) {
-    FILE *fp_in = NULL;
-    FILE *fp_out = NULL;
-
-    fp_in = fopen(in_file, "r");
-    if (fp_in == NULL) {
-        return FILE_READ_ERR;
-    }
-
-    int r_year, r_month, r_day;
-    char r_player_name[MAX_NAME_LENGTH];
-    char team_name[MAX_NAME_LENGTH];
-    int points, assists, blocks;
-    float minutes;
-
-    /* Statistics accumulators */
-    int total_points = 0;
-    int total_assists = 0;
-    int total_blocks = 0;
-    float total_minutes = 0.0;
-    int games_played = 0;
-    int games_won = 0;
-
-    /* We need to track match boundaries to count wins */
-    int current_year = -1, current_month = -1, current_day = -1;
-    int purdue_score = 0, opponent_score = 0;
-    int player_in_this_match = 0;
-
-    /* First pass: collect all data */
-    while (fscanf(fp_in, "%d-%d-%d|%63[^,],%63[^#]#%d,%d,%d,%f",
-                  &r_year, &r_month, &r_day,
-                  r_player_name, team_name,
-                  &points, &assists, &blocks, &minutes) == 9) {
-
-        if (!is_valid_date(r_year, r_month, r_day)) {
-            fclose(fp_in);
-            return BAD_DATE;
-        }
-
-        if (points < 0 || assists < 0 || blocks < 0 || minutes <= 0) {
-            fclose(fp_in);
-            return BAD_RECORD;
-        }
-
-        /* Detect new match */
-        if (r_year != current_year || r_month != current_month || r_day != current_day) {
-            /* Process previous match - count win if player was in it */
-            if (player_in_this_match && purdue_score > opponent_score) {
-                games_won++;
-            }
-
-            current_year = r_year;
-            current_month = r_month;
-            current_day = r_day;
-            purdue_score = 0;
-            opponent_score = 0;
-            player_in_this_match = 0;
-        }
-
-        /* Accumulate scores for win/loss determination */
-        if (strcmp(team_name, "Purdue") == 0) {
-            purdue_score += points;
-        } else {
-            opponent_score += points;
-        }
+    return team_player_report(in_file, home_team, player_name, out_file);
+}
 
-        /* Check if this is our player (must be Purdue) */
-        if (strcmp(r_player_name, player_name) == 0 && strcmp(team_name, "Purdue") == 0) {
-            total_points += points;
-            total_assists += assists;
-            total_blocks += blocks;
-            total_minutes += minutes;
-            games_played++;
-            player_in_this_match = 1;
-        }
-    }
+/* ============================================================
+ * FUNCTIONS: team_* (any home team)
+ * ============================================================
+ * The same one-query plans, with plan_set_team() instead of the
+ * default team.
+ */
+int team_matches_history(char *in_file, char *team, int year, char *out_file) {
+    QueryPlan local;
+    QueryPlan *plan = acquire_plan(&local);
 
-    /* Process last match */
-    if (player_in_this_match && purdue_score > opponent_score) {
-        games_won++;
-    }
+    return (int)run_single_query(plan, plan_add_matches_history(plan, year, out_file), in_file,
+                                 team);
+}
 
-    fclose(fp_in);
+int team_best_winning_match_score(char *in_file, char *team, int year, int month) {
+    QueryPlan local;
+    QueryPlan *plan = acquire_plan(&local);
 
-    if (games_played == 0) {
-        return NO_DATA_POINTS;
-    }
+    return (int)run_single_query(plan, plan_add_best_winning_match(plan, year, month), in_file,
+                                 team);
+}
 
-    /* Now write the report */
-    fp_out = fopen(out_file, "w");
-    if (fp_out == NULL) {
-        return FILE_WRITE_ERR;
-    }
+int team_best_month(char *in_file, char *team) {
+    QueryPlan local;
+    QueryPlan *plan = acquire_plan(&local);
 
-    /*
-     * Write formatted report
-     * %.2f means: floating point with exactly 2 decimal places
-     */
-    fprintf(fp_out, "Player: %s\n", player_name);
-    fprintf(fp_out, "Games: %d\n", games_played);
-    fprintf(fp_out, "Games Won: %d\n", games_won);
-    fprintf(fp_out, "Points per Game: %.2f\n", (double)total_points / games_played);
-    fprintf(fp_out, "Assists per Game: %.2f\n", (double)total_assists / games_played);
-    fprintf(fp_out, "Blocks per Game: %.2f\n", (double)total_blocks / games_played);
-    fprintf(fp_out, "Average Minutes: %.2f\n", total_minutes / games_played);
+    return (int)run_single_query(plan, plan_add_best_month(plan), in_file, team);
+}
 
-    fclose(fp_out);
+int team_player_report(char *in_file, char *team, char *player_name, char *out_file) {
+    QueryPlan local;
+    QueryPlan *plan = acquire_plan(&local);
 
-    return SUCCESS;
+    return (int)run_single_query(plan, plan_add_player_report(plan, player_name, out_file),
+                                 in_file, team);
 }
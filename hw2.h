@@ -24,12 +24,49 @@
 #define BAD_RECORD     -3   /* Invalid data format in record */
 #define BAD_DATE       -4   /* Invalid date (month 1-12, day 1-30, year > 0) */
 #define NO_DATA_POINTS -5   /* No matching data found */
+#define NO_MEMORY      -6   /* Could not allocate memory */
 
 /* ========== CONSTANTS ========== */
 #define MAX_NAME_LENGTH 64  /* Maximum length for player/team names */
+#define BAD_RECORD_LOG_SIZE 16  /* Bad records listed in lenient mode */
+
+/* ========== TYPES ========== */
+
+/*
+ * Where the last BAD_RECORD / BAD_DATE was found.
+ * Filled in by every function below; code is SUCCESS if the
+ * last call did not stop on a bad record.
+ */
+typedef struct {
+    int code;           /* BAD_RECORD, BAD_DATE, or SUCCESS */
+    long line;          /* Line number of the bad record (1-based) */
+    long long offset;   /* Byte offset of the start of that line */
+} ParseError;
+
+/*
+ * The bad records a lenient scan skipped (hw2_set_lenient): how many
+ * there were, and where the first BAD_RECORD_LOG_SIZE of them are.
+ */
+typedef struct {
+    int code;           /* BAD_RECORD or BAD_DATE */
+    long line;          /* Line number (1-based) */
+    long long offset;   /* Byte offset of the start of the line */
+    const char *reason; /* "malformed line", "invalid date", ... */
+} BadRecord;
+
+typedef struct {
+    long long skipped;  /* Bad records skipped in total */
+    int count;          /* Entries in first[] (at most BAD_RECORD_LOG_SIZE) */
+    BadRecord first[BAD_RECORD_LOG_SIZE];  /* In file order */
+} BadRecordLog;
 
 /* ========== FUNCTION PROTOTYPES ========== */
 
+/*
+ * in_file may also name a dataset split into several files: a
+ * directory, a glob pattern or "@list_file" (see shard_scan.h).
+ */
+
 /*
  * generate_matches_history
  *
@@ -126,4 +163,169 @@ int purdue_best_month(char *in_file);
  */
 int generate_player_report(char *in_file, char *player_name, char *out_file);
 
+/*
+ * team_matches_history / team_best_winning_match_score /
+ * team_best_month / team_player_report
+ *
+ * Purpose: The four Purdue functions above, for any team
+ *
+ * Parameters:
+ *   team - Home team whose rows are counted where the functions above
+ *          count Purdue's (NULL means Purdue); other parameters as
+ *          above
+ *
+ * Returns:
+ *   As the matching function above, or BAD_RECORD if team is empty
+ *   or too long (MAX_NAME_LENGTH). To get the results of every team
+ *   from one scan, see team_table.h; for the reports of every player
+ *   of a team, see roster_report.h.
+ */
+int team_matches_history(char *in_file, char *team, int year, char *out_file);
+int team_best_winning_match_score(char *in_file, char *team, int year, int month);
+int team_best_month(char *in_file, char *team);
+int team_player_report(char *in_file, char *team, char *player_name, char *out_file);
+
+/*
+ * hw2_last_parse_error
+ *
+ * Purpose: Report where the most recent call above found a bad record
+ *
+ * Returns:
+ *   A ParseError; code is SUCCESS if the last call found no bad record
+ *
+ * This and the other hw2_last_ functions are per thread: they describe
+ * the most recent call made by the calling thread, whatever other
+ * threads run at the same time. A thread that made no call gets
+ * SUCCESS / zeros.
+ */
+ParseError hw2_last_parse_error(void);
+
+/*
+ * hw2_set_threads
+ *
+ * Purpose: Let the functions above scan large files on several threads
+ *
+ * Parameters:
+ *   threads - Number of threads to use; 1 (the default) scans on the
+ *             calling thread. Results are the same either way.
+ */
+void hw2_set_threads(int threads);
+
+/*
+ * hw2_set_team
+ *
+ * Purpose: Report on a team other than Purdue
+ *
+ * Parameters:
+ *   team - Team whose matches, wins and players the functions above
+ *          report on (histories print this name instead of "Purdue").
+ *          The default is "Purdue"; NULL restores it.
+ *
+ * Returns:
+ *   SUCCESS, or BAD_RECORD if team is empty or too long to appear in
+ *   a game data file (MAX_NAME_LENGTH)
+ */
+int hw2_set_team(const char *team);
+
+/*
+ * hw2_set_checkpoints
+ *
+ * Purpose: Avoid rescanning a game log that only grows at the end
+ *
+ * Parameters:
+ *   enabled - 1: average_points_player, purdue_best_month and
+ *             generate_player_report (and their team_ versions) save
+ *             their progress in in_file + ".ckpt" and later read only
+ *             the lines added since (see checkpoint.h). A file that was
+ *             truncated or rewritten is read again from the start.
+ *             0 (the default): every call reads the whole file.
+ */
+void hw2_set_checkpoints(int enabled);
+
+/*
+ * hw2_set_date_range / hw2_clear_date_range
+ *
+ * Purpose: Answer the functions above for a window of dates only
+ *
+ * Parameters:
+ *   from_*, to_* - First and last day of the window (both included).
+ *                  Every function above then sees only the records
+ *                  dated inside it, as if the file held nothing else
+ *                  (generate_matches_history's year, for example,
+ *                  still applies on top).
+ *
+ * Once a scan has found a file's dates in order (they never go down),
+ * later calls on the unchanged file binary-search to the window and
+ * stop after it instead of reading the whole file. Checkpoints are
+ * not used while a window is set. hw2_clear_date_range() goes back
+ * to whole files (the default).
+ *
+ * Returns:
+ *   SUCCESS, or BAD_DATE if a date is invalid or from is after to
+ *   (the window is then unchanged)
+ */
+int hw2_set_date_range(int from_year, int from_month, int from_day,
+                       int to_year, int to_month, int to_day);
+void hw2_clear_date_range(void);
+
+/*
+ * hw2_set_lenient / hw2_last_bad_records
+ *
+ * Purpose: Keep going past bad records instead of failing
+ *
+ * Parameters:
+ *   enabled - 1: a malformed line, invalid date or invalid stat no
+ *             longer makes the functions above return BAD_RECORD /
+ *             BAD_DATE; the line is skipped, the scan resumes at the
+ *             next line, and the results are those of the file without
+ *             its bad lines. 0 (the default): the first bad record
+ *             stops the call, as described above.
+ *
+ * Read errors and damaged column files still stop a lenient call.
+ * Checkpoints are not used in lenient mode.
+ *
+ * Returns (hw2_last_bad_records):
+ *   The bad records the most recent call above (on this thread)
+ *   skipped (skipped is 0 if there were none, or the call was not
+ *   lenient)
+ */
+void hw2_set_lenient(int enabled);
+BadRecordLog hw2_last_bad_records(void);
+
+/*
+ * hw2_set_grouping
+ *
+ * Purpose: Find games in logs that are not in game order
+ *
+ * Parameters:
+ *   memory_budget - > 0: the functions above group records by game
+ *                   (date, and a new game where a player shows up
+ *                   again that day) wherever they are in the file, so interleaved
+ *                   or unsorted logs and doubleheaders give correct
+ *                   match scores. About memory_budget bytes of records
+ *                   are kept in memory; the rest go to a temporary
+ *                   file (see game_groups.h). 0 (the default): a match
+ *                   is a run of records with the same date.
+ *
+ * Threads, checkpoints and index / match table files are not used
+ * while grouping is on.
+ */
+void hw2_set_grouping(long long memory_budget);
+
+/*
+ * hw2_last_ambiguous_days
+ *
+ * Purpose: Report days whose games the calling thread's most recent
+ *          grouped call could not tell apart (see game_groups.h); their match scores are
+ *          a best guess
+ *
+ * Parameters:
+ *   first_day - if not NULL, receives the first such day as YYYYMMDD
+ *               (0 if there was none)
+ *
+ * Returns:
+ *   The number of such days (0 if none, or grouping was off)
+ */
+long long hw2_last_ambiguous_days(long long *first_day);
+
 #endif /* HW2_H */
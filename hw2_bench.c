@@ -0,0 +1,437 @@
+/*
+ * hw2_bench.c - Time the hw2.h functions on a game data file
+ *
+ * COMPILE: make hw2_bench
+ * RUN:     ./hw2_bench [options] <data_file>
+ *
+ * OPTIONS:
+ *   --runs N      timed runs per function, after one warm-up run (default 5)
+ *   --threads N   passed to hw2_set_threads() (default 1)
+ *   --player S    player for the average and report (default "Z. Edey")
+ *   --label S     recorded in the results, e.g. a version or commit
+ *   --json FILE   also write the results as JSON ("-" = standard output)
+ *
+ * HW2_SIMD=scalar (or sse4.2) in the environment benchmarks the
+ * tokenizer without its faster vector paths.
+ *
+ * For each function: latency (mean, min, p50, p90, p99, max),
+ * throughput in records/s and MB/s, and the peak resident set size.
+ * Each function runs in its own child process, so its peak RSS is
+ * not hidden by the functions measured before it.
+ *
+ * Query parameters come from the file's first record: its date for
+ * the MVP, its year for the history, its year and month for the best
+ * winning match.
+ *
+ * A file with bad records (hw2_gen --corrupt) is timed in lenient
+ * mode: otherwise every call would stop at the first bad line, and
+ * throughput would be the time of a short prefix over the whole file.
+ */
+
+/* Needed for wait4() with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "hw2.h"
+#include "record_reader.h"
+#include "simd_scan.h"
+
+/* ========== CONSTANTS ========== */
+#define BENCH_OUT_FILE  "bench_out.tmp"   /* history / report output */
+#define BENCH_MAX_RUNS  10000
+
+/* ========== TYPES ========== */
+
+/* What the benchmark runs and on which file */
+typedef struct {
+    char *in_file;
+    char *player;
+    int year, month, day;        /* from the first record */
+    long long bytes;
+    long long records;           /* good records */
+    long long bad_records;       /* skipped: the calls run lenient */
+    int file_status;             /* SUCCESS, or the error that ended the file early */
+    int runs;
+} BenchSetup;
+
+/* One function's measurements */
+typedef struct {
+    const char *function;
+    double result;
+    double *seconds;             /* one per run, sorted */
+    long peak_rss_kb;
+} BenchResult;
+
+enum {
+    BENCH_HISTORY, BENCH_MVP, BENCH_AVERAGE, BENCH_BEST_WIN, BENCH_BEST_MONTH, BENCH_REPORT,
+    BENCH_COUNT
+};
+
+static const char *function_names[BENCH_COUNT] = {
+    "generate_matches_history",
+    "match_most_valuable_player",
+    "average_points_player",
+    "purdue_best_winning_match_score",
+    "purdue_best_month",
+    "generate_player_report"
+};
+
+/* ============================================================
+ * HELPER FUNCTIONS: Timing
+ * ============================================================
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted values */
+static double percentile(const double *sorted, int n, double p) {
+    int rank = (int)(p / 100.0 * n + 0.999999);
+
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[rank > n ? n - 1 : rank - 1];
+}
+
+static long max_rss_kb(const struct rusage *usage) {
+#ifdef __APPLE__
+    return usage->ru_maxrss / 1024;  /* bytes on macOS */
+#else
+    return usage->ru_maxrss;         /* kilobytes on Linux */
+#endif
+}
+
+/* ============================================================
+ * HELPER FUNCTION: run_function
+ * ============================================================
+ * Calls one hw2.h function once and returns its result.
+ */
+static double run_function(const BenchSetup *setup, int which) {
+    switch (which) {
+        case BENCH_HISTORY:
+            return generate_matches_history(setup->in_file, setup->year, BENCH_OUT_FILE);
+        case BENCH_MVP:
+            return match_most_valuable_player(setup->in_file, setup->year, setup->month,
+                                              setup->day);
+        case BENCH_AVERAGE:
+            return average_points_player(setup->in_file, setup->player);
+        case BENCH_BEST_WIN:
+            return purdue_best_winning_match_score(setup->in_file, setup->year, setup->month);
+        case BENCH_BEST_MONTH:
+            return purdue_best_month(setup->in_file);
+        default:
+            return generate_player_report(setup->in_file, setup->player, BENCH_OUT_FILE);
+    }
+}
+
+/* One warm-up call, then setup->runs timed calls */
+static void time_function(const BenchSetup *setup, int which, BenchResult *r) {
+    r->result = run_function(setup, which);
+    for (int i = 0; i < setup->runs; i++) {
+        double start = now_seconds();
+        run_function(setup, which);
+        r->seconds[i] = now_seconds() - start;
+    }
+}
+
+/* read() until size bytes arrived; a pipe may deliver them in pieces */
+static int read_all(int fd, void *data, size_t size) {
+    char *p = data;
+
+    while (size > 0) {
+        ssize_t got = read(fd, p, size);
+        if (got <= 0) {
+            return 0;
+        }
+        p += got;
+        size -= (size_t)got;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: measure
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - fork() gives each function a fresh process; wait4() returns the
+ *   child's resource usage, including its peak RSS
+ * - The child sends its timings back through a pipe
+ * - If fork() fails, the function is timed in this process instead
+ */
+static void measure(const BenchSetup *setup, int which, BenchResult *r) {
+    size_t size = (size_t)setup->runs * sizeof(double);
+    struct rusage usage;
+    int fds[2];
+    pid_t pid;
+
+    r->function = function_names[which];
+    r->peak_rss_kb = -1;
+
+    if (pipe(fds) != 0 || (pid = fork()) < 0) {
+        time_function(setup, which, r);
+        getrusage(RUSAGE_SELF, &usage);
+        r->peak_rss_kb = max_rss_kb(&usage);
+        return;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        time_function(setup, which, r);
+        if (write(fds[1], &r->result, sizeof(double)) != (ssize_t)sizeof(double) ||
+            write(fds[1], r->seconds, size) != (ssize_t)size) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    if (!read_all(fds[0], &r->result, sizeof(double)) || !read_all(fds[0], r->seconds, size)) {
+        memset(r->seconds, 0, size);
+        r->result = NO_MEMORY;
+    }
+    close(fds[0]);
+    if (wait4(pid, NULL, 0, &usage) == pid) {
+        r->peak_rss_kb = max_rss_kb(&usage);
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: inspect_file
+ * ============================================================
+ * One scan to count records and take the query parameters from the
+ * first record. Bad text records are skipped, as a lenient scan does;
+ * anything else ends the scan, and bytes then counts only what was
+ * read before it.
+ */
+static int inspect_file(BenchSetup *setup) {
+    RecordReader rd;
+    GameRecord rec;
+    struct stat st;
+    int status;
+
+    if (stat(setup->in_file, &st) != 0) {
+        return FILE_READ_ERR;
+    }
+    setup->bytes = (long long)st.st_size;
+
+    status = reader_open(&rd, setup->in_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    reader_set_fields(&rd, FIELD_DATE);
+    while ((status = reader_next(&rd, &rec)) != RECORD_EOF) {
+        if (status == RECORD_OK) {
+            if (setup->records++ == 0) {
+                setup->year = rec.year;
+                setup->month = rec.month;
+                setup->day = rec.day;
+            }
+        } else if ((status == BAD_RECORD || status == BAD_DATE) && rd.columns == NULL) {
+            setup->bad_records++;
+        } else {
+            if (rd.err_offset > 0) {
+                setup->bytes = rd.err_offset;
+            }
+            break;
+        }
+    }
+    setup->file_status = status == RECORD_EOF ? SUCCESS : status;
+    reader_close(&rd);
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: Output
+ * ============================================================
+ */
+static void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            fprintf(out, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned)*s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void write_json(FILE *out, const BenchSetup *setup, const char *label, int threads,
+                       const BenchResult *results) {
+    fprintf(out, "{\n  \"label\": ");
+    json_string(out, label);
+    fprintf(out, ",\n  \"file\": ");
+    json_string(out, setup->in_file);
+    fprintf(out, ",\n  \"bytes\": %lld,\n  \"records\": %lld,\n  \"bad_records\": %lld,\n"
+                 "  \"file_status\": %d,\n  \"threads\": %d,\n  \"simd\": \"%s\",\n"
+                 "  \"runs\": %d,\n  \"results\": [\n",
+            setup->bytes, setup->records, setup->bad_records, setup->file_status, threads,
+            simd_level_name(simd_level()), setup->runs);
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        const BenchResult *r = &results[i];
+        const double *s = r->seconds;
+        int n = setup->runs;
+        double mean = 0.0;
+
+        for (int k = 0; k < n; k++) {
+            mean += s[k] / n;
+        }
+        fprintf(out, "    {\"function\": \"%s\", \"result\": %.6g, \"mean_s\": %.9f, "
+                     "\"min_s\": %.9f, \"p50_s\": %.9f, \"p90_s\": %.9f, \"p99_s\": %.9f, "
+                     "\"max_s\": %.9f, \"records_per_s\": %.1f, \"mb_per_s\": %.3f, "
+                     "\"peak_rss_kb\": %ld}%s\n",
+                r->function, r->result, mean, s[0], percentile(s, n, 50), percentile(s, n, 90),
+                percentile(s, n, 99), s[n - 1],
+                mean > 0 ? (double)setup->records / mean : 0.0,
+                mean > 0 ? (double)setup->bytes / 1e6 / mean : 0.0,
+                r->peak_rss_kb, i + 1 < BENCH_COUNT ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void print_table(const BenchSetup *setup, const BenchResult *results) {
+    printf("%-32s %10s %10s %10s %10s %10s %9s %9s\n", "function", "result", "mean ms",
+           "p50 ms", "p99 ms", "Mrec/s", "MB/s", "RSS MB");
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        const BenchResult *r = &results[i];
+        int n = setup->runs;
+        double mean = 0.0;
+
+        for (int k = 0; k < n; k++) {
+            mean += r->seconds[k] / n;
+        }
+        printf("%-32s %10.2f %10.3f %10.3f %10.3f %10.2f %9.1f %9.1f\n",
+               r->function, r->result, mean * 1e3,
+               percentile(r->seconds, n, 50) * 1e3, percentile(r->seconds, n, 99) * 1e3,
+               mean > 0 ? (double)setup->records / 1e6 / mean : 0.0,
+               mean > 0 ? (double)setup->bytes / 1e6 / mean : 0.0,
+               r->peak_rss_kb / 1024.0);
+    }
+}
+
+static int usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--runs N] [--threads N] [--player S] [--label S] [--json FILE]"
+            " <data_file>\n", program);
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    BenchSetup setup;
+    BenchResult results[BENCH_COUNT];
+    const char *label = "";
+    const char *json_file = NULL;
+    int threads = 1;
+    int status;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.player = "Z. Edey";
+    setup.runs = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (arg[0] != '-') {
+            if (setup.in_file != NULL) {
+                return usage(argv[0]);
+            }
+            setup.in_file = argv[i];
+            continue;
+        }
+        if (i + 1 == argc) {
+            return usage(argv[0]);
+        }
+        i++;
+        if (strcmp(arg, "--runs") == 0) {
+            setup.runs = atoi(argv[i]);
+        } else if (strcmp(arg, "--threads") == 0) {
+            threads = atoi(argv[i]);
+        } else if (strcmp(arg, "--player") == 0) {
+            setup.player = argv[i];
+        } else if (strcmp(arg, "--label") == 0) {
+            label = argv[i];
+        } else if (strcmp(arg, "--json") == 0) {
+            json_file = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (setup.in_file == NULL || setup.runs < 1 || setup.runs > BENCH_MAX_RUNS) {
+        return usage(argv[0]);
+    }
+
+    status = inspect_file(&setup);
+    if (status != SUCCESS) {
+        fprintf(stderr, "%s: cannot read %s (error %d)\n", argv[0], setup.in_file, status);
+        return 1;
+    }
+    if (setup.records == 0) {
+        setup.year = 2024;
+        setup.month = 1;
+        setup.day = 1;
+    }
+    hw2_set_threads(threads);
+    hw2_set_lenient(setup.bad_records > 0);
+
+    fprintf(stderr, "%s: %lld bytes, %lld records, %lld bad records skipped%s, %d runs, "
+                    "%d thread(s), %s parsing\n",
+            setup.in_file, setup.bytes, setup.records, setup.bad_records,
+            setup.file_status == SUCCESS ? "" : " (file read up to an error)", setup.runs,
+            threads, simd_level_name(simd_level()));
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        results[i].seconds = malloc((size_t)setup.runs * sizeof(double));
+        if (results[i].seconds == NULL) {
+            fprintf(stderr, "%s: out of memory\n", argv[0]);
+            return 1;
+        }
+        fflush(stdout);  /* the child must not inherit buffered output */
+        measure(&setup, i, &results[i]);
+        qsort(results[i].seconds, (size_t)setup.runs, sizeof(double), compare_doubles);
+    }
+    remove(BENCH_OUT_FILE);
+
+    print_table(&setup, results);
+
+    if (json_file != NULL) {
+        FILE *out = strcmp(json_file, "-") == 0 ? stdout : fopen(json_file, "w");
+
+        if (out == NULL) {
+            fprintf(stderr, "%s: cannot write %s\n", argv[0], json_file);
+            return 1;
+        }
+        write_json(out, &setup, label, threads, results);
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        free(results[i].seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * hw2_client.c - The hw2.h queries, answered by a running hw2_daemon
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. connect() once, then one send() / recv() pair per call
+ * 2. Reconnecting once when the daemon was restarted under us
+ * 3. realpath() and getcwd() to turn relative paths into absolute ones
+ * 4. Falling back to the local hw2.h function when no daemon answers
+ * 5. _Thread_local (C11) results, so each thread sees its own last call
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "hw2.h"
+#include "query_server.h"
+#include "hw2_client.h"
+
+/* The connection, shared by every call (one call at a time) */
+static pthread_mutex_t client_lock = PTHREAD_MUTEX_INITIALIZER;
+static int client_fd = -1;
+static char client_socket[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+/*
+ * What this thread's last call found (remote_last_parse_error /
+ * remote_last_served); set after client_lock is released, so one per
+ * thread instead of one shared copy
+ */
+static _Thread_local ParseError last_parse_error = { SUCCESS, 0, 0 };
+static _Thread_local int last_served = 0;
+
+ParseError remote_last_parse_error(void) {
+    return last_parse_error;
+}
+
+int remote_last_served(void) {
+    return last_served;
+}
+
+/* ============================================================
+ * FUNCTION: remote_set_socket
+ * ============================================================
+ */
+static void disconnect(void) {
+    if (client_fd >= 0) {
+        close(client_fd);
+        client_fd = -1;
+    }
+}
+
+void remote_set_socket(const char *socket_path) {
+    pthread_mutex_lock(&client_lock);
+    disconnect();
+    if (socket_path == NULL) {
+        client_socket[0] = '\0';
+    } else if (strlen(socket_path) < sizeof(client_socket)) {
+        strcpy(client_socket, socket_path);
+    }
+    pthread_mutex_unlock(&client_lock);
+}
+
+/* Connects if not connected; returns 0 if no daemon answers */
+static int connect_daemon(void) {
+    struct sockaddr_un addr;
+    const char *path = client_socket;
+
+    if (client_fd >= 0) {
+        return 1;
+    }
+    if (path[0] == '\0') {
+        path = getenv("HW2_SOCKET");
+        if (path == NULL || path[0] == '\0') {
+            path = SERVER_SOCKET;
+        }
+    }
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return 0;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    client_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (client_fd < 0) {
+        return 0;
+    }
+    if (connect(client_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        disconnect();
+        return 0;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: absolute_path
+ * ============================================================
+ * An existing file: realpath(). An output file may not exist yet, so
+ * it is only prefixed with the working directory.
+ * Returns 0 if the path cannot be made absolute or is too long.
+ */
+static int absolute_path(const char *path, int must_exist, char *buf) {
+    char cwd[PATH_MAX];
+
+    if (must_exist) {
+        char *real = realpath(path, NULL);
+        int fits = real != NULL && strlen(real) < SERVER_MAX_PATH;
+
+        if (fits) {
+            strcpy(buf, real);
+        }
+        free(real);
+        return fits;
+    }
+    if (path[0] == '/') {
+        cwd[0] = '\0';
+    } else if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        return 0;
+    }
+    return snprintf(buf, SERVER_MAX_PATH, "%s%s%s", cwd, cwd[0] ? "/" : "", path) <
+           SERVER_MAX_PATH;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: ask
+ * ============================================================
+ * Sends req (with its strings; NULL = none) and stores the daemon's
+ * answer in *value. Returns 1 if the daemon answered, 0 if the caller
+ * should answer locally.
+ *
+ * LEARNING POINTS:
+ * - A daemon that was restarted leaves us holding a dead connection:
+ *   the first send() or recv() fails, so connect again and retry once
+ * - MSG_NOSIGNAL: writing to a closed socket must not kill the
+ *   program with SIGPIPE
+ */
+static int ask(ServerRequest *req, const char *in_file, const char *name,
+               const char *out_file, double *value) {
+    char buf[SERVER_MAX_REQUEST];
+    char file_abs[SERVER_MAX_PATH], out_abs[SERVER_MAX_PATH];
+    const char *strings[3] = { "", name != NULL ? name : "", "" };
+    ServerReply reply;
+    size_t len = sizeof(*req);
+    int served = 0;
+
+    if (in_file != NULL) {
+        if (!absolute_path(in_file, 1, file_abs)) {
+            return 0;
+        }
+        strings[0] = file_abs;
+    }
+    if (out_file != NULL) {
+        if (!absolute_path(out_file, 0, out_abs)) {
+            return 0;
+        }
+        strings[2] = out_abs;
+    }
+    if (strlen(strings[1]) >= SERVER_MAX_PATH) {
+        return 0;
+    }
+
+    req->magic = SERVER_MAGIC;
+    req->file_len = (uint16_t)strlen(strings[0]);
+    req->name_len = (uint16_t)strlen(strings[1]);
+    req->out_len = (uint16_t)strlen(strings[2]);
+    for (int i = 0; i < 3; i++) {
+        size_t n = strlen(strings[i]);
+
+        memcpy(buf + len, strings[i], n);
+        len += n;
+    }
+    memcpy(buf, req, sizeof(*req));
+
+    pthread_mutex_lock(&client_lock);
+    for (int attempt = 0; attempt < 2 && !served; attempt++) {
+        if (!connect_daemon()) {
+            break;
+        }
+        if (send(client_fd, buf, len, MSG_NOSIGNAL) == (ssize_t)len &&
+            recv(client_fd, &reply, sizeof(reply), 0) == (ssize_t)sizeof(reply) &&
+            reply.magic == SERVER_MAGIC) {
+            served = 1;
+        } else {
+            disconnect();
+        }
+    }
+    pthread_mutex_unlock(&client_lock);
+
+    if (served) {
+        *value = reply.value;
+        last_parse_error.code = reply.err_code;
+        last_parse_error.line = (long)reply.err_line;
+        last_parse_error.offset = reply.err_offset;
+    }
+    last_served = served;
+    return served;
+}
+
+/* After a local answer: hw2_last_parse_error() is this thread's too (hw2.h) */
+static void answered_locally(void) {
+    last_served = 0;
+    last_parse_error = hw2_last_parse_error();
+}
+
+/* ============================================================
+ * FUNCTIONS: The six queries
+ * ============================================================
+ */
+int remote_generate_matches_history(char *in_file, int year, char *out_file) {
+    ServerRequest req = { 0 };
+    double value;
+    int result;
+
+    req.op = SERVER_MATCHES_HISTORY;
+    req.year = year;
+    if (ask(&req, in_file, NULL, out_file, &value)) {
+        return (int)value;
+    }
+    result = generate_matches_history(in_file, year, out_file);
+    answered_locally();
+    return result;
+}
+
+double remote_match_most_valuable_player(char *in_file, int year, int month, int day) {
+    ServerRequest req = { 0 };
+    double value;
+
+    req.op = SERVER_MOST_VALUABLE_PLAYER;
+    req.year = year;
+    req.month = month;
+    req.day = day;
+    if (ask(&req, in_file, NULL, NULL, &value)) {
+        return value;
+    }
+    value = match_most_valuable_player(in_file, year, month, day);
+    answered_locally();
+    return value;
+}
+
+double remote_average_points_player(char *in_file, char *player_name) {
+    ServerRequest req = { 0 };
+    double value;
+
+    req.op = SERVER_AVERAGE_POINTS;
+    if (ask(&req, in_file, player_name, NULL, &value)) {
+        return value;
+    }
+    value = average_points_player(in_file, player_name);
+    answered_locally();
+    return value;
+}
+
+int remote_purdue_best_winning_match_score(char *in_file, int year, int month) {
+    ServerRequest req = { 0 };
+    double value;
+    int result;
+
+    req.op = SERVER_BEST_WINNING_MATCH;
+    req.year = year;
+    req.month = month;
+    if (ask(&req, in_file, NULL, NULL, &value)) {
+        return (int)value;
+    }
+    result = purdue_best_winning_match_score(in_file, year, month);
+    answered_locally();
+    return result;
+}
+
+int remote_purdue_best_month(char *in_file) {
+    ServerRequest req = { 0 };
+    double value;
+    int result;
+
+    req.op = SERVER_BEST_MONTH;
+    if (ask(&req, in_file, NULL, NULL, &value)) {
+        return (int)value;
+    }
+    result = purdue_best_month(in_file);
+    answered_locally();
+    return result;
+}
+
+int remote_generate_player_report(char *in_file, char *player_name, char *out_file) {
+    ServerRequest req = { 0 };
+    double value;
+    int result;
+
+    req.op = SERVER_PLAYER_REPORT;
+    if (ask(&req, in_file, player_name, out_file, &value)) {
+        return (int)value;
+    }
+    result = generate_player_report(in_file, player_name, out_file);
+    answered_locally();
+    return result;
+}
+
+/* ============================================================
+ * FUNCTION: remote_shutdown
+ * ============================================================
+ */
+int remote_shutdown(void) {
+    ServerRequest req = { 0 };
+    double value;
+
+    req.op = SERVER_SHUTDOWN;
+    if (!ask(&req, NULL, NULL, NULL, &value)) {
+        return FILE_READ_ERR;
+    }
+    pthread_mutex_lock(&client_lock);
+    disconnect();
+    pthread_mutex_unlock(&client_lock);
+    return SUCCESS;
+}
@@ -0,0 +1,73 @@
+/*
+ * hw2_client.h - The hw2.h queries, answered by a running hw2_daemon
+ *
+ * This file contains:
+ * - remote_* versions of the six hw2.h functions (same parameters,
+ *   same return values)
+ * - Functions to choose the daemon's socket and to stop the daemon
+ *
+ * Learning Concepts:
+ * - A thin client: each call is one request and one reply on a socket
+ *   that stays connected between calls
+ * - Paths are made absolute before they are sent: the daemon has its
+ *   own working directory
+ * - Graceful fallback: with no daemon to ask, the call is simply
+ *   answered locally by the hw2.h function
+ *
+ * Typical use:
+ *   $ ./hw2_daemon game_data.txt &           (loads it once)
+ *   ...
+ *   double avg = remote_average_points_player("game_data.txt", "Z. Edey");
+ *
+ * The daemon answers with the hw2.h defaults (Purdue, whole file,
+ * strict parsing); hw2_set_team() and the other hw2_set_* settings of
+ * the calling program only apply to the local fallback. Output files
+ * are written by the daemon, so it must be allowed to write them.
+ */
+
+#ifndef HW2_CLIENT_H
+#define HW2_CLIENT_H
+
+#include "hw2.h"
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * The six queries: parameters and return values are those of the
+ * matching hw2.h function.
+ */
+int remote_generate_matches_history(char *in_file, int year, char *out_file);
+double remote_match_most_valuable_player(char *in_file, int year, int month, int day);
+double remote_average_points_player(char *in_file, char *player_name);
+int remote_purdue_best_winning_match_score(char *in_file, int year, int month);
+int remote_purdue_best_month(char *in_file);
+int remote_generate_player_report(char *in_file, char *player_name, char *out_file);
+
+/*
+ * remote_last_parse_error / remote_last_served
+ *
+ * Where the calling thread's last call above found a bad record (as
+ * hw2_last_parse_error()), and whether the daemon answered it
+ * (1) or it was answered locally (0). Each thread has its own.
+ */
+ParseError remote_last_parse_error(void);
+int remote_last_served(void);
+
+/*
+ * remote_set_socket
+ *
+ * The daemon's socket: socket_path, or NULL for $HW2_SOCKET if it is
+ * set, else SERVER_SOCKET (query_server.h). Closes the current
+ * connection; the next call connects again.
+ */
+void remote_set_socket(const char *socket_path);
+
+/*
+ * remote_shutdown
+ *
+ * Asks the daemon to exit. Returns SUCCESS, or FILE_READ_ERR if no
+ * daemon answered.
+ */
+int remote_shutdown(void);
+
+#endif /* HW2_CLIENT_H */
@@ -0,0 +1,36 @@
+/*
+ * hw2_convert.c - Convert a text game data file to a column file
+ *
+ * COMPILE: make hw2_convert
+ * RUN:     ./hw2_convert game_data.txt game_data.col
+ *
+ * Every function in hw2.h accepts the resulting .col file in place
+ * of the text file and returns the same results.
+ */
+
+#include <stdio.h>
+#include "hw2.h"
+#include "column_file.h"
+
+int main(int argc, char *argv[]) {
+    ParseError err;
+    int result;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <in_file.txt> <out_file.col>\n", argv[0]);
+        return 2;
+    }
+
+    result = column_convert(argv[1], argv[2], &err);
+    if (result != SUCCESS) {
+        fprintf(stderr, "%s: conversion failed (error %d)", argv[1], result);
+        if (err.code != SUCCESS) {
+            fprintf(stderr, " at line %ld, byte offset %lld", err.line, err.offset);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+
+    printf("Wrote %s\n", argv[2]);
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * hw2_daemon.c - Keep game data files loaded and answer queries on them
+ *
+ * COMPILE: make hw2_daemon
+ * RUN:     ./hw2_daemon [--socket PATH] [data_file ...] &
+ *
+ * Loads each data_file now (others on their first query), then
+ * answers the remote_* functions of hw2_client.h on a Unix domain
+ * socket (default SERVER_SOCKET, /tmp/hw2d.sock) until it gets
+ * SIGINT / SIGTERM or remote_shutdown(). A file that changes is
+ * reloaded on its next query.
+ *
+ * Thousands of small queries then cost one load of the file plus a
+ * round trip each, instead of a process start and a full scan each.
+ */
+
+/* Needed for sigaction() with -std=c17 */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include "hw2.h"
+#include "query_server.h"
+
+static QueryServer server;
+
+/* Signal handler: server_stop() only write()s one byte */
+static void on_signal(int sig) {
+    (void)sig;
+    server_stop(&server);
+}
+
+int main(int argc, char *argv[]) {
+    const char *socket_path = NULL;
+    struct sigaction sa;
+    int first = 1;
+    int result;
+
+    if (argc >= 3 && strcmp(argv[1], "--socket") == 0) {
+        socket_path = argv[2];
+        first = 3;
+    } else if (argc >= 2 && argv[1][0] == '-') {
+        fprintf(stderr, "usage: %s [--socket PATH] [data_file ...]\n", argv[0]);
+        return 2;
+    }
+
+    result = server_open(&server, socket_path);
+    if (result != SUCCESS) {
+        fprintf(stderr, "%s: cannot listen on %s (error %d; is a daemon already running?)\n",
+                argv[0], socket_path != NULL ? socket_path : SERVER_SOCKET, result);
+        return 1;
+    }
+
+    for (int i = first; i < argc; i++) {
+        result = server_load(&server, argv[i]);
+        if (result != SUCCESS) {
+            fprintf(stderr, "%s: %s: error %d (its queries will return it)\n",
+                    argv[0], argv[i], result);
+        }
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    result = server_run(&server);
+    server_close(&server);
+    return result == SUCCESS ? 0 : 1;
+}
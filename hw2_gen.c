@@ -0,0 +1,125 @@
+/*
+ * hw2_gen.c - Generate a synthetic game data file
+ *
+ * COMPILE: make hw2_gen
+ * RUN:     ./hw2_gen [options] <out_file>
+ *
+ * OPTIONS:
+ *   --seed N         random seed (default 1); same options = same file
+ *   --seasons N      number of seasons (default 4)
+ *   --first-year N   year of the first season (default 2021)
+ *   --teams N        teams, team 0 is Purdue (default 14)
+ *   --players N      players per team (default 15)
+ *   --games N        games per season (default 300)
+ *   --corrupt R      fraction of damaged lines, 0 to 1 (default 0)
+ *   --size S         add seasons until the file has S bytes; accepts
+ *                    K, M and G suffixes (e.g. 500M, 2G, 40G). Seasons
+ *                    then have at most 360 games (one a day: a date is
+ *                    one match); past about 2 GB the seasons up to
+ *                    9999 run out and games get more rows per team
+ *                    instead. Fails if S still cannot be reached
+ *
+ * <out_file> may be "-" for standard output.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hw2.h"
+#include "synth_data.h"
+
+/* "64M" -> 67108864; returns -1 if the text is not a size */
+static long long parse_size(const char *text) {
+    char *end;
+    long long value = strtoll(text, &end, 10);
+
+    switch (*end) {
+        case 'G': case 'g': value <<= 10; /* fall through */
+        case 'M': case 'm': value <<= 10; /* fall through */
+        case 'K': case 'k': value <<= 10; end++; break;
+        default: break;
+    }
+    return (*end != '\0' || end == text || value < 0) ? -1 : value;
+}
+
+static int usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--seed N] [--seasons N] [--first-year N] [--teams N]\n"
+            "       [--players N] [--games N] [--corrupt R] [--size S] <out_file>\n",
+            program);
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    SynthOptions opt;
+    SynthStats stats;
+    const char *out_file = NULL;
+    int result;
+
+    synth_defaults(&opt);
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (arg[0] != '-' || strcmp(arg, "-") == 0) {
+            if (out_file != NULL) {
+                return usage(argv[0]);
+            }
+            out_file = arg;
+            continue;
+        }
+        if (value == NULL) {
+            return usage(argv[0]);
+        }
+        i++;
+
+        if (strcmp(arg, "--seed") == 0) {
+            opt.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--seasons") == 0) {
+            opt.seasons = atoi(value);
+        } else if (strcmp(arg, "--first-year") == 0) {
+            opt.first_year = atoi(value);
+        } else if (strcmp(arg, "--teams") == 0) {
+            opt.teams = atoi(value);
+        } else if (strcmp(arg, "--players") == 0) {
+            opt.players = atoi(value);
+        } else if (strcmp(arg, "--games") == 0) {
+            opt.games = atoi(value);
+        } else if (strcmp(arg, "--corrupt") == 0) {
+            opt.corrupt_rate = atof(value);
+        } else if (strcmp(arg, "--size") == 0) {
+            opt.size = parse_size(value);
+            if (opt.size < 0) {
+                return usage(argv[0]);
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (out_file == NULL) {
+        return usage(argv[0]);
+    }
+
+    result = synth_write(&opt, out_file, &stats);
+    if (result == BAD_RECORD) {
+        fprintf(stderr, "%s: option out of range (or --size too large to reach)\n", argv[0]);
+        return usage(argv[0]);
+    }
+    if (result != SUCCESS) {
+        fprintf(stderr, "%s: writing %s failed (error %d)\n", argv[0], out_file, result);
+        return 1;
+    }
+
+    fprintf(stderr, "Wrote %s: %lld lines, %lld bytes, %d seasons, %lld damaged lines\n",
+            out_file, stats.lines, stats.bytes, stats.seasons, stats.corrupt_lines);
+    if (opt.size > 0 && stats.bytes < opt.size) {
+        fprintf(stderr, "%s: error: stopped short of %lld bytes at the year 9999\n",
+                argv[0], opt.size);
+        if (strcmp(out_file, "-") != 0) {
+            remove(out_file);
+        }
+        return 1;
+    }
+    return 0;
+}
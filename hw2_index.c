@@ -0,0 +1,42 @@
+/*
+ * hw2_index.c - Build the date / player index for a game data file
+ *
+ * COMPILE: make hw2_index
+ * RUN:     ./hw2_index game_data.txt
+ *
+ * Writes game_data.txt.idx and game_data.txt.mtab. While the data
+ * file is unchanged, match_most_valuable_player() and
+ * average_points_player() read only the matching records instead of
+ * the whole file, and generate_matches_history(),
+ * purdue_best_winning_match_score() and purdue_best_month() read only
+ * the per-match totals. Works on text files and column files.
+ */
+
+#include <stdio.h>
+#include "hw2.h"
+#include "file_index.h"
+#include "match_table.h"
+
+int main(int argc, char *argv[]) {
+    int result;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data_file>\n", argv[0]);
+        return 2;
+    }
+
+    result = index_build(argv[1], NULL);
+    if (result != SUCCESS) {
+        fprintf(stderr, "%s: indexing failed (error %d)\n", argv[1], result);
+        return 1;
+    }
+
+    result = match_table_build(argv[1], NULL);
+    if (result != SUCCESS) {
+        fprintf(stderr, "%s: match table failed (error %d)\n", argv[1], result);
+        return 1;
+    }
+
+    printf("Wrote %s%s and %s%s\n", argv[1], INDEX_SUFFIX, argv[1], MATCH_SUFFIX);
+    return 0;
+}
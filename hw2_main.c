@@ -9,7 +9,25 @@
  */
 
 #include <stdio.h>
+#include <pthread.h>
+#include <zlib.h>
 #include "hw2.h"
+#include "query_plan.h"
+#include "column_file.h"
+#include "file_index.h"
+#include "match_table.h"
+#include "dataset.h"
+#include "team_table.h"
+#include "checkpoint.h"
+#include "game_groups.h"
+#include "external_sort.h"
+#include "shard_scan.h"
+#include "roster_report.h"
+#include "leaderboard.h"
+#include "query_server.h"
+#include "hw2_client.h"
+#include "stats.h"
+#include "arena.h"
 
 /*
  * Helper function to print error codes in human-readable form
@@ -34,6 +52,9 @@ void print_result_code(int code) {
         case NO_DATA_POINTS:
             printf("ERROR: NO_DATA_POINTS\n");
             break;
+        case NO_MEMORY:
+            printf("ERROR: NO_MEMORY\n");
+            break;
         default:
             printf("UNKNOWN CODE: %d\n", code);
     }
@@ -59,6 +80,102 @@ void print_file_contents(const char *filename) {
     fclose(fp);
 }
 
+/*
+ * Helper function to create a small input file for a test
+ */
+void write_text_file(const char *filename, const char *text) {
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        printf("Could not create %s\n", filename);
+        return;
+    }
+    fputs(text, fp);
+    fclose(fp);
+}
+
+/*
+ * Helper function to copy lines [skip, skip + count) of one file to
+ * another (count -1 = to the end); mode "a" appends
+ */
+void copy_lines(const char *from, const char *to, const char *mode, int skip, int count) {
+    FILE *fp_in = fopen(from, "r");
+    FILE *fp_out = fopen(to, mode);
+    char line[256];
+
+    if (fp_in == NULL || fp_out == NULL) {
+        printf("Could not copy %s to %s\n", from, to);
+    } else {
+        for (int n = 0; fgets(line, sizeof(line), fp_in) != NULL; n++) {
+            if (n >= skip && (count < 0 || n < skip + count)) {
+                fputs(line, fp_out);
+            }
+        }
+    }
+    if (fp_in != NULL) {
+        fclose(fp_in);
+    }
+    if (fp_out != NULL) {
+        fclose(fp_out);
+    }
+}
+
+/*
+ * Helper function to write a gzip-compressed copy of a file
+ * (what "gzip -k" does), using zlib's gzopen()/gzwrite()
+ */
+void gzip_copy(const char *from, const char *to) {
+    FILE *fp_in = fopen(from, "rb");
+    gzFile gz_out = gzopen(to, "wb");
+    char block[4096];
+    size_t n;
+
+    if (fp_in == NULL || gz_out == NULL) {
+        printf("Could not compress %s to %s\n", from, to);
+    } else {
+        while ((n = fread(block, 1, sizeof(block), fp_in)) > 0) {
+            gzwrite(gz_out, block, (unsigned)n);
+        }
+    }
+    if (fp_in != NULL) {
+        fclose(fp_in);
+    }
+    if (gz_out != NULL) {
+        gzclose(gz_out);
+    }
+}
+
+/*
+ * Thread body for TEST 26: what hw2_daemon does, in this process
+ */
+void *run_server(void *srv) {
+    server_run(srv);
+    return NULL;
+}
+
+/*
+ * Thread body for TEST 26: local answers on two threads at once; each
+ * thread must see its own call's parse error, never the other's
+ */
+typedef struct {
+    char *file;
+    int bad_file;                /* 1: every call must report a parse error */
+    int mismatches;              /* calls whose error belonged to the other file */
+    ParseError error;
+} LocalCalls;
+
+void *run_local_calls(void *arg) {
+    LocalCalls *calls = arg;
+
+    for (int i = 0; i < 200; i++) {
+        remote_average_points_player(calls->file, "Z. Edey");
+        calls->error = remote_last_parse_error();
+        if ((calls->error.code != SUCCESS) != calls->bad_file || remote_last_served()) {
+            calls->mismatches++;
+        }
+    }
+    return NULL;
+}
+
 int main() {
     int result;
     double dbl_result;
@@ -185,6 +302,579 @@ int main() {
     print_result_code((int)dbl_result);
     printf("\n");
 
+    /*
+     * TEST 10: Error handling - location of a bad record
+     */
+    printf("=== TEST 10: Error Handling (Bad Record Location) ===\n");
+    printf("Reading a file whose third line has a missing field...\n");
+
+    write_text_file("bad_data.txt",
+                    "2024-01-10|Z. Edey,Purdue#28,3,2,30.5\n"
+                    "2024-01-10|B. Smith,Purdue#15,7,0,38.0\n"
+                    "2024-01-10|T. Kaufman,Purdue#10,1,30.0\n");
+
+    dbl_result = average_points_player("bad_data.txt", "Z. Edey");
+    printf("Result: ");
+    print_result_code((int)dbl_result);
+
+    ParseError err = hw2_last_parse_error();
+    printf("Bad record at line %ld, byte offset %lld\n\n", err.line, err.offset);
+    remove("bad_data.txt");
+
+    /*
+     * TEST 11: Query plan - several queries in one pass
+     */
+    printf("=== TEST 11: Query Plan (One Pass, Many Queries) ===\n");
+    printf("Running tests 2-6 together in a single scan...\n");
+
+    QueryPlan plan;
+    plan_init(&plan);
+    int mvp_id = plan_add_most_valuable_player(&plan, 2024, 1, 10);
+    int avg_id = plan_add_average_points(&plan, "Z. Edey");
+    int win_id = plan_add_best_winning_match(&plan, 2024, 1);
+    int month_id = plan_add_best_month(&plan);
+    int report_id = plan_add_player_report(&plan, "Z. Edey", "edey_report.txt");
+
+    result = plan_run(&plan, "game_data.txt");
+    printf("Result: ");
+    print_result_code(result);
+    printf("MVP Combined Score: %.2f\n", plan_result(&plan, mvp_id));
+    printf("Average Points: %.2f\n", plan_result(&plan, avg_id));
+    printf("Best Winning Match Score: %d\n", (int)plan_result(&plan, win_id));
+    printf("Best Month: %d\n", (int)plan_result(&plan, month_id));
+    printf("Player Report: ");
+    print_result_code((int)plan_result(&plan, report_id));
+    printf("\n");
+    plan_free(&plan);
+
+    /*
+     * TEST 12: Column file - same answers from the binary format
+     */
+    printf("=== TEST 12: Column File (Binary Columnar Format) ===\n");
+    printf("Converting game_data.txt to game_data.col...\n");
+
+    result = column_convert("game_data.txt", "game_data.col", NULL);
+    printf("Result: ");
+    print_result_code(result);
+
+    if (result == SUCCESS) {
+        printf("Best Month (from .col): %d\n", purdue_best_month("game_data.col"));
+        printf("Average Points (from .col): %.2f\n",
+               average_points_player("game_data.col", "Z. Edey"));
+        printf("MVP Combined Score (from .col): %.2f\n\n",
+               match_most_valuable_player("game_data.col", 2024, 1, 10));
+    }
+
+    /*
+     * TEST 13: Index sidecar - point lookups without a full scan
+     */
+    printf("=== TEST 13: Index Sidecar (game_data.txt.idx) ===\n");
+    printf("Building index for game_data.txt...\n");
+
+    result = index_build("game_data.txt", NULL);
+    printf("Result: ");
+    print_result_code(result);
+
+    if (result == SUCCESS) {
+        printf("MVP Combined Score (indexed): %.2f\n",
+               match_most_valuable_player("game_data.txt", 2024, 1, 10));
+        printf("Average Points (indexed): %.2f\n",
+               average_points_player("game_data.txt", "Z. Edey"));
+    }
+
+    /* A changed data file makes its index stale; queries scan instead */
+    write_text_file("index_data.txt",
+                    "2024-01-10|Z. Edey,Purdue#28,3,2,30.5\n");
+    index_build("index_data.txt", NULL);
+    write_text_file("index_data.txt",
+                    "2024-01-10|Z. Edey,Purdue#28,3,2,30.5\n"
+                    "2024-01-12|Z. Edey,Purdue#20,1,1,25.0\n");
+    printf("Average Points after the file changed: %.2f\n\n",
+           average_points_player("index_data.txt", "Z. Edey"));
+    remove("index_data.txt");
+    remove("index_data.txt.idx");
+
+    /*
+     * TEST 14: Multi-threaded scans give the same answers
+     */
+    printf("=== TEST 14: Parallel Scan (4 threads) ===\n");
+    hw2_set_threads(4);
+    printf("Best Month: %d\n", purdue_best_month("game_data.txt"));
+    printf("Best Winning Score (2024-01): %d\n",
+           purdue_best_winning_match_score("game_data.txt", 2024, 1));
+    hw2_set_threads(1);
+    printf("(Small files are scanned on one thread; large ones are split\n"
+           " at newlines and the per-thread results merged in order)\n\n");
+
+    /*
+     * TEST 15: Dataset handle - load once, query many times
+     */
+    printf("=== TEST 15: In-Memory Dataset ===\n");
+    Dataset ds;
+
+    result = dataset_open(&ds, "game_data.txt", NULL);
+    printf("Load: ");
+    print_result_code(result);
+
+    if (result == SUCCESS) {
+        printf("Records: %u, Matches: %u\n", ds.count, ds.match_count);
+        printf("Best Month: %d\n", dataset_best_month(&ds));
+        printf("MVP Combined Score (2024-01-10): %.2f\n",
+               dataset_most_valuable_player(&ds, 2024, 1, 10));
+        printf("Average Points (Z. Edey): %.2f\n",
+               dataset_average_points_player(&ds, "Z. Edey"));
+        printf("Best Winning Score (2024-01): %d\n\n",
+               dataset_best_winning_match_score(&ds, 2024, 1));
+        dataset_close(&ds);
+    }
+
+    /*
+     * TEST 16: Another home team - same functions, different team
+     */
+    printf("=== TEST 16: Home Team = Indiana ===\n");
+    hw2_set_team("Indiana");
+    result = generate_matches_history("game_data.txt", 2024, "indiana_history.txt");
+    printf("Result: ");
+    print_result_code(result);
+    if (result == SUCCESS) {
+        printf("Output written to: indiana_history.txt\n");
+    }
+    printf("Best Winning Score (2024-01): %d\n",
+           purdue_best_winning_match_score("game_data.col", 2024, 1));
+    hw2_set_team("Purdue");
+    printf("(Column files compare team and player ids, not names)\n\n");
+
+    /*
+     * TEST 17: Every team from one scan
+     */
+    printf("=== TEST 17: All Teams in One Scan ===\n");
+    TeamTable teams;
+
+    result = team_table_build(&teams, "game_data.txt", 2024, 1, NULL);
+    printf("Build: ");
+    print_result_code(result);
+
+    if (result == SUCCESS) {
+        for (uint32_t t = 0; t < team_table_count(&teams); t++) {
+            printf("%-10s best month %3d, best win (2024-01) %3d\n",
+                   team_table_name(&teams, t),
+                   team_table_best_month(&teams, t),
+                   team_table_best_winning_match_score(&teams, t));
+        }
+        printf("Same as team_best_month(\"game_data.txt\", \"Purdue\"): %d\n",
+               team_best_month("game_data.txt", "Purdue"));
+        if (team_table_write(&teams, "all_teams.txt") == SUCCESS) {
+            printf("Output written to: all_teams.txt\n");
+        }
+        team_table_free(&teams);
+    }
+    printf("\n");
+
+    /*
+     * TEST 18: A log that grows - later calls read only the new lines
+     */
+    printf("=== TEST 18: Growing Log with Checkpoints ===\n");
+    hw2_set_checkpoints(1);
+    remove("season_log.txt" CHECKPOINT_SUFFIX);
+    copy_lines("game_data.txt", "season_log.txt", "w", 0, 22);
+    printf("Lines 1-22:  best month %d, average (Z. Edey) %.2f\n",
+           purdue_best_month("season_log.txt"),
+           average_points_player("season_log.txt", "Z. Edey"));
+    generate_player_report("season_log.txt", "Z. Edey", "season_report.txt");
+
+    /* Line 22 is in the middle of a match: its partial score was saved */
+    copy_lines("game_data.txt", "season_log.txt", "a", 22, -1);
+    printf("Lines 1-44:  best month %d, average (Z. Edey) %.2f\n",
+           purdue_best_month("season_log.txt"),
+           average_points_player("season_log.txt", "Z. Edey"));
+    result = generate_player_report("season_log.txt", "Z. Edey", "season_report.txt");
+    hw2_set_checkpoints(0);
+    printf("Full scan:   best month %d, average (Z. Edey) %.2f\n",
+           purdue_best_month("season_log.txt"),
+           average_points_player("season_log.txt", "Z. Edey"));
+    if (result == SUCCESS) {
+        printf("Output written to: season_report.txt (same as edey_report.txt)\n");
+    }
+    printf("\n");
+
+    /*
+     * TEST 19: Every player's report from one scan
+     */
+    printf("=== TEST 19: Roster Reports in One Scan ===\n");
+    Roster roster;
+
+    result = roster_build(&roster, "game_data.txt", "Purdue", NULL);
+    printf("Build: ");
+    print_result_code(result);
+
+    if (result == SUCCESS) {
+        for (uint32_t p = 0; p < roster_count(&roster); p++) {
+            printf("%-12s %d games\n", roster_name(&roster, p), roster.totals[p].games_played);
+        }
+        if (roster_write(&roster, "purdue_roster.txt") == SUCCESS) {
+            printf("Output written to: purdue_roster.txt\n");
+        }
+        if (roster_write_files(&roster, "roster_") == SUCCESS) {
+            printf("Output written to: roster_*.txt (roster_Z_Edey.txt = edey_report.txt)\n");
+        }
+        roster_free(&roster);
+    }
+    printf("\n");
+
+    /*
+     * TEST 20: A compressed file is read as it is
+     */
+    printf("=== TEST 20: Compressed Input (gzip) ===\n");
+    gzip_copy("game_data.txt", "game_data.txt.gz");
+    printf("Best month: %d (plain: %d)\n",
+           purdue_best_month("game_data.txt.gz"), purdue_best_month("game_data.txt"));
+    printf("Average points (Z. Edey): %.2f (plain: %.2f)\n",
+           average_points_player("game_data.txt.gz", "Z. Edey"),
+           average_points_player("game_data.txt", "Z. Edey"));
+    printf("Best winning match (2024-01): %d (plain: %d)\n",
+           purdue_best_winning_match_score("game_data.txt.gz", 2024, 1),
+           purdue_best_winning_match_score("game_data.txt", 2024, 1));
+    printf("\n");
+
+    /*
+     * TEST 21: Where the time of a query goes
+     */
+    printf("=== TEST 21: Per-Phase Counters ===\n");
+    printf("Best month: %d\n", purdue_best_month("game_data.txt"));
+    Hw2Stats stats = hw2_last_stats();
+    if (stats.enabled) {
+        stats_write_json(&stats, stdout);
+    } else {
+        printf("Instrumentation: off (build with make STATS=1)\n");
+    }
+    printf("\n");
+
+    /*
+     * TEST 22: An arena reused round after round
+     */
+    printf("=== TEST 22: Arena Reset and Reuse ===\n");
+    Arena arena;
+    arena_init(&arena, 1024);
+    for (int round = 1; round <= 3; round++) {
+        for (int i = 0; i < 100; i++) {
+            int *scratch = arena_calloc(&arena, 12, sizeof(int));
+            char *name = arena_strndup(&arena, "Z. Edey", 7);
+            if (scratch == NULL || name == NULL) {
+                printf("Out of memory\n");
+                break;
+            }
+        }
+        printf("Round %d: %zu bytes used, %zu blocks allocated so far\n", round, arena.used,
+               arena.mallocs);
+        arena_reset(&arena);
+    }
+    arena_free(&arena);
+    printf("\n");
+
+    /*
+     * TEST 23: A window of dates
+     */
+    printf("=== TEST 23: Date Range 2024-01-01 .. 2024-01-30 ===\n");
+    if (hw2_set_date_range(2024, 1, 1, 2024, 1, 30) == SUCCESS) {
+        printf("Best month: %d\n", purdue_best_month("game_data.txt"));
+        printf("Average points (Z. Edey): %.2f\n",
+               average_points_player("game_data.txt", "Z. Edey"));
+        hw2_clear_date_range();
+    }
+    printf("Average points (Z. Edey), whole file: %.2f\n",
+           average_points_player("game_data.txt", "Z. Edey"));
+    printf("Backwards range: %d\n", hw2_set_date_range(2024, 2, 1, 2024, 1, 1));
+    printf("\n");
+
+    /*
+     * TEST 24: Top-K leaderboards
+     */
+    printf("=== TEST 24: Leaderboards (top 3) ===\n");
+    Leaderboard board;
+
+    result = leaderboard_top_games(&board, "game_data.txt", 3, 2024, 1, 10, NULL);
+    printf("Best games on 2024-01-10 (MVP score %.2f):\n",
+           match_most_valuable_player("game_data.txt", 2024, 1, 10));
+    if (result == SUCCESS) {
+        for (int i = 0; i < board.count; i++) {
+            printf("  %d. %-16s %-8s %.2f\n", i + 1, board.items[i].player,
+                   board.items[i].team, board.items[i].value);
+        }
+        leaderboard_free(&board);
+    }
+    result = leaderboard_top_games(&board, "game_data.txt", 3, 2024, 0, 0, NULL);
+    printf("Best games of 2024:\n");
+    if (result == SUCCESS) {
+        for (int i = 0; i < board.count; i++) {
+            printf("  %d. %-16s %-8s %04d-%02d-%02d %.2f\n", i + 1, board.items[i].player,
+                   board.items[i].team, board.items[i].year, board.items[i].month,
+                   board.items[i].day, board.items[i].value);
+        }
+        leaderboard_free(&board);
+    }
+    result = leaderboard_top_averages(&board, "game_data.txt", 3, 2024, 0, 0, NULL);
+    printf("Points per game in 2024:\n");
+    if (result == SUCCESS) {
+        for (int i = 0; i < board.count; i++) {
+            printf("  %d. %-16s %.2f (%d games)\n", i + 1, board.items[i].player,
+                   board.items[i].value, board.items[i].games);
+        }
+        leaderboard_free(&board);
+    }
+    printf("Day without a month: %d\n",
+           leaderboard_top_games(&board, "game_data.txt", 3, 2024, 0, 10, NULL));
+    printf("No rows asked for: %d\n",
+           leaderboard_top_games(&board, "game_data.txt", 0, 2024, 0, 0, NULL));
+    printf("\n");
+
+    /*
+     * TEST 25: Skipping bad records instead of failing
+     */
+    printf("=== TEST 25: Lenient Mode ===\n");
+    write_text_file("bad_data.txt",
+                    "2024-01-10|Z. Edey,Purdue#28,3,2,30.5\n"
+                    "2024-01-10|B. Smith,Purdue#15,7,0,38.0\n"
+                    "2024-01-10|T. Kaufman,Purdue#10,1,30.0\n"
+                    "2024-13-20|Z. Edey,Purdue#25,1,1,35.0\n"
+                    "2024-01-20|Z. Edey,Purdue#31,2,2,36.0\n"
+                    "2024-01-20|L. Jones,Purdue#-4,2,0,32.0\n");
+    printf("Strict:  ");
+    print_result_code((int)average_points_player("bad_data.txt", "Z. Edey"));
+    hw2_set_lenient(1);
+    printf("Lenient: average points (Z. Edey) %.2f\n",
+           average_points_player("bad_data.txt", "Z. Edey"));
+    hw2_set_lenient(0);
+
+    BadRecordLog bad = hw2_last_bad_records();
+    printf("Skipped %lld bad records:\n", bad.skipped);
+    for (int i = 0; i < bad.count; i++) {
+        printf("  line %ld, byte offset %lld: %s\n", bad.first[i].line, bad.first[i].offset,
+               bad.first[i].reason);
+    }
+    remove("bad_data.txt");
+    printf("\n");
+
+    /*
+     * TEST 26: Queries answered by a server that keeps the file loaded
+     */
+    printf("=== TEST 26: Query Daemon ===\n");
+    QueryServer server;
+    pthread_t server_thread;
+
+    copy_lines("game_data.txt", "daemon_data.txt", "w", 0, -1);
+    if (server_open(&server, "hw2_test.sock") == SUCCESS) {
+        if (pthread_create(&server_thread, NULL, run_server, &server) == 0) {
+            remote_set_socket("hw2_test.sock");
+            dbl_result = remote_average_points_player("daemon_data.txt", "Z. Edey");
+            printf("Average points (Z. Edey): %.2f, answered by the daemon: %s\n", dbl_result,
+                   remote_last_served() ? "yes" : "no");
+            printf("Local answer: %.2f\n", average_points_player("daemon_data.txt", "Z. Edey"));
+            printf("MVP Combined Score: %.2f, best month: %d\n",
+                   remote_match_most_valuable_player("daemon_data.txt", 2024, 1, 10),
+                   remote_purdue_best_month("daemon_data.txt"));
+
+            /* inotify sees the append; the next query reloads the file */
+            write_text_file("daemon_extra.txt", "2024-03-01|Z. Edey,Purdue#50,1,1,30.0\n");
+            copy_lines("daemon_extra.txt", "daemon_data.txt", "a", 0, -1);
+            printf("After appending a 50-point game: %.2f (local: %.2f)\n",
+                   remote_average_points_player("daemon_data.txt", "Z. Edey"),
+                   average_points_player("daemon_data.txt", "Z. Edey"));
+            printf("Files loaded by the daemon: %llu\n", server.loads);
+
+            printf("Shutdown: ");
+            print_result_code(remote_shutdown());
+            pthread_join(server_thread, NULL);
+        }
+        server_close(&server);
+    }
+    dbl_result = remote_average_points_player("daemon_data.txt", "Z. Edey");
+    printf("Daemon stopped: %.2f, answered by the daemon: %s\n", dbl_result,
+           remote_last_served() ? "yes" : "no");
+
+    /* Two threads falling back to local answers at the same time */
+    LocalCalls local_calls[2] = { { "daemon_data.txt", 0, 0 }, { "daemon_bad.txt", 1, 0 } };
+    pthread_t local_threads[2];
+
+    copy_lines("game_data.txt", "daemon_bad.txt", "w", 0, 5);
+    write_text_file("daemon_extra.txt", "2024-03-01|Z. Edey,Purdue#50\n");
+    copy_lines("daemon_extra.txt", "daemon_bad.txt", "a", 0, -1);
+    for (int i = 0; i < 2; i++) {
+        pthread_create(&local_threads[i], NULL, run_local_calls, &local_calls[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        pthread_join(local_threads[i], NULL);
+        printf("%s on its own thread: last error line %ld, %d of 200 calls saw another's\n",
+               local_calls[i].file, local_calls[i].error.line, local_calls[i].mismatches);
+    }
+    remote_set_socket(NULL);
+    remove("daemon_bad.txt");
+    remove("daemon_data.txt");
+    remove("daemon_extra.txt");
+    printf("\n");
+
+    /*
+     * TEST 27: Match-level queries from the per-match totals
+     */
+    printf("=== TEST 27: Match Table (match_data.txt.mtab) ===\n");
+    MatchTable table;
+
+    copy_lines("game_data.txt", "match_data.txt", "w", 0, -1);
+    printf("Before: best month %d, best winning score (2024-01) %d\n",
+           purdue_best_month("match_data.txt"),
+           purdue_best_winning_match_score("match_data.txt", 2024, 1));
+    printf("Building match table: ");
+    print_result_code(match_table_build("match_data.txt", NULL));
+    if (match_table_open(&table, "match_data.txt") == SUCCESS) {
+        printf("Matches in the table: %llu\n", (unsigned long long)table.match_count);
+        match_table_close(&table);
+    }
+    printf("From the table: best month %d, best winning score (2024-01) %d\n",
+           purdue_best_month("match_data.txt"),
+           purdue_best_winning_match_score("match_data.txt", 2024, 1));
+    result = generate_matches_history("match_data.txt", 2024, "match_history.txt");
+    printf("History from the table: ");
+    print_result_code(result);
+    if (result == SUCCESS) {
+        print_file_contents("match_history.txt");
+    }
+
+    /* An appended game makes the table stale; queries scan instead */
+    write_text_file("match_extra.txt", "2024-03-01|Z. Edey,Purdue#90,1,1,30.0\n"
+                                       "2024-03-01|T. Player,Rival#10,1,1,30.0\n");
+    copy_lines("match_extra.txt", "match_data.txt", "a", 0, -1);
+    printf("After appending a 90-10 win: best winning score (2024-03) %d\n",
+           purdue_best_winning_match_score("match_data.txt", 2024, 3));
+    remove("match_data.txt");
+    remove("match_data.txt.mtab");
+    remove("match_extra.txt");
+    remove("match_history.txt");
+    printf("\n");
+
+    /*
+     * TEST 28: An interleaved log with a doubleheader
+     */
+    printf("=== TEST 28: Grouping Records by Game ===\n");
+    QueryPlan group_plan;
+    GroupStats group_stats;
+
+    write_text_file("merged_log.txt",
+                    "2024-03-02|Z. Edey,Purdue#20,2,1,30.0\n"
+                    "2024-03-01|Z. Edey,Purdue#30,3,2,32.0\n"
+                    "2024-03-02|A. Rival,Iowa#25,4,0,35.0\n"
+                    "2024-03-01|A. Rival,Iowa#10,1,0,28.0\n"
+                    "2024-03-02|Z. Edey,Purdue#18,1,1,24.0\n"
+                    "2024-03-02|A. Rival,Iowa#12,2,0,20.0\n");
+    result = generate_matches_history("merged_log.txt", 2024, "merged_history.txt");
+    printf("Runs of equal dates: ");
+    print_result_code(result);
+    print_file_contents("merged_history.txt");
+
+    hw2_set_grouping(1 << 20);
+    result = generate_matches_history("merged_log.txt", 2024, "merged_history.txt");
+    printf("Grouped by game: ");
+    print_result_code(result);
+    print_file_contents("merged_history.txt");
+
+    /*
+     * A doubleheader in date order: C. Newman only plays the second
+     * game, listed before the players of the first; L. Jones plays
+     * for both teams. On 03-12 the rows could be split either way
+     */
+    write_text_file("doubleheader.txt",
+                    "2024-03-09|Z. Edey,Purdue#20,2,1,30.0\n"
+                    "2024-03-09|L. Jones,Purdue#10,1,0,25.0\n"
+                    "2024-03-09|A. Rival,Iowa#25,4,0,35.0\n"
+                    "2024-03-09|L. Jones,Iowa#8,0,0,20.0\n"
+                    "2024-03-09|C. Newman,Purdue#12,0,0,15.0\n"
+                    "2024-03-09|Z. Edey,Purdue#18,1,1,24.0\n"
+                    "2024-03-09|A. Rival,Iowa#22,2,0,30.0\n"
+                    "2024-03-12|Z. Edey,Purdue#20,2,1,30.0\n"
+                    "2024-03-12|C. Newman,Purdue#8,0,0,15.0\n"
+                    "2024-03-12|Z. Edey,Purdue#15,1,1,24.0\n");
+    result = generate_matches_history("doubleheader.txt", 2024, "merged_history.txt");
+    printf("Doubleheader: ");
+    print_result_code(result);
+    print_file_contents("merged_history.txt");
+    {
+        long long first_day;
+        long long days = hw2_last_ambiguous_days(&first_day);
+        printf("Days that could not be split: %lld (first %lld)\n", days, first_day);
+    }
+    hw2_set_grouping(0);
+    remove("doubleheader.txt");
+
+    /* The smallest budget: buckets are spilled to a temporary file */
+    plan_init(&group_plan);
+    plan_add_best_month(&group_plan);
+    group_run(&group_plan, "game_data.txt", 0, &group_stats);
+    printf("Best month (grouped): %d, %lld records in %lld games\n\n",
+           (int)plan_result(&group_plan, 0), group_stats.records, group_stats.games);
+    plan_free(&group_plan);
+    remove("merged_history.txt");
+
+    /*
+     * TEST 29: Sorting a file once instead of grouping on every query
+     */
+    printf("=== TEST 29: External Sort ===\n");
+    SortOptions sort_opt;
+    SortStats sort_stats;
+
+    /* The same log, with one line sent twice */
+    copy_lines("merged_log.txt", "dup_log.txt", "w", 0, -1);
+    copy_lines("merged_log.txt", "dup_log.txt", "a", 1, 1);
+    sort_defaults(&sort_opt);
+    sort_opt.threads = 1;
+    sort_opt.dedup = 1;
+    result = sort_file("dup_log.txt", "sorted_log.txt", &sort_opt, &sort_stats);
+    printf("Sorted: ");
+    print_result_code(result);
+    printf("%lld records, %lld duplicate dropped\n", sort_stats.records, sort_stats.duplicates);
+    print_file_contents("sorted_log.txt");
+    result = generate_matches_history("sorted_log.txt", 2024, "merged_history.txt");
+    printf("History of the sorted file: ");
+    print_result_code(result);
+    print_file_contents("merged_history.txt");
+    remove("merged_log.txt");
+    remove("dup_log.txt");
+    remove("sorted_log.txt");
+    remove("merged_history.txt");
+    printf("\n");
+
+    /*
+     * TEST 30: One dataset split into several files
+     */
+    printf("=== TEST 30: Sharded Datasets (shard_*.txt) ===\n");
+    QueryPlan shard_plan;
+    ShardStats shard_stats;
+
+    copy_lines("game_data.txt", "shard_1.txt", "w", 0, 19);    /* 2024-01 */
+    copy_lines("game_data.txt", "shard_2.txt", "w", 19, 18);   /* 2024-02 */
+    copy_lines("game_data.txt", "shard_3.txt", "w", 37, -1);   /* 2023-12 */
+    index_build("shard_3.txt", NULL);
+
+    hw2_set_threads(2);
+    printf("Best month: %d (game_data.txt: %d)\n",
+           purdue_best_month("shard_*.txt"), purdue_best_month("game_data.txt"));
+    result = generate_matches_history("shard_*.txt", 2024, "history_shards.txt");
+    printf("History of the shards: ");
+    print_result_code(result);
+    print_file_contents("history_shards.txt");
+    hw2_set_threads(1);
+
+    /* shard_3.txt's index shows it has nothing in 2024: not opened */
+    plan_init(&shard_plan);
+    plan_add_best_month(&shard_plan);
+    plan_set_date_range(&shard_plan, 2024, 1, 1, 2024, 12, 30);
+    plan_run_sharded(&shard_plan, "shard_*.txt", 2, &shard_stats);
+    printf("Best month of 2024: %d, %d shards, %d pruned\n\n",
+           (int)plan_result(&shard_plan, 0), shard_stats.shards, shard_stats.pruned);
+    plan_free(&shard_plan);
+    remove("shard_1.txt");
+    remove("shard_2.txt");
+    remove("shard_3.txt");
+    remove("shard_3.txt.idx");
+    remove("history_shards.txt");
+
     printf("============================================\n");
     printf("           All Tests Completed!\n");
     printf("============================================\n");
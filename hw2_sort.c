@@ -0,0 +1,94 @@
+/*
+ * hw2_sort.c - Sort a game data file by date, team and player
+ *
+ * COMPILE: make hw2_sort
+ * RUN:     ./hw2_sort [options] <in_file> <out_file>
+ *
+ * OPTIONS:
+ *   --memory S       keep about S bytes of records in memory (default
+ *                    256M); accepts K, M and G suffixes
+ *   --threads N      threads sorting each batch (default: one per CPU)
+ *   --dedup          drop lines identical to an earlier line
+ *
+ * Files of any size are sorted: what does not fit in memory waits in
+ * temporary files (see external_sort.h). <out_file> may be <in_file>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hw2.h"
+#include "external_sort.h"
+
+/* "64M" -> 67108864; returns -1 if the text is not a size */
+static long long parse_size(const char *text) {
+    char *end;
+    long long value = strtoll(text, &end, 10);
+
+    switch (*end) {
+        case 'G': case 'g': value <<= 10; /* fall through */
+        case 'M': case 'm': value <<= 10; /* fall through */
+        case 'K': case 'k': value <<= 10; end++; break;
+        default: break;
+    }
+    return (*end != '\0' || end == text || value < 0) ? -1 : value;
+}
+
+static int usage(const char *program) {
+    fprintf(stderr, "usage: %s [--memory S] [--threads N] [--dedup] <in_file> <out_file>\n",
+            program);
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    SortOptions opt;
+    SortStats stats;
+    const char *files[2];
+    int file_count = 0;
+    int result;
+
+    sort_defaults(&opt);
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (arg[0] != '-') {
+            if (file_count == 2) {
+                return usage(argv[0]);
+            }
+            files[file_count++] = arg;
+        } else if (strcmp(arg, "--dedup") == 0) {
+            opt.dedup = 1;
+        } else if (i + 1 == argc) {
+            return usage(argv[0]);
+        } else if (strcmp(arg, "--memory") == 0) {
+            long long size = parse_size(argv[++i]);
+            if (size < 0) {
+                return usage(argv[0]);
+            }
+            opt.memory_budget = (size_t)size;
+        } else if (strcmp(arg, "--threads") == 0) {
+            opt.threads = atoi(argv[++i]);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (file_count != 2) {
+        return usage(argv[0]);
+    }
+
+    result = sort_file(files[0], files[1], &opt, &stats);
+    if (result != SUCCESS) {
+        fprintf(stderr, "%s: sorting failed (error %d)", files[0], result);
+        if (stats.error.code != SUCCESS) {
+            fprintf(stderr, " at line %ld, byte offset %lld", stats.error.line, stats.error.offset);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+
+    fprintf(stderr, "Wrote %s: %lld records, %lld duplicates dropped, %lld runs, %d merge passes\n",
+            files[1], stats.records - stats.duplicates, stats.duplicates, stats.runs,
+            stats.merge_passes);
+    return 0;
+}
@@ -0,0 +1,450 @@
+/*
+ * input_source.c - Compressed game data files, decompressed on a thread
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. zlib's inflate() (and libzstd's ZSTD_decompressStream()): both
+ *    take "some input, some room for output" and say how far they got
+ * 2. A bounded producer / consumer ring: the decompression thread
+ *    fills blocks, source_read() empties them; each side waits on a
+ *    condition variable when the ring is full / empty
+ * 3. A codec table - start / decode / end function pointers per format
+ */
+
+/* Needed for pthreads with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#if HW2_ZSTD
+#include <zstd.h>
+#endif
+#include "hw2.h"
+#include "input_source.h"
+#include "stats.h"
+
+/* ========== TYPES ========== */
+
+/* What decode() says about the data after the bytes it produced */
+#define BLOCK_MORE  0                /* more to come */
+#define BLOCK_END   1                /* end of the data */
+#define BLOCK_ERROR 2                /* read error, damaged or truncated */
+
+/* One ring entry: decompressed bytes and what follows them */
+typedef struct {
+    char *data;                      /* SOURCE_BLOCK_SIZE bytes */
+    size_t len;
+    int status;                      /* BLOCK_* */
+} SourceBlock;
+
+typedef struct {
+    int (*start)(InputSource *src);                  /* SUCCESS / NO_MEMORY */
+    int (*decode)(InputSource *src, char *out, size_t cap, size_t *got);  /* BLOCK_* */
+    void (*end)(InputSource *src);
+} SourceCodec;
+
+struct InputSource {
+    int fd;
+    const SourceCodec *codec;
+    void *stream;                    /* the codec's decompressor */
+
+    /* Compressed bytes (decompression side only) */
+    unsigned char *in;
+    size_t in_len, in_pos;
+    int in_eof, in_error;
+
+    /*
+     * The ring. ready counts filled blocks, including the one being
+     * read, so the thread never writes to a block the reader is in.
+     */
+    SourceBlock blocks[SOURCE_BLOCKS];
+    int fill_index, read_index, ready;
+    size_t read_pos;                 /* bytes of blocks[read_index] handed out */
+    int done;                        /* the END / ERROR block was produced */
+
+    int threaded, stopping;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t filled;           /* a block was filled */
+    pthread_cond_t emptied;          /* a block was handed out */
+    Hw2Stats stats;                  /* the thread's counters, until source_close() */
+};
+
+/* ============================================================
+ * HELPER FUNCTION: fill_input
+ * ============================================================
+ * Reads the next compressed bytes from the file. Returns how many
+ * (0 at end of file or after a read error).
+ */
+static size_t fill_input(InputSource *src) {
+    ssize_t got;
+
+    src->in_len = 0;
+    src->in_pos = 0;
+    if (src->in_eof) {
+        return 0;
+    }
+    do {
+        got = read(src->fd, src->in, SOURCE_INPUT_SIZE);
+        STATS_COUNT(syscalls, SYSCALL_READ);
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0) {
+        src->in_eof = 1;
+        src->in_error = got < 0;
+        return 0;
+    }
+    src->in_len = (size_t)got;
+    return src->in_len;
+}
+
+/* ============================================================
+ * CODEC: gzip (zlib)
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - windowBits 15 + 32 accepts gzip and zlib headers
+ * - Z_STREAM_END ends one gzip member; if more bytes follow, they are
+ *   the next member and inflateReset() starts over
+ * - Running out of input before Z_STREAM_END means a truncated file
+ */
+typedef struct {
+    z_stream z;
+    int member_done;                 /* the last member ended cleanly */
+} GzipStream;
+
+static int gzip_start(InputSource *src) {
+    GzipStream *g = calloc(1, sizeof(*g));
+
+    if (g == NULL) {
+        return NO_MEMORY;
+    }
+    if (inflateInit2(&g->z, 15 + 32) != Z_OK) {
+        free(g);
+        return NO_MEMORY;
+    }
+    src->stream = g;
+    return SUCCESS;
+}
+
+static int gzip_decode(InputSource *src, char *out, size_t cap, size_t *got) {
+    GzipStream *g = src->stream;
+    z_stream *z = &g->z;
+    int ret;
+
+    z->next_out = (Bytef *)out;
+    z->avail_out = (uInt)cap;
+
+    while (z->avail_out > 0) {
+        if (src->in_pos == src->in_len && fill_input(src) == 0) {
+            *got = cap - z->avail_out;
+            return src->in_error || !g->member_done ? BLOCK_ERROR : BLOCK_END;
+        }
+        if (g->member_done) {
+            inflateReset(z);         /* another member follows */
+            g->member_done = 0;
+        }
+
+        z->next_in = src->in + src->in_pos;
+        z->avail_in = (uInt)(src->in_len - src->in_pos);
+        ret = inflate(z, Z_NO_FLUSH);
+        src->in_pos = src->in_len - z->avail_in;
+
+        if (ret == Z_STREAM_END) {
+            g->member_done = 1;
+        } else if (ret != Z_OK && !(ret == Z_BUF_ERROR && z->avail_in == 0)) {
+            *got = cap - z->avail_out;
+            return BLOCK_ERROR;
+        }
+    }
+    *got = cap;
+    return BLOCK_MORE;
+}
+
+static void gzip_end(InputSource *src) {
+    GzipStream *g = src->stream;
+
+    inflateEnd(&g->z);
+    free(g);
+}
+
+/* ============================================================
+ * CODEC: zstd (libzstd, "make ZSTD=1")
+ * ============================================================
+ * ZSTD_decompressStream() returns 0 when a frame is complete; frames
+ * one after another are read as one file, like gzip members.
+ */
+#if HW2_ZSTD
+typedef struct {
+    ZSTD_DStream *ds;
+    size_t last;                     /* last return value: 0 = frame complete */
+} ZstdStream;
+
+static int zstd_start(InputSource *src) {
+    ZstdStream *s = calloc(1, sizeof(*s));
+
+    if (s == NULL) {
+        return NO_MEMORY;
+    }
+    s->ds = ZSTD_createDStream();
+    if (s->ds == NULL || ZSTD_isError(ZSTD_initDStream(s->ds))) {
+        ZSTD_freeDStream(s->ds);
+        free(s);
+        return NO_MEMORY;
+    }
+    src->stream = s;
+    return SUCCESS;
+}
+
+static int zstd_decode(InputSource *src, char *out, size_t cap, size_t *got) {
+    ZstdStream *s = src->stream;
+    ZSTD_outBuffer output = { out, cap, 0 };
+
+    while (output.pos < output.size) {
+        ZSTD_inBuffer input;
+
+        if (src->in_pos == src->in_len && fill_input(src) == 0) {
+            *got = output.pos;
+            return src->in_error || s->last != 0 ? BLOCK_ERROR : BLOCK_END;
+        }
+        input.src = src->in;
+        input.size = src->in_len;
+        input.pos = src->in_pos;
+        s->last = ZSTD_decompressStream(s->ds, &output, &input);
+        src->in_pos = input.pos;
+        if (ZSTD_isError(s->last)) {
+            *got = output.pos;
+            return BLOCK_ERROR;
+        }
+    }
+    *got = cap;
+    return BLOCK_MORE;
+}
+
+static void zstd_end(InputSource *src) {
+    ZstdStream *s = src->stream;
+
+    ZSTD_freeDStream(s->ds);
+    free(s);
+}
+#endif
+
+/* Indexed by format; NULL = not in this build */
+static const SourceCodec gzip_codec = { gzip_start, gzip_decode, gzip_end };
+#if HW2_ZSTD
+static const SourceCodec zstd_codec = { zstd_start, zstd_decode, zstd_end };
+#endif
+
+static const SourceCodec *codec_for(int format) {
+    switch (format) {
+        case SOURCE_GZIP:
+            return &gzip_codec;
+#if HW2_ZSTD
+        case SOURCE_ZSTD:
+            return &zstd_codec;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+/* ============================================================
+ * FUNCTION: source_detect / source_format_name
+ * ============================================================
+ */
+int source_detect(const unsigned char *magic, size_t len) {
+    if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return SOURCE_GZIP;
+    }
+    if (len >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return SOURCE_ZSTD;
+    }
+    return SOURCE_PLAIN;
+}
+
+const char *source_format_name(int format) {
+    switch (format) {
+        case SOURCE_GZIP:
+            return "gzip";
+        case SOURCE_ZSTD:
+            return "zstd";
+        default:
+            return "plain";
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: produce
+ * ============================================================
+ * Decompresses into the block at fill_index (which the reader is not
+ * using: the ring has room). Called by the thread, or by
+ * source_read() itself when there is no thread.
+ */
+static void produce(InputSource *src) {
+    SourceBlock *b = &src->blocks[src->fill_index];
+
+    b->status = src->codec->decode(src, b->data, SOURCE_BLOCK_SIZE, &b->len);
+    src->fill_index = (src->fill_index + 1) % SOURCE_BLOCKS;
+    if (b->status != BLOCK_MORE) {
+        src->done = 1;
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: decompress_main
+ * ============================================================
+ * The decompression thread: fill a block whenever the ring has room,
+ * until the last block is produced or source_close() says stop.
+ */
+static void *decompress_main(void *arg) {
+    InputSource *src = arg;
+
+    pthread_mutex_lock(&src->lock);
+    while (!src->done) {
+        while (src->ready == SOURCE_BLOCKS && !src->stopping) {
+            pthread_cond_wait(&src->emptied, &src->lock);
+        }
+        if (src->stopping) {
+            break;
+        }
+        pthread_mutex_unlock(&src->lock);
+
+        produce(src);
+
+        pthread_mutex_lock(&src->lock);
+        src->ready++;
+        pthread_cond_signal(&src->filled);
+    }
+    pthread_mutex_unlock(&src->lock);
+    STATS_FLUSH(&src->stats);
+    return NULL;
+}
+
+/* ============================================================
+ * FUNCTION: source_open
+ * ============================================================
+ */
+int source_open(InputSource **out, int fd, int format) {
+    const SourceCodec *codec = codec_for(format);
+    InputSource *src;
+    int allocated;
+
+    if (codec == NULL) {
+        return FILE_READ_ERR;        /* not compressed, or not in this build */
+    }
+    src = calloc(1, sizeof(*src));
+    if (src == NULL) {
+        return NO_MEMORY;
+    }
+    src->fd = fd;
+    src->codec = codec;
+    src->in = malloc(SOURCE_INPUT_SIZE);
+    allocated = src->in != NULL;
+    for (int i = 0; i < SOURCE_BLOCKS; i++) {
+        src->blocks[i].data = malloc(SOURCE_BLOCK_SIZE);
+        allocated = allocated && src->blocks[i].data != NULL;
+    }
+    if (!allocated || codec->start(src) != SUCCESS) {
+        free(src->in);
+        for (int i = 0; i < SOURCE_BLOCKS; i++) {
+            free(src->blocks[i].data);
+        }
+        free(src);
+        return NO_MEMORY;
+    }
+
+    pthread_mutex_init(&src->lock, NULL);
+    pthread_cond_init(&src->filled, NULL);
+    pthread_cond_init(&src->emptied, NULL);
+    src->threaded = pthread_create(&src->thread, NULL, decompress_main, src) == 0;
+
+    *out = src;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: source_read
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Copying out of the ring decouples the reader's buffer size from
+ *   the block size
+ * - A block is given back (ready--) only once it is fully read
+ */
+ssize_t source_read(InputSource *src, char *dst, size_t cap) {
+    SourceBlock *b;
+    size_t n;
+
+    for (;;) {
+        if (src->threaded) {
+            pthread_mutex_lock(&src->lock);
+            while (src->ready == 0) {
+                pthread_cond_wait(&src->filled, &src->lock);
+            }
+            pthread_mutex_unlock(&src->lock);
+        } else if (src->ready == 0) {
+            if (src->done) {
+                return 0;
+            }
+            produce(src);
+            src->ready++;
+        }
+
+        b = &src->blocks[src->read_index];
+        if (src->read_pos < b->len) {
+            break;
+        }
+        if (b->status != BLOCK_MORE) {
+            return b->status == BLOCK_END ? 0 : -1;   /* stays the last block */
+        }
+
+        /* Fully read: give the block back */
+        src->read_pos = 0;
+        src->read_index = (src->read_index + 1) % SOURCE_BLOCKS;
+        pthread_mutex_lock(&src->lock);
+        src->ready--;
+        pthread_cond_signal(&src->emptied);
+        pthread_mutex_unlock(&src->lock);
+    }
+
+    n = b->len - src->read_pos;
+    if (n > cap) {
+        n = cap;
+    }
+    memcpy(dst, b->data + src->read_pos, n);
+    src->read_pos += n;
+    return (ssize_t)n;
+}
+
+/* ============================================================
+ * FUNCTION: source_close
+ * ============================================================
+ */
+void source_close(InputSource *src) {
+    if (src == NULL) {
+        return;
+    }
+    if (src->threaded) {
+        pthread_mutex_lock(&src->lock);
+        src->stopping = 1;
+        pthread_cond_signal(&src->emptied);
+        pthread_mutex_unlock(&src->lock);
+        pthread_join(src->thread, NULL);
+        stats_absorb(&src->stats);
+    }
+    pthread_cond_destroy(&src->emptied);
+    pthread_cond_destroy(&src->filled);
+    pthread_mutex_destroy(&src->lock);
+
+    src->codec->end(src);
+    free(src->in);
+    for (int i = 0; i < SOURCE_BLOCKS; i++) {
+        free(src->blocks[i].data);
+    }
+    free(src);
+}
@@ -0,0 +1,99 @@
+/*
+ * input_source.h - Compressed game data files, decompressed on a thread
+ *
+ * This file contains:
+ * - Detection of compressed files by their first bytes ("magic")
+ * - An InputSource that hands out decompressed bytes, read() style
+ *
+ * Learning Concepts:
+ * - Streaming decompression: the file is never decompressed to disk
+ *   or held in memory as a whole, only SOURCE_BLOCK_SIZE at a time
+ * - Pipelining with a ring of buffers: one thread decompresses block
+ *   n + 1 while the parser reads block n
+ * - A table of codecs (gzip, zstd) behind one interface, so adding a
+ *   format does not touch the reader
+ *
+ * record_reader.c uses this for you: reader_open() on a gzip or zstd
+ * file reads the records inside it, so every hw2.h function accepts
+ * "season_2019.txt.gz" as it is.
+ *
+ * Formats:
+ *   gzip  1f 8b        - always available (zlib); several members
+ *                        one after another (pigz, bgzip) are read as
+ *                        one file
+ *   zstd  28 b5 2f fd  - only when built with "make ZSTD=1" (libzstd);
+ *                        otherwise opening such a file fails
+ *
+ * Compressed column files are not supported (column files are read
+ * through mmap()); compress text files only.
+ */
+
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* ========== CONSTANTS ========== */
+#define SOURCE_BLOCK_SIZE (1 << 20)   /* decompressed bytes per block */
+#define SOURCE_BLOCKS     4           /* blocks in the ring */
+#define SOURCE_INPUT_SIZE (256 * 1024) /* compressed bytes per read() */
+#define SOURCE_MAGIC_LEN  4           /* bytes source_detect() looks at */
+
+/* Formats returned by source_detect() */
+#define SOURCE_PLAIN 0
+#define SOURCE_GZIP  1
+#define SOURCE_ZSTD  2
+
+/* ========== TYPES ========== */
+typedef struct InputSource InputSource;  /* input_source.c */
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * source_detect
+ *
+ * The format of a file that starts with the len bytes at magic
+ * (SOURCE_PLAIN if it is not a compressed format we know).
+ */
+int source_detect(const unsigned char *magic, size_t len);
+
+/*
+ * source_format_name
+ *
+ * "plain", "gzip" or "zstd".
+ */
+const char *source_format_name(int format);
+
+/*
+ * source_open
+ *
+ * Starts decompressing fd (positioned at the start of the compressed
+ * data) in the given format. fd stays owned by the caller and must
+ * stay open until source_close().
+ *
+ * Returns SUCCESS (and *src), NO_MEMORY, or FILE_READ_ERR if this
+ * build cannot read the format.
+ */
+int source_open(InputSource **src, int fd, int format);
+
+/*
+ * source_read
+ *
+ * Copies up to cap decompressed bytes to dst, waiting for the
+ * decompression thread if needed.
+ *
+ * Returns the number of bytes copied, 0 at the end of the data, or
+ * -1 if the file could not be read or is damaged / truncated.
+ */
+ssize_t source_read(InputSource *src, char *dst, size_t cap);
+
+/*
+ * source_close
+ *
+ * Stops the decompression thread and frees everything. Does not
+ * close the fd.
+ */
+void source_close(InputSource *src);
+
+#endif /* INPUT_SOURCE_H */
@@ -0,0 +1,181 @@
+/*
+ * intern.c - String interning (name -> small integer id)
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Open addressing with linear probing
+ * 2. Growing a hash table by doubling and re-inserting
+ * 3. Arena storage (arena.c): one malloc() per 64 KiB of names
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "hw2.h"
+#include "intern.h"
+
+/* ============================================================
+ * FUNCTION: intern_hash
+ * ============================================================
+ */
+uint32_t intern_hash(const char *name, size_t len) {
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* ============================================================
+ * FUNCTION: intern_init / intern_free
+ * ============================================================
+ */
+int intern_init(InternTable *table) {
+    memset(table, 0, sizeof(*table));
+
+    table->mask = 255;
+    table->slots = calloc(table->mask + 1, sizeof(uint32_t));
+    if (table->slots == NULL) {
+        return NO_MEMORY;
+    }
+    return SUCCESS;
+}
+
+void intern_free(InternTable *table) {
+    arena_free(&table->strings);
+    free(table->slots);
+    free(table->names);
+    free(table->lengths);
+    free(table->hashes);
+    memset(table, 0, sizeof(*table));
+}
+
+/* ============================================================
+ * HELPER FUNCTION: grow_slots
+ * ============================================================
+ * Doubles the slot array and re-inserts every id using the
+ * remembered hashes (no need to re-hash the strings).
+ */
+static int grow_slots(InternTable *table) {
+    size_t new_mask = table->mask * 2 + 1;
+    uint32_t *slots = calloc(new_mask + 1, sizeof(uint32_t));
+
+    if (slots == NULL) {
+        return NO_MEMORY;
+    }
+    for (uint32_t id = 0; id < table->count; id++) {
+        size_t slot = table->hashes[id] & new_mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & new_mask;
+        }
+        slots[slot] = id + 1;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->mask = new_mask;
+    return SUCCESS;
+}
+
+/* Grows the id -> name arrays */
+static int grow_entries(InternTable *table) {
+    uint32_t capacity = table->capacity ? table->capacity * 2 : 256;
+    const char **names = realloc(table->names, capacity * sizeof(*names));
+    uint32_t *lengths;
+    uint32_t *hashes;
+
+    if (names == NULL) {
+        return NO_MEMORY;
+    }
+    table->names = names;
+
+    lengths = realloc(table->lengths, capacity * sizeof(*lengths));
+    if (lengths == NULL) {
+        return NO_MEMORY;
+    }
+    table->lengths = lengths;
+
+    hashes = realloc(table->hashes, capacity * sizeof(*hashes));
+    if (hashes == NULL) {
+        return NO_MEMORY;
+    }
+    table->hashes = hashes;
+
+    table->capacity = capacity;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: intern_find
+ * ============================================================
+ */
+long intern_find(const InternTable *table, const char *name, size_t len) {
+    uint32_t h = intern_hash(name, len);
+    size_t slot = h & table->mask;
+
+    while (table->slots[slot] != 0) {
+        uint32_t id = table->slots[slot] - 1;
+        if (table->hashes[id] == h && table->lengths[id] == len &&
+            memcmp(table->names[id], name, len) == 0) {
+            return (long)id;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+    return -1;
+}
+
+/* ============================================================
+ * FUNCTION: intern_add
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Probe until we find the name or an empty slot
+ * - Keep the table at most half full so probes stay short
+ */
+int intern_add(InternTable *table, const char *name, size_t len, uint32_t *id) {
+    uint32_t h = intern_hash(name, len);
+    size_t slot = h & table->mask;
+    const char *copy;
+
+    while (table->slots[slot] != 0) {
+        uint32_t found = table->slots[slot] - 1;
+        if (table->hashes[found] == h && table->lengths[found] == len &&
+            memcmp(table->names[found], name, len) == 0) {
+            *id = found;
+            return SUCCESS;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+
+    /* New name */
+    if (table->count == table->capacity && grow_entries(table) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    copy = arena_strndup(&table->strings, name, len);
+    if (copy == NULL) {
+        return NO_MEMORY;
+    }
+
+    *id = table->count;
+    table->names[*id] = copy;
+    table->lengths[*id] = (uint32_t)len;
+    table->hashes[*id] = h;
+    table->slots[slot] = *id + 1;
+    table->count++;
+
+    if ((size_t)table->count * 2 > table->mask + 1) {
+        return grow_slots(table);
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: intern_name
+ * ============================================================
+ */
+const char *intern_name(const InternTable *table, uint32_t id, size_t *len) {
+    if (len != NULL) {
+        *len = table->lengths[id];
+    }
+    return table->names[id];
+}
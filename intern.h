@@ -0,0 +1,79 @@
+/*
+ * intern.h - String interning (name -> small integer id)
+ *
+ * This file contains:
+ * - The InternTable structure
+ * - Functions to look up / add names and to get a name back from its id
+ *
+ * Learning Concepts:
+ * - Open-addressing hash tables
+ * - Storing many small strings in an arena (arena.h) instead of
+ *   one malloc() per string
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/* ========== TYPES ========== */
+
+/*
+ * Maps each distinct name to an id 0, 1, 2, ... in order of first use.
+ * Stored names are null-terminated and never move, so the pointers
+ * returned by intern_name() stay valid until intern_free().
+ */
+typedef struct {
+    uint32_t *slots;         /* hash slot -> id + 1 (0 = empty) */
+    size_t mask;             /* number of slots - 1 (power of two) */
+    const char **names;      /* id -> name */
+    uint32_t *lengths;       /* id -> name length */
+    uint32_t *hashes;        /* id -> hash (for fast growing) */
+    uint32_t count;
+    uint32_t capacity;
+    Arena strings;           /* the names, packed back to back */
+} InternTable;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * intern_hash
+ *
+ * FNV-1a hash of len bytes.
+ */
+uint32_t intern_hash(const char *name, size_t len);
+
+/*
+ * intern_init / intern_free
+ *
+ * intern_init returns SUCCESS or NO_MEMORY.
+ */
+int intern_init(InternTable *table);
+void intern_free(InternTable *table);
+
+/*
+ * intern_add
+ *
+ * Stores *id for the name, adding it if it is new.
+ * Returns SUCCESS or NO_MEMORY.
+ */
+int intern_add(InternTable *table, const char *name, size_t len, uint32_t *id);
+
+/*
+ * intern_find
+ *
+ * Returns the id of the name, or -1 if it was never added.
+ */
+long intern_find(const InternTable *table, const char *name, size_t len);
+
+/*
+ * intern_name
+ *
+ * Returns the (null-terminated) name for id; *len gets its length
+ * if len is not NULL.
+ */
+const char *intern_name(const InternTable *table, uint32_t id, size_t *len);
+
+#endif /* INTERN_H */
@@ -0,0 +1,368 @@
+/*
+ * leaderboard.c - Top-K leaderboards from one scan
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. A bounded min-heap: K slots, the weakest leader at the root
+ * 2. Cheap rejection: a candidate that does not beat the root costs
+ *    one compare; names are copied only for rows that get a slot
+ * 3. Heap sort in place to list the leaders best first
+ * 4. Hash aggregation (as in roster_report.c) for per-player averages,
+ *    followed by the same heap over the players
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "hw2.h"
+#include "intern.h"
+#include "record_reader.h"
+#include "leaderboard.h"
+
+/* Same RESERVE as roster_report.c, for int and uint32_t capacities */
+#define RESERVE(array, capacity, needed) do { \
+        if ((needed) > (capacity)) { \
+            size_t new_capacity = (capacity) ? (size_t)(capacity) * 2 : 16; \
+            void *grown; \
+            while (new_capacity < (size_t)(needed)) { \
+                new_capacity *= 2; \
+            } \
+            grown = realloc((array), new_capacity * sizeof(*(array))); \
+            if (grown == NULL) { \
+                return NO_MEMORY; \
+            } \
+            (array) = grown; \
+            (capacity) = new_capacity; \
+        } \
+    } while (0)
+
+#define PLAYER_NONE UINT32_MAX
+
+/* Points of one player in scope */
+typedef struct {
+    long long total_points;
+    int games;
+    uint64_t first;              /* number of the player's first row */
+} PlayerTotals;
+
+/* Everything a scan needs while reading */
+typedef struct {
+    int year, month, day;        /* scope (0 = whole month / season) */
+    uint64_t seq;                /* rows read so far */
+    InternTable players;         /* averages: name -> player */
+    PlayerTotals *totals;        /* averages: player -> totals */
+    uint32_t totals_capacity;
+    uint32_t *names;             /* column files: dictionary id -> player */
+} Scan;
+
+/* ============================================================
+ * HELPER FUNCTIONS: The bounded heap
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - items[0] is the root; the children of i are 2i+1 and 2i+2
+ * - "below" is the heap order: the lower value, or on a tie the
+ *   later row, so the result does not depend on the heap's layout
+ */
+static int below(const Leader *a, const Leader *b) {
+    if (a->value != b->value) {
+        return a->value < b->value;
+    }
+    return a->seq > b->seq;
+}
+
+static void swap(Leader *a, Leader *b) {
+    Leader t = *a;
+    *a = *b;
+    *b = t;
+}
+
+static void sift_up(Leader *items, int i) {
+    while (i > 0 && below(&items[i], &items[(i - 1) / 2])) {
+        swap(&items[i], &items[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(Leader *items, int count, int i) {
+    for (;;) {
+        int low = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+
+        if (left < count && below(&items[left], &items[low])) {
+            low = left;
+        }
+        if (right < count && below(&items[right], &items[low])) {
+            low = right;
+        }
+        if (low == i) {
+            return;
+        }
+        swap(&items[i], &items[low]);
+        i = low;
+    }
+}
+
+/* Would (value, seq) make the board? A full board needs it above the root. */
+static int admits(const Leaderboard *lb, double value, uint64_t seq) {
+    if (lb->count < lb->k) {
+        return 1;
+    }
+    return lb->items[0].value < value ||
+           (lb->items[0].value == value && lb->items[0].seq > seq);
+}
+
+/* Adds a candidate that admits() accepted, dropping the root if full */
+static int offer(Leaderboard *lb, const Leader *leader) {
+    if (lb->count < lb->k) {
+        RESERVE(lb->items, lb->capacity, lb->count + 1);
+        lb->items[lb->count] = *leader;
+        sift_up(lb->items, lb->count);
+        lb->count++;
+    } else {
+        lb->items[0] = *leader;
+        sift_down(lb->items, lb->count, 0);
+    }
+    return SUCCESS;
+}
+
+/* Heap sort: the root (the weakest) goes to the back each round */
+static void sort_best_first(Leaderboard *lb) {
+    for (int n = lb->count - 1; n > 0; n--) {
+        swap(&lb->items[0], &lb->items[n]);
+        sift_down(lb->items, n, 0);
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: Scope
+ * ============================================================
+ */
+static int valid_scope(int year, int month, int day) {
+    if (day != 0 && month == 0) {
+        return 0;
+    }
+    return is_valid_date(year, month ? month : 1, day ? day : 1);
+}
+
+static int in_scope(const Scan *s, const GameRecord *rec) {
+    return rec->year == s->year &&
+           (s->month == 0 || rec->month == s->month) &&
+           (s->day == 0 || rec->day == s->day);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: game_feed
+ * ============================================================
+ * The combined score exactly as mvp_feed() in query_plan.c computes it.
+ */
+static int game_feed(Leaderboard *lb, Scan *s, const GameRecord *rec) {
+    Leader leader;
+
+    leader.value = (double)rec->points +
+                   1.5 * (double)rec->assists +
+                   2.0 * (double)rec->blocks +
+                   0.2 * (double)rec->minutes;
+    if (!admits(lb, leader.value, s->seq)) {
+        return SUCCESS;
+    }
+
+    memcpy(leader.player, rec->player, rec->player_len);
+    leader.player[rec->player_len] = '\0';
+    memcpy(leader.team, rec->team, rec->team_len);
+    leader.team[rec->team_len] = '\0';
+    leader.year = rec->year;
+    leader.month = rec->month;
+    leader.day = rec->day;
+    leader.games = 1;
+    leader.seq = s->seq;
+    return offer(lb, &leader);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: average_feed
+ * ============================================================
+ * Player lookup as in roster_report.c: column files hash each
+ * dictionary name once, text files hash every row's name.
+ */
+static int add_player(Scan *s, const char *name, size_t len, uint32_t *id) {
+    uint32_t before = s->players.count;
+
+    if (intern_add(&s->players, name, len, id) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    if (s->players.count != before) {
+        RESERVE(s->totals, s->totals_capacity, s->players.count);
+        s->totals[*id].total_points = 0;
+        s->totals[*id].games = 0;
+        s->totals[*id].first = s->seq;
+    }
+    return SUCCESS;
+}
+
+static int average_feed(Scan *s, const GameRecord *rec) {
+    uint32_t player;
+
+    if (s->names != NULL) {
+        player = s->names[rec->player_id];
+        if (player == PLAYER_NONE) {
+            if (add_player(s, rec->player, rec->player_len, &player) != SUCCESS) {
+                return NO_MEMORY;
+            }
+            s->names[rec->player_id] = player;
+        }
+    } else if (add_player(s, rec->player, rec->player_len, &player) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    s->totals[player].total_points += rec->points;
+    s->totals[player].games++;
+    return SUCCESS;
+}
+
+static int map_dictionary(Scan *s, const RecordReader *rd) {
+    uint32_t players = reader_name_count(rd, READER_PLAYERS);
+
+    if (players == 0) {
+        return SUCCESS;
+    }
+    s->names = malloc((size_t)players * sizeof(uint32_t));
+    if (s->names == NULL) {
+        return NO_MEMORY;
+    }
+    for (uint32_t id = 0; id < players; id++) {
+        s->names[id] = PLAYER_NONE;
+    }
+    return SUCCESS;
+}
+
+/* Every player in scope is a candidate; the value is average_end()'s */
+static int rank_averages(Leaderboard *lb, Scan *s) {
+    for (uint32_t p = 0; p < s->players.count; p++) {
+        const PlayerTotals *t = &s->totals[p];
+        size_t len;
+        const char *name;
+        Leader leader;
+
+        leader.value = (double)t->total_points / (double)t->games;
+        if (!admits(lb, leader.value, t->first)) {
+            continue;
+        }
+        name = intern_name(&s->players, p, &len);
+        memcpy(leader.player, name, len + 1);
+        leader.team[0] = '\0';
+        leader.year = 0;
+        leader.month = 0;
+        leader.day = 0;
+        leader.games = t->games;
+        leader.seq = t->first;
+        if (offer(lb, &leader) != SUCCESS) {
+            return NO_MEMORY;
+        }
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: build
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - One scan for either board; rows out of scope are only counted
+ * - Errors are reported like roster_build(): the reader's code and
+ *   location, nothing left to free
+ */
+static int build(Leaderboard *lb, const char *in_file, int k, int year, int month, int day,
+                 int averages, ParseError *err) {
+    RecordReader rd;
+    GameRecord rec;
+    Scan s;
+    int status;
+
+    memset(lb, 0, sizeof(*lb));
+    if (err != NULL) {
+        err->code = SUCCESS;
+        err->line = 0;
+        err->offset = 0;
+    }
+    if (!valid_scope(year, month, day)) {
+        return BAD_DATE;
+    }
+    if (k < 1) {
+        return BAD_RECORD;
+    }
+    lb->k = k;
+
+    status = reader_open(&rd, in_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    memset(&s, 0, sizeof(s));
+    s.year = year;
+    s.month = month;
+    s.day = day;
+
+    status = SUCCESS;
+    if (averages) {
+        status = intern_init(&s.players);
+        if (status == SUCCESS) {
+            status = map_dictionary(&s, &rd);
+        }
+    }
+    if (status == SUCCESS) {
+        while ((status = reader_next(&rd, &rec)) == RECORD_OK) {
+            int fed = SUCCESS;
+
+            if (in_scope(&s, &rec)) {
+                fed = averages ? average_feed(&s, &rec) : game_feed(lb, &s, &rec);
+            }
+            if (fed != SUCCESS) {
+                status = NO_MEMORY;
+                break;
+            }
+            s.seq++;
+        }
+    }
+
+    if (status == RECORD_EOF) {
+        status = averages ? rank_averages(lb, &s) : SUCCESS;
+    } else if (status != NO_MEMORY && err != NULL) {
+        err->code = status;
+        err->line = rd.err_line;
+        err->offset = rd.err_offset;
+    }
+    if (averages) {
+        intern_free(&s.players);
+        free(s.totals);
+        free(s.names);
+    }
+    reader_close(&rd);
+
+    if (status != SUCCESS) {
+        leaderboard_free(lb);
+        return status;
+    }
+    sort_best_first(lb);
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTIONS: leaderboard_top_games / leaderboard_top_averages
+ * ============================================================
+ */
+int leaderboard_top_games(Leaderboard *lb, const char *in_file, int k,
+                          int year, int month, int day, ParseError *err) {
+    return build(lb, in_file, k, year, month, day, 0, err);
+}
+
+int leaderboard_top_averages(Leaderboard *lb, const char *in_file, int k,
+                             int year, int month, int day, ParseError *err) {
+    return build(lb, in_file, k, year, month, day, 1, err);
+}
+
+/* ============================================================
+ * FUNCTION: leaderboard_free
+ * ============================================================
+ */
+void leaderboard_free(Leaderboard *lb) {
+    free(lb->items);
+    memset(lb, 0, sizeof(*lb));
+}
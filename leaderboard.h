@@ -0,0 +1,99 @@
+/*
+ * leaderboard.h - Top-K leaderboards from one scan
+ *
+ * This file contains:
+ * - The Leader and Leaderboard structures
+ * - Functions to rank the best single-game performances, or the best
+ *   scoring averages, of a game, a month or a season
+ *
+ * Learning Concepts:
+ * - Top-K with a bounded min-heap: the worst of the K best so far
+ *   sits at the root, so a new candidate is compared with one element
+ *   and most rows are rejected without touching the heap
+ * - Memory that depends on K, not on the size of the file
+ * - Heap sort to turn the heap into a best-first list at the end
+ *
+ * Typical use:
+ *   Leaderboard lb;
+ *   if (leaderboard_top_games(&lb, "game_data.txt", 5, 2024, 1, 0, NULL) == SUCCESS) {
+ *       for (int i = 0; i < lb.count; i++) {
+ *           printf("%s %.2f\n", lb.items[i].player, lb.items[i].value);
+ *       }
+ *       leaderboard_free(&lb);
+ *   }
+ *
+ * A "season" is a year, as in the synthetic data (synth_data.h).
+ */
+
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <stdint.h>
+#include "hw2.h"
+
+/* ========== TYPES ========== */
+
+/* One place on a leaderboard */
+typedef struct {
+    char player[MAX_NAME_LENGTH];
+    char team[MAX_NAME_LENGTH];  /* top games only ("" for averages) */
+    int year, month, day;        /* top games only (0 for averages) */
+    double value;                /* combined score, or points per game */
+    int games;                   /* rows behind value (1 for a single game) */
+    uint64_t seq;                /* first row's number in the file; breaks ties */
+} Leader;
+
+/*
+ * After a successful build, items[0 .. count-1] are best first.
+ * Equal values keep file order (the earlier row ranks higher).
+ */
+typedef struct {
+    Leader *items;
+    int count;                   /* at most k */
+    int capacity;
+    int k;
+} Leaderboard;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * leaderboard_top_games
+ *
+ * The k best rows by the combined score of match_most_valuable_player()
+ * (points + 1.5*assists + 2*blocks + 0.2*minutes) among the rows of
+ *   - one game:   year, month, day
+ *   - one month:  year, month, day = 0
+ *   - one season: year, month = 0, day = 0
+ * Memory is O(k) whatever the size of in_file.
+ *
+ * Returns:
+ *   SUCCESS (count may be 0 if nothing is in scope), BAD_DATE (scope
+ *   is not one of the above), BAD_RECORD (k < 1, like the other bad
+ *   arguments of hw2_set_team()), FILE_READ_ERR, NO_MEMORY, or the
+ *   BAD_RECORD / BAD_DATE the hw2.h functions would report for this
+ *   file (err, if not NULL, gets its location; it stays SUCCESS for a
+ *   bad scope or k).
+ *   On failure there is nothing to free.
+ */
+int leaderboard_top_games(Leaderboard *lb, const char *in_file, int k,
+                          int year, int month, int day, ParseError *err);
+
+/*
+ * leaderboard_top_averages
+ *
+ * The k players with the most points per game in scope (same scopes
+ * as above); each value is what average_points_player() returns for
+ * that player over those rows. Needs one small total per player in
+ * scope; the ranking itself is O(k).
+ *
+ * Returns: as leaderboard_top_games()
+ */
+int leaderboard_top_averages(Leaderboard *lb, const char *in_file, int k,
+                             int year, int month, int day, ParseError *err);
+
+/*
+ * leaderboard_free
+ */
+void leaderboard_free(Leaderboard *lb);
+
+#endif /* LEADERBOARD_H */
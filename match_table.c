@@ -0,0 +1,427 @@
+/*
+ * match_table.c - Per-match totals, saved next to the data file
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Aggregating while scanning: one row per match, one side per team
+ * 2. Checking every count and cross-reference of a file before use
+ * 3. Reusing the index's cache validation (size, mtime, checksum)
+ *
+ * See match_table.h for the file layout.
+ */
+
+/* Needed for st_mtim and 64-bit file offsets with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hw2.h"
+#include "encoding.h"
+#include "intern.h"
+#include "record_reader.h"
+#include "file_index.h"
+#include "match_table.h"
+
+/* ========== BUILD-TIME TYPES ========== */
+
+typedef struct {
+    long long start;
+    long long end;
+    uint32_t date;
+    uint32_t first_side;
+    uint32_t sides;
+    uint32_t winner;
+} BuildMatch;
+
+typedef struct {
+    uint32_t team;
+    int32_t points;
+} BuildSide;
+
+/*
+ * data_file + ".mtab", in buf if it fits (buf may be NULL), else in
+ * malloc() memory the caller frees
+ */
+static char *table_path(const char *data_file, char *buf, size_t buf_size) {
+    size_t len = strlen(data_file);
+    char *path = len + sizeof(MATCH_SUFFIX) <= buf_size ? buf : malloc(len + sizeof(MATCH_SUFFIX));
+
+    if (path != NULL) {
+        memcpy(path, data_file, len);
+        memcpy(path + len, MATCH_SUFFIX, sizeof(MATCH_SUFFIX));
+    }
+    return path;
+}
+
+/* Grows *array (of elem_size items) so it can hold one more */
+static int reserve(void **array, size_t *capacity, size_t count, size_t elem_size) {
+    size_t new_capacity;
+    void *grown;
+
+    if (count < *capacity) {
+        return SUCCESS;
+    }
+    new_capacity = *capacity ? *capacity * 2 : 1024;
+    grown = realloc(*array, new_capacity * elem_size);
+    if (grown == NULL) {
+        return NO_MEMORY;
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return SUCCESS;
+}
+
+/* The side that scored more than all the others together, if any */
+static void find_winner(BuildMatch *m, const BuildSide *sides) {
+    long long total = 0;
+
+    for (uint32_t i = 0; i < m->sides; i++) {
+        total += sides[m->first_side + i].points;
+    }
+    m->winner = MATCH_NO_WINNER;
+    for (uint32_t i = 0; i < m->sides; i++) {
+        long long points = sides[m->first_side + i].points;
+        if (points > total - points) {
+            m->winner = i;
+        }
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: write_table
+ * ============================================================
+ */
+static int write_table(FILE *out, const struct stat *st, uint64_t checksum,
+                       const BuildMatch *matches, size_t match_count,
+                       const BuildSide *sides, size_t side_count,
+                       const InternTable *teams) {
+    unsigned char header[MATCH_HEADER_SIZE] = {0};
+    unsigned char entry[MATCH_ENTRY];
+    uint64_t name_bytes = 0;
+
+    for (uint32_t t = 0; t < teams->count; t++) {
+        name_bytes += teams->lengths[t];
+    }
+
+    memcpy(header, MATCH_MAGIC, MATCH_MAGIC_LEN);
+    put_le(header + 8, MATCH_VERSION, 4);
+    put_le(header + 16, (uint64_t)st->st_size, 8);
+    put_le(header + 24, (uint64_t)(int64_t)st->st_mtime, 8);
+    put_le(header + 32, (uint64_t)MTIME_NSEC(*st), 4);
+    put_le(header + 40, checksum, 8);
+    put_le(header + 48, match_count, 8);
+    put_le(header + 56, side_count, 8);
+    put_le(header + 64, teams->count, 8);
+    put_le(header + 72, name_bytes, 8);
+    fwrite(header, 1, sizeof(header), out);
+
+    for (size_t i = 0; i < match_count; i++) {
+        put_le(entry, (uint64_t)matches[i].start, 8);
+        put_le(entry + 8, (uint64_t)matches[i].end, 8);
+        put_le(entry + 16, matches[i].date, 4);
+        put_le(entry + 20, matches[i].first_side, 4);
+        put_le(entry + 24, matches[i].sides, 4);
+        put_le(entry + 28, matches[i].winner, 4);
+        fwrite(entry, 1, MATCH_ENTRY, out);
+    }
+
+    for (size_t i = 0; i < side_count; i++) {
+        put_le(entry, sides[i].team, 4);
+        put_le(entry + 4, (uint32_t)sides[i].points, 4);
+        fwrite(entry, 1, MATCH_SIDE_ENTRY, out);
+    }
+
+    name_bytes = 0;
+    for (uint32_t t = 0; t < teams->count; t++) {
+        put_le(entry, name_bytes, 4);
+        put_le(entry + 4, teams->lengths[t], 4);
+        fwrite(entry, 1, MATCH_TEAM_ENTRY, out);
+        name_bytes += teams->lengths[t];
+    }
+    for (uint32_t t = 0; t < teams->count; t++) {
+        fwrite(teams->names[t], 1, teams->lengths[t], out);
+    }
+
+    return ferror(out) ? FILE_WRITE_ERR : SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: match_table_build
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - A date change closes the open match; each team's first record in
+ *   a match adds a side, later ones add to it (a short linear search:
+ *   a match has two teams)
+ * - Sides stay in order of first appearance, so "the first team that
+ *   is not the home team" (the opponent in a history line) is the
+ *   same as in a full scan
+ * - Any bad record stops the build, and a failed build removes its
+ *   half-written output
+ */
+int match_table_build(const char *data_file, const char *table_file) {
+    RecordReader rd;
+    GameRecord rec;
+    InternTable teams;
+    struct stat st;
+    uint64_t checksum;
+    BuildMatch *matches = NULL;
+    size_t match_count = 0, match_capacity = 0;
+    BuildSide *sides = NULL;
+    size_t side_count = 0, side_capacity = 0;
+    char *default_path = NULL;
+    FILE *out;
+    int status;
+
+    status = reader_open(&rd, data_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    if (fstat(rd.fd, &st) != 0) {
+        reader_close(&rd);
+        return FILE_READ_ERR;
+    }
+    if (intern_init(&teams) != SUCCESS) {
+        reader_close(&rd);
+        return NO_MEMORY;
+    }
+
+    while ((status = reader_next(&rd, &rec)) == RECORD_OK) {
+        uint32_t date = (uint32_t)rec.year << 9 | (uint32_t)rec.month << 5 | (uint32_t)rec.day;
+        BuildMatch *m = match_count > 0 ? &matches[match_count - 1] : NULL;
+        uint32_t team, i;
+
+        status = SUCCESS;
+        if (m == NULL || m->date != date) {
+            if (m != NULL) {
+                find_winner(m, sides);
+            }
+            if (reserve((void **)&matches, &match_capacity, match_count, sizeof(BuildMatch))
+                    != SUCCESS) {
+                status = NO_MEMORY;
+                break;
+            }
+            m = &matches[match_count++];
+            m->start = rd.rec_offset;
+            m->date = date;
+            m->first_side = (uint32_t)side_count;
+            m->sides = 0;
+        }
+        m->end = reader_tell(&rd);
+
+        if (intern_add(&teams, rec.team, rec.team_len, &team) != SUCCESS) {
+            status = NO_MEMORY;
+            break;
+        }
+        i = 0;
+        while (i < m->sides && sides[m->first_side + i].team != team) {
+            i++;
+        }
+        if (i == m->sides) {
+            if (reserve((void **)&sides, &side_capacity, side_count, sizeof(BuildSide))
+                    != SUCCESS) {
+                status = NO_MEMORY;
+                break;
+            }
+            sides[side_count].team = team;
+            sides[side_count].points = 0;
+            side_count++;
+            m->sides++;
+        }
+        sides[m->first_side + i].points += rec.points;
+    }
+
+    if (status == RECORD_EOF) {
+        if (match_count > 0) {
+            find_winner(&matches[match_count - 1], sides);
+        }
+        status = index_checksum(rd.fd, (uint64_t)st.st_size, &checksum);
+    }
+    reader_close(&rd);
+
+    if (status == SUCCESS) {
+        if (table_file == NULL) {
+            default_path = table_path(data_file, NULL, 0);
+            table_file = default_path;
+        }
+        if (table_file == NULL) {
+            status = NO_MEMORY;
+        } else if ((out = fopen(table_file, "wb")) == NULL) {
+            status = FILE_WRITE_ERR;
+        } else {
+            status = write_table(out, &st, checksum, matches, match_count,
+                                 sides, side_count, &teams);
+            if (fclose(out) != 0 && status == SUCCESS) {
+                status = FILE_WRITE_ERR;
+            }
+            if (status != SUCCESS) {
+                remove(table_file);
+            }
+        }
+    }
+
+    free(default_path);
+    free(matches);
+    free(sides);
+    intern_free(&teams);
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: match_table_open / match_table_close
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Every count, side range, team number and name range is checked
+ *   before the table is trusted, so a damaged file can never make a
+ *   query read outside the mapping (or overflow a score)
+ */
+int match_table_open(MatchTable *mt, const char *data_file) {
+    struct stat data_st, st;
+    char path_buf[256];          /* short paths need no malloc() */
+    char *path = table_path(data_file, path_buf, sizeof(path_buf));
+    const unsigned char *data;
+    uint64_t checksum;
+    void *map;
+    int fd;
+    int status = BAD_RECORD;
+
+    memset(mt, 0, sizeof(*mt));
+    if (path == NULL) {
+        return NO_MEMORY;
+    }
+    fd = open(path, O_RDONLY);
+    if (path != path_buf) {
+        free(path);
+    }
+    if (fd < 0) {
+        return FILE_READ_ERR;
+    }
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size < MATCH_HEADER_SIZE || (uintmax_t)st.st_size > (uintmax_t)SIZE_MAX) {
+        close(fd);
+        return BAD_RECORD;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return FILE_READ_ERR;
+    }
+
+    data = map;
+    mt->data = data;
+    mt->size = (size_t)st.st_size;
+    mt->match_count = get_le(data + 48, 8);
+    mt->side_count = get_le(data + 56, 8);
+    mt->team_count = get_le(data + 64, 8);
+    mt->name_bytes = get_le(data + 72, 8);
+
+    /* Header and table sizes */
+    if (memcmp(data, MATCH_MAGIC, MATCH_MAGIC_LEN) != 0 ||
+        get_le(data + 8, 4) != MATCH_VERSION ||
+        mt->match_count > mt->size / MATCH_ENTRY ||
+        mt->side_count > mt->size / MATCH_SIDE_ENTRY ||
+        mt->team_count > mt->size / MATCH_TEAM_ENTRY ||
+        mt->name_bytes > mt->size ||
+        mt->match_count * MATCH_ENTRY + mt->side_count * MATCH_SIDE_ENTRY +
+        mt->team_count * MATCH_TEAM_ENTRY + mt->name_bytes != mt->size - MATCH_HEADER_SIZE) {
+        goto fail;
+    }
+    mt->matches = data + MATCH_HEADER_SIZE;
+    mt->sides = mt->matches + mt->match_count * MATCH_ENTRY;
+    mt->teams = mt->sides + mt->side_count * MATCH_SIDE_ENTRY;
+    mt->names = (const char *)(mt->teams + mt->team_count * MATCH_TEAM_ENTRY);
+
+    for (uint64_t i = 0; i < mt->match_count; i++) {
+        const unsigned char *entry = mt->matches + i * MATCH_ENTRY;
+        uint64_t first = get_le(entry + 20, 4);
+        uint64_t sides = get_le(entry + 24, 4);
+        uint64_t winner = get_le(entry + 28, 4);
+        uint64_t total = 0;
+
+        if (first + sides > mt->side_count ||
+            (winner != MATCH_NO_WINNER && winner >= sides)) {
+            goto fail;
+        }
+        /* Totals of points that are never negative, kept in an int by the queries */
+        for (uint64_t j = first; j < first + sides; j++) {
+            const unsigned char *side = mt->sides + j * MATCH_SIDE_ENTRY;
+
+            total += get_le(side + 4, 4);
+            if (get_le(side, 4) >= mt->team_count || total > INT_MAX) {
+                goto fail;
+            }
+        }
+    }
+    for (uint64_t i = 0; i < mt->team_count; i++) {
+        const unsigned char *entry = mt->teams + i * MATCH_TEAM_ENTRY;
+        if (get_le(entry, 4) + get_le(entry + 4, 4) > mt->name_bytes) {
+            goto fail;
+        }
+    }
+
+    /* Does it still describe the data file? */
+    fd = open(data_file, O_RDONLY);
+    if (fd < 0) {
+        status = FILE_READ_ERR;
+        goto fail;
+    }
+    if (fstat(fd, &data_st) != 0 ||
+        (uint64_t)data_st.st_size != get_le(data + 16, 8) ||
+        (uint64_t)(int64_t)data_st.st_mtime != get_le(data + 24, 8) ||
+        (uint64_t)MTIME_NSEC(data_st) != get_le(data + 32, 4) ||
+        index_checksum(fd, (uint64_t)data_st.st_size, &checksum) != SUCCESS ||
+        checksum != get_le(data + 40, 8)) {
+        close(fd);
+        goto fail;
+    }
+    close(fd);
+    return SUCCESS;
+
+fail:
+    match_table_close(mt);
+    return status;
+}
+
+void match_table_close(MatchTable *mt) {
+    if (mt->data != NULL) {
+        munmap((void *)mt->data, mt->size);
+    }
+    memset(mt, 0, sizeof(*mt));
+}
+
+/* ============================================================
+ * FUNCTIONS: match_table_row / match_table_side
+ * ============================================================
+ */
+void match_table_row(const MatchTable *mt, uint64_t i, MatchRow *row) {
+    const unsigned char *entry = mt->matches + i * MATCH_ENTRY;
+    uint32_t date = (uint32_t)get_le(entry + 16, 4);
+
+    row->start = (long long)get_le(entry, 8);
+    row->end = (long long)get_le(entry + 8, 8);
+    row->year = (int)(date >> 9);
+    row->month = (int)((date >> 5) & 15);
+    row->day = (int)(date & 31);
+    row->first_side = (uint32_t)get_le(entry + 20, 4);
+    row->sides = (uint32_t)get_le(entry + 24, 4);
+    row->winner = (uint32_t)get_le(entry + 28, 4);
+}
+
+const char *match_table_side(const MatchTable *mt, uint32_t side, size_t *len, int *points) {
+    const unsigned char *entry = mt->sides + (uint64_t)side * MATCH_SIDE_ENTRY;
+    const unsigned char *team = mt->teams + get_le(entry, 4) * MATCH_TEAM_ENTRY;
+
+    *points = (int)(int32_t)(uint32_t)get_le(entry + 4, 4);
+    *len = (size_t)get_le(team + 4, 4);
+    return mt->names + get_le(team, 4);
+}
@@ -0,0 +1,137 @@
+/*
+ * match_table.h - Per-match totals, saved next to the data file
+ *
+ * This file contains:
+ * - A description of the match table file layout
+ * - Functions to build a match table and to check that it is up to date
+ * - Access to its rows
+ *
+ * Learning Concepts:
+ * - Materializing a derived table: the match-level queries only ever
+ *   look at per-team totals of each match, so those totals are summed
+ *   once and kept, and later queries read a few thousand match rows
+ *   instead of every player row
+ * - The same staleness check as the index (size, modification time,
+ *   checksum; see file_index.h)
+ *
+ * The table for "game_data.txt" lives in "game_data.txt.mtab".
+ * A match is a run of consecutive records with the same date, as the
+ * hw2.h functions count them.
+ *
+ * FILE LAYOUT (all integers little-endian):
+ *
+ *   Header (80 bytes)
+ *     char     magic[8]       "HW2MTB01"
+ *     uint32   version        1
+ *     uint32   reserved
+ *     uint64   data_size      size of the data file when built
+ *     int64    data_mtime     its modification time (seconds)
+ *     uint32   data_mtime_ns  and nanoseconds
+ *     uint32   reserved
+ *     uint64   data_checksum  index_checksum() of the data file
+ *     uint64   match_count
+ *     uint64   side_count
+ *     uint64   team_count
+ *     uint64   name_bytes
+ *
+ *   Matches, in file order; match_count * 32 bytes
+ *     uint64 start, uint64 end    positions of its records: [start, end)
+ *     uint32 date                 year << 9 | month << 5 | day
+ *     uint32 first_side           index of its first side
+ *     uint32 sides                number of sides (teams that played)
+ *     uint32 winner               side that outscored all the others
+ *                                 together, or MATCH_NO_WINNER
+ *
+ *   Sides, in order of each team's first record in the match;
+ *   side_count * 8 bytes
+ *     uint32 team                 team number
+ *     int32  points               the team's total in the match
+ *
+ *   Teams: team_count * 8 bytes
+ *     uint32 offset, uint32 length   the name in the name bytes
+ *
+ *   Names: name_bytes bytes, back to back (no '\0's)
+ */
+
+#ifndef MATCH_TABLE_H
+#define MATCH_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========== CONSTANTS ========== */
+#define MATCH_MAGIC        "HW2MTB01"
+#define MATCH_MAGIC_LEN    8
+#define MATCH_VERSION      1
+#define MATCH_HEADER_SIZE  80
+#define MATCH_ENTRY        32
+#define MATCH_SIDE_ENTRY   8
+#define MATCH_TEAM_ENTRY   8
+#define MATCH_NO_WINNER    UINT32_MAX
+#define MATCH_SUFFIX       ".mtab"
+
+/* ========== TYPES ========== */
+
+/* One row of the table */
+typedef struct {
+    int year, month, day;
+    long long start, end;        /* record positions (reader_seek) */
+    uint32_t first_side;         /* match_table_side(mt, first_side + i) */
+    uint32_t sides;
+    uint32_t winner;             /* side number (0 = first), or MATCH_NO_WINNER */
+} MatchRow;
+
+/* An open (memory-mapped) match table. Treat as private. */
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    uint64_t match_count;
+    uint64_t side_count;
+    uint64_t team_count;
+    uint64_t name_bytes;
+    const unsigned char *matches;
+    const unsigned char *sides;
+    const unsigned char *teams;
+    const char *names;
+} MatchTable;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * match_table_build
+ *
+ * Scans data_file and writes its match table to table_file (or to
+ * data_file + ".mtab" if table_file is NULL). As with the index, only
+ * files without bad records get a table.
+ *
+ * Returns:
+ *   SUCCESS, FILE_READ_ERR, FILE_WRITE_ERR, NO_MEMORY, or the
+ *   BAD_RECORD / BAD_DATE found in the data file.
+ */
+int match_table_build(const char *data_file, const char *table_file);
+
+/*
+ * match_table_open
+ *
+ * Opens data_file + ".mtab" and checks that it still describes
+ * data_file.
+ *
+ * Returns:
+ *   SUCCESS       - the table can be used
+ *   FILE_READ_ERR - there is no table
+ *   BAD_RECORD    - the table is damaged or out of date
+ */
+int match_table_open(MatchTable *mt, const char *data_file);
+void match_table_close(MatchTable *mt);
+
+/*
+ * match_table_row / match_table_side
+ *
+ * Row i (0 <= i < mt->match_count), and side number `side` of the
+ * table: its team name (not null-terminated; *len gets its length)
+ * and *points its total.
+ */
+void match_table_row(const MatchTable *mt, uint64_t i, MatchRow *row);
+const char *match_table_side(const MatchTable *mt, uint32_t side, size_t *len, int *points);
+
+#endif /* MATCH_TABLE_H */
@@ -0,0 +1,552 @@
+/*
+ * output_writer.c - Buffered output files with a background writer
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. A growable buffer (doubling) instead of many small fprintf() calls
+ * 2. Integer and fixed-point formatting by hand
+ * 3. A job queue guarded by a mutex, with condition variables for
+ *    "work arrived" and "all work done"
+ * 4. Atomic file replacement: O_EXCL temporary file, then rename()
+ *    (only where that leaves the same file behind; see outfile_open)
+ */
+
+/* Needed for pthreads, fma() and getpid() with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "hw2.h"
+#include "output_writer.h"
+#include "stats.h"
+
+/* ========== TYPES ========== */
+/* JOB_FAIL: a buffer ran out of memory; NO_MEMORY, then as JOB_DISCARD */
+typedef enum { JOB_WRITE, JOB_COMMIT, JOB_DISCARD, JOB_FAIL } JobKind;
+
+struct OutputJob {
+    JobKind kind;
+    OutFile *file;
+    char *data;                  /* JOB_WRITE: owned, freed when written */
+    size_t len;
+    struct OutputJob *next;
+};
+
+/* Temporary file names are made unique with this counter */
+static pthread_mutex_t tmp_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long tmp_counter = 0;
+
+/* ============================================================
+ * FUNCTIONS: OutBuf
+ * ============================================================
+ */
+void outbuf_init(OutBuf *b) {
+    b->data = NULL;
+    b->len = 0;
+    b->capacity = 0;
+    b->failed = 0;
+}
+
+void outbuf_free(OutBuf *b) {
+    free(b->data);
+    outbuf_init(b);
+}
+
+/* Room for `extra` more bytes; doubles the capacity */
+static int outbuf_reserve(OutBuf *b, size_t extra) {
+    size_t capacity = b->capacity ? b->capacity : 256;
+    char *grown;
+
+    if (b->failed) {
+        return 0;
+    }
+    if (b->len + extra <= b->capacity) {
+        return 1;
+    }
+    while (capacity < b->len + extra) {
+        capacity *= 2;
+    }
+    grown = realloc(b->data, capacity);
+    if (grown == NULL) {
+        b->failed = 1;
+        return 0;
+    }
+    b->data = grown;
+    b->capacity = capacity;
+    return 1;
+}
+
+void out_text(OutBuf *b, const char *text, size_t len) {
+    /* len 0: text may be the NULL data of an empty OutBuf */
+    if (len > 0 && outbuf_reserve(b, len)) {
+        memcpy(b->data + b->len, text, len);
+        b->len += len;
+    }
+}
+
+void out_cstr(OutBuf *b, const char *text) {
+    out_text(b, text, strlen(text));
+}
+
+void out_char(OutBuf *b, char c) {
+    if (outbuf_reserve(b, 1)) {
+        b->data[b->len++] = c;
+    }
+}
+
+/* ============================================================
+ * FUNCTIONS: Number formatting
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Digits come out last-first, so they are written backwards into
+ *   a small array
+ * - Unsigned arithmetic makes the most negative value safe to negate
+ */
+static void out_unsigned(OutBuf *b, unsigned long long value, int min_digits) {
+    char digits[24];
+    int n = 0;
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n < min_digits) {
+        digits[sizeof(digits) - 1 - n++] = '0';
+    }
+    out_text(b, digits + sizeof(digits) - n, (size_t)n);
+}
+
+void out_int(OutBuf *b, long long value) {
+    if (value < 0) {
+        out_char(b, '-');
+        out_unsigned(b, 0ull - (unsigned long long)value, 1);
+    } else {
+        out_unsigned(b, (unsigned long long)value, 1);
+    }
+}
+
+void out_int2(OutBuf *b, int value) {
+    if (value < 0) {
+        out_int(b, value);       /* "%02d" pads the sign too: "-5" */
+    } else {
+        out_unsigned(b, (unsigned long long)value, 2);
+    }
+}
+
+/* ============================================================
+ * FUNCTION: out_fixed2
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - printf("%.2f") rounds the EXACT binary value: 1.005 is stored as
+ *   1.00499999999999989..., so it prints "1.00"
+ * - value * 100 is rounded once more; fma(value, 100, -p) recovers
+ *   that rounding error exactly, so the true hundredths are n + frac + e
+ * - Only an exact tie (e.g. 0.125) rounds to the even neighbour
+ * - Values too large for this (never seen in game data) and NaN /
+ *   infinity are left to snprintf()
+ */
+void out_fixed2(OutBuf *b, double value) {
+    double a = fabs(value);
+    double p, e, n, frac, half;
+    unsigned long long hundredths;
+    int up;
+
+    if (!(a < 1e12)) {
+        char tmp[512];
+        int len = snprintf(tmp, sizeof(tmp), "%.2f", value);
+        out_text(b, tmp, len < 0 ? 0 : (size_t)len < sizeof(tmp) ? (size_t)len : sizeof(tmp) - 1);
+        return;
+    }
+
+    p = a * 100.0;
+    e = fma(a, 100.0, -p);       /* a * 100 == p + e, exactly */
+    n = floor(p);
+    frac = p - n;
+    half = frac - 0.5;           /* exact: both are multiples of p's last bit */
+
+    if (half != 0.0) {
+        up = half > 0.0;         /* |e| is smaller than p's last bit */
+    } else if (e != 0.0) {
+        up = e > 0.0;
+    } else {
+        up = fmod(n, 2.0) != 0.0;
+    }
+
+    /* frac == 0 with e < 0: the true value is just below n, nearest is n */
+    hundredths = (unsigned long long)n + (unsigned long long)up;
+
+    if (signbit(value)) {
+        out_char(b, '-');
+    }
+    out_unsigned(b, hundredths / 100, 1);
+    out_char(b, '.');
+    out_unsigned(b, hundredths % 100, 2);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: run_job
+ * ============================================================
+ * Does one job on whichever thread the writer uses.
+ */
+static void run_job(OutputJob *job) {
+    OutFile *f = job->file;
+    size_t done = 0;
+    STATS_START(start);
+
+    switch (job->kind) {
+        case JOB_WRITE:
+            while (f->status == SUCCESS && done < job->len) {
+                ssize_t n = write(f->fd, job->data + done, job->len - done);
+                STATS_COUNT(syscalls, SYSCALL_WRITE);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    f->status = FILE_WRITE_ERR;
+                } else {
+                    done += (size_t)n;
+                }
+            }
+            STATS_ADD(bytes_written, done);
+            free(job->data);
+            break;
+        case JOB_COMMIT:
+            if (close(f->fd) != 0 && f->status == SUCCESS) {
+                f->status = FILE_WRITE_ERR;
+            }
+            f->fd = -1;
+            if (f->tmp_path == NULL) {
+                break;           /* written in place */
+            }
+            if (f->status == SUCCESS) {
+                STATS_COUNT(syscalls, SYSCALL_RENAME);
+                if (rename(f->tmp_path, f->path) != 0) {
+                    f->status = FILE_WRITE_ERR;
+                }
+            }
+            if (f->status != SUCCESS) {
+                unlink(f->tmp_path);
+            }
+            break;
+        case JOB_FAIL:
+            if (f->status == SUCCESS) {
+                f->status = NO_MEMORY;
+            }
+            /* fall through */
+        case JOB_DISCARD:
+            close(f->fd);
+            f->fd = -1;
+            if (f->tmp_path != NULL) {
+                unlink(f->tmp_path);
+            }
+            break;
+    }
+    STATS_STOP(STATS_WRITE, start);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: writer_main
+ * ============================================================
+ * The background thread: take the oldest job, do it without holding
+ * the lock, repeat. Leaves only when stopping and the queue is empty.
+ */
+static void *writer_main(void *arg) {
+    OutputWriter *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        OutputJob *job;
+
+        while (w->head == NULL && !w->stopping) {
+            pthread_cond_wait(&w->wake, &w->lock);
+        }
+        if (w->head == NULL) {
+            break;
+        }
+        job = w->head;
+        w->head = job->next;
+        if (w->head == NULL) {
+            w->tail = NULL;
+        }
+        w->busy = 1;
+        pthread_mutex_unlock(&w->lock);
+
+        run_job(job);
+        free(job);
+
+        pthread_mutex_lock(&w->lock);
+        w->busy = 0;
+        if (w->head == NULL) {
+            pthread_cond_broadcast(&w->idle);
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+    STATS_FLUSH(&w->stats);
+    return NULL;
+}
+
+/* Waits until the background thread has done every queued job */
+static void writer_drain(OutputWriter *w) {
+    pthread_mutex_lock(&w->lock);
+    while (w->head != NULL || w->busy) {
+        pthread_cond_wait(&w->idle, &w->lock);
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: submit
+ * ============================================================
+ * Queues a job, starting the thread if needed. Without a thread, or
+ * if the job cannot be allocated, the job is done right here (after
+ * the queued ones, so each file's bytes stay in order).
+ */
+static void submit(OutFile *f, JobKind kind, char *data, size_t len) {
+    OutputWriter *w = f->writer;
+    OutputJob *job = NULL;
+    OutputJob local;
+
+    if (w->threaded && !w->started) {
+        if (pthread_create(&w->thread, NULL, writer_main, w) == 0) {
+            w->started = 1;
+        } else {
+            w->threaded = 0;
+        }
+    }
+    if (w->started) {
+        job = malloc(sizeof(*job));
+    }
+
+    if (job == NULL) {
+        if (w->started) {
+            writer_drain(w);
+        }
+        local.kind = kind;
+        local.file = f;
+        local.data = data;
+        local.len = len;
+        run_job(&local);
+        return;
+    }
+
+    job->kind = kind;
+    job->file = f;
+    job->data = data;
+    job->len = len;
+    job->next = NULL;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->tail != NULL) {
+        w->tail->next = job;
+    } else {
+        w->head = job;
+    }
+    w->tail = job;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/* ============================================================
+ * FUNCTIONS: writer_init / writer_finish / writer_free
+ * ============================================================
+ */
+int writer_init(OutputWriter *w, int threaded) {
+    memset(w, 0, sizeof(*w));
+    w->threaded = threaded;
+    if (pthread_mutex_init(&w->lock, NULL) != 0) {
+        return NO_MEMORY;
+    }
+    if (pthread_cond_init(&w->wake, NULL) != 0) {
+        pthread_mutex_destroy(&w->lock);
+        return NO_MEMORY;
+    }
+    if (pthread_cond_init(&w->idle, NULL) != 0) {
+        pthread_cond_destroy(&w->wake);
+        pthread_mutex_destroy(&w->lock);
+        return NO_MEMORY;
+    }
+    return SUCCESS;
+}
+
+void writer_finish(OutputWriter *w) {
+    if (!w->started) {
+        return;
+    }
+    pthread_mutex_lock(&w->lock);
+    w->stopping = 1;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+    stats_absorb(&w->stats);     /* the write phase is the caller's now */
+    w->started = 0;
+    w->stopping = 0;
+}
+
+void writer_free(OutputWriter *w) {
+    OutFile *f = w->files;
+
+    while (f != NULL) {
+        OutFile *next = f->next;
+        if (f->fd >= 0) {
+            close(f->fd);
+            if (f->tmp_path != NULL) {
+                unlink(f->tmp_path);
+            }
+        }
+        free(f->path);
+        free(f->tmp_path);
+        free(f);
+        f = next;
+    }
+    w->files = NULL;
+    pthread_cond_destroy(&w->idle);
+    pthread_cond_destroy(&w->wake);
+    pthread_mutex_destroy(&w->lock);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: open_temporary
+ * ============================================================
+ * A new file "<path>.tmp-<pid>-<n>" that will replace path. If path
+ * exists (st != NULL), the new file gets its mode, owner and group.
+ * Returns the descriptor, or -1 (tmp_path is then unlinked).
+ */
+static int open_temporary(const char *path, const struct stat *st, char *tmp_path, size_t size) {
+    int fd;
+
+    do {
+        unsigned long n;
+
+        pthread_mutex_lock(&tmp_lock);
+        n = tmp_counter++;
+        pthread_mutex_unlock(&tmp_lock);
+        snprintf(tmp_path, size, "%s.tmp-%ld-%lu", path, (long)getpid(), n);
+        fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+        STATS_COUNT(syscalls, SYSCALL_OPEN);
+    } while (fd < 0 && errno == EEXIST);
+
+    if (fd >= 0 && st != NULL &&
+        (fchown(fd, st->st_uid, st->st_gid) != 0 || fchmod(fd, st->st_mode & 07777) != 0)) {
+        close(fd);
+        unlink(tmp_path);
+        fd = -1;
+    }
+    return fd;
+}
+
+/* ============================================================
+ * FUNCTION: outfile_open
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - O_CREAT | O_EXCL fails if the name exists, so two outputs (or two
+ *   programs) never share a temporary file
+ * - The temporary file is in the same directory as path: rename() is
+ *   only atomic within one file system
+ * - rename() replaces the directory entry, not the file behind it: a
+ *   symlink, a FIFO, a device such as /dev/null, or a file with other
+ *   hard links would be swapped for a new regular file. lstat() tells
+ *   them apart, and those are opened and truncated in place, as
+ *   fopen(path, "w") does. So is a file whose directory we may not
+ *   write to, or whose owner we cannot give to a new file.
+ */
+int outfile_open(OutputWriter *w, const char *path, OutFile **file) {
+    size_t len = strlen(path);
+    struct stat st;
+    int exists = lstat(path, &st) == 0;
+    OutFile *f;
+
+    /* rename() would replace a file we may not write to */
+    if (access(path, F_OK) == 0 && access(path, W_OK) != 0) {
+        return FILE_WRITE_ERR;
+    }
+    f = calloc(1, sizeof(*f));
+    if (f == NULL) {
+        return NO_MEMORY;
+    }
+    f->path = malloc(len + 1);
+    f->tmp_path = malloc(len + 48);
+    if (f->path == NULL || f->tmp_path == NULL) {
+        free(f->path);
+        free(f->tmp_path);
+        free(f);
+        return NO_MEMORY;
+    }
+    memcpy(f->path, path, len + 1);
+
+    f->fd = -1;
+    if (!exists || (S_ISREG(st.st_mode) && st.st_nlink == 1)) {
+        f->fd = open_temporary(path, exists ? &st : NULL, f->tmp_path, len + 48);
+    }
+    if (f->fd < 0 && exists) {
+        free(f->tmp_path);
+        f->tmp_path = NULL;
+        f->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        STATS_COUNT(syscalls, SYSCALL_OPEN);
+    }
+
+    if (f->fd < 0) {
+        free(f->path);
+        free(f->tmp_path);
+        free(f);
+        return FILE_WRITE_ERR;
+    }
+
+    f->status = SUCCESS;
+    f->writer = w;
+    f->next = w->files;
+    w->files = f;
+    *file = f;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTIONS: outfile_write / outfile_chunk / outfile_close / ...
+ * ============================================================
+ */
+void outfile_write(OutFile *f, OutBuf *b) {
+    if (b->failed) {
+        return;                  /* reported by outfile_close() */
+    }
+    if (b->len > 0) {
+        submit(f, JOB_WRITE, b->data, b->len);
+        outbuf_init(b);
+    }
+}
+
+void outfile_chunk(OutFile *f, OutBuf *b) {
+    if (b->len >= OUTPUT_CHUNK_SIZE) {
+        outfile_write(f, b);
+    }
+}
+
+void outfile_close(OutFile *f, OutBuf *b) {
+    if (b != NULL && b->failed) {
+        /* The writer may still be on this file's writes: status is its to set */
+        outbuf_free(b);
+        submit(f, JOB_FAIL, NULL, 0);
+        return;
+    }
+    if (b != NULL) {
+        outfile_write(f, b);
+        outbuf_free(b);
+    }
+    submit(f, JOB_COMMIT, NULL, 0);
+}
+
+void outfile_discard(OutFile *f) {
+    submit(f, JOB_DISCARD, NULL, 0);
+}
+
+int outfile_status(const OutFile *f) {
+    return f->status;
+}
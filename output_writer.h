@@ -0,0 +1,170 @@
+/*
+ * output_writer.h - Buffered output files with a background writer
+ *
+ * This file contains:
+ * - OutBuf: a growable text buffer with its own number formatting
+ * - OutFile: an output file that appears under its name only once it
+ *   is complete
+ * - OutputWriter: hands finished text to a background thread
+ *
+ * Learning Concepts:
+ * - Formatting numbers by hand instead of parsing a format string
+ *   for every line (and getting %.2f rounding exactly right)
+ * - Producer / consumer: the scan formats text, another thread makes
+ *   the write() system calls
+ * - Write to a temporary file, then rename(): readers see the old
+ *   file or the whole new one, never half of it
+ *
+ * Typical use:
+ *   OutputWriter w;
+ *   OutFile *f;
+ *   OutBuf text;
+ *   writer_init(&w, 1);
+ *   outbuf_init(&text);
+ *   if (outfile_open(&w, "report.txt", &f) == SUCCESS) {
+ *       out_cstr(&text, "Games: ");
+ *       out_int(&text, 12);
+ *       out_char(&text, '\n');
+ *       outfile_close(f, &text);
+ *   }
+ *   writer_finish(&w);        // waits for every write
+ *   status = outfile_status(f);
+ *   writer_free(&w);          // frees every OutFile
+ */
+
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include "stats.h"
+
+/* ========== CONSTANTS ========== */
+#define OUTPUT_CHUNK_SIZE (64 * 1024)   /* outfile_chunk() hands over this much */
+
+/* ========== TYPES ========== */
+
+/* Text being formatted */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    int failed;                  /* an allocation failed: text is incomplete */
+} OutBuf;
+
+/* An output file; created by outfile_open(), owned by its writer */
+typedef struct OutFile {
+    char *path;                  /* final name */
+    char *tmp_path;              /* written here, renamed to path at the end;
+                                    NULL: path is written in place */
+    int fd;
+    int status;                  /* SUCCESS, FILE_WRITE_ERR or NO_MEMORY */
+    struct OutputWriter *writer;
+    struct OutFile *next;        /* every file of the writer */
+} OutFile;
+
+typedef struct OutputJob OutputJob;  /* output_writer.c */
+
+/*
+ * Writes, closes and renames output files, in the order they were
+ * asked for. Threaded writers do it on a background thread (started
+ * with the first job); others do it at once on the calling thread.
+ */
+typedef struct OutputWriter {
+    int threaded;
+    int started;                 /* background thread running */
+    int stopping;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;         /* signalled when a job is queued */
+    pthread_cond_t idle;         /* signalled when the queue empties */
+    OutputJob *head, *tail;      /* jobs not yet done */
+    int busy;                    /* the thread is doing a job */
+    OutFile *files;
+    Hw2Stats stats;              /* the thread's counters, until writer_finish() */
+} OutputWriter;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * outbuf_init / outbuf_free
+ *
+ * An empty buffer / release its memory.
+ */
+void outbuf_init(OutBuf *b);
+void outbuf_free(OutBuf *b);
+
+/*
+ * out_text / out_cstr / out_char
+ *
+ * Append len bytes / a C string / one character.
+ */
+void out_text(OutBuf *b, const char *text, size_t len);
+void out_cstr(OutBuf *b, const char *text);
+void out_char(OutBuf *b, char c);
+
+/*
+ * out_int / out_int2 / out_fixed2
+ *
+ * Append a number exactly as printf() would with "%lld", "%02d" and
+ * "%.2f" (ties round to even, like glibc).
+ */
+void out_int(OutBuf *b, long long value);
+void out_int2(OutBuf *b, int value);
+void out_fixed2(OutBuf *b, double value);
+
+/*
+ * writer_init / writer_finish / writer_free
+ *
+ * writer_init() prepares a writer (threaded: 1 = background thread).
+ * writer_finish() waits until every job is done and stops the thread;
+ * afterwards outfile_status() is final. writer_free() frees every
+ * OutFile the writer opened (call writer_finish() first).
+ * writer_init() returns SUCCESS or NO_MEMORY.
+ */
+int writer_init(OutputWriter *w, int threaded);
+void writer_finish(OutputWriter *w);
+void writer_free(OutputWriter *w);
+
+/*
+ * outfile_open
+ *
+ * Creates a uniquely named temporary file next to path. A path that
+ * is not a plain file (a symlink, FIFO or device), has other hard
+ * links, or cannot be replaced by a new file (directory not writable,
+ * owner not ours) is opened and truncated in place instead, like
+ * fopen(path, "w").
+ * Returns SUCCESS (and *file), FILE_WRITE_ERR or NO_MEMORY.
+ */
+int outfile_open(OutputWriter *w, const char *path, OutFile **file);
+
+/*
+ * outfile_write / outfile_chunk
+ *
+ * Hand the text in b to the writer (b is left empty). outfile_chunk()
+ * only does so once b holds OUTPUT_CHUNK_SIZE bytes, so callers can
+ * call it after every line.
+ */
+void outfile_write(OutFile *f, OutBuf *b);
+void outfile_chunk(OutFile *f, OutBuf *b);
+
+/*
+ * outfile_close / outfile_discard
+ *
+ * outfile_close() writes what is left in b (may be NULL) and renames
+ * the temporary file to its name; if anything failed, the temporary
+ * file is removed instead and the old file, if any, is left alone.
+ * outfile_discard() removes the temporary file. A file written in
+ * place is only closed: whatever was written stays.
+ */
+void outfile_close(OutFile *f, OutBuf *b);
+void outfile_discard(OutFile *f);
+
+/*
+ * outfile_status
+ *
+ * SUCCESS, FILE_WRITE_ERR or NO_MEMORY. Final after writer_finish().
+ */
+int outfile_status(const OutFile *f);
+
+#endif /* OUTPUT_WRITER_H */
@@ -0,0 +1,289 @@
+/*
+ * parallel_scan.c - Run a QueryPlan on several threads
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Choosing chunk boundaries with memchr() so no line is split
+ * 2. One thread per chunk, each with its own reader and plan copy
+ * 3. Joining threads, then merging their results in file order
+ * 4. Falling back to the simple path when anything unusual happens
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hw2.h"
+#include "record_reader.h"
+#include "column_file.h"
+#include "file_index.h"
+#include "match_table.h"
+#include "query_plan.h"
+#include "parallel_scan.h"
+#include "stats.h"
+
+/* ========== TYPES ========== */
+
+/* One chunk of the input and the thread that scans it */
+typedef struct {
+    QueryPlan worker;
+    const char *in_file;
+    unsigned fields;
+    long long start, end;        /* records with position in [start, end) */
+    int status;
+    pthread_t thread;
+    int started;
+} ScanChunk;
+
+/* ============================================================
+ * HELPER FUNCTION: scan_chunk (thread body)
+ * ============================================================
+ * Each thread opens its own reader (mapping the same file again
+ * costs nothing) and seeks to its chunk. A text reader may read one
+ * line past the end of the chunk; that record belongs to the next
+ * chunk and is not fed (or, if it is bad, not logged).
+ */
+static void *scan_chunk(void *arg) {
+    ScanChunk *c = arg;
+    RecordReader rd;
+    GameRecord rec;
+    int status;
+
+    status = reader_open(&rd, c->in_file);
+    if (status != SUCCESS) {
+        c->status = status;
+        return NULL;
+    }
+    memset(&rec, 0, sizeof(rec));
+    reader_set_fields(&rd, c->fields);
+
+    status = reader_seek(&rd, c->start);
+    while (status == SUCCESS && reader_tell(&rd) < c->end) {
+        status = reader_next(&rd, &rec);
+        if (status == RECORD_OK) {
+            if (rd.rec_offset >= c->end) {
+                break;
+            }
+            plan_feed(&c->worker, &rec);
+            status = SUCCESS;
+        } else if (rd.columns == NULL && (status == BAD_RECORD || status == BAD_DATE) &&
+                   rd.err_offset >= c->end) {
+            status = SUCCESS;  /* the next chunk's line */
+            break;
+        } else if (plan_skip_bad(&c->worker, &rd, status)) {
+            status = SUCCESS;
+        }
+    }
+    if (status == RECORD_OK || status == RECORD_EOF) {
+        status = SUCCESS;
+    }
+    if (status == SUCCESS) {
+        status = c->worker.feed_status;
+    }
+
+    reader_close(&rd);
+    c->status = status;
+    STATS_FLUSH(&c->worker.stats);
+    return NULL;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: split_input
+ * ============================================================
+ * Fills bounds[0..n] with chunk boundaries and returns n (the number
+ * of chunks, 1 if the input is too small to split).
+ *
+ * Text files: bounds are the positions of '\n' characters near equal
+ * fractions of the file. Column files: record numbers.
+ */
+static int split_input(const RecordReader *rd, int threads, long long *bounds) {
+    long long size;
+    int n = threads;
+
+    if (rd->columns != NULL) {
+        size = (long long)rd->columns->record_count;
+        if (size / PARALLEL_MIN_RECORDS < n) {
+            n = (int)(size / PARALLEL_MIN_RECORDS);
+        }
+    } else {
+        size = (long long)rd->map_len;
+        if (size / PARALLEL_MIN_CHUNK < n) {
+            n = (int)(size / PARALLEL_MIN_CHUNK);
+        }
+    }
+    if (n < 2) {
+        return 1;
+    }
+
+    bounds[0] = 0;
+    for (int i = 1; i < n; i++) {
+        long long target = size / n * i;
+        const char *newline;
+
+        if (target < bounds[i - 1]) {
+            target = bounds[i - 1];
+        }
+        if (rd->columns != NULL) {
+            bounds[i] = target;
+            continue;
+        }
+        newline = memchr(rd->base + target, '\n', (size_t)(size - target));
+        bounds[i] = newline != NULL ? newline - rd->base : size;
+    }
+    bounds[n] = size;
+    return n;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: number_bad_lines
+ * ============================================================
+ * A worker starts reading in the middle of the file, where its line
+ * count is unknown. Once the logs are merged, count the newlines
+ * before each logged bad record (they are in file order, so one pass
+ * from the start of the file covers them all).
+ */
+static void number_bad_lines(const RecordReader *rd, BadRecordLog *log) {
+    const char *p = rd->base;
+    long line = 1;
+
+    for (int i = 0; i < log->count; i++) {
+        const char *stop = rd->base + log->first[i].offset;
+
+        while (p < stop && (p = memchr(p, '\n', (size_t)(stop - p))) != NULL) {
+            line++;
+            p++;
+        }
+        if (p == NULL) {
+            p = stop;
+        }
+        log->first[i].line = line;
+    }
+}
+
+/* ============================================================
+ * FUNCTION: plan_run_parallel
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - plan_begin() once on the main thread (routing, output files)
+ * - plan_fork() per chunk, pthread_create(), pthread_join()
+ * - plan_merge() in chunk order, then plan_end() as usual
+ * - Errors are rare: rescanning with plan_run() keeps their exact
+ *   semantics without teaching every merge about them
+ */
+int plan_run_parallel(QueryPlan *plan, const char *in_file, int threads) {
+    long long bounds[PARALLEL_MAX_THREADS + 1];
+    ScanChunk *chunks;
+    RecordReader rd;
+    FileIndex ix;
+    MatchTable mt;
+    int any_active = 0;
+    int status = SUCCESS;
+    int n;
+
+    for (int i = 0; i < plan->count; i++) {
+        if (!plan->queries[i].done) {
+            any_active = 1;
+        }
+    }
+    if (threads <= 1 || !any_active) {
+        return plan_run(plan, in_file);
+    }
+    if (threads > PARALLEL_MAX_THREADS) {
+        threads = PARALLEL_MAX_THREADS;
+    }
+
+    /* An index or a match table beats any number of threads */
+    if (plan_point_lookups_only(plan) && index_open(&ix, in_file) == SUCCESS) {
+        index_close(&ix);
+        return plan_run(plan, in_file);
+    }
+    if (plan_match_level_only(plan) && match_table_open(&mt, in_file) == SUCCESS) {
+        match_table_close(&mt);
+        return plan_run(plan, in_file);
+    }
+
+    if (reader_open(&rd, in_file) != SUCCESS) {
+        return plan_run(plan, in_file);  /* reports the error */
+    }
+    /* A date window of a sorted file is a binary search away */
+    if (plan->ranged && reader_known_sorted(&rd)) {
+        reader_close(&rd);
+        return plan_run(plan, in_file);
+    }
+    n = rd.map != NULL ? split_input(&rd, threads, bounds) : 1;
+    if (n < 2) {
+        reader_close(&rd);
+        return plan_run(plan, in_file);
+    }
+
+    plan->error.code = SUCCESS;
+    plan->error.line = 0;
+    plan->error.offset = 0;
+    memset(&plan->bad, 0, sizeof(plan->bad));
+    reader_set_fields(&rd, plan_fields(plan));
+    if (plan_begin(plan) != SUCCESS || plan_bind(plan, &rd) != SUCCESS) {
+        reader_close(&rd);
+        return plan_run(plan, in_file);
+    }
+    /* rd stays open (unread) so a sorted file can be remembered below */
+    chunks = calloc((size_t)n, sizeof(ScanChunk));
+    if (chunks == NULL) {
+        reader_close(&rd);
+        return plan_run(plan, in_file);
+    }
+
+    for (int i = 0; i < n; i++) {
+        ScanChunk *c = &chunks[i];
+
+        c->in_file = in_file;
+        c->fields = plan_fields(plan);
+        c->start = bounds[i];
+        c->end = bounds[i + 1];
+        c->status = plan_fork(plan, &c->worker);
+        if (c->status != SUCCESS) {
+            status = c->status;
+            n = i;
+            break;
+        }
+    }
+
+    for (int i = 0; i < n && status == SUCCESS; i++) {
+        if (pthread_create(&chunks[i].thread, NULL, scan_chunk, &chunks[i]) == 0) {
+            chunks[i].started = 1;
+        } else {
+            scan_chunk(&chunks[i]);  /* no thread: scan it here */
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (chunks[i].started) {
+            pthread_join(chunks[i].thread, NULL);
+        }
+        if (chunks[i].status != SUCCESS) {
+            status = chunks[i].status;
+        }
+    }
+
+    if (status == SUCCESS) {
+        for (int i = 0; i < n; i++) {
+            plan_merge(plan, &chunks[i].worker);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        plan_discard(&chunks[i].worker);
+    }
+    free(chunks);
+
+    if (status != SUCCESS) {
+        reader_close(&rd);
+        return plan_run(plan, in_file);
+    }
+    if (plan->bad.count > 0 && rd.columns == NULL) {
+        number_bad_lines(&rd, &plan->bad);
+    }
+    if (plan->ranged && plan->in_order && plan->bad.skipped == 0) {
+        reader_remember_sorted(&rd);
+    }
+    reader_close(&rd);
+    plan_end(plan, SUCCESS);
+    return SUCCESS;
+}
@@ -0,0 +1,50 @@
+/*
+ * parallel_scan.h - Run a QueryPlan on several threads
+ *
+ * This file contains:
+ * - plan_run_parallel(), a multi-threaded version of plan_run()
+ *
+ * Learning Concepts:
+ * - Splitting a file into chunks at line boundaries
+ * - POSIX threads (pthread_create / pthread_join)
+ * - Per-thread partial results merged afterwards, in order
+ */
+
+#ifndef PARALLEL_SCAN_H
+#define PARALLEL_SCAN_H
+
+#include "query_plan.h"
+
+/* ========== CONSTANTS ========== */
+#define PARALLEL_MAX_THREADS 256
+
+/* Chunks smaller than this are not worth a thread (bytes / records) */
+#ifndef PARALLEL_MIN_CHUNK
+#define PARALLEL_MIN_CHUNK   (1 << 20)
+#endif
+#ifndef PARALLEL_MIN_RECORDS
+#define PARALLEL_MIN_RECORDS 65536
+#endif
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * plan_run_parallel
+ *
+ * Same results as plan_run(plan, in_file), using up to `threads`
+ * threads. The input is split into one chunk per thread (at newlines
+ * for text files, at record numbers for column files); each thread
+ * feeds its chunk to its own copy of the plan (plan_fork) and the
+ * copies are merged in file order (plan_merge).
+ *
+ * Falls back to plan_run() when threads <= 1, the input cannot be
+ * memory-mapped (pipes), the file is small, or an index or a match
+ * table can answer the plan. If any chunk contains a bad record, the file is scanned
+ * again by plan_run() so the error, its location and any partial
+ * output are exactly what a single-threaded run produces.
+ *
+ * Returns: as plan_run().
+ */
+int plan_run_parallel(QueryPlan *plan, const char *in_file, int threads);
+
+#endif /* PARALLEL_SCAN_H */
@@ -0,0 +1,1700 @@
+/*
+ * query_plan.c - Run many hw2 queries in one pass over a game data file
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Each query is a small state machine: begin, feed one record, end
+ * 2. One scan can feed any number of queries
+ * 3. Records are routed through hash tables (by player name and by
+ *    date), so thousands of player queries do not mean thousands of
+ *    string compares per record
+ * 4. Match boundaries (date changes) are tracked once and shared
+ * 5. Splitting a scan: per-worker state that is merged in file order
+ * 6. Output is formatted into memory and written by an OutputWriter
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "hw2.h"
+#include "encoding.h"
+#include "intern.h"
+#include "file_index.h"
+#include "match_table.h"
+#include "record_reader.h"
+#include "query_plan.h"
+#include "stats.h"
+
+/* ============================================================
+ * HELPER FUNCTIONS: Small utilities
+ * ============================================================
+ */
+
+/* Record fields are pointer + length, so compare lengths first */
+static int field_equals(const char *field, size_t field_len, const char *str, size_t str_len) {
+    return field_len == str_len && memcmp(field, str, str_len) == 0;
+}
+
+static int is_home_team(const QueryPlan *plan, const GameRecord *rec) {
+    if (plan->home_teams != NULL) {
+        return plan->home_teams[rec->team_id];
+    }
+    return field_equals(rec->team, rec->team_len, plan->team_name, plan->team_len);
+}
+
+/* Copy of a C string in the plan's arena (freed with the plan) */
+static char *copy_string(QueryPlan *plan, const char *str) {
+    return arena_strndup(&plan->arena, str, strlen(str));
+}
+
+/* Mix year/month/day into a hash */
+static uint32_t hash_date(int year, int month, int day) {
+    uint32_t h = (uint32_t)(year * 372 + month * 31 + day);
+    return h * 2654435761u;
+}
+
+/* Smallest power of two >= 2 * n (at least 16), minus one */
+static size_t table_mask(int n) {
+    size_t size = 16;
+
+    while (size < (size_t)n * 2) {
+        size *= 2;
+    }
+    return size - 1;
+}
+
+/* Same match: same date and same game of that day */
+static int same_date(const MatchState *m, const GameRecord *rec) {
+    return rec->year == m->year && rec->month == m->month && rec->day == m->day &&
+           rec->game == m->game;
+}
+
+static void start_match(MatchState *m, const GameRecord *rec) {
+    m->year = rec->year;
+    m->month = rec->month;
+    m->day = rec->day;
+    m->game = rec->game;
+    m->home_score = 0;
+    m->opponent_score = 0;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: add_query
+ * ============================================================
+ * Appends an empty query of the given kind, growing the array by
+ * doubling. Returns its id or NO_MEMORY.
+ *
+ * The arena cannot grow an array in place: the old array stays in it
+ * until plan_reset(), which doubling keeps below the new one's size.
+ */
+static int add_query(QueryPlan *plan, QueryKind kind) {
+    Query *q;
+
+    if (plan->count == plan->capacity) {
+        int new_capacity = plan->capacity ? plan->capacity * 2 : 8;
+        Query *grown = arena_alloc(&plan->arena, (size_t)new_capacity * sizeof(Query));
+        if (grown == NULL) {
+            return NO_MEMORY;
+        }
+        if (plan->count > 0) {
+            memcpy(grown, plan->queries, (size_t)plan->count * sizeof(Query));
+        }
+        plan->queries = grown;
+        plan->capacity = new_capacity;
+    }
+
+    q = &plan->queries[plan->count];
+    memset(q, 0, sizeof(*q));
+    q->kind = kind;
+    q->next_same_key = -1;
+    q->next_in_match = -1;
+    return plan->count++;
+}
+
+/* Marks a query as answered before any scan (bad parameters) */
+static int finish_early(QueryPlan *plan, int id, int code) {
+    plan->queries[id].done = 1;
+    plan->queries[id].result = code;
+    return id;
+}
+
+/* Copies a player name into a new query; drops the query on failure */
+static int set_player(QueryPlan *plan, int id, const char *player_name) {
+    Query *q = &plan->queries[id];
+
+    q->player_name = copy_string(plan, player_name);
+    if (q->player_name == NULL) {
+        plan->count--;
+        return NO_MEMORY;
+    }
+    q->player_len = strlen(player_name);
+    return id;
+}
+
+static int set_out_file(QueryPlan *plan, int id, const char *out_file) {
+    Query *q = &plan->queries[id];
+
+    q->out_file = copy_string(plan, out_file);
+    if (q->out_file == NULL) {
+        plan->count--;
+        return NO_MEMORY;
+    }
+    return id;
+}
+
+/* ============================================================
+ * FUNCTION: plan_init / plan_free
+ * ============================================================
+ */
+void plan_init(QueryPlan *plan) {
+    memset(plan, 0, sizeof(*plan));
+    plan->match.year = plan->match.month = plan->match.day = -1;
+    plan->match.game = 0;
+    plan->in_match_head = -1;
+    plan->error.code = SUCCESS;
+    plan->team_name = PLAN_DEFAULT_TEAM;
+    plan->team_len = strlen(PLAN_DEFAULT_TEAM);
+    arena_init(&plan->arena, PLAN_ARENA_BLOCK);
+    arena_init(&plan->run, PLAN_ARENA_BLOCK);
+}
+
+/* The routing tables live in plan->run: rewinding it frees them all */
+static void free_routing(QueryPlan *plan) {
+    arena_reset(&plan->run);
+    plan->history_ids = NULL;
+    plan->match_ids = NULL;
+    plan->name_heads = NULL;
+    plan->date_heads = NULL;
+    plan->player_routes = NULL;
+    plan->home_teams = NULL;
+    plan->history_count = 0;
+    plan->match_count = 0;
+}
+
+/* Waits for the writer; files that were never closed are removed */
+static void free_writer(QueryPlan *plan) {
+    if (!plan->writer_ready) {
+        return;
+    }
+    writer_finish(&plan->writer);
+    writer_free(&plan->writer);
+    plan->writer_ready = 0;
+    for (int i = 0; i < plan->count; i++) {
+        plan->queries[i].file = NULL;
+    }
+}
+
+/* What a plan holds outside its arenas: history text and the writer */
+static void free_outputs(QueryPlan *plan) {
+    for (int i = 0; i < plan->count; i++) {
+        Query *q = &plan->queries[i];
+        if (q->kind == QUERY_MATCHES_HISTORY) {
+            outbuf_free(&q->s.history.text);
+        }
+    }
+    free_writer(plan);
+}
+
+void plan_free(QueryPlan *plan) {
+    free_outputs(plan);
+    arena_free(&plan->arena);
+    arena_free(&plan->run);
+    index_free_spans(&plan->spans);
+    plan_init(plan);
+}
+
+/* ============================================================
+ * FUNCTION: plan_reset
+ * ============================================================
+ * plan_free() without returning the arenas' blocks (or the index span
+ * array): queries, strings and routing tables of the next run are
+ * carved from the same memory.
+ */
+void plan_reset(QueryPlan *plan) {
+    Arena arena = plan->arena;
+    Arena run = plan->run;
+    IndexSpanList spans = plan->spans;
+
+    free_outputs(plan);
+    arena_reset(&arena);
+    arena_reset(&run);
+    plan_init(plan);
+    plan->arena = arena;
+    plan->run = run;
+    plan->spans = spans;
+}
+
+/* ============================================================
+ * FUNCTION: plan_set_date_range
+ * ============================================================
+ */
+int plan_set_date_range(QueryPlan *plan, int from_year, int from_month, int from_day,
+                        int to_year, int to_month, int to_day) {
+    long long from = pack_date(from_year, from_month, from_day);
+    long long to = pack_date(to_year, to_month, to_day);
+
+    if (!is_valid_date(from_year, from_month, from_day) ||
+        !is_valid_date(to_year, to_month, to_day) || from > to) {
+        return BAD_DATE;
+    }
+    plan->ranged = 1;
+    plan->range_from = from;
+    plan->range_to = to;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTIONS: plan_set_lenient / plan_bad_records / plan_skip_bad
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - The reader has already moved past a bad line, so skipping it is
+ *   just calling reader_next() again
+ * - The log is bounded: a file with a million bad lines still keeps
+ *   only the first few, plus a count
+ */
+void plan_set_lenient(QueryPlan *plan, int enabled) {
+    plan->lenient = enabled != 0;
+}
+
+const BadRecordLog *plan_bad_records(const QueryPlan *plan) {
+    return &plan->bad;
+}
+
+static void log_bad(BadRecordLog *log, const BadRecord *bad) {
+    if (log->count < BAD_RECORD_LOG_SIZE) {
+        log->first[log->count++] = *bad;
+    }
+    log->skipped++;
+}
+
+int plan_skip_bad(QueryPlan *plan, const RecordReader *rd, int status) {
+    BadRecord bad;
+
+    if (!plan->lenient || (status != BAD_RECORD && status != BAD_DATE) || rd->columns != NULL) {
+        return 0;
+    }
+    bad.code = status;
+    bad.line = rd->err_line;
+    bad.offset = rd->err_offset;
+    bad.reason = rd->err_reason;
+    log_bad(&plan->bad, &bad);
+    return 1;
+}
+
+/* reader_next(), skipping bad records if the plan is lenient */
+static int plan_next(QueryPlan *plan, RecordReader *rd, GameRecord *rec) {
+    int status;
+
+    do {
+        status = reader_next(rd, rec);
+    } while (status != RECORD_OK && plan_skip_bad(plan, rd, status));
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: plan_set_team
+ * ============================================================
+ */
+int plan_set_team(QueryPlan *plan, const char *team) {
+    char *copy;
+
+    if (team == NULL) {
+        team = PLAN_DEFAULT_TEAM;
+    }
+    if (team[0] == '\0' || strlen(team) >= MAX_NAME_LENGTH) {
+        return BAD_RECORD;
+    }
+    copy = copy_string(plan, team);
+    if (copy == NULL) {
+        return NO_MEMORY;
+    }
+    plan->team_name = copy;
+    plan->team_len = strlen(copy);
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTIONS: plan_add_*
+ * ============================================================
+ * Parameter checks happen here, so a query with bad parameters is
+ * answered at once and never takes part in a scan.
+ */
+int plan_add_matches_history(QueryPlan *plan, int year, const char *out_file) {
+    int id = add_query(plan, QUERY_MATCHES_HISTORY);
+
+    if (id < 0) {
+        return id;
+    }
+    plan->queries[id].year = year;
+    if (year <= 0) {
+        return finish_early(plan, id, BAD_DATE);
+    }
+    return set_out_file(plan, id, out_file);
+}
+
+int plan_add_most_valuable_player(QueryPlan *plan, int year, int month, int day) {
+    int id = add_query(plan, QUERY_MOST_VALUABLE_PLAYER);
+
+    if (id < 0) {
+        return id;
+    }
+    plan->queries[id].year = year;
+    plan->queries[id].month = month;
+    plan->queries[id].day = day;
+    if (!is_valid_date(year, month, day)) {
+        return finish_early(plan, id, BAD_DATE);
+    }
+    return id;
+}
+
+int plan_add_average_points(QueryPlan *plan, const char *player_name) {
+    int id = add_query(plan, QUERY_AVERAGE_POINTS);
+
+    if (id < 0) {
+        return id;
+    }
+    return set_player(plan, id, player_name);
+}
+
+int plan_add_best_winning_match(QueryPlan *plan, int year, int month) {
+    int id = add_query(plan, QUERY_BEST_WINNING_MATCH);
+
+    if (id < 0) {
+        return id;
+    }
+    plan->queries[id].year = year;
+    plan->queries[id].month = month;
+    if (year <= 0 || month < 1 || month > 12) {
+        return finish_early(plan, id, BAD_DATE);
+    }
+    return id;
+}
+
+int plan_add_best_month(QueryPlan *plan) {
+    return add_query(plan, QUERY_BEST_MONTH);
+}
+
+int plan_add_player_report(QueryPlan *plan, const char *player_name, const char *out_file) {
+    int id = add_query(plan, QUERY_PLAYER_REPORT);
+
+    if (id < 0) {
+        return id;
+    }
+    id = set_player(plan, id, player_name);
+    if (id < 0) {
+        return id;
+    }
+    return set_out_file(plan, id, out_file);
+}
+
+/* ============================================================
+ * QUERY: matches history
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Tracking state while reading (current date, scores)
+ * - Only records from the requested year are considered, so this
+ *   query keeps its own match state
+ * - Formatting each line into memory as matches complete; the writer
+ *   gets the text in OUTPUT_CHUNK_SIZE pieces
+ */
+static void history_close_match(Query *q, const char *team) {
+    MatchState *m = &q->s.history.match;
+    OutBuf *text = &q->s.history.text;
+
+    if (m->year == -1) {
+        return;
+    }
+
+    /* A worker's first match may continue in the previous chunk */
+    if (q->s.history.hold_first && !q->s.history.first_closed) {
+        q->s.history.first = *m;
+        memcpy(q->s.history.first_opponent, q->s.history.opponent_name, MAX_NAME_LENGTH);
+        q->s.history.first_closed = 1;
+        return;
+    }
+
+    /* Write header on first match */
+    if (!q->s.history.header_written) {
+        out_int(text, q->year);
+        out_char(text, '\n');
+        q->s.history.header_written = 1;
+    }
+
+    /* "%02d-%02d:%s(%d)-%s(%d)\n" */
+    out_int2(text, m->month);
+    out_char(text, '-');
+    out_int2(text, m->day);
+    out_char(text, ':');
+    out_cstr(text, team);
+    out_char(text, '(');
+    out_int(text, m->home_score);
+    out_cstr(text, ")-");
+    out_cstr(text, q->s.history.opponent_name);
+    out_char(text, '(');
+    out_int(text, m->opponent_score);
+    out_cstr(text, ")\n");
+    if (q->file != NULL) {
+        outfile_chunk(q->file, text);
+    }
+
+    /* Track win/loss */
+    if (m->home_score > m->opponent_score) {
+        q->s.history.wins++;
+    } else {
+        q->s.history.losses++;
+    }
+}
+
+static void history_feed(Query *q, const GameRecord *rec, int home_row, const char *team) {
+    MatchState *m = &q->s.history.match;
+
+    /* Skip records from other years */
+    if (rec->year != q->year) {
+        return;
+    }
+
+    /* Different date (or game of the day) = different game */
+    if (!same_date(m, rec)) {
+        history_close_match(q, team);
+        start_match(m, rec);
+        q->s.history.opponent_name[0] = '\0';
+    }
+
+    q->s.history.found_data = 1;
+
+    if (home_row) {
+        m->home_score += rec->points;
+    } else {
+        m->opponent_score += rec->points;
+        if (q->s.history.opponent_name[0] == '\0') {
+            /* team_len is always < MAX_NAME_LENGTH */
+            memcpy(q->s.history.opponent_name, rec->team, rec->team_len);
+            q->s.history.opponent_name[rec->team_len] = '\0';
+        }
+    }
+}
+
+static void history_end(Query *q, const char *team) {
+    /* Don't forget to output the last match! */
+    history_close_match(q, team);
+
+    if (q->s.history.found_data) {
+        out_cstr(&q->s.history.text, "Record: ");
+        out_int(&q->s.history.text, q->s.history.wins);
+        out_cstr(&q->s.history.text, "W-");
+        out_int(&q->s.history.text, q->s.history.losses);
+        out_cstr(&q->s.history.text, "L\n");
+    }
+    q->result = q->s.history.found_data ? SUCCESS : NO_DATA_POINTS;
+}
+
+/* ============================================================
+ * QUERY: most valuable player
+ * ============================================================
+ * Combined = points + 1.5*assists + 2*blocks + 0.2*minutes
+ */
+static void mvp_feed(Query *q, const GameRecord *rec) {
+    double combined;
+
+    if (rec->year != q->year || rec->month != q->month || rec->day != q->day) {
+        return;
+    }
+
+    q->s.mvp.found_match = 1;
+    combined = (double)rec->points +
+               1.5 * (double)rec->assists +
+               2.0 * (double)rec->blocks +
+               0.2 * (double)rec->minutes;
+
+    if (combined > q->s.mvp.max_combined_score) {
+        q->s.mvp.max_combined_score = combined;
+    }
+}
+
+/* ============================================================
+ * QUERY: best winning match / best month (match level)
+ * ============================================================
+ * Both are told about every finished match.
+ * "Best" win = largest score difference; ties go to the higher
+ * home team score.
+ */
+static void best_win_close_match(Query *q, const MatchState *m) {
+    int diff;
+
+    if (m->year != q->year || m->month != q->month) {
+        return;
+    }
+
+    diff = m->home_score - m->opponent_score;
+    if (diff > 0) {
+        if (diff > q->s.best_win.best_difference ||
+            (diff == q->s.best_win.best_difference &&
+             m->home_score > q->s.best_win.best_home_score)) {
+            q->s.best_win.best_difference = diff;
+            q->s.best_win.best_home_score = m->home_score;
+            q->s.best_win.found_win = 1;
+        }
+    }
+}
+
+static void best_month_close_match(Query *q, const MatchState *m) {
+    if (m->month >= 1 && m->month <= 12) {
+        q->s.best_month.total_games[m->month - 1]++;
+        if (m->home_score > m->opponent_score) {
+            q->s.best_month.wins[m->month - 1]++;
+        }
+    }
+}
+
+static void best_month_end(Query *q) {
+    int best_month = -1;
+    double best_rate = -1.0;
+
+    for (int i = 0; i < 12; i++) {
+        if (q->s.best_month.total_games[i] > 0) {
+            double rate = (double)q->s.best_month.wins[i] /
+                          (double)q->s.best_month.total_games[i];
+            if (rate > best_rate) {
+                best_rate = rate;
+                best_month = i + 1;  /* Convert back to 1-based month */
+            }
+        }
+    }
+
+    if (best_month == -1 || best_rate == 0.0) {
+        q->result = NO_DATA_POINTS;
+    } else {
+        q->result = best_month;
+    }
+}
+
+/* ============================================================
+ * QUERY: player report
+ * ============================================================
+ * Values are written like %.2f: exactly 2 decimal places (out_fixed2)
+ */
+static void report_line(OutBuf *text, const char *label, double value) {
+    out_cstr(text, label);
+    out_fixed2(text, value);
+    out_char(text, '\n');
+}
+
+static void report_end(QueryPlan *plan, Query *q) {
+    OutBuf text;
+    int games = q->s.report.games_played;
+
+    if (games == 0) {
+        q->result = NO_DATA_POINTS;
+        return;
+    }
+
+    q->result = outfile_open(&plan->writer, q->out_file, &q->file);
+    if (q->result != SUCCESS) {
+        q->file = NULL;
+        return;
+    }
+
+    outbuf_init(&text);
+    out_cstr(&text, "Player: ");
+    out_cstr(&text, q->player_name);
+    out_cstr(&text, "\nGames: ");
+    out_int(&text, games);
+    out_cstr(&text, "\nGames Won: ");
+    out_int(&text, q->s.report.games_won);
+    out_char(&text, '\n');
+    report_line(&text, "Points per Game: ", (double)q->s.report.total_points / games);
+    report_line(&text, "Assists per Game: ", (double)q->s.report.total_assists / games);
+    report_line(&text, "Blocks per Game: ", (double)q->s.report.total_blocks / games);
+    report_line(&text, "Average Minutes: ", q->s.report.total_minutes / games);
+    outfile_close(q->file, &text);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: close_shared_match
+ * ============================================================
+ * Called when the date changes (and at the end): hands the finished
+ * match to the match-level queries and counts wins for the players
+ * who appeared in it.
+ */
+static void close_shared_match(QueryPlan *plan) {
+    const MatchState *m = &plan->match;
+    int id, next;
+
+    if (m->year == -1) {
+        return;
+    }
+
+    /* A worker's first match may continue in the previous chunk */
+    if (plan->worker && !plan->first_closed) {
+        plan->first_match = *m;
+        plan->first_closed = 1;
+        for (id = plan->in_match_head; id >= 0; id = next) {
+            Query *q = &plan->queries[id];
+            next = q->next_in_match;
+            q->s.report.in_first_match = 1;
+            q->s.report.player_in_this_match = 0;
+            q->next_in_match = -1;
+        }
+        plan->in_match_head = -1;
+        return;
+    }
+
+    for (int i = 0; i < plan->match_count; i++) {
+        Query *q = &plan->queries[plan->match_ids[i]];
+        if (q->kind == QUERY_BEST_WINNING_MATCH) {
+            best_win_close_match(q, m);
+        } else {
+            best_month_close_match(q, m);
+        }
+    }
+
+    for (id = plan->in_match_head; id >= 0; id = next) {
+        Query *q = &plan->queries[id];
+        next = q->next_in_match;
+        if (m->home_score > m->opponent_score) {
+            q->s.report.games_won++;
+        }
+        q->s.report.player_in_this_match = 0;
+        q->next_in_match = -1;
+    }
+    plan->in_match_head = -1;
+}
+
+/* ============================================================
+ * FUNCTION: plan_begin
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Resetting every query so a plan can be run again
+ * - Building the routing tables once, before the scan
+ * - Opening history outputs up front (a failure only affects that query);
+ *   they replace the old files only when plan_end() closes them
+ */
+int plan_begin(QueryPlan *plan) {
+    int named = 0, dated = 0, outputs = 0;
+
+    free_routing(plan);
+    plan->match.year = plan->match.month = plan->match.day = -1;
+    plan->match.game = 0;
+    plan->in_match_head = -1;
+    plan->first_date = plan->last_date = -1;
+    plan->in_order = 1;
+
+    /* A run that never reached plan_end() leaves its old files alone */
+    free_writer(plan);
+
+    for (int i = 0; i < plan->count; i++) {
+        Query *q = &plan->queries[i];
+
+        if (q->kind == QUERY_MATCHES_HISTORY) {
+            outbuf_free(&q->s.history.text);
+        }
+        memset(&q->s, 0, sizeof(q->s));
+        q->active = !q->done;
+        q->next_same_key = -1;
+        q->next_in_match = -1;
+
+        switch (q->kind) {
+            case QUERY_MATCHES_HISTORY:
+                q->s.history.match.year = -1;
+                plan->history_count++;
+                outputs += q->active;
+                break;
+            case QUERY_MOST_VALUABLE_PLAYER:
+                q->s.mvp.max_combined_score = -1.0;
+                dated++;
+                break;
+            case QUERY_AVERAGE_POINTS:
+                named++;
+                break;
+            case QUERY_PLAYER_REPORT:
+                named++;
+                outputs += q->active;
+                break;
+            case QUERY_BEST_WINNING_MATCH:
+                q->s.best_win.best_difference = -1;
+                q->s.best_win.best_home_score = -1;
+                plan->match_count++;
+                break;
+            case QUERY_BEST_MONTH:
+                plan->match_count++;
+                break;
+        }
+    }
+
+    /* Allocate routing tables (sized for every query; fine if some are inactive) */
+    plan->history_ids = arena_alloc(&plan->run, (size_t)(plan->history_count + 1) * sizeof(int));
+    plan->match_ids = arena_alloc(&plan->run, (size_t)(plan->match_count + 1) * sizeof(int));
+    plan->name_mask = table_mask(named);
+    plan->date_mask = table_mask(dated);
+    plan->name_heads = named ? arena_alloc(&plan->run, (plan->name_mask + 1) * sizeof(int)) : NULL;
+    plan->date_heads = dated ? arena_alloc(&plan->run, (plan->date_mask + 1) * sizeof(int)) : NULL;
+    if (plan->history_ids == NULL || plan->match_ids == NULL ||
+        (named && plan->name_heads == NULL) || (dated && plan->date_heads == NULL)) {
+        free_routing(plan);
+        return NO_MEMORY;
+    }
+    for (size_t i = 0; named && i <= plan->name_mask; i++) {
+        plan->name_heads[i] = -1;
+    }
+    for (size_t i = 0; dated && i <= plan->date_mask; i++) {
+        plan->date_heads[i] = -1;
+    }
+    plan->history_count = 0;
+    plan->match_count = 0;
+
+    /* Many output files: let a thread make the write() calls */
+    if (writer_init(&plan->writer, outputs >= PLAN_ASYNC_OUTPUTS) != SUCCESS) {
+        free_routing(plan);
+        return NO_MEMORY;
+    }
+    plan->writer_ready = 1;
+
+    /* Route every active query */
+    for (int i = 0; i < plan->count; i++) {
+        Query *q = &plan->queries[i];
+        size_t slot;
+
+        if (!q->active) {
+            continue;
+        }
+
+        switch (q->kind) {
+            case QUERY_MATCHES_HISTORY:
+                q->result = outfile_open(&plan->writer, q->out_file, &q->file);
+                if (q->result != SUCCESS) {
+                    q->file = NULL;
+                    q->active = 0;
+                    break;
+                }
+                plan->history_ids[plan->history_count++] = i;
+                break;
+            case QUERY_MOST_VALUABLE_PLAYER:
+                slot = hash_date(q->year, q->month, q->day) & plan->date_mask;
+                q->next_same_key = plan->date_heads[slot];
+                plan->date_heads[slot] = i;
+                break;
+            case QUERY_AVERAGE_POINTS:
+            case QUERY_PLAYER_REPORT:
+                slot = intern_hash(q->player_name, q->player_len) & plan->name_mask;
+                q->next_same_key = plan->name_heads[slot];
+                plan->name_heads[slot] = i;
+                break;
+            case QUERY_BEST_WINNING_MATCH:
+            case QUERY_BEST_MONTH:
+                plan->match_ids[plan->match_count++] = i;
+                break;
+        }
+    }
+
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: plan_bind
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - A column file stores each name once; hashing and comparing each
+ *   dictionary entry once replaces a hash and a compare per record
+ * - Afterwards, "is this the player?" is an integer compare
+ * - Only names the scan will read are bound (a column that is not
+ *   decoded leaves its id unset)
+ */
+int plan_bind(QueryPlan *plan, const RecordReader *rd) {
+    unsigned fields = plan_fields(plan);
+    uint32_t players = reader_name_count(rd, READER_PLAYERS);
+    uint32_t teams = reader_name_count(rd, READER_TEAMS);
+    const char *name;
+    size_t len;
+
+    if ((fields & FIELD_TEAM) && teams > 0) {
+        plan->home_teams = arena_alloc(&plan->run, teams);
+        if (plan->home_teams == NULL) {
+            return NO_MEMORY;
+        }
+        for (uint32_t t = 0; t < teams; t++) {
+            name = reader_name(rd, READER_TEAMS, t, &len);
+            plan->home_teams[t] = (unsigned char)field_equals(name, len, plan->team_name,
+                                                              plan->team_len);
+        }
+    }
+
+    if ((fields & FIELD_PLAYER) && plan->name_heads != NULL && players > 0) {
+        plan->player_routes = arena_alloc(&plan->run, (size_t)players * sizeof(int));
+        if (plan->player_routes == NULL) {
+            return NO_MEMORY;
+        }
+        for (int i = 0; i < plan->count; i++) {
+            plan->queries[i].player_id = RECORD_NO_ID;
+        }
+        for (uint32_t p = 0; p < players; p++) {
+            int head;
+
+            name = reader_name(rd, READER_PLAYERS, p, &len);
+            head = plan->name_heads[intern_hash(name, len) & plan->name_mask];
+            plan->player_routes[p] = -1;
+            for (int id = head; id >= 0; id = plan->queries[id].next_same_key) {
+                Query *q = &plan->queries[id];
+
+                if (field_equals(name, len, q->player_name, q->player_len)) {
+                    q->player_id = p;
+                    plan->player_routes[p] = head;
+                }
+            }
+        }
+    }
+    return SUCCESS;
+}
+
+/*
+ * Workers remember each minutes value: float sums depend on the order
+ * of the additions, so plan_merge() replays them in file order.
+ */
+static void log_minutes(QueryPlan *plan, Query *q, float minutes) {
+    if (q->s.report.minutes_count == q->s.report.minutes_capacity) {
+        size_t capacity = q->s.report.minutes_capacity ? q->s.report.minutes_capacity * 2 : 64;
+        float *grown = realloc(q->s.report.minutes, capacity * sizeof(float));
+        if (grown == NULL) {
+            plan->feed_status = NO_MEMORY;
+            return;
+        }
+        q->s.report.minutes = grown;
+        q->s.report.minutes_capacity = capacity;
+    }
+    q->s.report.minutes[q->s.report.minutes_count++] = minutes;
+}
+
+/* ============================================================
+ * FUNCTION: plan_feed
+ * ============================================================
+ * Hands one record to every query that cares about it.
+ */
+void plan_feed(QueryPlan *plan, const GameRecord *rec) {
+    if (plan->ranged) {
+        long long date = pack_date(rec->year, rec->month, rec->day);
+
+        if (date < plan->last_date) {
+            plan->in_order = 0;
+        }
+        if (plan->first_date < 0) {
+            plan->first_date = date;
+        }
+        plan->last_date = date;
+        if (date < plan->range_from || date > plan->range_to) {
+            return;
+        }
+    }
+
+    STATS_START(start);
+    int home_row = is_home_team(plan, rec);
+    int id;
+
+    for (int i = 0; i < plan->history_count; i++) {
+        history_feed(&plan->queries[plan->history_ids[i]], rec, home_row, plan->team_name);
+    }
+
+    if (plan->date_heads != NULL) {
+        size_t slot = hash_date(rec->year, rec->month, rec->day) & plan->date_mask;
+        for (id = plan->date_heads[slot]; id >= 0; id = plan->queries[id].next_same_key) {
+            mvp_feed(&plan->queries[id], rec);
+        }
+    }
+
+    /* Shared match tracking: a new date closes the previous match */
+    if (!same_date(&plan->match, rec)) {
+        close_shared_match(plan);
+        start_match(&plan->match, rec);
+    }
+    if (home_row) {
+        plan->match.home_score += rec->points;
+    } else {
+        plan->match.opponent_score += rec->points;
+    }
+
+    if (plan->name_heads != NULL) {
+        if (plan->player_routes != NULL) {
+            id = plan->player_routes[rec->player_id];
+        } else {
+            id = plan->name_heads[intern_hash(rec->player, rec->player_len) & plan->name_mask];
+        }
+        for (; id >= 0; id = plan->queries[id].next_same_key) {
+            Query *q = &plan->queries[id];
+
+            if (plan->player_routes != NULL
+                    ? q->player_id != rec->player_id
+                    : !field_equals(rec->player, rec->player_len, q->player_name, q->player_len)) {
+                continue;
+            }
+
+            if (q->kind == QUERY_AVERAGE_POINTS) {
+                q->s.average.total_points += rec->points;
+                q->s.average.match_count++;
+            } else if (home_row) {
+                /* Player reports only count the home team's rows */
+                q->s.report.total_points += rec->points;
+                q->s.report.total_assists += rec->assists;
+                q->s.report.total_blocks += rec->blocks;
+                q->s.report.total_minutes += rec->minutes;
+                q->s.report.games_played++;
+                if (plan->worker) {
+                    log_minutes(plan, q, rec->minutes);
+                }
+                if (!q->s.report.player_in_this_match) {
+                    q->s.report.player_in_this_match = 1;
+                    q->next_in_match = plan->in_match_head;
+                    plan->in_match_head = id;
+                }
+            }
+        }
+    }
+    STATS_STOP(STATS_AGGREGATE, start);
+}
+
+/* ============================================================
+ * FUNCTION: plan_end
+ * ============================================================
+ * On SUCCESS, closes the last match and produces every result.
+ * On an error, every active query gets that error code (history files
+ * keep the lines written so far, as they always have).
+ * Returns once every output file is written; a file that could not be
+ * written turns its query's result into FILE_WRITE_ERR or NO_MEMORY.
+ */
+void plan_end(QueryPlan *plan, int status) {
+    if (status == SUCCESS) {
+        close_shared_match(plan);
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        Query *q = &plan->queries[i];
+
+        if (!q->active) {
+            continue;
+        }
+
+        if (status != SUCCESS) {
+            q->result = status;
+        } else {
+            switch (q->kind) {
+                case QUERY_MATCHES_HISTORY:
+                    history_end(q, plan->team_name);
+                    break;
+                case QUERY_MOST_VALUABLE_PLAYER:
+                    q->result = q->s.mvp.found_match ? q->s.mvp.max_combined_score
+                                                     : (double)NO_DATA_POINTS;
+                    break;
+                case QUERY_AVERAGE_POINTS:
+                    q->result = q->s.average.match_count == 0
+                        ? (double)NO_DATA_POINTS
+                        : (double)q->s.average.total_points / (double)q->s.average.match_count;
+                    break;
+                case QUERY_BEST_WINNING_MATCH:
+                    q->result = q->s.best_win.found_win ? q->s.best_win.best_home_score
+                                                        : NO_DATA_POINTS;
+                    break;
+                case QUERY_BEST_MONTH:
+                    best_month_end(q);
+                    break;
+                case QUERY_PLAYER_REPORT:
+                    report_end(plan, q);
+                    break;
+            }
+        }
+
+        if (q->kind == QUERY_MATCHES_HISTORY && q->file != NULL) {
+            outfile_close(q->file, &q->s.history.text);
+        }
+        q->active = 0;
+    }
+
+    /* Wait for the writes, then look at how they went */
+    if (plan->writer_ready) {
+        writer_finish(&plan->writer);
+        for (int i = 0; i < plan->count; i++) {
+            Query *q = &plan->queries[i];
+
+            if (q->file != NULL && outfile_status(q->file) != SUCCESS &&
+                (q->result == SUCCESS || q->result == NO_DATA_POINTS)) {
+                q->result = outfile_status(q->file);
+            }
+        }
+    }
+    free_writer(plan);
+    free_routing(plan);
+}
+
+/* ============================================================
+ * FUNCTION: plan_fields
+ * ============================================================
+ * The record fields the active queries read (FIELD_* bits).
+ */
+unsigned plan_fields(const QueryPlan *plan) {
+    unsigned fields = 0;
+
+    for (int i = 0; i < plan->count; i++) {
+        switch (plan->queries[i].done ? -1 : (int)plan->queries[i].kind) {
+            case QUERY_MATCHES_HISTORY:
+            case QUERY_BEST_WINNING_MATCH:
+            case QUERY_BEST_MONTH:
+                fields |= FIELD_DATE | FIELD_TEAM | FIELD_POINTS;
+                break;
+            case QUERY_MOST_VALUABLE_PLAYER:
+                fields |= FIELD_DATE | FIELD_POINTS | FIELD_ASSISTS | FIELD_BLOCKS | FIELD_MINUTES;
+                break;
+            case QUERY_AVERAGE_POINTS:
+                fields |= FIELD_PLAYER | FIELD_POINTS;
+                break;
+            case QUERY_PLAYER_REPORT:
+                fields |= FIELD_ALL;
+                break;
+            default:
+                break;
+        }
+    }
+    if (plan->ranged && fields != 0) {
+        fields |= FIELD_DATE;
+    }
+    return fields;
+}
+
+/* ============================================================
+ * FUNCTION: plan_point_lookups_only
+ * ============================================================
+ * An index only helps when every active query is a point lookup
+ * (MVP for one date, average for one player).
+ */
+int plan_point_lookups_only(const QueryPlan *plan) {
+    int any_active = 0;
+
+    for (int i = 0; i < plan->count; i++) {
+        const Query *q = &plan->queries[i];
+
+        if (q->done) {
+            continue;
+        }
+        if (q->kind != QUERY_MOST_VALUABLE_PLAYER && q->kind != QUERY_AVERAGE_POINTS) {
+            return 0;
+        }
+        any_active = 1;
+    }
+    return any_active;
+}
+
+/* ============================================================
+ * FUNCTION: plan_match_level_only
+ * ============================================================
+ * These queries only need each team's total in each match.
+ */
+int plan_match_level_only(const QueryPlan *plan) {
+    int any_active = 0;
+
+    for (int i = 0; i < plan->count; i++) {
+        const Query *q = &plan->queries[i];
+
+        if (q->done) {
+            continue;
+        }
+        if (q->kind != QUERY_MATCHES_HISTORY && q->kind != QUERY_BEST_WINNING_MATCH &&
+            q->kind != QUERY_BEST_MONTH) {
+            return 0;
+        }
+        any_active = 1;
+    }
+    return any_active;
+}
+
+/* ============================================================
+ * FUNCTIONS: plan_resumable / plan_snapshot / plan_restore
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Between two plan_feed() calls, a best-month, average or report
+ *   query is nothing but counters plus the open match: copying them
+ *   out and back in pauses and resumes the scan
+ * - The minutes total is saved bit for bit (float sums depend on the
+ *   order of the additions; resuming continues that exact order)
+ */
+int plan_resumable(const QueryPlan *plan) {
+    int any_active = 0;
+
+    if (plan->ranged) {
+        return 0;  /* a snapshot does not record the window */
+    }
+    if (plan->lenient) {
+        return 0;  /* nor which lines were skipped */
+    }
+
+    for (int i = 0; i < plan->count; i++) {
+        const Query *q = &plan->queries[i];
+
+        if (q->done) {
+            continue;
+        }
+        if (q->kind != QUERY_BEST_MONTH && q->kind != QUERY_AVERAGE_POINTS &&
+            q->kind != QUERY_PLAYER_REPORT) {
+            return 0;
+        }
+        any_active = 1;
+    }
+    return any_active;
+}
+
+void plan_snapshot(const QueryPlan *plan, int id, QuerySnapshot *snap) {
+    const Query *q = &plan->queries[id];
+
+    memset(snap, 0, sizeof(*snap));
+    snap->match = plan->match;
+
+    switch (q->kind) {
+        case QUERY_BEST_MONTH:
+            memcpy(snap->values, q->s.best_month.wins, sizeof(q->s.best_month.wins));
+            memcpy(snap->values + 12, q->s.best_month.total_games,
+                   sizeof(q->s.best_month.total_games));
+            break;
+        case QUERY_AVERAGE_POINTS:
+            snap->values[0] = q->s.average.total_points;
+            snap->values[1] = q->s.average.match_count;
+            break;
+        case QUERY_PLAYER_REPORT:
+            snap->values[0] = q->s.report.total_points;
+            snap->values[1] = q->s.report.total_assists;
+            snap->values[2] = q->s.report.total_blocks;
+            memcpy(&snap->values[3], &q->s.report.total_minutes, sizeof(float));
+            snap->values[4] = q->s.report.games_played;
+            snap->values[5] = q->s.report.games_won;
+            snap->in_match = q->s.report.player_in_this_match;
+            break;
+        default:
+            break;
+    }
+}
+
+void plan_restore(QueryPlan *plan, int id, const QuerySnapshot *snap) {
+    Query *q = &plan->queries[id];
+
+    plan->match = snap->match;
+
+    switch (q->kind) {
+        case QUERY_BEST_MONTH:
+            memcpy(q->s.best_month.wins, snap->values, sizeof(q->s.best_month.wins));
+            memcpy(q->s.best_month.total_games, snap->values + 12,
+                   sizeof(q->s.best_month.total_games));
+            break;
+        case QUERY_AVERAGE_POINTS:
+            q->s.average.total_points = snap->values[0];
+            q->s.average.match_count = snap->values[1];
+            break;
+        case QUERY_PLAYER_REPORT:
+            q->s.report.total_points = snap->values[0];
+            q->s.report.total_assists = snap->values[1];
+            q->s.report.total_blocks = snap->values[2];
+            memcpy(&q->s.report.total_minutes, &snap->values[3], sizeof(float));
+            q->s.report.games_played = snap->values[4];
+            q->s.report.games_won = snap->values[5];
+            /* Back on the open match's list, so its result still counts */
+            if (snap->in_match && !q->s.report.player_in_this_match) {
+                q->s.report.player_in_this_match = 1;
+                q->next_in_match = plan->in_match_head;
+                plan->in_match_head = id;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: feed_from_index
+ * ============================================================
+ * Reads only the records the index points at, in file order, so
+ * every query sees the same records in the same order as a full scan.
+ * Spans are sorted by start; `done` is where reading last stopped, so
+ * a record covered by two spans is fed once.
+ */
+static int feed_from_index(QueryPlan *plan, RecordReader *rd, GameRecord *rec,
+                           const FileIndex *ix) {
+    IndexSpanList *list = &plan->spans;
+    long long done = 0;
+    int status = SUCCESS;
+
+    for (int i = 0; i < plan->count && status == SUCCESS; i++) {
+        const Query *q = &plan->queries[i];
+
+        if (!q->active) {
+            continue;
+        }
+        if (q->kind == QUERY_MOST_VALUABLE_PLAYER) {
+            status = index_add_date(ix, q->year, q->month, q->day, list);
+        } else {
+            status = index_add_player(ix, q->player_name, q->player_len, list);
+        }
+    }
+    index_sort_spans(list);
+
+    for (size_t i = 0; i < list->count && status == SUCCESS; i++) {
+        const IndexSpan *span = &list->spans[i];
+        long long start = span->start > done ? span->start : done;
+
+        if (start >= span->end) {
+            continue;
+        }
+        if (reader_seek(rd, start) != SUCCESS) {
+            status = FILE_READ_ERR;
+            break;
+        }
+        while (reader_tell(rd) < span->end) {
+            int got = plan_next(plan, rd, rec);
+            if (got != RECORD_OK) {
+                if (got != RECORD_EOF) {
+                    status = got;
+                }
+                break;
+            }
+            plan_feed(plan, rec);
+        }
+        done = reader_tell(rd);
+    }
+
+    list->count = 0;  /* the array stays for the next run */
+    return status;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: feed_from_matches
+ * ============================================================
+ * Feeds one record per side of each match: the team and its total
+ * points. The match-level queries only add up points per team and
+ * take the first other team's name, so they reach the same results
+ * as with every player row.
+ */
+static void feed_from_matches(QueryPlan *plan, const MatchTable *mt, GameRecord *rec) {
+    MatchRow row;
+
+    rec->player = "";
+    rec->player_len = 0;
+    rec->player_id = RECORD_NO_ID;
+    rec->team_id = RECORD_NO_ID;
+    for (uint64_t i = 0; i < mt->match_count; i++) {
+        match_table_row(mt, i, &row);
+        rec->year = row.year;
+        rec->month = row.month;
+        rec->day = row.day;
+        for (uint32_t side = 0; side < row.sides; side++) {
+            rec->team = match_table_side(mt, row.first_side + side, &rec->team_len,
+                                         &rec->points);
+            plan_feed(plan, rec);
+        }
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: feed_window
+ * ============================================================
+ * The file is known to be in date order: jump to the first record of
+ * the window and stop at the first record after it.
+ */
+static int feed_window(QueryPlan *plan, RecordReader *rd, GameRecord *rec) {
+    long long from = plan->range_from;
+    int status = reader_seek_date(rd, (int)(from >> 9), (int)((from >> 5) & 15), (int)(from & 31));
+
+    if (status != SUCCESS) {
+        return status;
+    }
+    while ((status = plan_next(plan, rd, rec)) == RECORD_OK) {
+        if (pack_date(rec->year, rec->month, rec->day) > plan->range_to) {
+            return SUCCESS;
+        }
+        plan_feed(plan, rec);
+    }
+    return status == RECORD_EOF ? SUCCESS : status;
+}
+
+/* ============================================================
+ * FUNCTION: plan_feed_reader
+ * ============================================================
+ * The scan loop of plan_run(), also used for each file of a sharded
+ * run (shard_scan.c).
+ */
+int plan_feed_reader(QueryPlan *plan, RecordReader *rd) {
+    GameRecord rec;
+    int status;
+
+    memset(&rec, 0, sizeof(rec));
+    if (plan->ranged && reader_known_sorted(rd)) {
+        return feed_window(plan, rd, &rec);
+    }
+
+    while ((status = plan_next(plan, rd, &rec)) == RECORD_OK) {
+        plan_feed(plan, &rec);
+    }
+    if (status == RECORD_EOF) {
+        status = SUCCESS;
+    }
+    if (status == SUCCESS && plan->ranged && plan->in_order && plan->bad.skipped == 0) {
+        reader_remember_sorted(rd);
+    }
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: plan_run
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - One reader, one loop, many queries
+ * - Works the same on text files and column files (record_reader.c)
+ * - The input is not even opened if every query was answered early
+ * - Point lookups use an up-to-date index (file_index.h) when there
+ *   is one, and read only the matching records
+ * - Match-level queries use an up-to-date match table (match_table.h)
+ *   when there is one, and do not open the data file at all
+ */
+int plan_run(QueryPlan *plan, const char *in_file) {
+    RecordReader rd;
+    GameRecord rec;
+    FileIndex ix;
+    MatchTable mt;
+    int use_index = 0;
+    int use_table = 0;
+    int status;
+    int any_active = 0;
+
+    plan->error.code = SUCCESS;
+    plan->error.line = 0;
+    plan->error.offset = 0;
+    memset(&plan->bad, 0, sizeof(plan->bad));
+
+    for (int i = 0; i < plan->count; i++) {
+        if (!plan->queries[i].done) {
+            any_active = 1;
+        }
+    }
+    if (!any_active) {
+        return SUCCESS;
+    }
+
+    if (plan_match_level_only(plan) && match_table_open(&mt, in_file) == SUCCESS) {
+        use_table = 1;
+        status = SUCCESS;
+    } else {
+        status = reader_open(&rd, in_file);
+    }
+    if (status == SUCCESS) {
+        status = plan_begin(plan);
+        if (status != SUCCESS && use_table) {
+            match_table_close(&mt);
+        } else if (status != SUCCESS) {
+            reader_close(&rd);
+        }
+    }
+    if (status != SUCCESS) {
+        for (int i = 0; i < plan->count; i++) {
+            if (!plan->queries[i].done) {
+                plan->queries[i].result = status;
+            }
+        }
+        return status;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    if (use_table) {
+        feed_from_matches(plan, &mt, &rec);
+        match_table_close(&mt);
+        plan_end(plan, SUCCESS);
+        return SUCCESS;
+    }
+
+    /* Column files then only decode the columns these queries use */
+    reader_set_fields(&rd, plan_fields(plan));
+    status = plan_bind(plan, &rd);
+    if (status != SUCCESS) {
+        reader_close(&rd);
+        plan_end(plan, status);
+        return status;
+    }
+
+    if (plan_point_lookups_only(plan) && rd.map != NULL && index_open(&ix, in_file) == SUCCESS) {
+        use_index = 1;
+    }
+
+    if (use_index) {
+        status = feed_from_index(plan, &rd, &rec, &ix);
+        index_close(&ix);
+    } else {
+        status = plan_feed_reader(plan, &rd);
+    }
+
+    if (status != SUCCESS) {
+        plan->error.code = status;
+        plan->error.line = rd.err_line;
+        plan->error.offset = rd.err_offset;
+    }
+    reader_close(&rd);
+
+    plan_end(plan, status);
+    return status;
+}
+
+/* ============================================================
+ * FUNCTIONS: plan_result / plan_parse_error
+ * ============================================================
+ */
+double plan_result(const QueryPlan *plan, int id) {
+    if (id < 0 || id >= plan->count) {
+        return (double)NO_MEMORY;
+    }
+    return plan->queries[id].result;
+}
+
+ParseError plan_parse_error(const QueryPlan *plan) {
+    return plan->error;
+}
+
+/* ============================================================
+ * FUNCTION: plan_fork
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - A struct copy shares the read-only parts (parameters, routing)
+ * - Only the per-query state is duplicated
+ * - History lines stay in the worker's OutBuf until plan_merge()
+ */
+int plan_fork(const QueryPlan *plan, QueryPlan *worker) {
+    *worker = *plan;
+    worker->worker = 1;
+    worker->first_closed = 0;
+    worker->feed_status = SUCCESS;
+    worker->match.year = worker->match.month = worker->match.day = -1;
+    worker->in_match_head = -1;
+    worker->first_date = worker->last_date = -1;
+    worker->in_order = 1;
+    memset(&worker->bad, 0, sizeof(worker->bad));
+    memset(&worker->stats, 0, sizeof(worker->stats));
+
+    /* The worker reads plan's arenas; only a plan_bind() on it allocates (in its run) */
+    arena_init(&worker->arena, 0);
+    arena_init(&worker->run, 0);
+    memset(&worker->spans, 0, sizeof(worker->spans));
+
+    worker->queries = malloc((size_t)(plan->count + 1) * sizeof(Query));
+    if (worker->queries == NULL) {
+        return NO_MEMORY;
+    }
+    memcpy(worker->queries, plan->queries, (size_t)plan->count * sizeof(Query));
+
+    /* The writer and the output files stay with plan */
+    worker->writer_ready = 0;
+    for (int i = 0; i < plan->count; i++) {
+        Query *q = &worker->queries[i];
+
+        q->file = NULL;
+        if (q->kind != QUERY_MATCHES_HISTORY) {
+            continue;
+        }
+        outbuf_init(&q->s.history.text);
+        q->s.history.hold_first = 1;
+        q->s.history.header_written = 1;  /* plan_merge() writes it */
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: plan_discard
+ * ============================================================
+ */
+void plan_discard(QueryPlan *worker) {
+    for (int i = 0; i < worker->count; i++) {
+        Query *q = &worker->queries[i];
+
+        if (q->kind == QUERY_MATCHES_HISTORY) {
+            outbuf_free(&q->s.history.text);
+        } else if (q->kind == QUERY_PLAYER_REPORT) {
+            free(q->s.report.minutes);
+        }
+    }
+    free(worker->queries);
+    worker->queries = NULL;
+    worker->count = 0;
+    arena_free(&worker->run);    /* its own plan_bind() tables, if any */
+
+    /* A worker that was not merged still did the work */
+    stats_absorb(&worker->stats);
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: plan_merge
+ * ============================================================
+ */
+static int same_match(const MatchState *a, const MatchState *b) {
+    return a->year == b->year && a->month == b->month && a->day == b->day &&
+           a->game == b->game;
+}
+
+/*
+ * Adds the worker's held-back first match to the history's open match
+ * (or closes the open one and starts over), then appends the matches
+ * the worker finished itself.
+ */
+static void history_merge(Query *q, Query *w, const char *team) {
+    const MatchState *first;
+    const char *first_opponent;
+
+    if (!w->s.history.found_data) {
+        return;
+    }
+    first = w->s.history.first_closed ? &w->s.history.first : &w->s.history.match;
+    first_opponent = w->s.history.first_closed ? w->s.history.first_opponent
+                                               : w->s.history.opponent_name;
+
+    if (same_match(&q->s.history.match, first)) {
+        q->s.history.match.home_score += first->home_score;
+        q->s.history.match.opponent_score += first->opponent_score;
+        if (q->s.history.opponent_name[0] == '\0') {
+            memcpy(q->s.history.opponent_name, first_opponent, MAX_NAME_LENGTH);
+        }
+    } else {
+        history_close_match(q, team);
+        q->s.history.match = *first;
+        memcpy(q->s.history.opponent_name, first_opponent, MAX_NAME_LENGTH);
+    }
+    q->s.history.found_data = 1;
+
+    if (w->s.history.first_closed) {
+        history_close_match(q, team);
+        out_text(&q->s.history.text, w->s.history.text.data, w->s.history.text.len);
+        q->s.history.text.failed |= w->s.history.text.failed;
+        outfile_chunk(q->file, &q->s.history.text);
+        q->s.history.wins += w->s.history.wins;
+        q->s.history.losses += w->s.history.losses;
+        q->s.history.match = w->s.history.match;
+        memcpy(q->s.history.opponent_name, w->s.history.opponent_name, MAX_NAME_LENGTH);
+    }
+}
+
+/* Adds the worker's reports in its first (or open) match to the plan's open match */
+static void join_match_players(QueryPlan *plan, const QueryPlan *worker, int first) {
+    for (int i = 0; i < plan->count; i++) {
+        const Query *w = &worker->queries[i];
+        Query *q = &plan->queries[i];
+
+        if (!q->active || q->kind != QUERY_PLAYER_REPORT) {
+            continue;
+        }
+        if ((first ? w->s.report.in_first_match : w->s.report.player_in_this_match) &&
+            !q->s.report.player_in_this_match) {
+            q->s.report.player_in_this_match = 1;
+            q->next_in_match = plan->in_match_head;
+            plan->in_match_head = i;
+        }
+    }
+}
+
+/* Same idea as history_merge() for the shared match */
+static void shared_match_merge(QueryPlan *plan, const QueryPlan *worker) {
+    const MatchState *first;
+
+    if (!worker->first_closed && worker->match.year == -1) {
+        return;  /* empty chunk */
+    }
+    first = worker->first_closed ? &worker->first_match : &worker->match;
+
+    if (same_match(&plan->match, first)) {
+        plan->match.home_score += first->home_score;
+        plan->match.opponent_score += first->opponent_score;
+    } else {
+        close_shared_match(plan);
+        plan->match = *first;
+    }
+    join_match_players(plan, worker, worker->first_closed);
+
+    if (worker->first_closed) {
+        close_shared_match(plan);
+        plan->match = worker->match;
+        join_match_players(plan, worker, 0);
+    }
+}
+
+/* ============================================================
+ * FUNCTION: plan_merge
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Sums, counts and maximums merge in any order
+ * - History lines and float sums depend on order, so workers must be
+ *   merged in file order
+ * - Only a chunk's first match can straddle the boundary with the
+ *   previous chunk; everything after it is complete
+ */
+void plan_merge(QueryPlan *plan, QueryPlan *worker) {
+    /* Still in date order across the chunk boundary? */
+    if (worker->first_date >= 0) {
+        if (!worker->in_order || worker->first_date < plan->last_date) {
+            plan->in_order = 0;
+        }
+        plan->last_date = worker->last_date;
+    }
+
+    /* Bad records were logged in file order within the chunk */
+    for (int i = 0; i < worker->bad.count; i++) {
+        log_bad(&plan->bad, &worker->bad.first[i]);
+    }
+    plan->bad.skipped += worker->bad.skipped - worker->bad.count;
+    stats_absorb(&worker->stats);
+
+    for (int i = 0; i < plan->count; i++) {
+        Query *q = &plan->queries[i];
+        Query *w = &worker->queries[i];
+
+        if (!q->active) {
+            continue;
+        }
+
+        switch (q->kind) {
+            case QUERY_MATCHES_HISTORY:
+                history_merge(q, w, plan->team_name);
+                break;
+            case QUERY_MOST_VALUABLE_PLAYER:
+                if (w->s.mvp.found_match) {
+                    q->s.mvp.found_match = 1;
+                    if (w->s.mvp.max_combined_score > q->s.mvp.max_combined_score) {
+                        q->s.mvp.max_combined_score = w->s.mvp.max_combined_score;
+                    }
+                }
+                break;
+            case QUERY_AVERAGE_POINTS:
+                q->s.average.total_points += w->s.average.total_points;
+                q->s.average.match_count += w->s.average.match_count;
+                break;
+            case QUERY_BEST_WINNING_MATCH:
+                if (w->s.best_win.found_win &&
+                    (w->s.best_win.best_difference > q->s.best_win.best_difference ||
+                     (w->s.best_win.best_difference == q->s.best_win.best_difference &&
+                      w->s.best_win.best_home_score > q->s.best_win.best_home_score))) {
+                    q->s.best_win.best_difference = w->s.best_win.best_difference;
+                    q->s.best_win.best_home_score = w->s.best_win.best_home_score;
+                    q->s.best_win.found_win = 1;
+                }
+                break;
+            case QUERY_BEST_MONTH:
+                for (int m = 0; m < 12; m++) {
+                    q->s.best_month.wins[m] += w->s.best_month.wins[m];
+                    q->s.best_month.total_games[m] += w->s.best_month.total_games[m];
+                }
+                break;
+            case QUERY_PLAYER_REPORT:
+                q->s.report.total_points += w->s.report.total_points;
+                q->s.report.total_assists += w->s.report.total_assists;
+                q->s.report.total_blocks += w->s.report.total_blocks;
+                for (size_t k = 0; k < w->s.report.minutes_count; k++) {
+                    q->s.report.total_minutes += w->s.report.minutes[k];
+                }
+                q->s.report.games_played += w->s.report.games_played;
+                q->s.report.games_won += w->s.report.games_won;
+                break;
+        }
+    }
+
+    shared_match_merge(plan, worker);
+}
@@ -0,0 +1,437 @@
+/*
+ * query_plan.h - Run many hw2 queries in one pass over a game data file
+ *
+ * This file contains:
+ * - The Query and QueryPlan structures
+ * - Functions to add queries to a plan and run it
+ *
+ * Learning Concepts:
+ * - Turning a loop body into a "state machine" that is fed one record
+ *   at a time, so several of them can share a single scan
+ * - Hash tables for routing records only to the queries that need them
+ * - Arenas (arena.h) for the plan's own memory, so a plan that is
+ *   reset and reused stops calling malloc()
+ */
+
+#ifndef QUERY_PLAN_H
+#define QUERY_PLAN_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hw2.h"
+#include "record_reader.h"
+#include "output_writer.h"
+#include "file_index.h"
+#include "arena.h"
+#include "stats.h"
+
+/* ========== CONSTANTS ========== */
+#define PLAN_DEFAULT_TEAM "Purdue"   /* home team until plan_set_team() */
+#define PLAN_ASYNC_OUTPUTS 4         /* this many output files: write them on a thread */
+#define PLAN_ARENA_BLOCK   4096      /* most plans fit in one block per arena */
+
+/* ========== TYPES ========== */
+
+/* The six hw2.h queries */
+typedef enum {
+    QUERY_MATCHES_HISTORY,
+    QUERY_MOST_VALUABLE_PLAYER,
+    QUERY_AVERAGE_POINTS,
+    QUERY_BEST_WINNING_MATCH,
+    QUERY_BEST_MONTH,
+    QUERY_PLAYER_REPORT
+} QueryKind;
+
+/*
+ * Running totals of the match (one date and game) currently being read
+ */
+typedef struct {
+    int year, month, day;        /* -1 before the first record */
+    int game;                    /* GameRecord.game */
+    int home_score;              /* points of the plan's team */
+    int opponent_score;
+} MatchState;
+
+/*
+ * The running state of one resumable query between two plan_feed()
+ * calls (plan_snapshot / plan_restore)
+ */
+typedef struct {
+    MatchState match;            /* the plan's open match */
+    int in_match;                /* player report: player seen in it */
+    int values[24];              /* the query's counters */
+} QuerySnapshot;
+
+/*
+ * One query inside a plan. Treat as private; use plan_result().
+ */
+typedef struct {
+    QueryKind kind;
+    int done;                    /* result is final (bad parameters) */
+    int active;                  /* taking part in the current scan */
+    double result;               /* return value of the hw2.h function */
+
+    /* Parameters */
+    int year, month, day;
+    char *player_name;           /* copy in plan->arena, or NULL */
+    size_t player_len;
+    uint32_t player_id;          /* dictionary id of player_name (plan_bind) */
+    char *out_file;              /* copy in plan->arena, or NULL */
+
+    /* Routing: next query with the same player name / date */
+    int next_same_key;
+    /* Player reports in the current match: next one in the list */
+    int next_in_match;
+
+    /* History and report output while the plan runs (NULL in workers) */
+    OutFile *file;
+
+    /* Per-kind running state */
+    union {
+        struct {
+            OutBuf text;             /* lines not yet handed to the writer */
+            MatchState match;
+            char opponent_name[MAX_NAME_LENGTH];
+            int wins, losses;
+            int found_data;
+            int header_written;
+            /* Workers only (plan_fork): the first match is held back */
+            int hold_first;
+            int first_closed;
+            MatchState first;
+            char first_opponent[MAX_NAME_LENGTH];
+        } history;
+        struct {
+            double max_combined_score;
+            int found_match;
+        } mvp;
+        struct {
+            int total_points;
+            int match_count;
+        } average;
+        struct {
+            int best_difference;
+            int best_home_score;
+            int found_win;
+        } best_win;
+        struct {
+            int wins[12];
+            int total_games[12];
+        } best_month;
+        struct {
+            int total_points, total_assists, total_blocks;
+            float total_minutes;
+            int games_played, games_won;
+            int player_in_this_match;
+            /* Workers only: in the held-back first match; minutes in order */
+            int in_first_match;
+            float *minutes;
+            size_t minutes_count, minutes_capacity;
+        } report;
+    } s;
+} Query;
+
+/*
+ * A batch of queries answered by one scan.
+ *
+ * Typical use:
+ *   QueryPlan plan;
+ *   plan_init(&plan);
+ *   int a = plan_add_best_month(&plan);
+ *   int b = plan_add_player_report(&plan, "Z. Edey", "edey.txt");
+ *   plan_run(&plan, "game_data.txt");
+ *   printf("%d\n", (int)plan_result(&plan, a));
+ *   plan_free(&plan);
+ */
+typedef struct {
+    Query *queries;
+    int count, capacity;
+
+    /*
+     * arena: the queries, their strings and the team name (until
+     * plan_reset / plan_free). run: the routing tables below, rewound
+     * by every plan_begin().
+     */
+    Arena arena;
+    Arena run;
+    IndexSpanList spans;         /* index lookups; kept by plan_reset() */
+
+    /* Built by plan_begin(): which queries see which records */
+    int *history_ids;            /* every matches-history query */
+    int history_count;
+    int *match_ids;              /* best-winning-match and best-month queries */
+    int match_count;
+    int *name_heads;             /* player name hash -> first query id */
+    int *date_heads;             /* date hash -> first MVP query id */
+    size_t name_mask, date_mask;
+
+    /*
+     * Built by plan_bind() when the input has a name dictionary
+     * (column files): names are compared once per dictionary entry,
+     * and each record only needs its ids looked up
+     */
+    int *player_routes;          /* player id -> first query id, or -1 */
+    unsigned char *home_teams;   /* team id -> 1 for the home team */
+
+    /*
+     * Date window (plan_set_date_range): records outside it are
+     * skipped. While one is set, plan_feed() also checks whether the
+     * dates it is fed ever go down.
+     */
+    int ranged;
+    long long range_from, range_to;  /* year << 9 | month << 5 | day */
+    long long first_date, last_date; /* of the records fed, -1 before any */
+    int in_order;
+
+    /* The team whose matches are reported (plan_set_team) */
+    const char *team_name;       /* PLAN_DEFAULT_TEAM or a copy in arena */
+    size_t team_len;
+
+    /* Shared match tracking for the match-level queries */
+    MatchState match;
+    int in_match_head;           /* player reports seen in this match */
+
+    /*
+     * Set by plan_fork(). A worker sees one chunk of the file, so its
+     * first match may have started in the previous chunk: that match
+     * is held back in first_match for plan_merge() instead of closed.
+     */
+    int worker;
+    int first_closed;
+    MatchState first_match;
+    int feed_status;             /* NO_MEMORY if a worker ran out */
+
+    /* Writes the output files (plan_begin to plan_end) */
+    OutputWriter writer;
+    int writer_ready;
+
+    ParseError error;            /* where the last run stopped, if it did */
+
+    /* plan_set_lenient: bad text records are skipped and listed in bad */
+    int lenient;
+    BadRecordLog bad;
+
+    /* A worker thread's counters (stats.h), until plan_merge / plan_discard */
+    Hw2Stats stats;
+} QueryPlan;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * plan_init / plan_free
+ *
+ * Prepare an empty plan / release everything it owns.
+ */
+void plan_init(QueryPlan *plan);
+void plan_free(QueryPlan *plan);
+
+/*
+ * plan_reset
+ *
+ * Like plan_free() followed by plan_init(), but keeps the plan's
+ * arenas: the next queries added to the plan reuse the same memory.
+ */
+void plan_reset(QueryPlan *plan);
+
+/*
+ * plan_set_team
+ *
+ * Makes `team` the home team of every query in the plan (histories,
+ * best matches, best month and player reports count that team's rows
+ * where hw2.h counts Purdue's); NULL restores PLAN_DEFAULT_TEAM.
+ * Call before plan_run().
+ *
+ * Returns: SUCCESS, BAD_RECORD if team is empty or MAX_NAME_LENGTH
+ * long or more, or NO_MEMORY
+ */
+int plan_set_team(QueryPlan *plan, const char *team);
+
+/*
+ * plan_set_date_range
+ *
+ * Restricts every query in the plan to the records dated from
+ * from_year-from_month-from_day to to_year-to_month-to_day (both
+ * included): results are those of a file holding only those records,
+ * in the same order. Call before plan_run().
+ *
+ * The first full scan of a mapped file with a window set checks
+ * whether its dates never go down (and that it has no bad records);
+ * later runs on the unchanged file find the window by binary search
+ * (reader_seek_date) and stop after it. Checkpoints are not used
+ * (plan_resumable() is 0).
+ *
+ * Returns: SUCCESS, or BAD_DATE if a date is invalid or from is after to
+ */
+int plan_set_date_range(QueryPlan *plan, int from_year, int from_month, int from_day,
+                        int to_year, int to_month, int to_day);
+
+/*
+ * plan_set_lenient
+ *
+ * enabled = 1: plan_run() skips malformed lines and records with an
+ * invalid date or stat instead of stopping at the first one, and
+ * answers every query from the remaining records. The skipped records
+ * are counted, and the first BAD_RECORD_LOG_SIZE listed, in
+ * plan_bad_records(). Read errors and damaged column files still stop
+ * the scan. Checkpoints are not used (plan_resumable() is 0).
+ */
+void plan_set_lenient(QueryPlan *plan, int enabled);
+
+/*
+ * plan_bad_records
+ *
+ * The bad records the last run skipped (none unless lenient).
+ */
+const BadRecordLog *plan_bad_records(const QueryPlan *plan);
+
+/*
+ * plan_skip_bad
+ *
+ * For callers reading records themselves: after reader_next(rd)
+ * returned status, returns 1 if the plan is lenient and status is a
+ * bad text record (it is added to the plan's log; read on), else 0
+ * (status ends the input).
+ */
+int plan_skip_bad(QueryPlan *plan, const RecordReader *rd, int status);
+
+/*
+ * plan_add_*
+ *
+ * Add one query. Parameters mean the same as in hw2.h; strings are copied.
+ *
+ * Returns:
+ *   A query id (>= 0) for plan_result(), or NO_MEMORY
+ */
+int plan_add_matches_history(QueryPlan *plan, int year, const char *out_file);
+int plan_add_most_valuable_player(QueryPlan *plan, int year, int month, int day);
+int plan_add_average_points(QueryPlan *plan, const char *player_name);
+int plan_add_best_winning_match(QueryPlan *plan, int year, int month);
+int plan_add_best_month(QueryPlan *plan);
+int plan_add_player_report(QueryPlan *plan, const char *player_name, const char *out_file);
+
+/*
+ * plan_run
+ *
+ * Reads in_file once and answers every query. Output files are written
+ * as the scan finishes.
+ *
+ * in_file may be a text file or a column file (column_file.h).
+ * If every query is an MVP or average-points lookup and in_file has
+ * an up-to-date index (file_index.h), only the matching records are
+ * read. If every query is a history, best-winning-match or best-month
+ * query and in_file has an up-to-date match table (match_table.h),
+ * only the table is read.
+ *
+ * Returns:
+ *   SUCCESS, or the error that stopped the scan (FILE_READ_ERR,
+ *   BAD_RECORD, BAD_DATE unless lenient, NO_MEMORY). Per-query
+ *   results come from plan_result().
+ */
+int plan_run(QueryPlan *plan, const char *in_file);
+
+/*
+ * plan_result
+ *
+ * The value the matching hw2.h function would have returned
+ * (an error code, a score, a month, ...), as a double.
+ */
+double plan_result(const QueryPlan *plan, int id);
+
+/*
+ * plan_fields
+ *
+ * The GameRecord fields (FIELD_* bits) the plan's queries need.
+ */
+unsigned plan_fields(const QueryPlan *plan);
+
+/*
+ * plan_parse_error
+ *
+ * Where the last plan_run() found a bad record.
+ */
+ParseError plan_parse_error(const QueryPlan *plan);
+
+/*
+ * plan_begin / plan_feed / plan_end
+ *
+ * The three steps of plan_run(), for callers that produce records
+ * themselves. plan_end() takes the status that ended the input
+ * (SUCCESS or an error code) and writes all outputs.
+ * plan_begin() returns SUCCESS or NO_MEMORY.
+ *
+ * plan_bind() (optional, after plan_begin and reader_set_fields)
+ * resolves the plan's player and team names against rd's name
+ * dictionary, so plan_feed() compares ids instead of names. Only
+ * records read from that file may be fed afterwards. Returns SUCCESS
+ * (also for inputs without a dictionary) or NO_MEMORY.
+ */
+int plan_begin(QueryPlan *plan);
+int plan_bind(QueryPlan *plan, const RecordReader *rd);
+void plan_feed(QueryPlan *plan, const GameRecord *rec);
+void plan_end(QueryPlan *plan, int status);
+
+/*
+ * plan_feed_reader
+ *
+ * plan_feed()s every record of rd, the way plan_run() reads its file
+ * (a known-sorted file with a date window set is only read inside the
+ * window). Call between plan_begin() and plan_end(), or on a worker.
+ *
+ * Returns SUCCESS or the error that stopped the input; rd->err_line
+ * and rd->err_offset say where.
+ */
+int plan_feed_reader(QueryPlan *plan, RecordReader *rd);
+
+/*
+ * plan_point_lookups_only
+ *
+ * 1 if every active query is an MVP or average-points lookup (the
+ * queries an index can answer), else 0.
+ */
+int plan_point_lookups_only(const QueryPlan *plan);
+
+/*
+ * plan_match_level_only
+ *
+ * 1 if every active query is a matches-history, best-winning-match or
+ * best-month query (the queries a match table can answer), else 0.
+ */
+int plan_match_level_only(const QueryPlan *plan);
+
+/*
+ * plan_resumable / plan_snapshot / plan_restore
+ *
+ * Pause a scan and continue it later (see checkpoint.h).
+ * plan_resumable() is 1 if every active query is a best-month,
+ * average-points or player-report query (and no date window is set,
+ * and the plan is not lenient).
+ * Between plan_feed() calls,
+ * plan_snapshot() copies query id's state out; after plan_begin() on
+ * an equal plan, plan_restore() puts it back, and feeding the records
+ * that follow gives the same results as one uninterrupted scan.
+ */
+int plan_resumable(const QueryPlan *plan);
+void plan_snapshot(const QueryPlan *plan, int id, QuerySnapshot *snap);
+void plan_restore(QueryPlan *plan, int id, const QuerySnapshot *snap);
+
+/*
+ * plan_fork / plan_merge / plan_discard
+ *
+ * Split one scan across several workers (see parallel_scan.h).
+ * After plan_begin(plan), plan_fork() makes a worker that shares the
+ * plan's parameters and routing but has its own query state; feed it
+ * the records of one chunk with plan_feed(). Then plan_merge() each
+ * worker into plan IN FILE ORDER (matches that straddle two chunks
+ * are joined here), plan_discard() it, and finish with plan_end().
+ *
+ * A worker fed from another file than plan's may plan_bind() to
+ * that file's reader.
+ *
+ * plan_fork() returns SUCCESS or NO_MEMORY.
+ */
+int plan_fork(const QueryPlan *plan, QueryPlan *worker);
+void plan_merge(QueryPlan *plan, QueryPlan *worker);
+void plan_discard(QueryPlan *worker);
+
+#endif /* QUERY_PLAN_H */
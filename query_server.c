@@ -0,0 +1,459 @@
+/*
+ * query_server.c - Serve the hw2.h queries from loaded datasets
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. socket() / bind() / listen() / accept() on a Unix domain socket
+ * 2. One poll() loop for the listening socket, every client, inotify
+ *    and a "wake-up" pipe (the self-pipe trick: a signal handler or
+ *    another thread writes one byte to stop the loop)
+ * 3. A small cache of Datasets (dataset.h), checked against inotify
+ *    events instead of stat() before every query
+ * 4. Validating every byte count of a request before using it
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "hw2.h"
+#include "record_reader.h"
+#include "dataset.h"
+#include "query_server.h"
+
+/* Any change to a watched file makes its dataset stale */
+#define WATCH_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+
+/* ============================================================
+ * HELPER FUNCTION: socket_address
+ * ============================================================
+ * Fills a sockaddr_un; returns 0 if path does not fit in sun_path.
+ */
+static int socket_address(struct sockaddr_un *addr, const char *path) {
+    size_t len = strlen(path);
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (len == 0 || len >= sizeof(addr->sun_path)) {
+        return 0;
+    }
+    memcpy(addr->sun_path, path, len + 1);
+    return 1;
+}
+
+/* 1 if a server is answering on path */
+static int server_running(const struct sockaddr_un *addr) {
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    int running;
+
+    if (fd < 0) {
+        return 0;
+    }
+    running = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+    close(fd);
+    return running;
+}
+
+/* ============================================================
+ * FUNCTION: server_open
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - bind() fails if the socket file exists, even if nobody listens
+ *   on it any more: try to connect first, and remove it if that fails
+ * - umask(077) around bind() makes the socket usable by its owner only
+ */
+int server_open(QueryServer *srv, const char *socket_path) {
+    struct sockaddr_un addr;
+    mode_t old_mask;
+    int bound;
+
+    memset(srv, 0, sizeof(*srv));
+    srv->listen_fd = -1;
+    srv->inotify_fd = -1;
+    srv->wake[0] = srv->wake[1] = -1;
+    for (int i = 0; i < SERVER_MAX_FILES; i++) {
+        srv->files[i].watch = -1;
+        srv->files[i].status = FILE_READ_ERR;  /* nothing loaded */
+    }
+
+    if (socket_path == NULL) {
+        socket_path = SERVER_SOCKET;
+    }
+    if (!socket_address(&addr, socket_path) || server_running(&addr)) {
+        return FILE_WRITE_ERR;
+    }
+    unlink(socket_path);
+
+    srv->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (srv->listen_fd < 0) {
+        return FILE_WRITE_ERR;
+    }
+    old_mask = umask(077);
+    bound = bind(srv->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+    umask(old_mask);
+    if (!bound) {
+        server_close(srv);
+        return FILE_WRITE_ERR;
+    }
+    srv->socket_path = strdup(socket_path);
+    if (srv->socket_path == NULL) {
+        unlink(socket_path);
+        server_close(srv);
+        return NO_MEMORY;
+    }
+
+    srv->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (listen(srv->listen_fd, SOMAXCONN) != 0 || srv->inotify_fd < 0 ||
+        pipe2(srv->wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        server_close(srv);
+        return FILE_WRITE_ERR;
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: The dataset cache
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - The watch is added BEFORE the file is read, so a change made
+ *   while it loads is not missed
+ * - A file that could not be watched is treated as always stale
+ * - A failed load is cached too: every query on a file with a bad
+ *   record gets the same error without reading it again
+ */
+static void drop_dataset(QueryServer *srv, ServerFile *f) {
+    if (f->status == SUCCESS) {
+        dataset_close(&f->ds);
+    }
+    f->status = FILE_READ_ERR;
+    if (f->watch >= 0) {
+        inotify_rm_watch(srv->inotify_fd, f->watch);
+        f->watch = -1;
+    }
+}
+
+static void load_file(QueryServer *srv, ServerFile *f) {
+    f->watch = inotify_add_watch(srv->inotify_fd, f->path, WATCH_EVENTS);
+    f->stale = 0;
+    f->status = dataset_open(&f->ds, f->path, &f->err);
+    srv->loads++;
+}
+
+/* The cached dataset of path (loaded or reloaded as needed), or NULL */
+static ServerFile *get_file(QueryServer *srv, const char *path) {
+    ServerFile *f = NULL;
+
+    for (int i = 0; i < SERVER_MAX_FILES && f == NULL; i++) {
+        if (srv->files[i].path != NULL && strcmp(srv->files[i].path, path) == 0) {
+            f = &srv->files[i];
+        }
+    }
+
+    if (f != NULL) {
+        if (f->stale || f->watch < 0) {
+            drop_dataset(srv, f);
+            load_file(srv, f);
+        }
+    } else {
+        /* A free slot, or else the least recently used file */
+        f = &srv->files[0];
+        for (int i = 1; i < SERVER_MAX_FILES && f->path != NULL; i++) {
+            if (srv->files[i].path == NULL || srv->files[i].used < f->used) {
+                f = &srv->files[i];
+            }
+        }
+        drop_dataset(srv, f);
+        free(f->path);
+        f->path = strdup(path);
+        if (f->path == NULL) {
+            return NULL;
+        }
+        load_file(srv, f);
+    }
+    f->used = ++srv->clock;
+    return f;
+}
+
+/* Drains inotify: every file with an event is stale */
+static void read_events(QueryServer *srv) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t got;
+
+    while ((got = read(srv->inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + got; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+
+            for (int i = 0; i < SERVER_MAX_FILES; i++) {
+                ServerFile *f = &srv->files[i];
+
+                if (f->path != NULL && f->watch == ev->wd) {
+                    f->stale = 1;
+                    if (ev->mask & IN_IGNORED) {
+                        f->watch = -1;  /* the kernel removed it */
+                    }
+                }
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: answer
+ * ============================================================
+ * Parameter checks first, exactly as plan_add_*() makes them: a bad
+ * date is BAD_DATE even for a file that does not exist. Then the
+ * Dataset answers, or the error that stopped its load is returned.
+ */
+static int bad_parameters(const ServerRequest *req) {
+    switch (req->op) {
+        case SERVER_MATCHES_HISTORY:
+            return req->year <= 0;
+        case SERVER_MOST_VALUABLE_PLAYER:
+            return !is_valid_date(req->year, req->month, req->day);
+        case SERVER_BEST_WINNING_MATCH:
+            return req->year <= 0 || req->month < 1 || req->month > 12;
+        default:
+            return 0;
+    }
+}
+
+static void answer(QueryServer *srv, const ServerRequest *req, const char *file,
+                   const char *name, const char *out, ServerReply *reply) {
+    const ServerFile *f;
+    const Dataset *ds;
+
+    if (bad_parameters(req)) {
+        reply->value = BAD_DATE;
+        return;
+    }
+    f = get_file(srv, file);
+    if (f == NULL) {
+        reply->value = NO_MEMORY;
+        return;
+    }
+    if (f->status != SUCCESS) {
+        reply->value = f->status;
+        reply->err_code = f->err.code;
+        reply->err_line = f->err.line;
+        reply->err_offset = f->err.offset;
+        return;
+    }
+
+    ds = &f->ds;
+    switch (req->op) {
+        case SERVER_MATCHES_HISTORY:
+            reply->value = dataset_matches_history(ds, req->year, out);
+            break;
+        case SERVER_MOST_VALUABLE_PLAYER:
+            reply->value = dataset_most_valuable_player(ds, req->year, req->month, req->day);
+            break;
+        case SERVER_AVERAGE_POINTS:
+            reply->value = dataset_average_points_player(ds, name);
+            break;
+        case SERVER_BEST_WINNING_MATCH:
+            reply->value = dataset_best_winning_match_score(ds, req->year, req->month);
+            break;
+        case SERVER_BEST_MONTH:
+            reply->value = dataset_best_month(ds);
+            break;
+        case SERVER_PLAYER_REPORT:
+            reply->value = dataset_player_report(ds, name, out);
+            break;
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: serve_client
+ * ============================================================
+ * Reads one request and replies to it.
+ * Returns 0 to keep the connection, -1 to close it, 1 to stop.
+ *
+ * LEARNING POINTS:
+ * - recv() returns 0 when the client has closed its end
+ * - The lengths in the header must add up to exactly what arrived;
+ *   anything else is answered with BAD_RECORD
+ */
+static int serve_client(QueryServer *srv, int fd) {
+    char buf[SERVER_MAX_REQUEST + 1];
+    char file[SERVER_MAX_PATH], name[SERVER_MAX_PATH], out[SERVER_MAX_PATH];
+    ServerRequest req;
+    ServerReply reply;
+    ssize_t got;
+    const char *p;
+
+    got = recv(fd, buf, sizeof(buf), 0);
+    if (got <= 0) {
+        return -1;
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = SERVER_MAGIC;
+    reply.value = BAD_RECORD;
+    memcpy(&req, buf, (size_t)got < sizeof(req) ? (size_t)got : sizeof(req));
+
+    if ((size_t)got >= sizeof(req) && req.magic == SERVER_MAGIC &&
+        req.file_len < SERVER_MAX_PATH && req.name_len < SERVER_MAX_PATH &&
+        req.out_len < SERVER_MAX_PATH &&
+        (size_t)got == sizeof(req) + req.file_len + req.name_len + req.out_len) {
+        if (req.op == SERVER_SHUTDOWN) {
+            reply.value = SUCCESS;
+            send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+            return 1;
+        }
+
+        p = buf + sizeof(req);
+        memcpy(file, p, req.file_len);
+        file[req.file_len] = '\0';
+        p += req.file_len;
+        memcpy(name, p, req.name_len);
+        name[req.name_len] = '\0';
+        p += req.name_len;
+        memcpy(out, p, req.out_len);
+        out[req.out_len] = '\0';
+
+        if (req.op >= SERVER_MATCHES_HISTORY && req.op <= SERVER_PLAYER_REPORT &&
+            file[0] == '/') {
+            answer(srv, &req, file, name, out, &reply);
+        }
+    }
+
+    if (send(fd, &reply, sizeof(reply), MSG_NOSIGNAL) != (ssize_t)sizeof(reply)) {
+        return -1;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * FUNCTION: server_load
+ * ============================================================
+ */
+int server_load(QueryServer *srv, const char *in_file) {
+    char *path = realpath(in_file, NULL);
+    const ServerFile *f;
+
+    if (path == NULL) {
+        return FILE_READ_ERR;
+    }
+    f = get_file(srv, path);
+    free(path);
+    return f == NULL ? NO_MEMORY : f->status;
+}
+
+/* ============================================================
+ * FUNCTION: server_run
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - fds[] is rebuilt every round; clients[i] is fds[3 + i]
+ * - inotify is read before any client, so a query sent after a change
+ *   to its file sees the new contents
+ * - A closed client is replaced by the last one; walking the clients
+ *   from the back means the moved one was already served
+ */
+int server_run(QueryServer *srv) {
+    struct pollfd fds[3 + SERVER_MAX_CLIENTS];
+
+    for (;;) {
+        int n = 3;
+
+        fds[0].fd = srv->wake[0];
+        fds[1].fd = srv->inotify_fd;
+        fds[2].fd = srv->client_count < SERVER_MAX_CLIENTS ? srv->listen_fd : -1;
+        for (int i = 0; i < srv->client_count; i++) {
+            fds[n++].fd = srv->clients[i];
+        }
+        for (int i = 0; i < n; i++) {
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        if (poll(fds, (nfds_t)n, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FILE_READ_ERR;
+        }
+
+        if (fds[0].revents) {
+            char byte;
+            while (read(srv->wake[0], &byte, 1) > 0) {
+            }
+            return SUCCESS;
+        }
+        if (fds[1].revents) {
+            read_events(srv);
+        }
+        if (fds[2].revents) {
+            int fd = accept4(srv->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                srv->clients[srv->client_count++] = fd;
+            }
+        }
+
+        for (int i = n - 3 - 1; i >= 0; i--) {
+            int result;
+
+            if (fds[3 + i].revents == 0) {
+                continue;
+            }
+            result = serve_client(srv, srv->clients[i]);
+            if (result == 1) {
+                return SUCCESS;
+            }
+            if (result < 0) {
+                close(srv->clients[i]);
+                srv->clients[i] = srv->clients[--srv->client_count];
+            }
+        }
+    }
+}
+
+/* ============================================================
+ * FUNCTIONS: server_stop / server_close
+ * ============================================================
+ * write() is async-signal-safe, so server_stop() may run in a signal
+ * handler.
+ */
+void server_stop(QueryServer *srv) {
+    ssize_t ignored = write(srv->wake[1], "x", 1);
+    (void)ignored;
+}
+
+void server_close(QueryServer *srv) {
+    for (int i = 0; i < srv->client_count; i++) {
+        close(srv->clients[i]);
+    }
+    for (int i = 0; i < SERVER_MAX_FILES; i++) {
+        drop_dataset(srv, &srv->files[i]);
+        free(srv->files[i].path);
+    }
+    if (srv->listen_fd >= 0) {
+        close(srv->listen_fd);
+    }
+    if (srv->socket_path != NULL) {
+        unlink(srv->socket_path);
+        free(srv->socket_path);
+    }
+    if (srv->inotify_fd >= 0) {
+        close(srv->inotify_fd);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (srv->wake[i] >= 0) {
+            close(srv->wake[i]);
+        }
+    }
+    memset(srv, 0, sizeof(*srv));
+    srv->listen_fd = srv->inotify_fd = -1;
+    srv->wake[0] = srv->wake[1] = -1;
+}
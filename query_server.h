@@ -0,0 +1,156 @@
+/*
+ * query_server.h - Serve the hw2.h queries from loaded datasets
+ *
+ * This file contains:
+ * - The request / reply messages of the hw2_daemon protocol
+ * - The QueryServer structure (listening socket, dataset cache)
+ * - Functions to open, run and stop a server
+ *
+ * Learning Concepts:
+ * - Unix domain sockets: a "network" connection that is just a file
+ *   name, only reachable from the same machine
+ * - SOCK_SEQPACKET keeps message boundaries: one send() is one
+ *   recv(), so a request never arrives in pieces
+ * - poll() over many descriptors: one thread serves every client
+ * - inotify: the kernel tells us when a loaded file changes, instead
+ *   of us checking it before every query
+ *
+ * Typical use (see hw2_daemon.c; hw2_client.h is the other end):
+ *   QueryServer srv;
+ *   if (server_open(&srv, "/tmp/hw2d.sock") == SUCCESS) {
+ *       server_run(&srv);          (until server_stop() or a
+ *       server_close(&srv);         SERVER_SHUTDOWN request)
+ *   }
+ */
+
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <stdint.h>
+#include "hw2.h"
+#include "dataset.h"
+
+/* ========== CONSTANTS ========== */
+#define SERVER_SOCKET "/tmp/hw2d.sock"  /* default socket path */
+#define SERVER_MAGIC 0x44325748u        /* "HW2D" (little-endian) */
+#define SERVER_MAX_PATH 4096            /* longest string in a request */
+#define SERVER_MAX_FILES 8              /* datasets kept loaded */
+#define SERVER_MAX_CLIENTS 64           /* connections served at once */
+
+/* Request operations: the six hw2.h queries, and stopping the server */
+#define SERVER_MATCHES_HISTORY 1
+#define SERVER_MOST_VALUABLE_PLAYER 2
+#define SERVER_AVERAGE_POINTS 3
+#define SERVER_BEST_WINNING_MATCH 4
+#define SERVER_BEST_MONTH 5
+#define SERVER_PLAYER_REPORT 6
+#define SERVER_SHUTDOWN 7
+
+/* ========== TYPES ========== */
+
+/*
+ * A request is this header followed by file_len bytes of the data
+ * file's absolute path, then name_len bytes of the player name, then
+ * out_len bytes of the output file's absolute path (no '\0's).
+ * Unused numbers and strings are 0 / empty.
+ */
+typedef struct {
+    uint32_t magic;              /* SERVER_MAGIC */
+    uint32_t op;                 /* SERVER_* */
+    int32_t year, month, day;
+    uint16_t file_len, name_len, out_len;
+    uint16_t unused;
+} ServerRequest;
+
+/* The reply to every query request */
+typedef struct {
+    uint32_t magic;              /* SERVER_MAGIC */
+    int32_t err_code;            /* hw2_last_parse_error() of the call */
+    int64_t err_line;
+    int64_t err_offset;
+    double value;                /* what the hw2.h function returns */
+} ServerReply;
+
+#define SERVER_MAX_REQUEST (sizeof(ServerRequest) + 3 * SERVER_MAX_PATH)
+
+/* One loaded file */
+typedef struct {
+    char *path;                  /* NULL = free slot */
+    int watch;                   /* inotify watch, or -1 */
+    int stale;                   /* changed since it was loaded */
+    int status;                  /* dataset_open() result (ds is loaded if SUCCESS) */
+    ParseError err;              /* its bad record, if any */
+    Dataset ds;
+    unsigned long long used;     /* last use (for eviction) */
+} ServerFile;
+
+/*
+ * Treat as private; use the functions below.
+ */
+typedef struct {
+    int listen_fd;
+    int inotify_fd;
+    int wake[2];                 /* server_stop() writes to wake[1] */
+    char *socket_path;
+    int clients[SERVER_MAX_CLIENTS];
+    int client_count;
+    ServerFile files[SERVER_MAX_FILES];
+    unsigned long long clock;    /* counts requests */
+    unsigned long long loads;    /* dataset_open() calls so far */
+} QueryServer;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * server_open
+ *
+ * Listens on socket_path (NULL = SERVER_SOCKET). A stale socket file
+ * left by a server that is no longer running is replaced; one that a
+ * running server answers on is not.
+ *
+ * Returns: SUCCESS, FILE_WRITE_ERR (the socket could not be created)
+ * or NO_MEMORY
+ */
+int server_open(QueryServer *srv, const char *socket_path);
+
+/*
+ * server_load
+ *
+ * Loads in_file now instead of on its first query.
+ *
+ * Returns: what dataset_open() returned for it
+ */
+int server_load(QueryServer *srv, const char *in_file);
+
+/*
+ * server_run
+ *
+ * Answers requests until server_stop() is called or a client sends
+ * SERVER_SHUTDOWN. A file is loaded on its first query and reloaded
+ * on the first query after inotify reports a change (an append, a
+ * rewrite, a rename or delete); the least recently used file is
+ * dropped when SERVER_MAX_FILES are loaded.
+ *
+ * Results are those of the hw2.h functions with their default
+ * settings (Purdue, whole file, strict).
+ *
+ * Returns: SUCCESS, or FILE_READ_ERR if poll() failed
+ */
+int server_run(QueryServer *srv);
+
+/*
+ * server_stop
+ *
+ * Makes server_run() return. Safe to call from another thread or a
+ * signal handler.
+ */
+void server_stop(QueryServer *srv);
+
+/*
+ * server_close
+ *
+ * Closes every connection, frees every dataset and removes the socket.
+ */
+void server_close(QueryServer *srv);
+
+#endif /* QUERY_SERVER_H */
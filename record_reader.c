@@ -0,0 +1,812 @@
+/*
+ * record_reader.c - Streaming record tokenizer for game data files
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. mmap()/read() - regular files are mapped (no copying); pipes are
+ *                    read() in large blocks
+ * 2. memchr()    - finding the end of a line quickly
+ * 3. Hand-written integer/decimal parsing (no format strings)
+ * 4. Zero-copy   - names are returned as pointer + length into the buffer
+ * 5. Error locations - line number and byte offset of bad records
+ * 6. SIMD fast path - the date and the delimiters of typical lines are
+ *    found with vector instructions (simd_scan.h)
+ * 7. Compressed input - gzip / zstd files are recognised by their
+ *    first bytes and decompressed on another thread (input_source.h)
+ * 8. Binary search in a file - on a file sorted by date, the first
+ *    record of a date is found in O(log n) probes
+ */
+
+/* Needed for madvise() and 64-bit file offsets with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "hw2.h"
+#include "encoding.h"
+#include "record_reader.h"
+#include "column_file.h"
+#include "simd_scan.h"
+#include "input_source.h"
+#include "stats.h"
+
+/* ============================================================
+ * HELPER FUNCTIONS: Character classes
+ * ============================================================
+ * Faster than <ctype.h> because they ignore the locale.
+ */
+static int is_digit(char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* ============================================================
+ * FUNCTION: is_valid_date
+ * ============================================================
+ * Checks if year > 0, month in [1,12], day in [1,30]
+ */
+int is_valid_date(int year, int month, int day) {
+    return (year > 0 && month >= 1 && month <= 12 && day >= 1 && day <= 30);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: parse_int
+ * ============================================================
+ * Parses [blanks][+|-]digits starting at p. Returns a pointer just past
+ * the last digit, or NULL if there is no number. At most 9 digits are
+ * accepted so the value always fits in an int.
+ */
+static const char *parse_int(const char *p, const char *end, int *out) {
+    int negative = 0;
+    int value = 0;
+    const char *digits;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    digits = p;
+    while (p < end && is_digit(*p)) {
+        if (p - digits == 9) {
+            return NULL;
+        }
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digits) {
+        return NULL;
+    }
+
+    *out = negative ? -value : value;
+    return p;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: parse_float_slow
+ * ============================================================
+ * Fallback for unusual numbers (exponents, many digits): copy the
+ * field into a small string and let strtof() do the work.
+ */
+static const char *parse_float_slow(const char *p, const char *end, float *out) {
+    char tmp[64];
+    char *stop;
+    size_t len = (size_t)(end - p);
+
+    if (len >= sizeof(tmp)) {
+        len = sizeof(tmp) - 1;
+    }
+    memcpy(tmp, p, len);
+    tmp[len] = '\0';
+
+    *out = strtof(tmp, &stop);
+    if (stop == tmp) {
+        return NULL;
+    }
+    return p + (stop - tmp);
+}
+
+/* ============================================================
+ * HELPER FUNCTION: parse_float
+ * ============================================================
+ * Parses [blanks][+|-]digits[.digits] as a fixed-point number:
+ * all digits are collected into one integer and divided by a power
+ * of ten at the end.
+ *
+ * With at most 7 digits the integer and the power of ten are exact
+ * floats, so one float division gives exactly the same (correctly
+ * rounded) result as strtof().
+ */
+static const float pow10_table[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f
+};
+
+static const char *parse_float(const char *p, const char *end, float *out) {
+    const char *start;
+    int negative = 0;
+    unsigned long mantissa = 0;
+    int digits = 0;
+    int decimals = 0;
+    float value;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    start = p;
+
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        p++;
+    }
+    while (p < end && is_digit(*p)) {
+        mantissa = mantissa * 10 + (unsigned long)(*p - '0');
+        digits++;
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && is_digit(*p)) {
+            mantissa = mantissa * 10 + (unsigned long)(*p - '0');
+            digits++;
+            decimals++;
+            p++;
+        }
+    }
+
+    if (digits == 0) {
+        return NULL;
+    }
+    if (digits > 7 || (p < end && (*p == 'e' || *p == 'E'))) {
+        return parse_float_slow(start, end, out);
+    }
+
+    value = (float)mantissa / pow10_table[decimals];
+    *out = negative ? -value : value;
+    return p;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: parse_name
+ * ============================================================
+ * A name is 1 to MAX_NAME_LENGTH-1 characters ending at stop_char.
+ * Returns a pointer just past stop_char, or NULL.
+ */
+static const char *parse_name(const char *p, const char *end, char stop_char,
+                              const char **name, size_t *name_len) {
+    const char *stop = memchr(p, stop_char, (size_t)(end - p));
+
+    if (stop == NULL || stop == p || stop - p >= MAX_NAME_LENGTH) {
+        return NULL;
+    }
+    *name = p;
+    *name_len = (size_t)(stop - p);
+    return stop + 1;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: parse_line
+ * ============================================================
+ * Splits one line (without its '\n') into a GameRecord.
+ * Returns 1 on success, 0 if the line does not match the format.
+ */
+static int parse_line(const char *p, const char *end, GameRecord *rec) {
+    if ((p = parse_int(p, end, &rec->year)) == NULL || p == end || *p++ != '-') return 0;
+    if ((p = parse_int(p, end, &rec->month)) == NULL || p == end || *p++ != '-') return 0;
+    if ((p = parse_int(p, end, &rec->day)) == NULL || p == end || *p++ != '|') return 0;
+
+    if ((p = parse_name(p, end, ',', &rec->player, &rec->player_len)) == NULL) return 0;
+    if ((p = parse_name(p, end, '#', &rec->team, &rec->team_len)) == NULL) return 0;
+    rec->player_id = RECORD_NO_ID;
+    rec->team_id = RECORD_NO_ID;
+
+    if ((p = parse_int(p, end, &rec->points)) == NULL || p == end || *p++ != ',') return 0;
+    if ((p = parse_int(p, end, &rec->assists)) == NULL || p == end || *p++ != ',') return 0;
+    if ((p = parse_int(p, end, &rec->blocks)) == NULL || p == end || *p++ != ',') return 0;
+    if ((p = parse_float(p, end, &rec->minutes)) == NULL) return 0;
+
+    /* Only trailing whitespace (e.g. '\r') may follow the last field */
+    while (p < end) {
+        if (!is_space(*p++)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: parse_digits
+ * ============================================================
+ * [p, end) must be 1 to 9 digits and nothing else.
+ */
+static int parse_digits(const char *p, const char *end, int *out) {
+    int value = 0;
+
+    if (p == end || end - p > 9) {
+        return 0;
+    }
+    for (; p < end; p++) {
+        if (!is_digit(*p)) {
+            return 0;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    *out = value;
+    return 1;
+}
+
+/* Next delimiter in mask that is the character want; -1 if none */
+static int next_delimiter(const char *p, uint64_t *mask, char want) {
+    while (*mask != 0) {
+        int i = __builtin_ctzll(*mask);
+        *mask &= *mask - 1;
+        if (p[i] == want) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: parse_line_simd
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Lines of 16 to 64 bytes in the usual form ("2024-01-15|", plain
+ *   digits for the stats) are split using one delimiter bitmask
+ *   instead of a scan per field
+ * - Walking the mask finds the same ',' and '#' that memchr() would:
+ *   the first of the wanted kind after the previous field
+ * - Anything unusual (signs, blanks, long lines) goes to parse_line(),
+ *   so both paths always give the same record or the same error
+ * - avail is how far past p the buffer may be read
+ */
+static int parse_line_simd(int level, const char *p, const char *end, size_t avail,
+                           GameRecord *rec) {
+    size_t len = (size_t)(end - p);
+    uint64_t mask;
+    int stops[5];
+    static const char wanted[5] = { ',', '#', ',', ',', ',' };
+    const char *q;
+
+    if (len < 16 || len > SIMD_MASK_BYTES ||
+        !simd_parse_date(p, &rec->year, &rec->month, &rec->day)) {
+        return parse_line(p, end, rec);
+    }
+
+    /* The date holds no ',' or '#', so the mask starts at the player */
+    mask = simd_delimiter_mask(level, p, len, avail);
+    for (int i = 0; i < 5; i++) {
+        stops[i] = next_delimiter(p, &mask, wanted[i]);
+        if (stops[i] < 0) {
+            return parse_line(p, end, rec);
+        }
+    }
+    if (stops[0] == 11 || stops[0] - 11 >= MAX_NAME_LENGTH ||
+        stops[1] == stops[0] + 1 || stops[1] - stops[0] - 1 >= MAX_NAME_LENGTH) {
+        return parse_line(p, end, rec);
+    }
+
+    if (!parse_digits(p + stops[1] + 1, p + stops[2], &rec->points) ||
+        !parse_digits(p + stops[2] + 1, p + stops[3], &rec->assists) ||
+        !parse_digits(p + stops[3] + 1, p + stops[4], &rec->blocks) ||
+        (q = parse_float(p + stops[4] + 1, end, &rec->minutes)) == NULL) {
+        return parse_line(p, end, rec);
+    }
+    while (q < end) {
+        if (!is_space(*q++)) {
+            return 0;
+        }
+    }
+
+    rec->player = p + 11;
+    rec->player_len = (size_t)(stops[0] - 11);
+    rec->team = p + stops[0] + 1;
+    rec->team_len = (size_t)(stops[1] - stops[0] - 1);
+    rec->player_id = RECORD_NO_ID;
+    rec->team_id = RECORD_NO_ID;
+    return 1;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: fill_buffer
+ * ============================================================
+ * Buffered (non-mapped) mode only: moves the unread bytes to the
+ * front of the buffer and read()s more data after them (decompressed
+ * data, for compressed files).
+ * Sets rd->eof at end of file. Returns 0, or -1 if read() failed.
+ */
+static int fill_buffer(RecordReader *rd) {
+    size_t left = (size_t)(rd->end - rd->pos);
+    ssize_t got;
+    STATS_START(start);
+
+    if (rd->pos != rd->buf) {
+        memmove(rd->buf, rd->pos, left);
+        rd->base_offset += rd->pos - rd->buf;
+        rd->pos = rd->buf;
+        rd->end = rd->buf + left;
+    }
+
+    if (rd->source != NULL) {
+        got = source_read(rd->source, rd->buf + left, READER_BUFFER_SIZE - left);
+    } else {
+        do {
+            got = read(rd->fd, rd->buf + left, READER_BUFFER_SIZE - left);
+            STATS_COUNT(syscalls, SYSCALL_READ);
+        } while (got < 0 && errno == EINTR);
+    }
+    STATS_STOP(STATS_READ, start);
+
+    if (got < 0) {
+        rd->eof = 1;
+        return -1;
+    }
+    if (got == 0) {
+        rd->eof = 1;
+    }
+    rd->end += got;
+    return 0;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: map_file
+ * ============================================================
+ * Maps a whole regular file read-only. Returns 1 on success,
+ * 0 if the caller should fall back to read() (pipe, empty file,
+ * file too large for the address space, or mmap() failure).
+ *
+ * MADV_SEQUENTIAL tells the kernel to read ahead aggressively and
+ * drop pages behind us, which suits one front-to-back scan.
+ */
+static int map_file(RecordReader *rd) {
+    struct stat st;
+    void *map;
+
+    if (fstat(rd->fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return 0;
+    }
+    if ((uintmax_t)st.st_size > (uintmax_t)SIZE_MAX) {
+        return 0;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, rd->fd, 0);
+    STATS_COUNT(syscalls, SYSCALL_MMAP);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    rd->map = map;
+    rd->map_len = (size_t)st.st_size;
+    rd->base = map;
+    rd->pos = rd->base;
+    rd->end = rd->base + rd->map_len;
+    rd->eof = 1;  /* the whole file is already in the window */
+    return 1;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: compressed_format
+ * ============================================================
+ * Looks at the first bytes with pread(), which leaves the file
+ * position at 0. Pipes cannot pread(), so they are read as they are.
+ */
+static int compressed_format(RecordReader *rd) {
+    unsigned char magic[SOURCE_MAGIC_LEN];
+    ssize_t got = pread(rd->fd, magic, sizeof(magic), 0);
+
+    STATS_COUNT(syscalls, SYSCALL_PREAD);
+    return got > 0 ? source_detect(magic, (size_t)got) : SOURCE_PLAIN;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: reader_fail
+ * ============================================================
+ * Remembers where a bad record starts, and why, and returns its
+ * error code.
+ */
+static int reader_fail(RecordReader *rd, int code, const char *reason, const char *line_start) {
+    rd->err_code = code;
+    rd->err_reason = reason;
+    rd->err_line = rd->line;
+    rd->err_offset = rd->base_offset + (line_start - rd->base);
+    return code;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: open_columns
+ * ============================================================
+ * The mapped file is a column file: hand it to a ColumnReader.
+ */
+static int open_columns(RecordReader *rd) {
+    int status;
+
+    rd->columns = malloc(sizeof(ColumnReader));
+    if (rd->columns == NULL) {
+        reader_close(rd);
+        return NO_MEMORY;
+    }
+
+    status = column_reader_open(rd->columns, rd->map, rd->map_len);
+    if (status != SUCCESS) {
+        reader_close(rd);
+    }
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: reader_open
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - open()/fstat() tell us whether the input is a regular file
+ * - Regular files are mapped; everything else is read() in blocks
+ * - Compressed files are read() in blocks too, from an InputSource
+ */
+static int open_input(RecordReader *rd, const char *path) {
+    int format;
+
+    memset(rd, 0, sizeof(*rd));
+    rd->line = 1;
+
+    rd->fd = open(path, O_RDONLY);
+    STATS_COUNT(syscalls, SYSCALL_OPEN);
+    if (rd->fd < 0) {
+        return FILE_READ_ERR;
+    }
+
+    rd->fields = FIELD_ALL;
+    rd->simd = simd_level();
+
+    format = compressed_format(rd);
+    if (format != SOURCE_PLAIN) {
+        int status = source_open(&rd->source, rd->fd, format);
+        if (status != SUCCESS) {
+            close(rd->fd);
+            rd->fd = -1;
+            return status;
+        }
+    } else if (map_file(rd)) {
+        if (column_is_file(rd->base, rd->map_len)) {
+            return open_columns(rd);
+        }
+        return SUCCESS;
+    }
+
+    rd->buf = malloc(READER_BUFFER_SIZE);
+    if (rd->buf == NULL) {
+        reader_close(rd);
+        return FILE_READ_ERR;
+    }
+
+    rd->base = rd->buf;
+    rd->pos = rd->buf;
+    rd->end = rd->buf;
+    return SUCCESS;
+}
+
+int reader_open(RecordReader *rd, const char *path) {
+    STATS_START(start);
+    int status = open_input(rd, path);
+
+    STATS_STOP(STATS_OPEN, start);
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: reader_next
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Whitespace between records (including blank lines) is skipped
+ * - A line must be complete in the buffer before it is parsed,
+ *   so the buffer is refilled when no '\n' is found
+ * - After an error the reader has already moved past the bad line
+ */
+void reader_set_fields(RecordReader *rd, unsigned fields) {
+    rd->fields = fields;
+}
+
+/* Column files: decode the next record, remembering where errors are */
+static int next_column_record(RecordReader *rd, GameRecord *rec) {
+    int status = column_reader_next(rd->columns, rec, rd->fields);
+
+    if (status == RECORD_OK) {
+        rd->rec_offset = (long long)rd->columns->record_index - 1;
+        STATS_ADD(records, 1);
+    } else if (status == BAD_RECORD) {
+        STATS_COUNT(rejected, REJECT_MALFORMED);
+        rd->err_code = BAD_RECORD;
+        rd->err_reason = "damaged column file";
+        rd->err_line = (long)rd->columns->record_index + 1;
+        rd->err_offset = (long long)rd->columns->group_offset;
+    }
+    return status;
+}
+
+int reader_next(RecordReader *rd, GameRecord *rec) {
+    const char *line_start;
+    const char *line_end;
+    int parsed, valid_date, valid_stats;
+
+    if (rd->columns != NULL) {
+        return next_column_record(rd, rec);
+    }
+
+    for (;;) {
+        if (rd->skip_line) {
+            /* Drop the rest of an over-long line, up to its '\n' */
+            line_end = memchr(rd->pos, '\n', (size_t)(rd->end - rd->pos));
+            rd->pos = line_end != NULL ? line_end : rd->end;
+            rd->skip_line = line_end == NULL && !rd->eof;
+        }
+        while (rd->pos < rd->end && is_space(*rd->pos)) {
+            if (*rd->pos == '\n') {
+                rd->line++;
+            }
+            rd->pos++;
+        }
+
+        if (rd->pos < rd->end) {
+            line_end = memchr(rd->pos, '\n', (size_t)(rd->end - rd->pos));
+            if (line_end != NULL) {
+                break;
+            }
+            if (rd->eof) {
+                line_end = rd->end;
+                break;
+            }
+            if (rd->end - rd->pos == READER_BUFFER_SIZE) {
+                /* A single line larger than the whole buffer */
+                line_start = rd->pos;
+                rd->pos = rd->end;
+                rd->skip_line = 1;
+                return reader_fail(rd, BAD_RECORD, "line too long", line_start);
+            }
+        } else if (rd->eof) {
+            return RECORD_EOF;
+        }
+
+        if (fill_buffer(rd) != 0) {
+            rd->err_code = FILE_READ_ERR;
+            rd->err_reason = "read error";
+            rd->err_line = rd->line;
+            rd->err_offset = rd->base_offset + (rd->end - rd->base);
+            return FILE_READ_ERR;
+        }
+    }
+
+    line_start = rd->pos;
+    rd->pos = line_end;
+    rd->rec_offset = rd->base_offset + (line_start - rd->base);
+    STATS_ADD(bytes, line_end - line_start);
+
+    STATS_START(parse_start);
+    parsed = rd->simd != SIMD_SCALAR
+        ? parse_line_simd(rd->simd, line_start, line_end, (size_t)(rd->end - line_start), rec)
+        : parse_line(line_start, line_end, rec);
+    STATS_STOP(STATS_PARSE, parse_start);
+    if (!parsed) {
+        STATS_COUNT(rejected, REJECT_MALFORMED);
+        return reader_fail(rd, BAD_RECORD, "malformed line", line_start);
+    }
+
+    STATS_START(validate_start);
+    valid_date = is_valid_date(rec->year, rec->month, rec->day);
+    valid_stats = rec->points >= 0 && rec->assists >= 0 && rec->blocks >= 0 && rec->minutes > 0;
+    STATS_STOP(STATS_VALIDATE, validate_start);
+    if (!valid_date) {
+        STATS_COUNT(rejected, REJECT_BAD_DATE);
+        return reader_fail(rd, BAD_DATE, "invalid date", line_start);
+    }
+    if (!valid_stats) {
+        STATS_COUNT(rejected, REJECT_BAD_STATS);
+        return reader_fail(rd, BAD_RECORD, "negative stat or no minutes", line_start);
+    }
+
+    STATS_ADD(records, 1);
+    return RECORD_OK;
+}
+
+/* ============================================================
+ * FUNCTION: reader_tell / reader_seek
+ * ============================================================
+ * A mapped file is one window over the whole file, so seeking is just
+ * moving pos (or asking the ColumnReader to jump to a record).
+ */
+long long reader_tell(const RecordReader *rd) {
+    if (rd->columns != NULL) {
+        return (long long)rd->columns->record_index;
+    }
+    return rd->base_offset + (rd->pos - rd->base);
+}
+
+int reader_seek(RecordReader *rd, long long pos) {
+    if (rd->map == NULL || pos < 0) {
+        return FILE_READ_ERR;
+    }
+    if (rd->columns != NULL) {
+        return column_reader_seek(rd->columns, (uint64_t)pos) == SUCCESS ? SUCCESS : FILE_READ_ERR;
+    }
+    if ((unsigned long long)pos > rd->map_len) {
+        return FILE_READ_ERR;
+    }
+    rd->pos = rd->base + pos;
+    rd->line = 0;  /* unknown */
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: reader_seek_date
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Records before lo are dated before the target; the first record
+ *   at or after hi is dated on or after it. Each probe halves [lo, hi)
+ * - A text file has no record numbers: a probe backs up from the
+ *   middle byte to the start of its line and reads that record
+ * - reader_next() does the parsing, so a probe sees exactly what a
+ *   scan would
+ */
+int reader_seek_date(RecordReader *rd, int year, int month, int day) {
+    long long target = pack_date(year, month, day);
+    long long lo = 0, hi;
+    unsigned fields = rd->fields;
+    GameRecord rec;
+    int status = SUCCESS;
+
+    if (rd->map == NULL) {
+        return FILE_READ_ERR;
+    }
+    hi = rd->columns != NULL ? (long long)rd->columns->record_count : (long long)rd->map_len;
+    rd->fields |= FIELD_DATE;
+
+    while (lo < hi && status == SUCCESS) {
+        long long mid = lo + (hi - lo) / 2;
+        long long start = mid;
+        int got;
+
+        if (rd->columns == NULL) {
+            while (start > lo && rd->base[start - 1] != '\n') {
+                start--;
+            }
+        }
+        status = reader_seek(rd, start);
+        if (status != SUCCESS) {
+            break;
+        }
+        got = reader_next(rd, &rec);
+        if (got == RECORD_OK && pack_date(rec.year, rec.month, rec.day) < target) {
+            lo = reader_tell(rd);
+        } else if (got == RECORD_OK || got == RECORD_EOF) {
+            hi = start;
+        } else {
+            status = got;
+        }
+    }
+
+    rd->fields = fields;
+    if (status != SUCCESS) {
+        return status;
+    }
+    return reader_seek(rd, lo);
+}
+
+/* ============================================================
+ * FUNCTIONS: reader_known_sorted / reader_remember_sorted
+ * ============================================================
+ * A small table of files seen in date order, keyed by what fstat()
+ * says about their contents: appending to or rewriting a file changes
+ * its size or modification time, so it is checked again.
+ */
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+    long mtime_nsec;
+} SortedFile;
+
+static SortedFile sorted_files[READER_SORTED_FILES];
+static int sorted_count = 0;
+static int sorted_next = 0;
+static pthread_mutex_t sorted_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int same_file(const SortedFile *f, const struct stat *st) {
+    return f->dev == st->st_dev && f->ino == st->st_ino && f->size == st->st_size &&
+           f->mtime == st->st_mtime && f->mtime_nsec == (long)MTIME_NSEC(*st);
+}
+
+int reader_known_sorted(const RecordReader *rd) {
+    struct stat st;
+    int found = 0;
+
+    if (rd->map == NULL || fstat(rd->fd, &st) != 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&sorted_lock);
+    for (int i = 0; i < sorted_count && !found; i++) {
+        found = same_file(&sorted_files[i], &st);
+    }
+    pthread_mutex_unlock(&sorted_lock);
+    return found;
+}
+
+void reader_remember_sorted(const RecordReader *rd) {
+    struct stat st;
+    SortedFile *f;
+
+    if (rd->map == NULL || fstat(rd->fd, &st) != 0 || reader_known_sorted(rd)) {
+        return;
+    }
+    pthread_mutex_lock(&sorted_lock);
+    f = &sorted_files[sorted_next];  /* the oldest entry makes room */
+    sorted_next = (sorted_next + 1) % READER_SORTED_FILES;
+    if (sorted_count < READER_SORTED_FILES) {
+        sorted_count++;
+    }
+    f->dev = st.st_dev;
+    f->ino = st.st_ino;
+    f->size = st.st_size;
+    f->mtime = st.st_mtime;
+    f->mtime_nsec = (long)MTIME_NSEC(st);
+    pthread_mutex_unlock(&sorted_lock);
+}
+
+/* ============================================================
+ * FUNCTION: reader_name_count / reader_name
+ * ============================================================
+ * Only column files have a dictionary; text files report 0 names.
+ */
+uint32_t reader_name_count(const RecordReader *rd, int kind) {
+    if (rd->columns == NULL) {
+        return 0;
+    }
+    return kind == READER_TEAMS ? rd->columns->team_count : rd->columns->player_count;
+}
+
+const char *reader_name(const RecordReader *rd, int kind, uint32_t id, size_t *len) {
+    const ColumnName *names = kind == READER_TEAMS ? rd->columns->teams : rd->columns->players;
+
+    *len = names[id].len;
+    return names[id].name;
+}
+
+/* ============================================================
+ * FUNCTION: reader_close
+ * ============================================================
+ */
+void reader_close(RecordReader *rd) {
+    if (rd->columns != NULL) {
+        column_reader_close(rd->columns);
+        free(rd->columns);
+        rd->columns = NULL;
+    }
+    if (rd->map != NULL) {
+        munmap(rd->map, rd->map_len);
+        rd->map = NULL;
+    }
+    source_close(rd->source);
+    rd->source = NULL;
+    if (rd->fd >= 0) {
+        close(rd->fd);
+        rd->fd = -1;
+    }
+    free(rd->buf);
+    rd->buf = NULL;
+}
@@ -0,0 +1,242 @@
+/*
+ * record_reader.h - Streaming record tokenizer for game data files
+ *
+ * This file contains:
+ * - The GameRecord structure (one parsed line of game data)
+ * - The RecordReader structure (a reader over one input file)
+ * - Prototypes for opening, reading and closing a reader
+ *
+ * Learning Concepts:
+ * - Reading a file in large blocks instead of one field at a time
+ * - Hand-written parsing of integers and decimals
+ * - Pointer + length "views" into a buffer (no copying, no malloc per line)
+ * - Memory-mapped files (mmap) with a read() fallback for pipes
+ * - SIMD parsing of typical lines, chosen at run time (simd_scan.h)
+ */
+
+#ifndef RECORD_READER_H
+#define RECORD_READER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========== CONSTANTS ========== */
+#define READER_BUFFER_SIZE (1 << 20)  /* 1 MiB read buffer */
+#define READER_SORTED_FILES 16        /* files reader_remember_sorted() keeps */
+
+/*
+ * Fields a caller needs (reader_set_fields). Text input always parses
+ * every field; column files only decode the columns asked for.
+ */
+#define FIELD_DATE     0x01
+#define FIELD_PLAYER   0x02
+#define FIELD_TEAM     0x04
+#define FIELD_POINTS   0x08
+#define FIELD_ASSISTS  0x10
+#define FIELD_BLOCKS   0x20
+#define FIELD_MINUTES  0x40
+#define FIELD_ALL      0x7F
+
+/* Return values of reader_next() besides the hw2.h error codes */
+#define RECORD_OK   1   /* A record was read into *rec */
+#define RECORD_EOF  0   /* No more records */
+
+/* Name dictionaries (reader_name_count / reader_name) */
+#define READER_PLAYERS 0
+#define READER_TEAMS   1
+#define RECORD_NO_ID   UINT32_MAX   /* player_id / team_id of text input */
+
+/* ========== TYPES ========== */
+
+/*
+ * One line of game data:
+ *   yyyy-mm-dd|player_name,team#points,assists,blocks,minutes
+ *
+ * player and team point INTO the reader's buffer and are NOT
+ * null-terminated; use the *_len fields. They stay valid only until
+ * the next call to reader_next().
+ *
+ * Column files store every name once, so their records also carry
+ * player_id / team_id: the name's position in the file's dictionary
+ * (see reader_name). Equal ids mean equal names. Text input has no
+ * dictionary and sets both to RECORD_NO_ID.
+ *
+ * game tells two games on the same day apart. Readers leave it at 0
+ * (a date is one game, as hw2.h counts them); the grouping stage
+ * (game_groups.h) numbers a day's games 0, 1, 2, ...
+ */
+typedef struct {
+    int year, month, day;
+    int game;
+    const char *player;
+    size_t player_len;
+    uint32_t player_id;
+    const char *team;
+    size_t team_len;
+    uint32_t team_id;
+    int points, assists, blocks;
+    float minutes;
+} GameRecord;
+
+struct ColumnReader;  /* column_file.h */
+struct InputSource;   /* input_source.h */
+
+/*
+ * A reader over one input file.
+ *
+ * Regular files are memory-mapped: the whole file is one window
+ * [base, end) served straight from the page cache. Pipes, terminals
+ * and files that cannot be mapped are read() into buf instead.
+ * Mapped files that start with the column file magic (column_file.h)
+ * are decoded by a ColumnReader instead of the text tokenizer.
+ * gzip / zstd files are decompressed by an InputSource on another
+ * thread and fill buf like a pipe would.
+ *
+ * Treat the fields as private; use the functions below.
+ */
+typedef struct {
+    int fd;                  /* -1 once closed */
+    char *buf;               /* READER_BUFFER_SIZE bytes, or NULL if mapped */
+    void *map;               /* mmap() address, or NULL if buffered */
+    size_t map_len;
+    const char *base;        /* first byte of the current window */
+    const char *pos;         /* next unread byte */
+    const char *end;         /* one past the last valid byte */
+    long long base_offset;   /* file offset of base[0] */
+    long line;               /* current line number (1-based) */
+    int eof;                 /* no more data to read from fd */
+    struct ColumnReader *columns;  /* non-NULL for column files */
+    struct InputSource *source;    /* non-NULL for compressed files */
+    unsigned fields;         /* FIELD_* mask, FIELD_ALL by default */
+    int simd;                /* simd_scan.h level of the text tokenizer */
+
+    /*
+     * Position of the record just returned: its byte offset in a text
+     * file, or its record number (0-based) in a column file
+     */
+    long long rec_offset;
+
+    /* Location of the last BAD_RECORD / BAD_DATE */
+    int err_code;
+    long err_line;
+    long long err_offset;
+    const char *err_reason;  /* "malformed line", "invalid date", ... */
+
+    int skip_line;           /* the rest of an over-long line is still unread */
+} RecordReader;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * is_valid_date
+ *
+ * Returns 1 if year > 0, month in [1,12] and day in [1,30], else 0.
+ */
+int is_valid_date(int year, int month, int day);
+
+/*
+ * reader_open
+ *
+ * Opens path for reading, memory-mapping it when possible.
+ * Text files, column files (column_file.h) and gzip / zstd compressed
+ * text files (input_source.h) are accepted.
+ * Returns SUCCESS, FILE_READ_ERR, NO_MEMORY, or BAD_RECORD for a
+ * damaged column file.
+ */
+int reader_open(RecordReader *rd, const char *path);
+
+/*
+ * reader_set_fields
+ *
+ * Tells the reader which GameRecord fields the caller uses
+ * (FIELD_* bits). Other fields may be left unchanged.
+ */
+void reader_set_fields(RecordReader *rd, unsigned fields);
+
+/*
+ * reader_next
+ *
+ * Reads and validates the next record.
+ *
+ * Returns:
+ *   RECORD_OK  - *rec holds the record
+ *   RECORD_EOF - end of input
+ *   BAD_DATE   - the record has an invalid date
+ *   BAD_RECORD - the line is malformed or has invalid stats
+ *   FILE_READ_ERR - read() failed part way through the file
+ *
+ * After an error, rd->err_line / rd->err_offset give the line number
+ * and byte offset of the start of the offending line (for column
+ * files: the record number and the offset of its row group), and
+ * rd->err_reason says what was wrong with it.
+ *
+ * A bad text line is consumed: calling reader_next() again continues
+ * with the next line, so a caller may skip bad records and go on (see
+ * plan_set_lenient). A damaged column file cannot be resynchronized;
+ * it keeps returning BAD_RECORD.
+ */
+int reader_next(RecordReader *rd, GameRecord *rec);
+
+/*
+ * reader_tell / reader_seek
+ *
+ * reader_tell() returns the position of the next unread byte (text
+ * files) or record (column files), in the same units as rec_offset.
+ * reader_seek() continues reading from a position returned by
+ * reader_tell() or stored in rec_offset; line numbers in error
+ * locations are 0 after a seek, unless the caller knows the line
+ * number at pos and sets rd->line. Only memory-mapped inputs can seek.
+ *
+ * reader_seek() returns SUCCESS, or FILE_READ_ERR if the input is not
+ * mapped or the position is past the end.
+ */
+long long reader_tell(const RecordReader *rd);
+int reader_seek(RecordReader *rd, long long pos);
+
+/*
+ * reader_seek_date
+ *
+ * On a memory-mapped input whose records are in date order (dates
+ * never go down), continues reading at the first record dated on or
+ * after year-month-day (or at the end), by binary search. On an
+ * unsorted input the position is meaningless.
+ *
+ * Returns SUCCESS, FILE_READ_ERR if the input is not mapped, or the
+ * error of a bad record a probe landed on.
+ */
+int reader_seek_date(RecordReader *rd, int year, int month, int day);
+
+/*
+ * reader_known_sorted / reader_remember_sorted
+ *
+ * reader_remember_sorted() records, for this process, that the mapped
+ * file rd reads was found in date order with no bad records.
+ * reader_known_sorted() is 1 if that was recorded for the file as it
+ * is now (same file, size and modification time), else 0.
+ */
+int reader_known_sorted(const RecordReader *rd);
+void reader_remember_sorted(const RecordReader *rd);
+
+/*
+ * reader_name_count / reader_name
+ *
+ * The name dictionary of a column file: reader_name_count() returns how
+ * many player (READER_PLAYERS) or team (READER_TEAMS) names it holds,
+ * 0 for text files. reader_name() returns name number id (not
+ * null-terminated) and stores its length in *len.
+ *
+ * Callers that compare names can compare each dictionary entry once,
+ * then compare only the ids in GameRecord.
+ */
+uint32_t reader_name_count(const RecordReader *rd, int kind);
+const char *reader_name(const RecordReader *rd, int kind, uint32_t id, size_t *len);
+
+/*
+ * reader_close
+ *
+ * Unmaps / closes the file and frees the buffer. Safe to call twice.
+ */
+void reader_close(RecordReader *rd);
+
+#endif /* RECORD_READER_H */
@@ -0,0 +1,431 @@
+/*
+ * roster_report.c - Player reports for a whole team from one scan
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Hash aggregation: each team row's player is looked up once (or
+ *    read as a dictionary id from a column file) and its numbers are
+ *    added to that player's bucket
+ * 2. Match boundaries are tracked once for every player: the players
+ *    with rows in the open match are a short list, credited with a
+ *    win when the match closes
+ * 3. Many output files handed to one background writer
+ *
+ * The per-player answers follow query_plan.c exactly: only rows of
+ * the team count, a match is a run of same-date records, and the
+ * team won it if its rows scored more than all other rows.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "hw2.h"
+#include "intern.h"
+#include "record_reader.h"
+#include "output_writer.h"
+#include "roster_report.h"
+
+/* ============================================================
+ * HELPER FUNCTIONS: Growing arrays
+ * ============================================================
+ * Same RESERVE as team_table.c: grows array (by doubling) until it
+ * holds at least `needed` elements, or returns NO_MEMORY.
+ */
+#define RESERVE(array, capacity, needed) do { \
+        if ((needed) > (capacity)) { \
+            uint32_t new_capacity = (capacity) ? (capacity) * 2 : 16; \
+            void *grown; \
+            while (new_capacity < (needed)) { \
+                new_capacity *= 2; \
+            } \
+            grown = realloc((array), (size_t)new_capacity * sizeof(*(array))); \
+            if (grown == NULL) { \
+                return NO_MEMORY; \
+            } \
+            (array) = grown; \
+            (capacity) = new_capacity; \
+        } \
+    } while (0)
+
+/* The match being read */
+typedef struct {
+    int year, month, day;        /* -1 before the first record */
+    uint32_t number;             /* 1, 2, 3, ... (0 = none yet) */
+    int home_score, opponent_score;
+    uint32_t *players;           /* players with a team row in it */
+    uint32_t count, capacity;
+} OpenMatch;
+
+/* Everything roster_build() needs while reading */
+typedef struct {
+    const char *team;
+    size_t team_len;
+    uint32_t home_id;            /* column files: the team's dictionary id */
+    uint32_t *names;             /* column files: player dictionary id -> player */
+} ScanState;
+
+/* ============================================================
+ * HELPER FUNCTION: add_player
+ * ============================================================
+ * Player name -> id; a new player gets zeroed totals.
+ */
+static int add_player(Roster *r, const char *name, size_t len, uint32_t *id) {
+    uint32_t before = r->players.count;
+
+    if (intern_add(&r->players, name, len, id) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    if (r->players.count != before) {
+        RESERVE(r->totals, r->totals_capacity, r->players.count);
+        memset(&r->totals[*id], 0, sizeof(RosterTotals));
+    }
+    return SUCCESS;
+}
+
+/*
+ * Column files name the team once: find its id up front, so rows are
+ * tested with an integer compare. Players get their roster id on
+ * their first team row (names[] starts out as ROSTER_NONE).
+ */
+static int map_dictionary(ScanState *s, const RecordReader *rd) {
+    uint32_t teams = reader_name_count(rd, READER_TEAMS);
+    uint32_t players = reader_name_count(rd, READER_PLAYERS);
+
+    s->home_id = RECORD_NO_ID;
+    s->names = NULL;
+    for (uint32_t id = 0; id < teams; id++) {
+        size_t len;
+        const char *name = reader_name(rd, READER_TEAMS, id, &len);
+
+        if (len == s->team_len && memcmp(name, s->team, len) == 0) {
+            s->home_id = id;
+        }
+    }
+    if (players == 0) {
+        return SUCCESS;
+    }
+    s->names = malloc((size_t)players * sizeof(uint32_t));
+    if (s->names == NULL) {
+        return NO_MEMORY;
+    }
+    for (uint32_t id = 0; id < players; id++) {
+        s->names[id] = ROSTER_NONE;
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: close_match
+ * ============================================================
+ * A win counts once for every player with a team row in the match.
+ */
+static void close_match(Roster *r, const OpenMatch *open) {
+    if (open->home_score <= open->opponent_score) {
+        return;
+    }
+    for (uint32_t i = 0; i < open->count; i++) {
+        r->totals[open->players[i]].games_won++;
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: feed
+ * ============================================================
+ */
+static int feed(Roster *r, ScanState *s, OpenMatch *open, const GameRecord *rec) {
+    RosterTotals *t;
+    uint32_t player;
+    int home_row;
+
+    if (rec->year != open->year || rec->month != open->month || rec->day != open->day) {
+        if (open->year != -1) {
+            close_match(r, open);
+        }
+        open->year = rec->year;
+        open->month = rec->month;
+        open->day = rec->day;
+        open->number++;
+        open->home_score = 0;
+        open->opponent_score = 0;
+        open->count = 0;
+    }
+
+    if (s->names != NULL) {
+        home_row = rec->team_id == s->home_id;
+    } else {
+        home_row = rec->team_len == s->team_len && memcmp(rec->team, s->team, s->team_len) == 0;
+    }
+    if (!home_row) {
+        open->opponent_score += rec->points;
+        return SUCCESS;
+    }
+    open->home_score += rec->points;
+
+    if (s->names != NULL) {
+        player = s->names[rec->player_id];
+        if (player == ROSTER_NONE) {
+            if (add_player(r, rec->player, rec->player_len, &player) != SUCCESS) {
+                return NO_MEMORY;
+            }
+            s->names[rec->player_id] = player;
+        }
+    } else if (add_player(r, rec->player, rec->player_len, &player) != SUCCESS) {
+        return NO_MEMORY;
+    }
+
+    t = &r->totals[player];
+    t->total_points += rec->points;
+    t->total_assists += rec->assists;
+    t->total_blocks += rec->blocks;
+    t->total_minutes += rec->minutes;
+    t->games_played++;
+    if (t->last_match != open->number) {
+        t->last_match = open->number;
+        RESERVE(open->players, open->capacity, open->count + 1);
+        open->players[open->count++] = player;
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: roster_build
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - One scan, however many players the team has
+ * - Rows of other teams only add to the opponent score
+ */
+int roster_build(Roster *r, const char *in_file, const char *team, ParseError *err) {
+    RecordReader rd;
+    GameRecord rec;
+    OpenMatch open;
+    ScanState s;
+    int status;
+
+    memset(r, 0, sizeof(*r));
+    if (err != NULL) {
+        err->code = SUCCESS;
+        err->line = 0;
+        err->offset = 0;
+    }
+
+    status = reader_open(&rd, in_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    memset(&open, 0, sizeof(open));
+    open.year = -1;
+    s.team = team;
+    s.team_len = strlen(team);
+    s.names = NULL;
+
+    status = intern_init(&r->players);
+    if (status == SUCCESS) {
+        status = map_dictionary(&s, &rd);
+    }
+    if (status == SUCCESS) {
+        while ((status = reader_next(&rd, &rec)) == RECORD_OK) {
+            if (feed(r, &s, &open, &rec) != SUCCESS) {
+                status = NO_MEMORY;
+                break;
+            }
+        }
+    }
+
+    if (status == RECORD_EOF) {
+        status = SUCCESS;
+        if (open.year != -1) {
+            close_match(r, &open);
+        }
+    } else if (status != NO_MEMORY && err != NULL) {
+        err->code = status;
+        err->line = rd.err_line;
+        err->offset = rd.err_offset;
+    }
+    free(s.names);
+    free(open.players);
+    reader_close(&rd);
+
+    if (status != SUCCESS) {
+        roster_free(r);
+    }
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: roster_free
+ * ============================================================
+ */
+void roster_free(Roster *r) {
+    intern_free(&r->players);
+    free(r->totals);
+    memset(r, 0, sizeof(*r));
+}
+
+/* ============================================================
+ * FUNCTIONS: Players
+ * ============================================================
+ */
+uint32_t roster_count(const Roster *r) {
+    return r->players.count;
+}
+
+const char *roster_name(const Roster *r, uint32_t player) {
+    return intern_name(&r->players, player, NULL);
+}
+
+/* ============================================================
+ * FUNCTION: roster_format_report
+ * ============================================================
+ * The lines of report_end() in query_plan.c; every roster player has
+ * at least one row, so games is never 0.
+ */
+static void report_line(OutBuf *text, const char *label, double value) {
+    out_cstr(text, label);
+    out_fixed2(text, value);
+    out_char(text, '\n');
+}
+
+void roster_format_report(const Roster *r, uint32_t player, OutBuf *text) {
+    const RosterTotals *t = &r->totals[player];
+    int games = t->games_played;
+
+    out_cstr(text, "Player: ");
+    out_cstr(text, roster_name(r, player));
+    out_cstr(text, "\nGames: ");
+    out_int(text, games);
+    out_cstr(text, "\nGames Won: ");
+    out_int(text, t->games_won);
+    out_char(text, '\n');
+    report_line(text, "Points per Game: ", (double)t->total_points / games);
+    report_line(text, "Assists per Game: ", (double)t->total_assists / games);
+    report_line(text, "Blocks per Game: ", (double)t->total_blocks / games);
+    report_line(text, "Average Minutes: ", t->total_minutes / games);
+}
+
+/* ============================================================
+ * FUNCTION: roster_write
+ * ============================================================
+ */
+int roster_write(const Roster *r, const char *out_file) {
+    OutputWriter w;
+    OutFile *f;
+    OutBuf text;
+    int status;
+
+    if (roster_count(r) == 0) {
+        return NO_DATA_POINTS;
+    }
+    if (writer_init(&w, 0) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    status = outfile_open(&w, out_file, &f);
+    if (status == SUCCESS) {
+        outbuf_init(&text);
+        for (uint32_t p = 0; p < roster_count(r); p++) {
+            if (p > 0) {
+                out_char(&text, '\n');
+            }
+            roster_format_report(r, p, &text);
+            outfile_chunk(f, &text);
+        }
+        outfile_close(f, &text);
+        writer_finish(&w);
+        status = outfile_status(f);
+    }
+    writer_free(&w);
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: roster_write_files
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Player names make poor file names ("Z. Edey"), so they are
+ *   reduced to letters, digits and '_'
+ * - Two players may reduce to the same name; an InternTable of the
+ *   names already used catches that
+ * - The writer thread writes one report while the next is formatted
+ */
+
+/* out_prefix + reduced name (+ "_<id>" on a clash) + suffix */
+static int file_name(const Roster *r, uint32_t player, const char *out_prefix,
+                     InternTable *used, OutBuf *path) {
+    const char *name = roster_name(r, player);
+    size_t start;
+    uint32_t id;
+    int gap = 0;
+
+    path->len = 0;
+    out_cstr(path, out_prefix);
+    start = path->len;
+    for (const char *c = name; *c != '\0'; c++) {
+        if (isalnum((unsigned char)*c)) {
+            if (gap && path->len > start) {
+                out_char(path, '_');
+            }
+            out_char(path, *c);
+            gap = 0;
+        } else {
+            gap = 1;
+        }
+    }
+    if (intern_find(used, path->data + start, path->len - start) >= 0) {
+        out_char(path, '_');
+        out_int(path, player);
+    }
+    if (path->failed || intern_add(used, path->data + start, path->len - start, &id) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    out_cstr(path, ROSTER_FILE_SUFFIX);
+    out_char(path, '\0');
+    return path->failed ? NO_MEMORY : SUCCESS;
+}
+
+int roster_write_files(const Roster *r, const char *out_prefix) {
+    OutputWriter w;
+    InternTable used;
+    OutBuf path, text;
+    int status = SUCCESS;
+
+    if (roster_count(r) == 0) {
+        return NO_DATA_POINTS;
+    }
+    if (intern_init(&used) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    if (writer_init(&w, 1) != SUCCESS) {
+        intern_free(&used);
+        return NO_MEMORY;
+    }
+    outbuf_init(&path);
+
+    for (uint32_t p = 0; p < roster_count(r) && status != NO_MEMORY; p++) {
+        OutFile *f;
+        int opened;
+
+        if (file_name(r, p, out_prefix, &used, &path) != SUCCESS) {
+            status = NO_MEMORY;
+            break;
+        }
+        opened = outfile_open(&w, path.data, &f);
+        if (opened != SUCCESS) {
+            status = opened;
+            continue;
+        }
+        outbuf_init(&text);
+        roster_format_report(r, p, &text);
+        outfile_close(f, &text);
+    }
+
+    /* Wait for the writes; the first failure is the result */
+    writer_finish(&w);
+    for (OutFile *f = w.files; f != NULL && status == SUCCESS; f = f->next) {
+        status = outfile_status(f);
+    }
+    writer_free(&w);
+    outbuf_free(&path);
+    intern_free(&used);
+    return status;
+}
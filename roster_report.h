@@ -0,0 +1,118 @@
+/*
+ * roster_report.h - Player reports for a whole team from one scan
+ *
+ * This file contains:
+ * - The Roster structure (per-player totals keyed by player id)
+ * - Functions to fill it from a game data file and write the reports
+ *
+ * Learning Concepts:
+ * - Hash aggregation again (see team_table.h), keyed by player: the
+ *   player name -> id table is a flat open-addressing InternTable, the
+ *   totals are a plain array indexed by id
+ * - Stamping each player with the last match seen, so "games won"
+ *   counts a match once however many rows the player has in it
+ *
+ * Typical use:
+ *   Roster r;
+ *   if (roster_build(&r, "game_data.txt", "Purdue", NULL) == SUCCESS) {
+ *       roster_write(&r, "purdue_roster.txt");        // one file
+ *       roster_write_files(&r, "reports/purdue_");    // one per player
+ *       roster_free(&r);
+ *   }
+ *
+ * Each player's report is exactly what team_player_report() (hw2.h)
+ * writes for that team and player - for 15 players that is one scan
+ * of the file instead of 15.
+ */
+
+#ifndef ROSTER_REPORT_H
+#define ROSTER_REPORT_H
+
+#include <stdint.h>
+#include "hw2.h"
+#include "intern.h"
+#include "output_writer.h"
+
+/* ========== CONSTANTS ========== */
+#define ROSTER_NONE UINT32_MAX        /* "not a player of the team" id */
+#define ROSTER_FILE_SUFFIX ".txt"     /* roster_write_files() */
+
+/* ========== TYPES ========== */
+
+/* Totals of one player (index = player id); rows of the team only */
+typedef struct {
+    int total_points, total_assists, total_blocks;
+    float total_minutes;         /* summed in file order, like the report */
+    int games_played;            /* rows */
+    int games_won;               /* matches with a row that the team won */
+    uint32_t last_match;         /* number of the last match with a row */
+} RosterTotals;
+
+/*
+ * Results of one scan. Treat as private; use the functions below.
+ */
+typedef struct {
+    InternTable players;         /* player name -> id (order of first row) */
+    RosterTotals *totals;        /* id -> totals */
+    uint32_t totals_capacity;
+} Roster;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * roster_build
+ *
+ * Reads in_file (text or column file) once and totals every player
+ * with at least one row of team.
+ *
+ * Returns:
+ *   SUCCESS, FILE_READ_ERR, NO_MEMORY, or the BAD_RECORD / BAD_DATE
+ *   the hw2.h functions would report for this file (err, if not NULL,
+ *   gets its location). On failure there is nothing to free.
+ */
+int roster_build(Roster *r, const char *in_file, const char *team, ParseError *err);
+
+/*
+ * roster_free
+ */
+void roster_free(Roster *r);
+
+/*
+ * roster_count / roster_name
+ *
+ * Players are numbered 0 .. count-1 in order of their first row.
+ */
+uint32_t roster_count(const Roster *r);
+const char *roster_name(const Roster *r, uint32_t player);
+
+/*
+ * roster_format_report
+ *
+ * Appends player's report, as team_player_report() writes it.
+ */
+void roster_format_report(const Roster *r, uint32_t player, OutBuf *text);
+
+/*
+ * roster_write
+ *
+ * Writes every player's report to out_file, separated by blank lines.
+ *
+ * Returns: SUCCESS, NO_DATA_POINTS (no players; out_file is not
+ * touched), FILE_WRITE_ERR or NO_MEMORY
+ */
+int roster_write(const Roster *r, const char *out_file);
+
+/*
+ * roster_write_files
+ *
+ * Writes one report file per player, named out_prefix + the player's
+ * name (letters and digits kept, anything else becomes '_') +
+ * ROSTER_FILE_SUFFIX, e.g. "reports/purdue_Z_Edey.txt". A name that
+ * would clash with an earlier player's gets the player id appended.
+ *
+ * Returns: SUCCESS, NO_DATA_POINTS (no players), FILE_WRITE_ERR (any
+ * file; the others are still written) or NO_MEMORY
+ */
+int roster_write_files(const Roster *r, const char *out_prefix);
+
+#endif /* ROSTER_REPORT_H */
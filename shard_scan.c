@@ -0,0 +1,460 @@
+/*
+ * shard_scan.c - Run a QueryPlan over a dataset split into many files
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Listing a directory (opendir / readdir) and matching a pattern
+ *    (glob), sorted so the shard order never depends on the disk
+ * 2. A thread pool sharing one "next shard" counter under a mutex
+ * 3. One plan_fork() per shard, merged in shard order
+ * 4. Skipping shards by their index's first and last date
+ *
+ * See shard_scan.h for how a dataset is named.
+ */
+
+/* Needed for glob(), strdup() and getline() with -std=c17 */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include "hw2.h"
+#include "record_reader.h"
+#include "file_index.h"
+#include "match_table.h"
+#include "checkpoint.h"
+#include "query_plan.h"
+#include "parallel_scan.h"
+#include "shard_scan.h"
+#include "stats.h"
+
+/* ========== TYPES ========== */
+
+/* One shard and the copy of the plan that scans it */
+typedef struct {
+    QueryPlan worker;
+    const char *file;
+    int pruned;                  /* outside the date window: not scanned */
+    int forked;
+    int status;
+    ParseError error;
+} ShardJob;
+
+/* The work shared by the pool's threads */
+typedef struct {
+    ShardJob *jobs;
+    int count;
+    unsigned fields;
+    pthread_mutex_t lock;
+    int next;                    /* next shard to scan */
+    int first_failed;            /* lowest shard that failed, or count */
+} ShardPool;
+
+/* ========== BUILDING THE LIST ========== */
+
+int shard_list_add(ShardList *list, const char *path) {
+    char *copy;
+
+    if (list->count == list->capacity) {
+        int capacity = list->capacity == 0 ? 16 : list->capacity * 2;
+        char **files = realloc(list->files, (size_t)capacity * sizeof(char *));
+        if (files == NULL) {
+            return NO_MEMORY;
+        }
+        list->files = files;
+        list->capacity = capacity;
+    }
+    copy = strdup(path);
+    if (copy == NULL) {
+        return NO_MEMORY;
+    }
+    list->files[list->count++] = copy;
+    return SUCCESS;
+}
+
+void shard_list_free(ShardList *list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->files[i]);
+    }
+    free(list->files);
+    list->files = NULL;
+    list->count = list->capacity = 0;
+}
+
+static int ends_with(const char *name, const char *suffix) {
+    size_t len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+
+    return len >= suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+/* Regular files that are not hidden and not another file's sidecar */
+static int is_data_file(const char *path) {
+    const char *name = strrchr(path, '/');
+    struct stat st;
+
+    name = name != NULL ? name + 1 : path;
+    if (name[0] == '.' || ends_with(name, INDEX_SUFFIX) || ends_with(name, MATCH_SUFFIX) ||
+        ends_with(name, CHECKPOINT_SUFFIX)) {
+        return 0;
+    }
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Every data file in dir, by name */
+static int add_directory(ShardList *list, const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *entry;
+    size_t dir_len = strlen(dir);
+    int first = list->count;
+    int status = SUCCESS;
+
+    if (d == NULL) {
+        return FILE_READ_ERR;
+    }
+    while (status == SUCCESS && (entry = readdir(d)) != NULL) {
+        size_t len = dir_len + strlen(entry->d_name) + 2;
+        char *path = malloc(len);
+
+        if (path == NULL) {
+            status = NO_MEMORY;
+            break;
+        }
+        snprintf(path, len, "%s%s%s", dir,
+                 dir_len > 0 && dir[dir_len - 1] == '/' ? "" : "/", entry->d_name);
+        if (is_data_file(path)) {
+            status = shard_list_add(list, path);
+        }
+        free(path);
+    }
+    closedir(d);
+
+    qsort(list->files + first, (size_t)(list->count - first), sizeof(char *), compare_paths);
+    return status;
+}
+
+/* Every data file matching pattern; glob() sorts them */
+static int add_pattern(ShardList *list, const char *pattern) {
+    glob_t g;
+    int status = SUCCESS;
+
+    if (glob(pattern, 0, NULL, &g) != 0) {
+        return FILE_READ_ERR;  /* no match, or a read error */
+    }
+    for (size_t i = 0; i < g.gl_pathc && status == SUCCESS; i++) {
+        if (is_data_file(g.gl_pathv[i])) {
+            status = shard_list_add(list, g.gl_pathv[i]);
+        }
+    }
+    globfree(&g);
+    return status;
+}
+
+/* The paths listed in list_file, one per line */
+static int add_list_file(ShardList *list, const char *list_file) {
+    FILE *fp = fopen(list_file, "r");
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    int status = SUCCESS;
+
+    if (fp == NULL) {
+        return FILE_READ_ERR;
+    }
+    while (status == SUCCESS && (len = getline(&line, &capacity, fp)) >= 0) {
+        char *start = line;
+
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' ||
+                           line[len - 1] == ' ' || line[len - 1] == '\t')) {
+            line[--len] = '\0';
+        }
+        while (*start == ' ' || *start == '\t') {
+            start++;
+        }
+        if (*start != '\0' && *start != '#') {
+            status = shard_list_add(list, start);
+        }
+    }
+    free(line);
+    fclose(fp);
+    return status;
+}
+
+int shard_is_spec(const char *in_file) {
+    struct stat st;
+
+    if (stat(in_file, &st) == 0) {
+        return S_ISDIR(st.st_mode);
+    }
+    return in_file[0] == SHARD_LIST_PREFIX || strpbrk(in_file, "*?[") != NULL;
+}
+
+int shard_list_expand(ShardList *list, const char *spec) {
+    struct stat st;
+    int before = list->count;
+    int status;
+
+    if (stat(spec, &st) == 0) {
+        status = S_ISDIR(st.st_mode) ? add_directory(list, spec) : shard_list_add(list, spec);
+    } else if (spec[0] == SHARD_LIST_PREFIX) {
+        status = add_list_file(list, spec + 1);
+    } else {
+        status = add_pattern(list, spec);
+    }
+    if (status == SUCCESS && list->count == before) {
+        status = FILE_READ_ERR;  /* an empty dataset */
+    }
+    return status;
+}
+
+/* ========== SCANNING ========== */
+
+/* Does the shard's index show no date inside the plan's window? */
+static int outside_window(const QueryPlan *plan, const char *file) {
+    FileIndex ix;
+    long long first, last;
+    int outside;
+
+    if (index_open(&ix, file) != SUCCESS) {
+        return 0;  /* no (usable) index: scan it */
+    }
+    if (index_date_bounds(&ix, &first, &last) != SUCCESS) {
+        outside = 1;  /* no records at all */
+    } else {
+        outside = last < plan->range_from || first > plan->range_to;
+    }
+    index_close(&ix);
+    return outside;
+}
+
+/* Feeds one whole shard to its worker */
+static void scan_shard(ShardJob *job, unsigned fields) {
+    RecordReader rd;
+    int status;
+
+    status = reader_open(&rd, job->file);
+    if (status != SUCCESS) {
+        job->status = status;
+        return;
+    }
+    reader_set_fields(&rd, fields);
+
+    /* Column shards each have their own name dictionary */
+    status = plan_bind(&job->worker, &rd);
+    if (status == SUCCESS) {
+        status = plan_feed_reader(&job->worker, &rd);
+        if (status != SUCCESS) {
+            job->error.code = status;
+            job->error.line = rd.err_line;
+            job->error.offset = rd.err_offset;
+        }
+    }
+    if (status == SUCCESS) {
+        status = job->worker.feed_status;
+    }
+    reader_close(&rd);
+    job->status = status;
+}
+
+/*
+ * Thread body: scan shards until none are left. Shards after one
+ * that failed are not needed (the run stops at the first error).
+ */
+static void *pool_thread(void *arg) {
+    ShardPool *pool = arg;
+
+    for (;;) {
+        int i;
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->next < pool->count && pool->jobs[pool->next].pruned) {
+            pool->next++;
+        }
+        i = pool->next++;
+        if (i >= pool->count || i > pool->first_failed) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        scan_shard(&pool->jobs[i], pool->fields);
+        STATS_FLUSH(&pool->jobs[i].worker.stats);   /* plan_merge() takes them back */
+
+        if (pool->jobs[i].status != SUCCESS) {
+            pthread_mutex_lock(&pool->lock);
+            if (i < pool->first_failed) {
+                pool->first_failed = i;
+            }
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+    return NULL;
+}
+
+/* What plan_run() does when its input cannot be opened */
+static int fail_queries(QueryPlan *plan, int status) {
+    for (int i = 0; i < plan->count; i++) {
+        if (!plan->queries[i].done) {
+            plan->queries[i].result = status;
+        }
+    }
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: plan_run_shards
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Pruning happens before any thread starts: it only reads indexes
+ * - plan_begin() once, plan_fork() per shard, a pool of threads,
+ *   then plan_merge() IN SHARD ORDER and plan_end() as usual
+ * - A match that ends one shard and goes on at the start of the next
+ *   is joined by plan_merge(), as for the chunks of parallel_scan.c
+ */
+int plan_run_shards(QueryPlan *plan, const ShardList *list, int threads, ShardStats *stats) {
+    ShardStats local_stats;
+    ShardPool pool;
+    pthread_t thread_ids[PARALLEL_MAX_THREADS];
+    int started = 0;
+    int remaining = 0;
+    int last = -1;
+    int any_active = 0;
+    int status = SUCCESS;
+
+    if (stats == NULL) {
+        stats = &local_stats;
+    }
+    stats->shards = list->count;
+    stats->pruned = 0;
+    stats->failed = -1;
+    plan->error.code = SUCCESS;
+    plan->error.line = 0;
+    plan->error.offset = 0;
+    memset(&plan->bad, 0, sizeof(plan->bad));
+
+    for (int i = 0; i < plan->count; i++) {
+        if (!plan->queries[i].done) {
+            any_active = 1;
+        }
+    }
+    if (!any_active) {
+        return SUCCESS;
+    }
+    if (list->count == 0) {
+        return fail_queries(plan, FILE_READ_ERR);
+    }
+
+    memset(&pool, 0, sizeof(pool));
+    pool.jobs = calloc((size_t)list->count, sizeof(ShardJob));
+    if (pool.jobs == NULL) {
+        return fail_queries(plan, NO_MEMORY);
+    }
+    pool.count = list->count;
+    pool.first_failed = list->count;
+    for (int i = 0; i < list->count; i++) {
+        ShardJob *job = &pool.jobs[i];
+
+        job->file = list->files[i];
+        job->error.code = SUCCESS;
+        job->pruned = plan->ranged && outside_window(plan, job->file);
+        if (job->pruned) {
+            stats->pruned++;
+        } else {
+            remaining++;
+            last = i;
+        }
+    }
+
+    /* One shard left: the single-file path (index, match table, chunks) */
+    if (remaining == 1) {
+        free(pool.jobs);
+        status = plan_run_parallel(plan, list->files[last], threads);
+        if (status != SUCCESS) {
+            stats->failed = last;
+        }
+        return status;
+    }
+
+    status = plan_begin(plan);
+    if (status != SUCCESS) {
+        free(pool.jobs);
+        return fail_queries(plan, status);
+    }
+    pool.fields = plan_fields(plan);
+    for (int i = 0; i < pool.count && status == SUCCESS; i++) {
+        if (!pool.jobs[i].pruned) {
+            status = plan_fork(plan, &pool.jobs[i].worker);
+            pool.jobs[i].forked = status == SUCCESS;
+        }
+    }
+
+    if (status == SUCCESS) {
+        if (threads > remaining) {
+            threads = remaining;
+        }
+        if (threads > PARALLEL_MAX_THREADS) {
+            threads = PARALLEL_MAX_THREADS;
+        }
+        pthread_mutex_init(&pool.lock, NULL);
+        for (int t = 1; t < threads; t++) {
+            if (pthread_create(&thread_ids[started], NULL, pool_thread, &pool) == 0) {
+                started++;
+            }
+        }
+        pool_thread(&pool);  /* this thread works too */
+        for (int t = 0; t < started; t++) {
+            pthread_join(thread_ids[t], NULL);
+        }
+        pthread_mutex_destroy(&pool.lock);
+
+        /* Everything up to the first failed shard, in shard order */
+        for (int i = 0; i < pool.count && i <= pool.first_failed; i++) {
+            if (!pool.jobs[i].pruned) {
+                plan_merge(plan, &pool.jobs[i].worker);
+            }
+        }
+        if (pool.first_failed < pool.count) {
+            status = pool.jobs[pool.first_failed].status;
+            plan->error = pool.jobs[pool.first_failed].error;
+            stats->failed = pool.first_failed;
+        }
+    }
+
+    for (int i = 0; i < pool.count; i++) {
+        if (pool.jobs[i].forked) {
+            plan_discard(&pool.jobs[i].worker);
+        }
+    }
+    free(pool.jobs);
+    plan_end(plan, status);
+    return status;
+}
+
+int plan_run_sharded(QueryPlan *plan, const char *spec, int threads, ShardStats *stats) {
+    ShardList list = {NULL, 0, 0};
+    int status = shard_list_expand(&list, spec);
+
+    if (status != SUCCESS) {
+        shard_list_free(&list);
+        if (stats != NULL) {
+            stats->shards = stats->pruned = 0;
+            stats->failed = -1;
+        }
+        plan->error.code = SUCCESS;
+        plan->error.line = 0;
+        plan->error.offset = 0;
+        memset(&plan->bad, 0, sizeof(plan->bad));
+        return fail_queries(plan, status);
+    }
+    status = plan_run_shards(plan, &list, threads, stats);
+    shard_list_free(&list);
+    return status;
+}
@@ -0,0 +1,108 @@
+/*
+ * shard_scan.h - Run a QueryPlan over a dataset split into many files
+ *
+ * This file contains:
+ * - The ShardList and ShardStats structures
+ * - Functions to turn a directory, a glob pattern or a list file into
+ *   an ordered list of files
+ * - plan_run_shards(), a plan_run() over all of them at once
+ *
+ * Learning Concepts:
+ * - A thread pool: a few threads take the next unscanned shard from
+ *   a shared counter until none are left
+ * - Partial aggregates: every shard gets its own copy of the plan
+ *   (plan_fork), and the copies are merged in shard order
+ *   (plan_merge), so the result does not depend on which thread
+ *   finished first
+ * - Pruning with metadata: a shard whose index (file_index.h) shows
+ *   no date inside the plan's date window is not opened at all
+ *
+ * A dataset split by season or conference is named by one string,
+ * accepted wherever a hw2.h function takes in_file:
+ *
+ *   "seasons/"           every data file in the directory
+ *   "seasons/20*.txt"    every file matching a glob(3) pattern
+ *   "@shards.txt"        the files listed in shards.txt, one per line
+ *                        (blank lines and lines starting with '#'
+ *                        are ignored)
+ *
+ * Directories and patterns are sorted by name; sidecar files (.idx,
+ * .mtab, .ckpt) and hidden files are left out. Results are those of
+ * one file holding the shards one after another, in that order.
+ */
+
+#ifndef SHARD_SCAN_H
+#define SHARD_SCAN_H
+
+#include "query_plan.h"
+
+/* ========== CONSTANTS ========== */
+#define SHARD_LIST_PREFIX '@'
+
+/* ========== TYPES ========== */
+
+/* The files of a dataset, in order */
+typedef struct {
+    char **files;
+    int count;
+    int capacity;
+} ShardList;
+
+/* What a plan_run_shards() did */
+typedef struct {
+    int shards;                  /* files in the list */
+    int pruned;                  /* skipped: outside the date window */
+    int failed;                  /* shard whose error ended the run, or -1 */
+} ShardStats;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * shard_is_spec
+ *
+ * 1 if in_file names several files (a directory, a pattern or a list
+ * file, as above) rather than one data file, else 0. An existing
+ * file is always one data file, whatever its name.
+ */
+int shard_is_spec(const char *in_file);
+
+/*
+ * shard_list_expand / shard_list_add / shard_list_free
+ *
+ * shard_list_expand() appends the files spec names to list (start
+ * from a zeroed ShardList). shard_list_add() appends one path.
+ *
+ * Returns SUCCESS, NO_MEMORY, or FILE_READ_ERR if the directory or
+ * list file cannot be read or nothing matches the pattern.
+ */
+int shard_list_expand(ShardList *list, const char *spec);
+int shard_list_add(ShardList *list, const char *path);
+void shard_list_free(ShardList *list);
+
+/*
+ * plan_run_shards
+ *
+ * Same results as plan_run() on the concatenation of list's files,
+ * using up to `threads` threads (at most one per shard). With a date
+ * window set (plan_set_date_range), a shard with an up-to-date index
+ * whose dates all fall outside the window is skipped. A single
+ * remaining shard is handed to plan_run_parallel().
+ *
+ * Each shard is read from its start, so the line numbers of bad
+ * records (plan_parse_error, plan_bad_records) count lines of their
+ * own shard; stats->failed says which one stopped the run. Indexes and
+ * match tables only serve for pruning here. stats may be NULL.
+ *
+ * Returns: as plan_run().
+ */
+int plan_run_shards(QueryPlan *plan, const ShardList *list, int threads, ShardStats *stats);
+
+/*
+ * plan_run_sharded
+ *
+ * shard_list_expand(spec), then plan_run_shards(). If spec cannot be
+ * expanded, every active query gets that error.
+ */
+int plan_run_sharded(QueryPlan *plan, const char *spec, int threads, ShardStats *stats);
+
+#endif /* SHARD_SCAN_H */
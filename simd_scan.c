@@ -0,0 +1,211 @@
+/*
+ * simd_scan.c - Vectorized helpers for the text record tokenizer
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Runtime dispatch - __builtin_cpu_supports() asks the CPU which
+ *    instructions it has; target("...") compiles one function for them
+ * 2. SSE4.2 string instructions - _mm_cmpestrm() finds any of a set of
+ *    characters in 16 bytes
+ * 3. AVX2 compares - 32 byte compares, one bit per byte with movemask
+ * 4. Vectorized digit conversion - multiply-add instructions turn
+ *    "2024-01-15" into 2024, 1 and 15 without a loop
+ */
+
+/* Needed for getenv() and pthread_once() with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "simd_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+/* ========== STATE ========== */
+static pthread_once_t level_once = PTHREAD_ONCE_INIT;
+static int chosen_level = SIMD_SCALAR;
+
+static const char *level_names[] = { "scalar", "sse4.2", "avx2" };
+
+/* ============================================================
+ * HELPER FUNCTION: choose_level
+ * ============================================================
+ * Runs once (pthread_once), so threads never race on chosen_level.
+ */
+static void choose_level(void) {
+    const char *wanted = getenv("HW2_SIMD");
+    int level = SIMD_SCALAR;
+
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        level = SIMD_SSE42;
+        if (__builtin_cpu_supports("avx2")) {
+            level = SIMD_AVX2;
+        }
+    }
+#endif
+
+    if (wanted != NULL) {
+        for (int i = SIMD_SCALAR; i < level; i++) {
+            if (strcmp(wanted, level_names[i]) == 0) {
+                level = i;
+            }
+        }
+    }
+    chosen_level = level;
+}
+
+/* ============================================================
+ * FUNCTION: simd_level / simd_level_name
+ * ============================================================
+ */
+int simd_level(void) {
+    pthread_once(&level_once, choose_level);
+    return chosen_level;
+}
+
+const char *simd_level_name(int level) {
+    if (level < SIMD_SCALAR || level > SIMD_AVX2) {
+        return "unknown";
+    }
+    return level_names[level];
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: Delimiter masks, one per level
+ * ============================================================
+ * Each returns the mask for whole blocks that fit in avail and leaves
+ * the rest (from *done on) to the scalar loop.
+ */
+static uint64_t mask_scalar(const char *p, size_t from, size_t len) {
+    uint64_t mask = 0;
+
+    for (size_t i = from; i < len; i++) {
+        if (p[i] == ',' || p[i] == '#') {
+            mask |= (uint64_t)1 << i;
+        }
+    }
+    return mask;
+}
+
+#if SIMD_X86
+__attribute__((target("sse4.2")))
+static uint64_t mask_sse42(const char *p, size_t len, size_t avail, size_t *done) {
+    const __m128i set = _mm_setr_epi8(',', '#', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    uint64_t mask = 0;
+    size_t i;
+
+    /* Explicit lengths (cmpestrm), so a '\0' in the data ends nothing */
+    for (i = 0; i < len && i + 16 <= avail; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i hits = _mm_cmpestrm(set, 2, block, 16,
+                                    _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+        mask |= (uint64_t)(uint32_t)_mm_cvtsi128_si32(hits) << i;
+    }
+    *done = i;
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t mask_avx2(const char *p, size_t len, size_t avail, size_t *done) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i hash = _mm256_set1_epi8('#');
+    uint64_t mask = 0;
+    size_t i;
+
+    for (i = 0; i < len && i + 32 <= avail; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(block, comma),
+                                       _mm256_cmpeq_epi8(block, hash));
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(hits) << i;
+    }
+    *done = i;
+    return mask;
+}
+#endif
+
+/* ============================================================
+ * FUNCTION: simd_delimiter_mask
+ * ============================================================
+ */
+uint64_t simd_delimiter_mask(int level, const char *p, size_t len, size_t avail) {
+    uint64_t mask = 0;
+    size_t done = 0;
+
+#if SIMD_X86
+    if (level == SIMD_AVX2) {
+        mask = mask_avx2(p, len, avail, &done);
+    } else if (level == SIMD_SSE42) {
+        mask = mask_sse42(p, len, avail, &done);
+    }
+#else
+    (void)level;
+    (void)avail;
+#endif
+
+    /* Whole blocks may run past len: keep only bits below len */
+    if (len < SIMD_MASK_BYTES) {
+        mask &= ((uint64_t)1 << len) - 1;
+    }
+    return mask | mask_scalar(p, done, len);
+}
+
+/* ============================================================
+ * FUNCTION: simd_parse_date
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - One compare checks the punctuation, one min/compare checks that
+ *   the eight digit positions hold '0'..'9'
+ * - _mm_maddubs_epi16 multiplies bytes by weights and adds neighbours:
+ *   "20","24" -> 20, 24;  _mm_madd_epi16 then gives 20 * 100 + 24
+ * - The month digits sit at odd/even positions 5 and 6, so they get
+ *   weights 10 and 1 in different pairs and are added in the second step
+ */
+#if SIMD_X86
+__attribute__((target("sse4.2")))
+static int parse_date_sse42(const char *p, int *year, int *month, int *day) {
+    const __m128i punctuation = _mm_setr_epi8(0, 0, 0, 0, '-', 0, 0, '-', 0, 0, '|',
+                                              0, 0, 0, 0, 0);
+    const __m128i byte_weights = _mm_setr_epi8(10, 1, 10, 1, 0, 10, 1, 0, 10, 1,
+                                               0, 0, 0, 0, 0, 0);
+    const __m128i pair_weights = _mm_setr_epi16(100, 1, 1, 1, 1, 0, 0, 0);
+    __m128i text = _mm_loadu_si128((const __m128i *)p);
+    __m128i digits = _mm_sub_epi8(text, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    int digit_bits = _mm_movemask_epi8(is_digit);
+    int punct_bits = _mm_movemask_epi8(_mm_cmpeq_epi8(text, punctuation));
+    __m128i pairs, values;
+
+    /* Digits at 0-3, 5-6, 8-9; '-' at 4 and 7; '|' at 10 */
+    if ((digit_bits & 0x36F) != 0x36F || (punct_bits & 0x490) != 0x490) {
+        return 0;
+    }
+
+    pairs = _mm_maddubs_epi16(digits, byte_weights);
+    values = _mm_madd_epi16(pairs, pair_weights);
+    *year = _mm_cvtsi128_si32(values);
+    *month = _mm_extract_epi32(values, 1);
+    *day = _mm_extract_epi32(values, 2);
+    return 1;
+}
+#endif
+
+int simd_parse_date(const char *p, int *year, int *month, int *day) {
+#if SIMD_X86
+    return parse_date_sse42(p, year, month, day);
+#else
+    (void)p;
+    (void)year;
+    (void)month;
+    (void)day;
+    return 0;
+#endif
+}
@@ -0,0 +1,74 @@
+/*
+ * simd_scan.h - Vectorized helpers for the text record tokenizer
+ *
+ * This file contains:
+ * - The instruction set levels the tokenizer can use
+ * - A function that picks the best level for the running CPU
+ * - Delimiter search and date parsing for the vector levels
+ *
+ * Learning Concepts:
+ * - SIMD: one instruction compares 16 (SSE) or 32 (AVX2) bytes at once
+ * - Runtime dispatch: the same binary runs on every x86-64 CPU and only
+ *   uses AVX2 where the CPU has it
+ * - A scalar fallback that gives exactly the same results, for other
+ *   CPUs and for checking the vector code
+ *
+ * Typical use (record_reader.c):
+ *   int level = simd_level();
+ *   if (level != SIMD_SCALAR && simd_parse_date(line, &y, &m, &d)) {
+ *       uint64_t mask = simd_delimiter_mask(level, line, len, avail);
+ *       ...
+ *   }
+ */
+
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ========== CONSTANTS ========== */
+#define SIMD_SCALAR  0   /* plain C, any CPU */
+#define SIMD_SSE42   1   /* x86 with SSE4.2 */
+#define SIMD_AVX2    2   /* x86 with AVX2 (and SSE4.2) */
+
+#define SIMD_MASK_BYTES 64   /* simd_delimiter_mask() covers this many bytes */
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * simd_level
+ *
+ * The best level the CPU supports, decided once per process.
+ * The environment variable HW2_SIMD ("scalar", "sse4.2" or "avx2")
+ * can lower it, e.g. to compare the paths or to benchmark them.
+ */
+int simd_level(void);
+
+/*
+ * simd_level_name
+ *
+ * "scalar", "sse4.2" or "avx2".
+ */
+const char *simd_level_name(int level);
+
+/*
+ * simd_delimiter_mask
+ *
+ * Bit i of the result is set if p[i] is ',' or '#', for i < len
+ * (len <= SIMD_MASK_BYTES). avail is how many bytes may be read from
+ * p; blocks that do not fit are checked one byte at a time.
+ */
+uint64_t simd_delimiter_mask(int level, const char *p, size_t len, size_t avail);
+
+/*
+ * simd_parse_date
+ *
+ * If the 16 bytes at p start with "yyyy-mm-dd|" (digits exactly
+ * there), stores the date and returns 1. Returns 0 for anything else;
+ * the caller then parses the line the slow way. At least 16 bytes
+ * must be readable at p. Only for levels other than SIMD_SCALAR.
+ */
+int simd_parse_date(const char *p, int *year, int *month, int *day);
+
+#endif /* SIMD_SCAN_H */
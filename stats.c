@@ -0,0 +1,149 @@
+/*
+ * stats.c - Where the time goes: per-phase counters for every query
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Conditional compilation - with HW2_STATS off, the STATS_* macros
+ *    in stats.h are empty and this file only keeps zeros
+ * 2. _Thread_local (C11) - one set of counters per thread; a helper
+ *    thread hands its counters to the thread that joins it, so a
+ *    query's counters end up on the thread that made the call and
+ *    concurrent calls never mix
+ * 3. rdtsc - reading the time stamp counter costs a few nanoseconds,
+ *    cheap enough to time every record
+ */
+
+/* Needed for clock_gettime() with -std=c17 */
+#define _GNU_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "hw2.h"
+#include "stats.h"
+
+#if HW2_STATS && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STATS_TSC 1
+#include <x86intrin.h>
+#else
+#define STATS_TSC 0
+#endif
+
+/* ========== STATE ========== */
+#if HW2_STATS
+_Thread_local Hw2Stats stats_local;
+#endif
+
+static const char *phase_names[STATS_PHASES] = {
+    "open", "read", "parse", "validate", "aggregate", "write"
+};
+static const char *reject_names[REJECT_REASONS] = {
+    "malformed", "bad_date", "bad_stats"
+};
+static const char *syscall_names[SYSCALL_KINDS] = {
+    "open", "read", "pread", "mmap", "write", "rename"
+};
+
+/* ============================================================
+ * FUNCTION: stats_ticks / stats_tick_unit
+ * ============================================================
+ */
+#if HW2_STATS
+uint64_t stats_ticks(void) {
+#if STATS_TSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+#endif
+
+const char *stats_tick_unit(void) {
+    return STATS_TSC ? "tsc" : "ns";
+}
+
+/* ============================================================
+ * FUNCTIONS: stats_flush / stats_absorb / stats_reset / stats_collect
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - No lock: a helper thread writes *into just before it ends, and
+ *   its joiner reads it only after pthread_join(), which orders the
+ *   two
+ */
+#if HW2_STATS
+static void add_counters(Hw2Stats *into, const Hw2Stats *from) {
+    for (int i = 0; i < STATS_PHASES; i++) {
+        into->ticks[i] += from->ticks[i];
+    }
+    for (int i = 0; i < REJECT_REASONS; i++) {
+        into->rejected[i] += from->rejected[i];
+    }
+    for (int i = 0; i < SYSCALL_KINDS; i++) {
+        into->syscalls[i] += from->syscalls[i];
+    }
+    into->bytes += from->bytes;
+    into->records += from->records;
+    into->bytes_written += from->bytes_written;
+}
+#endif
+
+void stats_flush(Hw2Stats *into) {
+#if HW2_STATS
+    add_counters(into, &stats_local);
+    memset(&stats_local, 0, sizeof(stats_local));
+#else
+    (void)into;
+#endif
+}
+
+void stats_absorb(Hw2Stats *from) {
+#if HW2_STATS
+    add_counters(&stats_local, from);
+    memset(from, 0, sizeof(*from));
+#else
+    (void)from;
+#endif
+}
+
+void stats_reset(void) {
+#if HW2_STATS
+    memset(&stats_local, 0, sizeof(stats_local));
+#endif
+}
+
+void stats_collect(Hw2Stats *out) {
+    memset(out, 0, sizeof(*out));
+#if HW2_STATS
+    *out = stats_local;
+    out->enabled = 1;
+#endif
+}
+
+/* ============================================================
+ * FUNCTION: stats_write_json
+ * ============================================================
+ */
+static void write_group(FILE *fp_out, const char *name, const char **keys,
+                        const uint64_t *values, int count) {
+    fprintf(fp_out, ", \"%s\": {", name);
+    for (int i = 0; i < count; i++) {
+        fprintf(fp_out, "%s\"%s\": %llu", i ? ", " : "", keys[i], (unsigned long long)values[i]);
+    }
+    fprintf(fp_out, "}");
+}
+
+int stats_write_json(const Hw2Stats *s, FILE *fp_out) {
+    fprintf(fp_out, "{\"enabled\": %s, \"tick_unit\": \"%s\"",
+            s->enabled ? "true" : "false", stats_tick_unit());
+    write_group(fp_out, "ticks", phase_names, s->ticks, STATS_PHASES);
+    fprintf(fp_out, ", \"bytes\": %llu, \"records\": %llu, \"bytes_written\": %llu",
+            (unsigned long long)s->bytes, (unsigned long long)s->records,
+            (unsigned long long)s->bytes_written);
+    write_group(fp_out, "rejected", reject_names, s->rejected, REJECT_REASONS);
+    write_group(fp_out, "syscalls", syscall_names, s->syscalls, SYSCALL_KINDS);
+    fprintf(fp_out, "}\n");
+    return ferror(fp_out) ? FILE_WRITE_ERR : SUCCESS;
+}
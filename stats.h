@@ -0,0 +1,161 @@
+/*
+ * stats.h - Where the time goes: per-phase counters for every query
+ *
+ * This file contains:
+ * - The Hw2Stats structure (time per phase, records, rejects, syscalls)
+ * - STATS_* macros for the hot paths, which compile to nothing unless
+ *   the program is built with "make STATS=1" (-DHW2_STATS=1)
+ * - hw2_last_stats() and a JSON writer
+ *
+ * Learning Concepts:
+ * - Measuring without changing what is measured: the default build
+ *   has no counters at all, so it pays nothing
+ * - The CPU's time stamp counter (rdtsc) as a cheap clock
+ * - Thread-local counters: each thread adds to its own copy, so
+ *   threads never share a hot cache line. A helper thread hands its
+ *   copy in once, to the thread that joins it (stats_flush,
+ *   stats_absorb): every query's counters end up on the thread that
+ *   called it, and two concurrent calls never mix
+ *
+ * Typical use (after "make clean && make STATS=1"):
+ *   purdue_best_month("game_data.txt");
+ *   Hw2Stats s = hw2_last_stats();
+ *   stats_write_json(&s, stdout);
+ *
+ * Phases:
+ *   open      - reader_open(): open(), fstat(), mmap(), format checks
+ *   read      - getting more input: read(), or waiting for the
+ *               decompression thread (input_source.h)
+ *   parse     - splitting a line into fields
+ *   validate  - is_valid_date() and the non-negative stat checks
+ *   aggregate - plan_feed(): routing the record to its queries
+ *   write     - write() / rename() of output files (output_writer.h)
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* ========== CONSTANTS ========== */
+
+/* Phases (Hw2Stats.ticks) */
+#define STATS_OPEN      0
+#define STATS_READ      1
+#define STATS_PARSE     2
+#define STATS_VALIDATE  3
+#define STATS_AGGREGATE 4
+#define STATS_WRITE     5
+#define STATS_PHASES    6
+
+/* Why a record was rejected (Hw2Stats.rejected) */
+#define REJECT_MALFORMED 0           /* BAD_RECORD: not date|name,team#pts,... */
+#define REJECT_BAD_DATE  1           /* BAD_DATE */
+#define REJECT_BAD_STATS 2           /* BAD_RECORD: negative stats, minutes <= 0 */
+#define REJECT_REASONS   3
+
+/* System calls (Hw2Stats.syscalls) */
+#define SYSCALL_OPEN   0
+#define SYSCALL_READ   1
+#define SYSCALL_PREAD  2
+#define SYSCALL_MMAP   3
+#define SYSCALL_WRITE  4
+#define SYSCALL_RENAME 5
+#define SYSCALL_KINDS  6
+
+/* ========== TYPES ========== */
+
+/*
+ * Counters of one hw2.h call. In a build without HW2_STATS everything
+ * is 0 and enabled is 0.
+ */
+typedef struct {
+    int enabled;                         /* built with HW2_STATS */
+    uint64_t ticks[STATS_PHASES];        /* stats_tick_unit() per phase */
+    uint64_t bytes;                      /* bytes of the text lines parsed */
+    uint64_t records;                    /* records that passed validation */
+    uint64_t rejected[REJECT_REASONS];
+    uint64_t syscalls[SYSCALL_KINDS];
+    uint64_t bytes_written;
+} Hw2Stats;
+
+/* ========== HOT PATH MACROS ========== */
+#if HW2_STATS
+
+extern _Thread_local Hw2Stats stats_local;   /* this thread's counters */
+uint64_t stats_ticks(void);
+
+#define STATS_START(var)        uint64_t var = stats_ticks()
+#define STATS_STOP(phase, var)  (stats_local.ticks[(phase)] += stats_ticks() - (var))
+#define STATS_ADD(field, n)     (stats_local.field += (uint64_t)(n))
+#define STATS_COUNT(array, i)   (stats_local.array[(i)]++)
+#define STATS_FLUSH(into)       stats_flush(into)
+
+#else
+
+#define STATS_START(var)        ((void)0)
+#define STATS_STOP(phase, var)  ((void)0)
+#define STATS_ADD(field, n)     ((void)0)
+#define STATS_COUNT(array, i)   ((void)0)
+#define STATS_FLUSH(into)       ((void)0)
+
+#endif
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * stats_flush / stats_absorb
+ *
+ * stats_flush() adds the calling thread's counters to *into and
+ * clears them. Threads that count call it before they end, into a
+ * Hw2Stats their joiner owns: a scan worker into its worker plan
+ * (plan_merge() and plan_discard() absorb it), the output writer
+ * into its OutputWriter (writer_finish()), decompression into its
+ * InputSource (source_close()).
+ *
+ * stats_absorb() adds *from to the calling thread's counters and
+ * clears it; call it only after joining the thread that flushed.
+ */
+void stats_flush(Hw2Stats *into);
+void stats_absorb(Hw2Stats *from);
+
+/*
+ * stats_reset / stats_collect
+ *
+ * stats_reset() clears the calling thread's counters; stats_collect()
+ * copies them. hw2.c calls them around every query. Every runner
+ * joins its helper threads (plan_end() the writer) before it returns,
+ * so by then their counters are the calling thread's too.
+ */
+void stats_reset(void);
+void stats_collect(Hw2Stats *out);
+
+/*
+ * stats_tick_unit
+ *
+ * "tsc" (CPU time stamp counter cycles) or "ns".
+ */
+const char *stats_tick_unit(void);
+
+/*
+ * stats_write_json
+ *
+ * Writes s as one JSON object (and a newline) to fp_out.
+ * Returns SUCCESS or FILE_WRITE_ERR.
+ */
+int stats_write_json(const Hw2Stats *s, FILE *fp_out);
+
+/*
+ * hw2_last_stats
+ *
+ * Purpose: The counters of the calling thread's most recent hw2.h
+ *          query function, next to its result (like
+ *          hw2_last_parse_error)
+ *
+ * Returns:
+ *   A Hw2Stats; all zero (enabled = 0) unless built with STATS=1
+ */
+Hw2Stats hw2_last_stats(void);
+
+#endif /* STATS_H */
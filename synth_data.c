@@ -0,0 +1,295 @@
+/*
+ * synth_data.c - Deterministic synthetic game data for benchmarks
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. splitmix64: a tiny, well-mixed pseudo-random generator whose
+ *    output depends only on the seed (rand() differs between libcs)
+ * 2. Formatting lines into a 1 MiB buffer and writing it with one
+ *    fwrite() per megabyte
+ * 3. Partial Fisher-Yates shuffle to pick distinct players
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "hw2.h"
+#include "synth_data.h"
+
+/* ========== CONSTANTS ========== */
+#define SYNTH_BUFFER_SIZE (1 << 20)
+#define SYNTH_LINE_MAX    256
+#define SYNTH_MIN_ROWS    5      /* rows per team per game */
+#define SYNTH_MAX_ROWS    10
+#define SYNTH_DAYS        360    /* days of a season: one game a day */
+#define SYNTH_LAST_YEAR   9999   /* four-digit years only */
+#define SYNTH_MIN_LINE    39     /* shortest valid line, with its '\n' */
+#define SYNTH_MAX_SCALE   10000  /* rows per team grow at most this much */
+
+/* ============================================================
+ * HELPER FUNCTIONS: Random numbers
+ * ============================================================
+ */
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/* Uniform in [0, n) */
+static int random_below(uint64_t *state, int n) {
+    return (int)(next_random(state) % (uint64_t)n);
+}
+
+/* Uniform in [0, 1) */
+static double random_unit(uint64_t *state) {
+    return (double)(next_random(state) >> 11) / 9007199254740992.0;
+}
+
+/* ============================================================
+ * HELPER FUNCTIONS: Names
+ * ============================================================
+ */
+static void team_name(int team, char *out, size_t size) {
+    if (team == 0) {
+        snprintf(out, size, "Purdue");
+    } else {
+        snprintf(out, size, "Team %d", team);
+    }
+}
+
+static void player_name(int team, int player, char *out, size_t size) {
+    if (team == 0 && player == 0) {
+        snprintf(out, size, "Z. Edey");
+    } else {
+        snprintf(out, size, "%c. Player%d-%d", 'A' + player % 26, team, player);
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: damage_line
+ * ============================================================
+ * Turns a valid line (without '\n') into one the reader rejects.
+ * Returns the new length.
+ */
+static int damage_line(char *line, int len, uint64_t *state) {
+    char *p;
+
+    switch (random_below(state, 4)) {
+        case 0:                                  /* missing field */
+            p = strrchr(line, ',');
+            memmove(p, p + 1, (size_t)(line + len - p));
+            return len - 1;
+        case 1:                                  /* month 13 */
+            line[5] = '1';
+            line[6] = '3';
+            return len;
+        case 2:                                  /* negative points */
+            p = strchr(line, '#');
+            memmove(p + 2, p + 1, (size_t)(line + len - p));
+            p[1] = '-';
+            return len + 1;
+        default:                                 /* cut short */
+            return len / 2;
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: pick_scale
+ * ============================================================
+ * With a size target, the number k by which rows per team in a game
+ * (and, past 1, the rosters) are multiplied: the smallest k for which
+ * even the shortest rows reach the target by the year 9999. k = 1
+ * writes exactly what an untargeted run would. Returns 0 if no k up to
+ * SYNTH_MAX_SCALE is enough.
+ */
+static int roster_size(const SynthOptions *opt, int scale) {
+    if (scale > 1 && opt->players < SYNTH_MAX_ROWS * scale) {
+        return SYNTH_MAX_ROWS * scale;
+    }
+    return opt->players;
+}
+
+static int pick_scale(const SynthOptions *opt, int games) {
+    double years = (double)(SYNTH_LAST_YEAR - opt->first_year + 1);
+    /* A damaged line can be cut to half its length */
+    double line = SYNTH_MIN_LINE * (1.0 - opt->corrupt_rate / 2.0);
+
+    if (opt->size <= 0) {
+        return 1;
+    }
+    for (int scale = 1; scale <= SYNTH_MAX_SCALE; scale++) {
+        int rows = SYNTH_MIN_ROWS * scale;
+
+        if (rows > roster_size(opt, scale)) {
+            rows = roster_size(opt, scale);
+        }
+        if (years * games * 2 * rows * line >= (double)opt->size) {
+            return scale;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================
+ * FUNCTION: synth_defaults
+ * ============================================================
+ */
+void synth_defaults(SynthOptions *opt) {
+    opt->seed = 1;
+    opt->first_year = 2021;
+    opt->seasons = 4;
+    opt->teams = 14;
+    opt->players = 15;
+    opt->games = 300;
+    opt->corrupt_rate = 0.0;
+    opt->size = 0;
+}
+
+/* ============================================================
+ * FUNCTION: synth_write
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - Game g of a season gets day g * 360 / games: dates never go
+ *   backwards, and seasons with more than 360 games share dates
+ * - A date is one match to the hw2.h functions, so a size target is
+ *   reached with more seasons, never with more than 360 games a
+ *   season. Years only have four digits: when the seasons up to 9999
+ *   are not enough, every game gets more rows per team instead (and
+ *   the rosters more players, so nobody plays twice in one game).
+ *   Writing stops once the target is reached
+ * - Everything random comes from one state, so output is repeatable
+ */
+int synth_write(const SynthOptions *opt, const char *out_file, SynthStats *stats) {
+    SynthStats done = { 0, 0, 0, 0 };
+    uint64_t state = opt->seed;
+    FILE *fp_out;
+    char *buffer;
+    size_t used = 0;
+    int *roster;
+    int games = opt->games;
+    int scale, players;
+    int status = SUCCESS;
+
+    if (opt->teams < 2 || opt->players < 1 || opt->games < 1 || opt->first_year < 1 ||
+        (opt->size <= 0 && opt->seasons < 1) ||
+        opt->corrupt_rate < 0.0 || opt->corrupt_rate > 1.0) {
+        return BAD_RECORD;
+    }
+    if (opt->size > 0 && games > SYNTH_DAYS) {
+        games = SYNTH_DAYS;
+    }
+    scale = pick_scale(opt, games);
+    if (scale == 0) {
+        return BAD_RECORD;  /* too big even with SYNTH_MAX_SCALE */
+    }
+    players = roster_size(opt, scale);
+
+    fp_out = strcmp(out_file, "-") == 0 ? stdout : fopen(out_file, "w");
+    if (fp_out == NULL) {
+        return FILE_WRITE_ERR;
+    }
+
+    buffer = malloc(SYNTH_BUFFER_SIZE);
+    roster = malloc((size_t)players * sizeof(int));
+    if (buffer == NULL || roster == NULL) {
+        free(buffer);
+        free(roster);
+        if (fp_out != stdout) {
+            fclose(fp_out);
+        }
+        return NO_MEMORY;
+    }
+
+    for (int season = 0; status == SUCCESS; season++) {
+        int year = opt->first_year + season;
+
+        if (opt->size > 0 ? done.bytes >= opt->size : season == opt->seasons) {
+            break;
+        }
+        if (year > SYNTH_LAST_YEAR) {
+            break;  /* four-digit years only */
+        }
+        done.seasons++;
+
+        for (int g = 0; g < games && status == SUCCESS; g++) {
+            int date = (int)((long long)g * SYNTH_DAYS / games);
+            int teams[2];
+
+            if (opt->size > 0 && done.bytes >= opt->size) {
+                break;
+            }
+            teams[0] = random_below(&state, opt->teams);
+            teams[1] = (teams[0] + 1 + random_below(&state, opt->teams - 1)) % opt->teams;
+
+            for (int side = 0; side < 2; side++) {
+                int rows = SYNTH_MIN_ROWS * scale +
+                           random_below(&state, (SYNTH_MAX_ROWS - SYNTH_MIN_ROWS) * scale + 1);
+                char team[32];
+
+                if (rows > players) {
+                    rows = players;
+                }
+                team_name(teams[side], team, sizeof(team));
+                for (int p = 0; p < players; p++) {
+                    roster[p] = p;
+                }
+
+                for (int r = 0; r < rows; r++) {
+                    int pick = r + random_below(&state, players - r);
+                    int player = roster[pick];
+                    char name[48];
+                    char line[SYNTH_LINE_MAX];
+                    int len;
+
+                    roster[pick] = roster[r];
+                    roster[r] = player;
+                    player_name(teams[side], player, name, sizeof(name));
+
+                    len = snprintf(line, sizeof(line), "%04d-%02d-%02d|%s,%s#%d,%d,%d,%d.%d",
+                                   year, date / 30 + 1, date % 30 + 1, name, team,
+                                   random_below(&state, 31), random_below(&state, 11),
+                                   random_below(&state, 6), 1 + random_below(&state, 40),
+                                   random_below(&state, 10));
+                    if (opt->corrupt_rate > 0.0 && random_unit(&state) < opt->corrupt_rate) {
+                        len = damage_line(line, len, &state);
+                        done.corrupt_lines++;
+                    }
+                    line[len++] = '\n';
+
+                    if (used + (size_t)len > SYNTH_BUFFER_SIZE) {
+                        if (fwrite(buffer, 1, used, fp_out) != used) {
+                            status = FILE_WRITE_ERR;
+                        }
+                        used = 0;
+                    }
+                    memcpy(buffer + used, line, (size_t)len);
+                    used += (size_t)len;
+                    done.lines++;
+                    done.bytes += len;
+                }
+            }
+        }
+    }
+
+    if (status == SUCCESS && fwrite(buffer, 1, used, fp_out) != used) {
+        status = FILE_WRITE_ERR;
+    }
+    free(buffer);
+    free(roster);
+    if (fp_out == stdout) {
+        if (fflush(fp_out) != 0) {
+            status = FILE_WRITE_ERR;
+        }
+    } else if (fclose(fp_out) != 0) {
+        status = FILE_WRITE_ERR;
+    }
+
+    if (status == SUCCESS && stats != NULL) {
+        *stats = done;
+    }
+    return status;
+}
@@ -0,0 +1,85 @@
+/*
+ * synth_data.h - Deterministic synthetic game data for benchmarks
+ *
+ * This file contains:
+ * - The SynthOptions structure (how big, how many teams, ...)
+ * - A function that writes a game data file from those options
+ *
+ * Learning Concepts:
+ * - Pseudo-random numbers from a seed: the same options always give
+ *   the same bytes, on any machine
+ * - Generating large files through one big output buffer
+ * - Damaging a controlled fraction of lines to test error paths
+ *
+ * Typical use:
+ *   SynthOptions opt;
+ *   synth_defaults(&opt);
+ *   opt.size = 100LL << 20;               // about 100 MB
+ *   synth_write(&opt, "bench_data.txt", NULL);
+ */
+
+#ifndef SYNTH_DATA_H
+#define SYNTH_DATA_H
+
+#include <stdint.h>
+#include "hw2.h"
+
+/* ========== TYPES ========== */
+
+typedef struct {
+    uint64_t seed;
+    int first_year;              /* first season's year */
+    int seasons;                 /* number of seasons (when size is 0) */
+    int teams;                   /* >= 2; team 0 is "Purdue" */
+    int players;                 /* roster size of each team (>= 1) */
+    int games;                   /* games per season (at most 360 with a size) */
+    double corrupt_rate;         /* fraction of lines damaged, 0 to 1 */
+    long long size;              /* if > 0: keep adding seasons until
+                                    the file has at least this many bytes;
+                                    if the seasons up to 9999 are too few,
+                                    games get more rows (see synth_write) */
+} SynthOptions;
+
+/* What synth_write() produced */
+typedef struct {
+    long long lines;
+    long long bytes;
+    long long corrupt_lines;
+    int seasons;
+} SynthStats;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * synth_defaults
+ *
+ * seed 1, 4 seasons from 2021, 14 teams of 15 players,
+ * 300 games per season, no corruption, no size target.
+ */
+void synth_defaults(SynthOptions *opt);
+
+/*
+ * synth_write
+ *
+ * Writes a game data file ("-" = standard output). Within a season
+ * games are in date order; each game has two teams and 5 to 10 rows
+ * per team. Team 0 is "Purdue" and its first player is "Z. Edey", so
+ * the hw2.h functions have something to find.
+ *
+ * Damaged lines (corrupt_rate) have a missing field, an invalid
+ * month, a negative stat or are cut short.
+ *
+ * With a size target, seasons have at most 360 games (a date is one
+ * match). If even the shortest possible rows would not reach size by
+ * the year 9999, each game gets k times the rows per team (5k to 10k)
+ * and rosters of at least 10k players, for the smallest k that does:
+ * a few GB from 2021 keep the usual 5 to 10 rows, tens of GB get more.
+ *
+ * Returns:
+ *   SUCCESS, FILE_WRITE_ERR, or BAD_RECORD if an option is out of range
+ *   or size cannot be reached (k would exceed 10000); nothing is
+ *   written then. stats, if not NULL, is filled in on SUCCESS.
+ */
+int synth_write(const SynthOptions *opt, const char *out_file, SynthStats *stats);
+
+#endif /* SYNTH_DATA_H */
@@ -0,0 +1,446 @@
+/*
+ * team_table.c - Season results for every team from one scan
+ *
+ * KEY CONCEPTS DEMONSTRATED:
+ * 1. Hash aggregation: each record's team is looked up once (or read
+ *    as a dictionary id from a column file) and its points are added
+ *    to that team's bucket
+ * 2. A match only has a few teams, so the teams of the open match are
+ *    a short list searched linearly
+ * 3. One team's score decides its result: the opponents scored
+ *    everything else (match total - team score)
+ *
+ * The per-team answers follow query_plan.c exactly: matches are runs
+ * of same-date records, a team with no rows in a match scored 0 in
+ * it, and every match counts towards every team's games per month.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "hw2.h"
+#include "intern.h"
+#include "output_writer.h"
+#include "record_reader.h"
+#include "team_table.h"
+
+/* ============================================================
+ * HELPER FUNCTIONS: Growing arrays
+ * ============================================================
+ * Grows array (by doubling) until it holds at least `needed`
+ * elements. realloc() keeps the old array if it fails.
+ */
+#define RESERVE(array, capacity, needed) do { \
+        if ((needed) > (capacity)) { \
+            uint32_t new_capacity = (capacity) ? (capacity) * 2 : 16; \
+            void *grown; \
+            while (new_capacity < (needed)) { \
+                new_capacity *= 2; \
+            } \
+            grown = realloc((array), (size_t)new_capacity * sizeof(*(array))); \
+            if (grown == NULL) { \
+                return NO_MEMORY; \
+            } \
+            (array) = grown; \
+            (capacity) = new_capacity; \
+        } \
+    } while (0)
+
+/* The match being read: one entry per team with rows in it */
+typedef struct {
+    int year, month, day;        /* -1 before the first record */
+    int total;
+    TeamScore *teams;
+    uint32_t count, capacity;
+} OpenMatch;
+
+/* Adds points to team's entry in the open match, adding the entry if needed */
+static int add_points(OpenMatch *open, uint32_t team, int points) {
+    for (uint32_t i = 0; i < open->count; i++) {
+        if (open->teams[i].team == team) {
+            open->teams[i].points += points;
+            return SUCCESS;
+        }
+    }
+    RESERVE(open->teams, open->capacity, open->count + 1);
+    open->teams[open->count].team = team;
+    open->teams[open->count].points = points;
+    open->count++;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: add_team
+ * ============================================================
+ * Team name -> id; a new team gets zeroed totals.
+ */
+static int add_team(TeamTable *tt, const char *name, size_t len, uint32_t *id) {
+    uint32_t before = tt->teams.count;
+
+    if (intern_add(&tt->teams, name, len, id) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    if (tt->teams.count != before) {
+        RESERVE(tt->totals, tt->totals_capacity, tt->teams.count);
+        memset(&tt->totals[*id], 0, sizeof(TeamTotals));
+    }
+    return SUCCESS;
+}
+
+/*
+ * Column files name each team once: map dictionary ids to table ids
+ * up front, so rows need no hashing at all.
+ */
+static int map_dictionary(TeamTable *tt, const RecordReader *rd, uint32_t **map) {
+    uint32_t count = reader_name_count(rd, READER_TEAMS);
+
+    *map = NULL;
+    if (count == 0) {
+        return SUCCESS;
+    }
+    *map = malloc((size_t)count * sizeof(uint32_t));
+    if (*map == NULL) {
+        return NO_MEMORY;
+    }
+    for (uint32_t id = 0; id < count; id++) {
+        size_t len;
+        const char *name = reader_name(rd, READER_TEAMS, id, &len);
+
+        if (add_team(tt, name, len, &(*map)[id]) != SUCCESS) {
+            return NO_MEMORY;
+        }
+    }
+    return SUCCESS;
+}
+
+/* ============================================================
+ * HELPER FUNCTION: close_match
+ * ============================================================
+ * Best month and best win for every team that played. Teams without
+ * rows scored 0 and cannot have won, but the match still counts as
+ * one of their games (total_games is shared).
+ */
+static void close_match(TeamTable *tt, const OpenMatch *open) {
+    tt->total_games[open->month - 1]++;
+
+    for (uint32_t i = 0; i < open->count; i++) {
+        TeamTotals *t = &tt->totals[open->teams[i].team];
+        int score = open->teams[i].points;
+        int diff = score - (open->total - score);
+
+        if (diff <= 0) {
+            continue;
+        }
+        t->wins[open->month - 1]++;
+        if (open->year == tt->year && open->month == tt->month &&
+            (diff > t->best_difference ||
+             (diff == t->best_difference && score > t->best_score))) {
+            t->best_difference = diff;
+            t->best_score = score;
+            t->found_win = 1;
+        }
+    }
+}
+
+/* ============================================================
+ * HELPER FUNCTION: feed
+ * ============================================================
+ * One record: the shared match (every year) and, for records of the
+ * history year, the history match.
+ */
+static int feed(TeamTable *tt, OpenMatch *open, const GameRecord *rec, uint32_t team) {
+    TeamMatch *m;
+
+    if (rec->year != open->year || rec->month != open->month || rec->day != open->day) {
+        if (open->year != -1) {
+            close_match(tt, open);
+        }
+        open->year = rec->year;
+        open->month = rec->month;
+        open->day = rec->day;
+        open->total = 0;
+        open->count = 0;
+    }
+    open->total += rec->points;
+    if (add_points(open, team, rec->points) != SUCCESS) {
+        return NO_MEMORY;
+    }
+
+    if (rec->year != tt->year) {
+        return SUCCESS;
+    }
+    m = tt->match_count > 0 ? &tt->matches[tt->match_count - 1] : NULL;
+    if (m == NULL || m->month != rec->month || m->day != rec->day) {
+        RESERVE(tt->matches, tt->match_capacity, tt->match_count + 1);
+        m = &tt->matches[tt->match_count++];
+        m->month = rec->month;
+        m->day = rec->day;
+        m->total = 0;
+        m->first_team = team;
+        m->second_team = TEAM_NONE;
+        m->scores_start = tt->score_count;
+        m->scores_count = 0;
+    }
+    m->total += rec->points;
+    if (team != m->first_team && m->second_team == TEAM_NONE) {
+        m->second_team = team;
+    }
+
+    /* The match's entries are the last ones in scores[] */
+    for (uint32_t s = m->scores_start; s < tt->score_count; s++) {
+        if (tt->scores[s].team == team) {
+            tt->scores[s].points += rec->points;
+            return SUCCESS;
+        }
+    }
+    RESERVE(tt->scores, tt->score_capacity, tt->score_count + 1);
+    tt->scores[tt->score_count].team = team;
+    tt->scores[tt->score_count].points = rec->points;
+    tt->score_count++;
+    m->scores_count++;
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: team_table_build
+ * ============================================================
+ *
+ * LEARNING POINTS:
+ * - The same RecordReader as every other query; only the date, team
+ *   and points columns are decoded from column files
+ * - Work per record is one lookup and a few additions, however many
+ *   teams the file has
+ */
+int team_table_build(TeamTable *tt, const char *in_file, int year, int month, ParseError *err) {
+    RecordReader rd;
+    GameRecord rec;
+    OpenMatch open;
+    uint32_t *names = NULL;
+    int status;
+
+    memset(tt, 0, sizeof(*tt));
+    tt->year = year;
+    tt->month = month;
+    if (err != NULL) {
+        err->code = SUCCESS;
+        err->line = 0;
+        err->offset = 0;
+    }
+    if (year <= 0 || month < 1 || month > 12) {
+        return BAD_DATE;
+    }
+
+    status = reader_open(&rd, in_file);
+    if (status != SUCCESS) {
+        return status;
+    }
+    reader_set_fields(&rd, FIELD_DATE | FIELD_TEAM | FIELD_POINTS);
+    memset(&open, 0, sizeof(open));
+    open.year = -1;
+
+    status = intern_init(&tt->teams);
+    if (status == SUCCESS) {
+        status = map_dictionary(tt, &rd, &names);
+    }
+    if (status == SUCCESS) {
+        while ((status = reader_next(&rd, &rec)) == RECORD_OK) {
+            uint32_t team;
+
+            if (names != NULL) {
+                team = names[rec.team_id];
+            } else if (add_team(tt, rec.team, rec.team_len, &team) != SUCCESS) {
+                status = NO_MEMORY;
+                break;
+            }
+            if (feed(tt, &open, &rec, team) != SUCCESS) {
+                status = NO_MEMORY;
+                break;
+            }
+        }
+    }
+
+    if (status == RECORD_EOF) {
+        status = SUCCESS;
+        if (open.year != -1) {
+            close_match(tt, &open);
+        }
+    } else if (status != NO_MEMORY && err != NULL) {
+        err->code = status;
+        err->line = rd.err_line;
+        err->offset = rd.err_offset;
+    }
+    free(names);
+    free(open.teams);
+    reader_close(&rd);
+
+    if (status != SUCCESS) {
+        team_table_free(tt);
+    }
+    return status;
+}
+
+/* ============================================================
+ * FUNCTION: team_table_free
+ * ============================================================
+ */
+void team_table_free(TeamTable *tt) {
+    intern_free(&tt->teams);
+    free(tt->totals);
+    free(tt->matches);
+    free(tt->scores);
+    memset(tt, 0, sizeof(*tt));
+}
+
+/* ============================================================
+ * FUNCTIONS: Teams
+ * ============================================================
+ */
+uint32_t team_table_count(const TeamTable *tt) {
+    return tt->teams.count;
+}
+
+const char *team_table_name(const TeamTable *tt, uint32_t team) {
+    return intern_name(&tt->teams, team, NULL);
+}
+
+uint32_t team_table_find(const TeamTable *tt, const char *team) {
+    long id = intern_find(&tt->teams, team, strlen(team));
+    return id < 0 ? TEAM_NONE : (uint32_t)id;
+}
+
+/* ============================================================
+ * FUNCTIONS: Per-team results
+ * ============================================================
+ */
+int team_table_best_month(const TeamTable *tt, uint32_t team) {
+    int best_month = -1;
+    double best_rate = -1.0;
+
+    for (int i = 0; i < 12; i++) {
+        if (tt->total_games[i] > 0) {
+            double rate = (double)tt->totals[team].wins[i] / (double)tt->total_games[i];
+            if (rate > best_rate) {
+                best_rate = rate;
+                best_month = i + 1;
+            }
+        }
+    }
+
+    if (best_month == -1 || best_rate == 0.0) {
+        return NO_DATA_POINTS;
+    }
+    return best_month;
+}
+
+int team_table_best_winning_match_score(const TeamTable *tt, uint32_t team) {
+    return tt->totals[team].found_win ? tt->totals[team].best_score : NO_DATA_POINTS;
+}
+
+/*
+ * The opponent is the team of the first row that is not `team`, and
+ * scored everything `team` did not.
+ */
+int team_table_write_history(const TeamTable *tt, uint32_t team, OutBuf *text) {
+    const char *name = team_table_name(tt, team);
+    int wins = 0, losses = 0;
+
+    if (tt->match_count == 0) {
+        return NO_DATA_POINTS;
+    }
+
+    out_int(text, tt->year);
+    out_char(text, '\n');
+    for (uint32_t i = 0; i < tt->match_count; i++) {
+        const TeamMatch *m = &tt->matches[i];
+        uint32_t opponent = team == m->first_team ? m->second_team : m->first_team;
+        int score = 0;
+
+        for (uint32_t s = m->scores_start; s < m->scores_start + m->scores_count; s++) {
+            if (tt->scores[s].team == team) {
+                score = tt->scores[s].points;
+            }
+        }
+
+        /* MM-DD:Team(score)-Opponent(score) */
+        out_int2(text, m->month);
+        out_char(text, '-');
+        out_int2(text, m->day);
+        out_char(text, ':');
+        out_cstr(text, name);
+        out_char(text, '(');
+        out_int(text, score);
+        out_cstr(text, ")-");
+        out_cstr(text, opponent == TEAM_NONE ? "" : team_table_name(tt, opponent));
+        out_char(text, '(');
+        out_int(text, m->total - score);
+        out_cstr(text, ")\n");
+        if (score > m->total - score) {
+            wins++;
+        } else {
+            losses++;
+        }
+    }
+    out_cstr(text, "Record: ");
+    out_int(text, wins);
+    out_cstr(text, "W-");
+    out_int(text, losses);
+    out_cstr(text, "L\n");
+    return SUCCESS;
+}
+
+/* ============================================================
+ * FUNCTION: team_table_write
+ * ============================================================
+ * Like roster_write(): each team's block is formatted into an OutBuf
+ * and handed to the output writer as one chunk.
+ */
+static void best_win_label(const TeamTable *tt, OutBuf *text) {
+    out_cstr(text, "Best Win (");
+    out_int(text, tt->year);
+    out_char(text, '-');
+    out_int2(text, tt->month);
+    out_cstr(text, "): ");
+}
+
+int team_table_write(const TeamTable *tt, const char *out_file) {
+    OutputWriter w;
+    OutFile *f;
+    OutBuf text;
+    int status;
+
+    if (writer_init(&w, 0) != SUCCESS) {
+        return NO_MEMORY;
+    }
+    status = outfile_open(&w, out_file, &f);
+    if (status == SUCCESS) {
+        outbuf_init(&text);
+        for (uint32_t t = 0; t < team_table_count(tt); t++) {
+            int best_month = team_table_best_month(tt, t);
+            int best_win = team_table_best_winning_match_score(tt, t);
+
+            out_cstr(&text, "Team: ");
+            out_cstr(&text, team_table_name(tt, t));
+            out_cstr(&text, "\nBest Month: ");
+            if (best_month > 0) {
+                out_int(&text, best_month);
+            } else {
+                out_cstr(&text, "none");
+            }
+            out_char(&text, '\n');
+            best_win_label(tt, &text);
+            if (best_win >= 0) {
+                out_int(&text, best_win);
+            } else {
+                out_cstr(&text, "none");
+            }
+            out_char(&text, '\n');
+            team_table_write_history(tt, t, &text);
+            out_char(&text, '\n');
+            outfile_chunk(f, &text);
+        }
+        outfile_close(f, &text);
+        writer_finish(&w);
+        status = outfile_status(f);
+    }
+    writer_free(&w);
+    return status;
+}
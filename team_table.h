@@ -0,0 +1,141 @@
+/*
+ * team_table.h - Season results for every team from one scan
+ *
+ * This file contains:
+ * - The TeamTable structure (per-team totals keyed by team id)
+ * - Functions to fill it from a game data file and read results back
+ *
+ * Learning Concepts:
+ * - Hash aggregation: one pass over the file, one bucket per key
+ *   (team name -> id with an InternTable, id -> totals in an array)
+ * - Deriving the other side of a match from its total
+ *   (opponent score = match total - team score)
+ * - Keeping only what the answers need instead of every record
+ *
+ * Typical use:
+ *   TeamTable tt;
+ *   if (team_table_build(&tt, "conference.txt", 2024, 1, NULL) == SUCCESS) {
+ *       for (uint32_t t = 0; t < team_table_count(&tt); t++) {
+ *           printf("%s: %d\n", team_table_name(&tt, t), team_table_best_month(&tt, t));
+ *       }
+ *       team_table_free(&tt);
+ *   }
+ *
+ * For every team, the results are exactly what team_best_month(),
+ * team_best_winning_match_score() and team_matches_history() (hw2.h)
+ * return for that team - without scanning the file once per team.
+ */
+
+#ifndef TEAM_TABLE_H
+#define TEAM_TABLE_H
+
+#include <stdint.h>
+#include "hw2.h"
+#include "intern.h"
+#include "output_writer.h"
+
+/* ========== CONSTANTS ========== */
+#define TEAM_NONE UINT32_MAX   /* "no team" id */
+
+/* ========== TYPES ========== */
+
+/* Totals of one team (index = team id) */
+typedef struct {
+    int wins[12];                /* matches won, by month (any year) */
+    int best_difference;         /* best win in (year, month) */
+    int best_score;
+    int found_win;
+} TeamTotals;
+
+/* Points one team scored in one match */
+typedef struct {
+    uint32_t team;
+    int points;
+} TeamScore;
+
+/*
+ * A match of the history year: the same grouping as
+ * generate_matches_history() (other years' records are skipped)
+ */
+typedef struct {
+    int month, day;
+    int total;                   /* points of every row */
+    uint32_t first_team;         /* team of the first row */
+    uint32_t second_team;        /* first row of another team, or TEAM_NONE */
+    uint32_t scores_start;       /* scores[scores_start .. + scores_count) */
+    uint32_t scores_count;
+} TeamMatch;
+
+/*
+ * Results of one scan. Treat as private; use the functions below.
+ */
+typedef struct {
+    int year, month;             /* parameters of team_table_build() */
+
+    InternTable teams;           /* team name -> id (order of first row) */
+    TeamTotals *totals;          /* id -> totals */
+    uint32_t totals_capacity;
+    int total_games[12];         /* every match counts for every team */
+
+    TeamMatch *matches;          /* matches of `year`, in file order */
+    uint32_t match_count, match_capacity;
+    TeamScore *scores;
+    uint32_t score_count, score_capacity;
+} TeamTable;
+
+/* ========== FUNCTION PROTOTYPES ========== */
+
+/*
+ * team_table_build
+ *
+ * Reads in_file (text or column file) once and computes, for every
+ * team in it: the best month, the best winning score in (year, month)
+ * and the matches history of year.
+ *
+ * Returns:
+ *   SUCCESS, BAD_DATE (year <= 0 or month outside 1-12),
+ *   FILE_READ_ERR, NO_MEMORY, or the BAD_RECORD / BAD_DATE the hw2.h
+ *   functions would report for this file (err, if not NULL, gets its
+ *   location). On failure there is nothing to free.
+ */
+int team_table_build(TeamTable *tt, const char *in_file, int year, int month, ParseError *err);
+
+/*
+ * team_table_free
+ */
+void team_table_free(TeamTable *tt);
+
+/*
+ * team_table_count / team_table_name / team_table_find
+ *
+ * Teams are numbered 0 .. count-1 in order of first appearance.
+ * team_table_find() returns TEAM_NONE for a team that never plays.
+ */
+uint32_t team_table_count(const TeamTable *tt);
+const char *team_table_name(const TeamTable *tt, uint32_t team);
+uint32_t team_table_find(const TeamTable *tt, const char *team);
+
+/*
+ * Per-team results. Return values are those of team_best_month(),
+ * team_best_winning_match_score() and team_matches_history();
+ * team_table_write_history() appends the history to text.
+ */
+int team_table_best_month(const TeamTable *tt, uint32_t team);
+int team_table_best_winning_match_score(const TeamTable *tt, uint32_t team);
+int team_table_write_history(const TeamTable *tt, uint32_t team, OutBuf *text);
+
+/*
+ * team_table_write
+ *
+ * Writes every team's results to out_file, one block per team:
+ *
+ *   Team: Indiana
+ *   Best Month: 3                (or "none")
+ *   Best Win (2024-01): 81       (or "none")
+ *   <matches history of year, as team_matches_history() writes it>
+ *
+ * Returns: SUCCESS, FILE_WRITE_ERR or NO_MEMORY
+ */
+int team_table_write(const TeamTable *tt, const char *out_file);
+
+#endif /* TEAM_TABLE_H */